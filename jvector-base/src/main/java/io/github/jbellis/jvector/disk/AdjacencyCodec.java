@@ -0,0 +1,201 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.disk;
+
+import io.github.jbellis.jvector.graph.GraphIndex;
+import io.github.jbellis.jvector.pq.PQVectors;
+
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.VarHandle;
+import java.nio.ByteOrder;
+import java.util.Arrays;
+import java.util.function.IntUnaryOperator;
+
+/**
+ * The encoding of adjacency lists in graphs written with compressed adjacency.  The neighbors of a node are
+ * sorted, and stored as
+ * <ul>
+ *     <li>the neighbor count, as a varint</li>
+ *     <li>if there are any neighbors, the first one as a varint, then the number of bits b needed for the
+ *     largest gap between consecutive neighbors as a byte, then the count - 1 gaps in b bits each, packed
+ *     little-endian</li>
+ * </ul>
+ * After renumbering (breadth-first in particular) neighbors are close to each other, so a list usually takes a
+ * byte or two per neighbor instead of four, and there is no padding out to the max degree.
+ * <p>
+ * Every gap has the same width, so unpacking them is a fixed-stride loop with no data-dependent branches,
+ * and only the final prefix sum is sequential.  The loop reads a whole long per gap, so a buffer that is decoded
+ * from must have {@link #PADDING} bytes to spare after the encoding.
+ */
+final class AdjacencyCodec {
+    private static final VarHandle LONG_LE = MethodHandles.byteArrayViewVarHandle(long[].class, ByteOrder.LITTLE_ENDIAN);
+
+    /** the bytes that decode may read past the end of an encoding */
+    static final int PADDING = Long.BYTES;
+
+    private AdjacencyCodec() {
+    }
+
+    /**
+     * @return an upper bound on the encoded size of a list of at most `maxDegree` neighbors
+     */
+    static int maxEncodedSize(int maxDegree) {
+        // count and first neighbor as varints of at most 5 bytes, the width, and gaps of at most 31 bits
+        return 5 + 5 + 1 + (int) (((long) Math.max(0, maxDegree - 1) * 31 + 7) / Byte.SIZE);
+    }
+
+    /**
+     * Encodes the first `count` entries of `neighbors`, which must be sorted, into `dest` at `offset`.
+     *
+     * @return the number of bytes written
+     */
+    static int encode(int[] neighbors, int count, byte[] dest, int offset) {
+        int pos = writeVarInt(count, dest, offset);
+        if (count == 0) {
+            return pos - offset;
+        }
+        if (neighbors[0] < 0) {
+            throw new IllegalArgumentException("Invalid neighbor " + neighbors[0]);
+        }
+        pos = writeVarInt(neighbors[0], dest, pos);
+
+        int maxGap = 0;
+        for (int i = 1; i < count; i++) {
+            int gap = neighbors[i] - neighbors[i - 1];
+            if (gap < 0) {
+                throw new IllegalArgumentException("Neighbors are not sorted: " + neighbors[i - 1] + " > " + neighbors[i]);
+            }
+            maxGap = Math.max(maxGap, gap);
+        }
+        int width = Integer.SIZE - Integer.numberOfLeadingZeros(maxGap);
+        dest[pos++] = (byte) width;
+
+        // fewer than 8 bits are left over after each gap, so with gaps of at most 31 bits this never overflows
+        long bits = 0;
+        int bitCount = 0;
+        for (int i = 1; i < count; i++) {
+            bits |= (long) (neighbors[i] - neighbors[i - 1]) << bitCount;
+            bitCount += width;
+            while (bitCount >= Byte.SIZE) {
+                dest[pos++] = (byte) bits;
+                bits >>>= Byte.SIZE;
+                bitCount -= Byte.SIZE;
+            }
+        }
+        if (bitCount > 0) {
+            dest[pos++] = (byte) bits;
+        }
+        return pos - offset;
+    }
+
+    /**
+     * Decodes the list encoded at `offset` in `src` into `dest`, which must be long enough to hold it.
+     *
+     * @return the neighbor count
+     */
+    static int decode(byte[] src, int offset, int[] dest) {
+        int count = readVarInt(src, offset);
+        int pos = offset + varIntSize(count);
+        if (count == 0) {
+            return 0;
+        }
+        assert count <= dest.length : String.format("neighborCount %d > M %d", count, dest.length);
+        dest[0] = readVarInt(src, pos);
+        pos += varIntSize(dest[0]);
+        int width = src[pos++];
+        long mask = (1L << width) - 1;
+
+        // each gap is in the 8 bytes starting at the byte holding its first bit
+        for (int i = 1; i < count; i++) {
+            int bit = (i - 1) * width;
+            long word = (long) LONG_LE.get(src, pos + (bit >>> 3));
+            dest[i] = (int) ((word >>> (bit & 7)) & mask);
+        }
+        for (int i = 1; i < count; i++) {
+            dest[i] += dest[i - 1];
+        }
+        return count;
+    }
+
+    /**
+     * Encodes the adjacency list of `node` into `dest` as it is stored in the compressed format: its neighbors,
+     * renumbered by `oldToNewOrdinals` and sorted, followed by their PQ codes in the same order if `pqVectors`
+     * is not null.  `dest` must hold at least maxEncodedSize(maxDegree) plus maxDegree codes.
+     *
+     * @param scratch at least maxDegree longs, and neighbors at least maxDegree ints, for the work in progress
+     * @return the number of bytes written
+     */
+    static int encodeNode(GraphIndex.View<?> view,
+                          int node,
+                          int maxDegree,
+                          IntUnaryOperator oldToNewOrdinals,
+                          PQVectors pqVectors,
+                          long[] scratch,
+                          int[] neighbors,
+                          byte[] dest)
+    {
+        var it = view.getNeighborsIterator(node);
+        int count = it.size();
+        if (count > maxDegree) {
+            throw new IllegalStateException(String.format("Node %d has %d neighbors, more than the max degree %d",
+                                                          node, count, maxDegree));
+        }
+        // sort by new ordinal, keeping the original ordinal alongside to look up the codes
+        for (int i = 0; i < count; i++) {
+            int original = it.nextInt();
+            scratch[i] = ((long) oldToNewOrdinals.applyAsInt(original) << 32) | original;
+        }
+        Arrays.sort(scratch, 0, count);
+        for (int i = 0; i < count; i++) {
+            neighbors[i] = (int) (scratch[i] >>> 32);
+        }
+
+        int length = encode(neighbors, count, dest, 0);
+        if (pqVectors != null) {
+            int codeSize = pqVectors.getProductQuantization().getSubspaceCount();
+            for (int i = 0; i < count; i++) {
+                System.arraycopy(pqVectors.getCompressedVectors(), pqVectors.get((int) scratch[i]), dest, length, codeSize);
+                length += codeSize;
+            }
+        }
+        return length;
+    }
+
+    private static int writeVarInt(int value, byte[] dest, int pos) {
+        while ((value & ~0x7F) != 0) {
+            dest[pos++] = (byte) ((value & 0x7F) | 0x80);
+            value >>>= 7;
+        }
+        dest[pos++] = (byte) value;
+        return pos;
+    }
+
+    private static int readVarInt(byte[] src, int pos) {
+        int value = 0;
+        for (int shift = 0; ; shift += 7) {
+            byte b = src[pos++];
+            value |= (b & 0x7F) << shift;
+            if (b >= 0) {
+                return value;
+            }
+        }
+    }
+
+    private static int varIntSize(int value) {
+        return value == 0 ? 1 : (Integer.SIZE - 1 - Integer.numberOfLeadingZeros(value)) / 7 + 1;
+    }
+}
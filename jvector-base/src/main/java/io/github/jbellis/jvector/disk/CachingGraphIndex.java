@@ -17,9 +17,11 @@
 package io.github.jbellis.jvector.disk;
 
 import io.github.jbellis.jvector.graph.GraphIndex;
+import io.github.jbellis.jvector.graph.NodeSimilarity;
 import io.github.jbellis.jvector.graph.NodesIterator;
 import io.github.jbellis.jvector.util.Accountable;
 import io.github.jbellis.jvector.util.Bits;
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
 
 import java.io.IOException;
 import java.io.UncheckedIOException;
@@ -29,6 +31,8 @@ public class CachingGraphIndex implements GraphIndex<float[]>, AutoCloseable, Ac
     private static final int CACHE_DISTANCE = 3;
 
     private final GraphCache cache;
+    // null unless created by withClockCache
+    private final ClockNodeCache clockCache;
     private final OnDiskGraphIndex<float[]> graph;
 
     public CachingGraphIndex(OnDiskGraphIndex<float[]> graph)
@@ -37,15 +41,44 @@ public class CachingGraphIndex implements GraphIndex<float[]>, AutoCloseable, Ac
     }
 
     public CachingGraphIndex(OnDiskGraphIndex<float[]> graph, int cacheDistance)
+    {
+        this(graph, loadCache(graph, cacheDistance), null);
+    }
+
+    private CachingGraphIndex(OnDiskGraphIndex<float[]> graph, GraphCache cache, ClockNodeCache clockCache)
     {
         this.graph = graph;
+        this.cache = cache;
+        this.clockCache = clockCache;
+    }
+
+    /**
+     * @return a CachingGraphIndex that caches the nodes visited by searches, up to `maxBytes` of
+     * vectors and adjacency lists, instead of a fixed neighborhood of the entry node.
+     * See {@link ClockNodeCache}.
+     */
+    public static CachingGraphIndex withClockCache(OnDiskGraphIndex<float[]> graph, long maxBytes)
+    {
+        var clockCache = new ClockNodeCache(graph.size(), graph.getDimension(), graph.maxDegree(), maxBytes);
+        return new CachingGraphIndex(graph, loadCache(graph, -1), clockCache);
+    }
+
+    private static GraphCache loadCache(OnDiskGraphIndex<float[]> graph, int cacheDistance) {
         try {
-            this.cache = GraphCache.load(graph, cacheDistance);
+            return GraphCache.load(graph, cacheDistance);
         } catch (IOException e) {
             throw new UncheckedIOException(e);
         }
     }
 
+    /**
+     * @return the cache populated by search traffic, or null if this index was not created by
+     * {@link #withClockCache}
+     */
+    public ClockNodeCache getClockCache() {
+        return clockCache;
+    }
+
     @Override
     public int size() {
         return graph.size();
@@ -57,7 +90,7 @@ public class CachingGraphIndex implements GraphIndex<float[]>, AutoCloseable, Ac
     }
 
     @Override
-    public View<float[]> getView() {
+    public CachedView getView() {
         return new CachedView(graph.getView());
     }
 
@@ -68,7 +101,7 @@ public class CachingGraphIndex implements GraphIndex<float[]>, AutoCloseable, Ac
 
     @Override
     public long ramBytesUsed() {
-        return graph.ramBytesUsed() + cache.ramBytesUsed();
+        return graph.ramBytesUsed() + cache.ramBytesUsed() + (clockCache == null ? 0 : clockCache.ramBytesUsed());
     }
 
     @Override
@@ -76,31 +109,107 @@ public class CachingGraphIndex implements GraphIndex<float[]>, AutoCloseable, Ac
         graph.close();
     }
 
-    private class CachedView implements View<float[]> {
-        private final View<float[]> view;
-
-        public CachedView(View<float[]> view) {
+    public class CachedView implements View<float[]> {
+        private final OnDiskGraphIndex<float[]>.OnDiskView view;
+        private int[] uncachedNodes = new int[0];
+        // scratch space for copying nodes out of (and into) the clock cache
+        private final int[] neighborScratch;
+        private final float[] vectorScratch;
+        // the vector returned by getVector for clock cache hits, kept apart from the scratch used to admit nodes
+        private final float[] cachedVector;
+        // for SearchStats
+        private long cacheHits;
+
+        public CachedView(OnDiskGraphIndex<float[]>.OnDiskView view) {
             this.view = view;
+            this.neighborScratch = clockCache == null ? null : new int[graph.maxDegree()];
+            this.vectorScratch = clockCache == null ? null : new float[graph.getDimension()];
+            this.cachedVector = clockCache == null ? null : new float[graph.getDimension()];
         }
 
         @Override
         public NodesIterator getNeighborsIterator(int node) {
             var cached = cache.getNode(node);
             if (cached != null) {
+                cacheHits++;
                 return new NodesIterator.ArrayNodesIterator(cached.neighbors, cached.neighbors.length);
             }
-            return view.getNeighborsIterator(node);
+            if (clockCache == null) {
+                return view.getNeighborsIterator(node);
+            }
+
+            int count = clockCache.getNeighbors(node, neighborScratch);
+            if (count < 0) {
+                // expanding a node means we are likely to want it again, so admit it.  The vector is
+                // in the same record as the adjacency list, so reading it costs little extra I/O
+                var it = view.getNeighborsIterator(node);
+                count = it.size();
+                for (int i = 0; i < count; i++) {
+                    neighborScratch[i] = it.nextInt();
+                }
+                view.loadVector(node, vectorScratch);
+                clockCache.admit(node, vectorScratch, neighborScratch, count);
+            } else {
+                cacheHits++;
+            }
+            return new NodesIterator.ArrayNodesIterator(neighborScratch, count);
+        }
+
+        @Override
+        public void prefetchNeighbors(int[] nodes, int count) {
+            // only the nodes that aren't cached need to come from disk
+            if (uncachedNodes.length < count) {
+                uncachedNodes = new int[count];
+            }
+            int uncachedCount = 0;
+            for (int i = 0; i < count; i++) {
+                if (cache.getNode(nodes[i]) == null && (clockCache == null || !clockCache.contains(nodes[i]))) {
+                    uncachedNodes[uncachedCount++] = nodes[i];
+                }
+            }
+            if (uncachedCount > 0) {
+                view.prefetchNeighbors(uncachedNodes, uncachedCount);
+            }
         }
 
+        /**
+         * Like the vectors of the fixed cache, a vector from the clock cache is not a copy the caller owns: it
+         * is only valid until the next call to getVector on this view.  Only misses allocate.
+         */
         @Override
         public float[] getVector(int node) {
             var cached = cache.getNode(node);
             if (cached != null) {
+                cacheHits++;
                 return cached.vector;
             }
+            if (clockCache != null && clockCache.getVector(node, cachedVector)) {
+                cacheHits++;
+                return cachedVector;
+            }
             return view.getVector(node);
         }
 
+        /**
+         * @return a ReRanker computing exact similarities against cached vectors where possible,
+         * and otherwise as {@link OnDiskGraphIndex.OnDiskView#rerankerFor}.
+         */
+        public NodeSimilarity.ReRanker rerankerFor(float[] query, VectorSimilarityFunction similarityFunction) {
+            var uncached = view.rerankerFor(query, similarityFunction);
+            return node2 -> {
+                var cached = cache.getNode(node2);
+                if (cached != null) {
+                    cacheHits++;
+                    return similarityFunction.compare(query, cached.vector);
+                }
+                if (clockCache != null && clockCache.getVector(node2, vectorScratch)) {
+                    cacheHits++;
+                    return similarityFunction.compare(query, vectorScratch);
+                }
+                return uncached.similarityTo(node2);
+            };
+        }
+
         @Override
         public int size() {
             return view.size();
@@ -111,11 +220,26 @@ public class CachingGraphIndex implements GraphIndex<float[]>, AutoCloseable, Ac
             return view.entryNode();
         }
 
+        @Override
+        public int[] entryPoints() {
+            return view.entryPoints();
+        }
+
         @Override
         public Bits liveNodes() {
             return view.liveNodes();
         }
 
+        @Override
+        public long bytesRead() {
+            return view.bytesRead();
+        }
+
+        @Override
+        public long cacheHits() {
+            return cacheHits;
+        }
+
         @Override
         public void close() throws Exception {
             view.close();
@@ -0,0 +1,239 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.disk;
+
+import io.github.jbellis.jvector.util.Accountable;
+import io.github.jbellis.jvector.util.RamUsageEstimator;
+
+import java.util.Arrays;
+import java.util.concurrent.atomic.LongAdder;
+import java.util.concurrent.locks.ReentrantLock;
+import java.util.concurrent.locks.StampedLock;
+
+/**
+ * A concurrent cache of node vectors and adjacency lists with a fixed memory budget, populated by
+ * the nodes that searches actually visit and evicted with the CLOCK (second chance) algorithm.
+ * <p>
+ * Nodes are stored in fixed-size slots of a few large primitive arrays, so there is no per-node
+ * object or boxed key; the only per-node state is the int slot index of each node in the graph.
+ * <p>
+ * Lookups copy the cached data into caller-supplied arrays without locking: each slot is guarded by
+ * a striped StampedLock, lookups use optimistic reads, and a lookup that races with the eviction of
+ * its slot is simply reported as a miss.  Admissions are serialized; an admission that finds another
+ * one in progress is skipped, so that misses never wait on each other.
+ */
+public final class ClockNodeCache implements Accountable {
+    private static final int LOCK_STRIPES = 64;
+
+    private final int dimension;
+    private final int maxDegree;
+    private final int capacity;
+
+    // node -> slot, or -1 if the node is not cached.  Only modified while holding admissionLock
+    private final int[] slotOf;
+    // slot -> node, or -1 if the slot is empty
+    private final int[] nodeOf;
+    private final float[] vectors;
+    private final int[] neighbors;
+    private final int[] neighborCounts;
+    // CLOCK reference bits.  Races between lookups setting them and the clock hand clearing them are benign
+    private final byte[] referenced;
+
+    private final StampedLock[] slotLocks;
+    private final ReentrantLock admissionLock = new ReentrantLock();
+    private int clockHand;
+    private int used;
+
+    private final LongAdder hits = new LongAdder();
+    private final LongAdder misses = new LongAdder();
+    private final LongAdder evictions = new LongAdder();
+
+    /**
+     * @param graphSize the number of nodes in the graph
+     * @param dimension the dimension of the vectors
+     * @param maxDegree the maximum number of neighbors of a node
+     * @param maxBytes the memory budget, including the per-node slot index
+     */
+    public ClockNodeCache(int graphSize, int dimension, int maxDegree, long maxBytes) {
+        long fixedBytes = RamUsageEstimator.NUM_BYTES_ARRAY_HEADER + (long) graphSize * Integer.BYTES;
+        long capacity = (maxBytes - fixedBytes) / bytesPerSlot(dimension, maxDegree);
+        if (capacity < 1) {
+            throw new IllegalArgumentException(String.format("Budget of %d bytes is too small to cache any nodes of %d vectors", maxBytes, graphSize));
+        }
+        this.capacity = (int) Math.min(capacity, graphSize);
+        this.dimension = dimension;
+        this.maxDegree = maxDegree;
+
+        slotOf = new int[graphSize];
+        Arrays.fill(slotOf, -1);
+        nodeOf = new int[this.capacity];
+        Arrays.fill(nodeOf, -1);
+        vectors = new float[Math.multiplyExact(this.capacity, dimension)];
+        neighbors = new int[Math.multiplyExact(this.capacity, maxDegree)];
+        neighborCounts = new int[this.capacity];
+        referenced = new byte[this.capacity];
+        slotLocks = new StampedLock[LOCK_STRIPES];
+        for (int i = 0; i < slotLocks.length; i++) {
+            slotLocks[i] = new StampedLock();
+        }
+    }
+
+    private static long bytesPerSlot(int dimension, int maxDegree) {
+        // vector, neighbors, neighbor count, owning node, reference bit
+        return (long) dimension * Float.BYTES + (long) maxDegree * Integer.BYTES + 2 * Integer.BYTES + 1;
+    }
+
+    /**
+     * Copies the neighbors of `node` into `dest`, which must have room for maxDegree entries.
+     *
+     * @return the number of neighbors, or -1 if the node is not cached
+     */
+    public int getNeighbors(int node, int[] dest) {
+        int slot = slotOf[node];
+        if (slot >= 0) {
+            var lock = slotLocks[slot % LOCK_STRIPES];
+            long stamp = lock.tryOptimisticRead();
+            if (stamp != 0 && nodeOf[slot] == node) {
+                int count = Math.min(neighborCounts[slot], maxDegree);
+                System.arraycopy(neighbors, slot * maxDegree, dest, 0, count);
+                if (lock.validate(stamp)) {
+                    referenced[slot] = 1;
+                    hits.increment();
+                    return count;
+                }
+            }
+        }
+        misses.increment();
+        return -1;
+    }
+
+    /**
+     * Copies the vector of `node` into `dest`.
+     *
+     * @return true if the node was cached
+     */
+    public boolean getVector(int node, float[] dest) {
+        int slot = slotOf[node];
+        if (slot >= 0) {
+            var lock = slotLocks[slot % LOCK_STRIPES];
+            long stamp = lock.tryOptimisticRead();
+            if (stamp != 0 && nodeOf[slot] == node) {
+                System.arraycopy(vectors, slot * dimension, dest, 0, dimension);
+                if (lock.validate(stamp)) {
+                    referenced[slot] = 1;
+                    hits.increment();
+                    return true;
+                }
+            }
+        }
+        misses.increment();
+        return false;
+    }
+
+    /**
+     * @return true if `node` is (probably) cached; for deciding what to prefetch, not for correctness
+     */
+    public boolean contains(int node) {
+        return slotOf[node] >= 0;
+    }
+
+    /**
+     * Adds `node` to the cache, evicting a node that has not been used since the clock hand last
+     * passed it if the cache is full.  This is a no-op if the node is already cached, or if another
+     * thread is admitting a node.
+     */
+    public void admit(int node, float[] vector, int[] nodeNeighbors, int neighborCount) {
+        if (slotOf[node] >= 0 || !admissionLock.tryLock()) {
+            return;
+        }
+        try {
+            if (slotOf[node] >= 0) {
+                return;
+            }
+            int slot = used < capacity ? used++ : evict();
+            var lock = slotLocks[slot % LOCK_STRIPES];
+            long stamp = lock.writeLock();
+            try {
+                int previous = nodeOf[slot];
+                if (previous >= 0) {
+                    slotOf[previous] = -1;
+                }
+                nodeOf[slot] = node;
+                System.arraycopy(vector, 0, vectors, slot * dimension, dimension);
+                System.arraycopy(nodeNeighbors, 0, neighbors, slot * maxDegree, neighborCount);
+                neighborCounts[slot] = neighborCount;
+                referenced[slot] = 0;
+            } finally {
+                lock.unlockWrite(stamp);
+            }
+            slotOf[node] = slot;
+        } finally {
+            admissionLock.unlock();
+        }
+    }
+
+    /** @return the slot to reuse; caller must hold admissionLock */
+    private int evict() {
+        while (true) {
+            int slot = clockHand;
+            clockHand = (clockHand + 1) % capacity;
+            if (referenced[slot] == 0) {
+                evictions.increment();
+                return slot;
+            }
+            referenced[slot] = 0;
+        }
+    }
+
+    /**
+     * @return the maximum number of nodes the cache can hold
+     */
+    public int capacity() {
+        return capacity;
+    }
+
+    /**
+     * @return the number of lookups that found their node in the cache
+     */
+    public long hitCount() {
+        return hits.sum();
+    }
+
+    /**
+     * @return the number of lookups that did not find their node in the cache
+     */
+    public long missCount() {
+        return misses.sum();
+    }
+
+    /**
+     * @return the number of nodes that have been evicted to make room for others
+     */
+    public long evictionCount() {
+        return evictions.sum();
+    }
+
+    @Override
+    public long ramBytesUsed() {
+        return RamUsageEstimator.sizeOf(slotOf)
+               + RamUsageEstimator.sizeOf(nodeOf)
+               + RamUsageEstimator.sizeOf(vectors)
+               + RamUsageEstimator.sizeOf(neighbors)
+               + RamUsageEstimator.sizeOf(neighborCounts)
+               + RamUsageEstimator.sizeOf(referenced);
+    }
+}
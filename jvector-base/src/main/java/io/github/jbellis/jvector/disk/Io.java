@@ -16,6 +16,8 @@
 
 package io.github.jbellis.jvector.disk;
 
+import io.github.jbellis.jvector.vector.Float16;
+
 import java.io.DataOutput;
 import java.io.IOException;
 
@@ -25,4 +27,13 @@ public class Io {
             out.writeFloat(a);
         }
     }
+
+    /**
+     * Writes `v` rounded to half precision; see {@link io.github.jbellis.jvector.vector.Float16}
+     */
+    public static void writeFloat16s(DataOutput out, float[] v) throws IOException {
+        for (var a : v) {
+            out.writeShort(Float16.fromFloat(a));
+        }
+    }
 }
@@ -17,45 +17,191 @@
 package io.github.jbellis.jvector.disk;
 
 import io.github.jbellis.jvector.graph.GraphIndex;
+import io.github.jbellis.jvector.graph.NodeSimilarity;
 import io.github.jbellis.jvector.graph.NodesIterator;
 import io.github.jbellis.jvector.graph.OnHeapGraphIndex;
 import io.github.jbellis.jvector.graph.RandomAccessVectorValues;
+import io.github.jbellis.jvector.pq.PQDecoder;
+import io.github.jbellis.jvector.pq.PQVectors;
+import io.github.jbellis.jvector.pq.ProductQuantization;
 import io.github.jbellis.jvector.util.Accountable;
 import io.github.jbellis.jvector.util.Bits;
+import io.github.jbellis.jvector.util.RamUsageEstimator;
+import io.github.jbellis.jvector.vector.Float16;
+import io.github.jbellis.jvector.vector.VectorEncoding;
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
 
+import java.io.ByteArrayOutputStream;
 import java.io.DataOutput;
+import java.io.DataOutputStream;
 import java.io.IOException;
 import java.io.UncheckedIOException;
 import java.util.ArrayList;
+import java.util.Arrays;
 import java.util.Comparator;
 import java.util.HashMap;
+import java.util.List;
 import java.util.Map;
+import java.util.function.IntUnaryOperator;
 import java.util.stream.IntStream;
 
+/**
+ * A read-only graph index backed by the layout written by {@link #write}, or in parallel by
+ * {@link OnDiskGraphIndexWriter}.
+ * <p>
+ * Each node is stored as a fixed-size record, so that a node's vector and neighbors can be found
+ * by direct offset computation.  If the graph was written with PQVectors, each record also contains
+ * the node's own PQ code and the codes of its neighbors, so expanding a node during search requires
+ * a single read from the record, with no separately resident compressed vectors.
+ * <p>
+ * Vectors are stored as floats, or at half precision if written with {@link VectorEncoding#FLOAT16}.
+ * Either way getVector returns float[], and rerankerFor scores the stored values directly.
+ * <p>
+ * Graphs written with compressed adjacency instead store each node's neighbors (and their PQ codes) after
+ * the records, sorted, delta-encoded, and bit-packed, with no padding out to the max degree.  An index of
+ * offsets locates each node's list; it is loaded onto the heap when the graph is opened (8 bytes per node), so
+ * expanding a node, or prefetching its list, reads just the bytes of the list.  The lists are much smaller than
+ * the padded ones, so more of them fit in the page cache.
+ */
 public class OnDiskGraphIndex<T> implements GraphIndex<T>, AutoCloseable, Accountable
 {
+    /**
+     * Written before the version number.  It is negative so that it cannot be confused with the
+     * graph size, which is what is found at the same position in unversioned (version 0) files.
+     */
+    static final int MAGIC = 0xFFFF0D61;
+    /**
+     * Version 1 added inline PQ codes, version 2 the vector encoding, version 3 the entry points, and version 4
+     * compressed adjacency.
+     */
+    static final int CURRENT_VERSION = 4;
+    /** values of the adjacency format in the header, from version 4 */
+    static final int FIXED_ADJACENCY = 0;
+    static final int COMPRESSED_ADJACENCY = 1;
+
     private final ReaderSupplier readerSupplier;
-    private final long neighborsOffset;
+    private final int version;
+    private final long nodesOffset;
     private final int size;
     private final int entryNode;
+    private final int[] entryPoints;
     private final int maxDegree;
     private final int dimension;
+    private final VectorEncoding vectorEncoding;
+    // codebooks for the PQ codes stored inline with each node, or null if there are none
+    private final ProductQuantization pq;
+    private final int pqCodeSize;
+    private final long recordSize;
+    // true if the adjacency lists are stored compressed, after the node records rather than in them
+    private final boolean compressedAdjacency;
+    // the start of the compressed adjacency lists, and the offset of each list from there (plus the end of the
+    // last one), held on the heap; the index is null if the adjacency lists are not compressed
+    private final long adjacencyOffset;
+    private final long[] adjacencyIndex;
+    // the largest a compressed list can be, including its neighbors' codes
+    private final int maxAdjacencySize;
 
     public OnDiskGraphIndex(ReaderSupplier readerSupplier, long offset)
     {
         this.readerSupplier = readerSupplier;
-        this.neighborsOffset = offset + 4 * Integer.BYTES;
         try (var reader = readerSupplier.get()) {
             reader.seek(offset);
-            size = reader.readInt();
+            int headerInts;
+            int firstInt = reader.readInt();
+            if (firstInt == MAGIC) {
+                version = reader.readInt();
+                if (version > CURRENT_VERSION) {
+                    throw new IOException("Unsupported OnDiskGraphIndex version " + version);
+                }
+                size = reader.readInt();
+                headerInts = version >= 2 ? 8 : 7;
+            } else {
+                version = 0;
+                size = firstInt;
+                headerInts = 4;
+            }
             dimension = reader.readInt();
             entryNode = reader.readInt();
             maxDegree = reader.readInt();
+            vectorEncoding = version >= 2 ? readVectorEncoding(reader) : VectorEncoding.FLOAT32;
+            if (version >= 3) {
+                int entryPointCount = reader.readInt();
+                entryPoints = new int[entryPointCount];
+                reader.read(entryPoints, 0, entryPointCount);
+                headerInts += 1 + entryPointCount;
+            } else {
+                entryPoints = NO_ENTRY_POINTS;
+            }
+            if (version >= 4) {
+                int adjacencyFormat = reader.readInt();
+                if (adjacencyFormat != FIXED_ADJACENCY && adjacencyFormat != COMPRESSED_ADJACENCY) {
+                    throw new IOException("Unsupported adjacency format " + adjacencyFormat);
+                }
+                compressedAdjacency = adjacencyFormat == COMPRESSED_ADJACENCY;
+                headerInts++;
+            } else {
+                compressedAdjacency = false;
+            }
+
+            int pqLength = version >= 1 ? reader.readInt() : 0;
+            pq = pqLength > 0 ? ProductQuantization.load(reader) : null;
+            pqCodeSize = pq == null ? 0 : pq.getSubspaceCount();
+            nodesOffset = offset + (long) headerInts * Integer.BYTES + pqLength;
+            recordSize = recordSize(dimension, vectorEncoding, pqCodeSize, maxDegree, compressedAdjacency);
+            long adjacencyIndexOffset = nodesOffset + size * recordSize;
+            adjacencyOffset = adjacencyIndexOffset + (size + 1L) * Long.BYTES;
+            maxAdjacencySize = maxAdjacencySize(maxDegree, pqCodeSize);
+            if (compressedAdjacency) {
+                adjacencyIndex = new long[size + 1];
+                reader.seek(adjacencyIndexOffset);
+                reader.readFully(adjacencyIndex);
+            } else {
+                adjacencyIndex = null;
+            }
         } catch (Exception e) {
             throw new RuntimeException("Error initializing OnDiskGraph at offset " + offset, e);
         }
     }
 
+    /**
+     * @return the size of each node record
+     */
+    static long recordSize(int dimension, VectorEncoding vectorEncoding, int pqCodeSize, int maxDegree, boolean compressedAdjacency) {
+        long size = Integer.BYTES // id
+                    + (long) dimension * vectorEncoding.byteSize
+                    + pqCodeSize;
+        if (!compressedAdjacency) {
+            size += Integer.BYTES // neighbor count
+                    + (long) maxDegree * (Integer.BYTES + pqCodeSize);
+        }
+        return size;
+    }
+
+    /**
+     * @return the largest a compressed adjacency list can be, including the codes of its neighbors
+     */
+    static int maxAdjacencySize(int maxDegree, int pqCodeSize) {
+        return AdjacencyCodec.maxEncodedSize(maxDegree) + maxDegree * pqCodeSize;
+    }
+
+    /** the encoding is written as its byteSize, since only FLOAT32 and FLOAT16 are supported */
+    private static VectorEncoding readVectorEncoding(RandomAccessReader reader) throws IOException {
+        int byteSize = reader.readInt();
+        if (byteSize == VectorEncoding.FLOAT32.byteSize) {
+            return VectorEncoding.FLOAT32;
+        }
+        if (byteSize == VectorEncoding.FLOAT16.byteSize) {
+            return VectorEncoding.FLOAT16;
+        }
+        throw new IOException("Unsupported vector encoding size " + byteSize);
+    }
+
+    static void checkVectorEncoding(VectorEncoding vectorEncoding) {
+        if (vectorEncoding != VectorEncoding.FLOAT32 && vectorEncoding != VectorEncoding.FLOAT16) {
+            throw new IllegalArgumentException("Vectors can only be written as FLOAT32 or FLOAT16, not " + vectorEncoding);
+        }
+    }
+
     /**
      * @return a Map of old to new graph ordinals where the new ordinals are sequential starting at 0,
      * while preserving the original relative ordering in `graph`.  That is, for all node ids i and j,
@@ -76,6 +222,21 @@ public class OnDiskGraphIndex<T> implements GraphIndex<T>, AutoCloseable, Accoun
         }
     }
 
+    /**
+     * @return a Map of old to new graph ordinals in breadth-first order from the entry node, so that
+     * neighbors are stored near each other on disk.  See {@link OnDiskGraphIndexWriter#getBreadthFirstRenumbering}.
+     */
+    public static <T> Map<Integer, Integer> getBreadthFirstRenumbering(GraphIndex<T> graph) {
+        int[] oldToNew = OnDiskGraphIndexWriter.getBreadthFirstRenumbering(graph);
+        Map<Integer, Integer> oldToNewMap = new HashMap<>();
+        for (int i = 0; i < oldToNew.length; i++) {
+            if (oldToNew[i] >= 0) {
+                oldToNewMap.put(i, oldToNew[i]);
+            }
+        }
+        return oldToNewMap;
+    }
+
     @Override
     public int size() {
         return size;
@@ -86,6 +247,51 @@ public class OnDiskGraphIndex<T> implements GraphIndex<T>, AutoCloseable, Accoun
         return maxDegree;
     }
 
+    /**
+     * @return the dimension of the vectors stored with each node
+     */
+    public int getDimension() {
+        return dimension;
+    }
+
+    /**
+     * @return how the vectors are stored: FLOAT32, or FLOAT16 for half precision
+     */
+    public VectorEncoding getVectorEncoding() {
+        return vectorEncoding;
+    }
+
+    /**
+     * @return true if the adjacency lists are stored compressed, outside the node records
+     */
+    public boolean hasCompressedAdjacency() {
+        return compressedAdjacency;
+    }
+
+    /**
+     * @return the codebooks for the PQ codes stored with each node, or null if the graph
+     * was written without them
+     */
+    public ProductQuantization getProductQuantization() {
+        return pq;
+    }
+
+    private long vectorOffset(int node) {
+        return nodesOffset + node * recordSize + Integer.BYTES; // skip the ID
+    }
+
+    private long pqCodeOffset(int node) {
+        return vectorOffset(node) + (long) dimension * vectorEncoding.byteSize;
+    }
+
+    private long neighborsOffset(int node) {
+        return pqCodeOffset(node) + pqCodeSize;
+    }
+
+    private long neighborCodesOffset(int node) {
+        return neighborsOffset(node) + (long) Integer.BYTES * (maxDegree + 1);
+    }
+
     /** return a Graph that can be safely queried concurrently */
     public OnDiskGraphIndex<T>.OnDiskView getView()
     {
@@ -97,23 +303,53 @@ public class OnDiskGraphIndex<T> implements GraphIndex<T>, AutoCloseable, Accoun
     {
         private final RandomAccessReader reader;
         private final int[] neighbors;
+        private final byte[] nodeCode;
+        private final byte[] neighborCodes;
+        private final float[] neighborSimilarities;
+        private final float[] vectorScratch;
+        // the stored values of a half-precision vector; null for FLOAT32
+        private final short[] float16Scratch;
+        private long[] prefetchOffsets = new long[0];
+        // the encoded adjacency list of cachedNeighborsNode; null if not compressed
+        private final byte[] adjacency;
+        private int cachedAdjacencyLength;
+        // the node whose adjacency list (and neighbor codes) are currently in `neighbors` (and `neighborCodes`)
+        private int cachedNeighborsNode = -1;
+        private int cachedNeighborCount;
+        private int cachedCodesNode = -1;
+        // for SearchStats
+        private long bytesRead;
 
         public OnDiskView(RandomAccessReader reader)
         {
             super();
             this.reader = reader;
             this.neighbors = new int[maxDegree];
+            this.nodeCode = new byte[pqCodeSize];
+            this.neighborCodes = new byte[maxDegree * pqCodeSize];
+            this.neighborSimilarities = pqCodeSize > 0 ? new float[maxDegree] : null;
+            this.vectorScratch = new float[dimension];
+            this.float16Scratch = vectorEncoding == VectorEncoding.FLOAT16 ? new short[dimension] : null;
+            this.adjacency = compressedAdjacency ? new byte[maxAdjacencySize + AdjacencyCodec.PADDING] : null;
         }
 
         public T getVector(int node) {
+            float[] vector = new float[dimension];
+            loadVector(node, vector);
+            return (T) vector;
+        }
+
+        /** Reads the vector of `node` into `dest`, without allocating */
+        void loadVector(int node, float[] dest) {
             try {
-                long offset = neighborsOffset +
-                        node * (Integer.BYTES + (long) dimension * Float.BYTES + (long) Integer.BYTES * (maxDegree + 1)) // earlier entries
-                        + Integer.BYTES; // skip the ID
-                float[] vector = new float[dimension];
-                reader.seek(offset);
-                reader.readFully(vector);
-                return (T) vector;
+                reader.seek(vectorOffset(node));
+                if (float16Scratch == null) {
+                    reader.readFully(dest);
+                } else {
+                    reader.readFully(float16Scratch);
+                    Float16.decode(float16Scratch, 0, dest);
+                }
+                bytesRead += (long) vectorEncoding.byteSize * dimension;
             }
             catch (IOException e) {
                 throw new UncheckedIOException(e);
@@ -122,19 +358,126 @@ public class OnDiskGraphIndex<T> implements GraphIndex<T>, AutoCloseable, Accoun
 
         public NodesIterator getNeighborsIterator(int node) {
             try {
-                reader.seek(neighborsOffset +
-                        (node + 1) * (Integer.BYTES + (long) dimension * Float.BYTES) +
-                        (node * (long) Integer.BYTES * (maxDegree + 1)));
-                int neighborCount = reader.readInt();
+                loadNeighbors(node);
+                return new NodesIterator.ArrayNodesIterator(neighbors, cachedNeighborCount);
+            }
+            catch (IOException e) {
+                throw new UncheckedIOException(e);
+            }
+        }
+
+        private void loadNeighbors(int node) throws IOException {
+            if (node == cachedNeighborsNode) {
+                return;
+            }
+            int neighborCount;
+            if (compressedAdjacency) {
+                // one read for the whole list, including the neighbors' codes
+                long length = adjacencyIndex[node + 1] - adjacencyIndex[node];
+                if (length < 0 || length > maxAdjacencySize) {
+                    throw new IOException(String.format("Invalid adjacency list length %d for node %d", length, node));
+                }
+                cachedAdjacencyLength = (int) length;
+                reader.seek(adjacencyOffset + adjacencyIndex[node]);
+                reader.read(adjacency, 0, cachedAdjacencyLength);
+                bytesRead += cachedAdjacencyLength;
+                neighborCount = AdjacencyCodec.decode(adjacency, 0, neighbors);
+            } else {
+                reader.seek(neighborsOffset(node));
+                neighborCount = reader.readInt();
                 assert neighborCount <= maxDegree : String.format("neighborCount %d > M %d", neighborCount, maxDegree);
                 reader.read(neighbors, 0, neighborCount);
-                return new NodesIterator.ArrayNodesIterator(neighbors, neighborCount);
+                bytesRead += (long) Integer.BYTES * (neighborCount + 1);
+            }
+            cachedNeighborsNode = node;
+            cachedNeighborCount = neighborCount;
+        }
+
+        /**
+         * Asks the reader to prefetch the adjacency lists (and neighbor codes, if any) of `nodes`, so that
+         * the reads issued by expanding them during a beam search overlap instead of happening serially.
+         */
+        @Override
+        public void prefetchNeighbors(int[] nodes, int count) {
+            if (prefetchOffsets.length < count) {
+                prefetchOffsets = new long[count];
+            }
+            try {
+                int length;
+                if (compressedAdjacency) {
+                    // the index is on the heap, so this does no I/O of its own.  The reader takes a single
+                    // length, so ask for the largest a list can be
+                    for (int i = 0; i < count; i++) {
+                        prefetchOffsets[i] = adjacencyOffset + adjacencyIndex[nodes[i]];
+                    }
+                    length = maxAdjacencySize;
+                } else {
+                    for (int i = 0; i < count; i++) {
+                        prefetchOffsets[i] = neighborsOffset(nodes[i]);
+                    }
+                    length = Integer.BYTES * (maxDegree + 1) + maxDegree * pqCodeSize;
+                }
+                reader.prefetch(prefetchOffsets, count, length);
             }
             catch (IOException e) {
                 throw new UncheckedIOException(e);
             }
         }
 
+        private void loadNeighborCodes(int node) throws IOException {
+            loadNeighbors(node);
+            if (node == cachedCodesNode) {
+                return;
+            }
+            if (compressedAdjacency) {
+                // the codes were read with the neighbors, and follow their encoding
+                int codesLength = cachedNeighborCount * pqCodeSize;
+                System.arraycopy(adjacency, cachedAdjacencyLength - codesLength, neighborCodes, 0, codesLength);
+            } else {
+                reader.seek(neighborCodesOffset(node));
+                reader.readFully(neighborCodes);
+                bytesRead += neighborCodes.length;
+            }
+            cachedCodesNode = node;
+        }
+
+        /**
+         * @return a ReRanker computing exact similarities between `query` and the vectors stored in this graph.
+         * Unlike scoring against getVector, this does not allocate, and readers that support it (such as
+         * MemorySegmentReader) compute the similarity in place.  Half-precision vectors are copied out
+         * without converting them, and scored with {@link VectorSimilarityFunction#compareFloat16}.  The
+         * ReRanker shares scratch state with this View, so it must be used from the same thread.
+         */
+        public NodeSimilarity.ReRanker rerankerFor(float[] query, VectorSimilarityFunction similarityFunction) {
+            return node2 -> {
+                try {
+                    bytesRead += (long) vectorEncoding.byteSize * dimension;
+                    if (float16Scratch != null) {
+                        reader.seek(vectorOffset(node2));
+                        reader.readFully(float16Scratch);
+                        return similarityFunction.compareFloat16(query, float16Scratch, 0);
+                    }
+                    return reader.similarityTo(query, vectorOffset(node2), similarityFunction, vectorScratch);
+                }
+                catch (IOException e) {
+                    throw new UncheckedIOException(e);
+                }
+            };
+        }
+
+        /**
+         * @return an ApproximateScoreFunction that scores nodes using the PQ codes stored in this graph,
+         * including scoring all the neighbors of a node at once when it is expanded.  The function shares
+         * scratch state with this View, so it must be used from the same thread.
+         * @throws IllegalStateException if the graph was written without PQ codes
+         */
+        public NodeSimilarity.ApproximateScoreFunction approximateScoreFunctionFor(float[] query, VectorSimilarityFunction similarityFunction) {
+            if (pq == null) {
+                throw new IllegalStateException("Graph was written without inline PQ codes");
+            }
+            return new InlinePQScoreFunction(PQDecoder.newDecoder(pq, query, similarityFunction));
+        }
+
         @Override
         public int size() {
             return OnDiskGraphIndex.this.size();
@@ -145,15 +488,63 @@ public class OnDiskGraphIndex<T> implements GraphIndex<T>, AutoCloseable, Accoun
             return OnDiskGraphIndex.this.entryNode;
         }
 
+        @Override
+        public int[] entryPoints() {
+            return OnDiskGraphIndex.this.entryPoints;
+        }
+
         @Override
         public Bits liveNodes() {
             return Bits.ALL;
         }
 
+        @Override
+        public long bytesRead() {
+            return bytesRead;
+        }
+
         @Override
         public void close() throws IOException {
             reader.close();
         }
+
+        private class InlinePQScoreFunction implements NodeSimilarity.ApproximateScoreFunction {
+            private final PQDecoder decoder;
+
+            private InlinePQScoreFunction(PQDecoder decoder) {
+                this.decoder = decoder;
+            }
+
+            @Override
+            public float similarityTo(int node2) {
+                try {
+                    reader.seek(pqCodeOffset(node2));
+                    reader.readFully(nodeCode);
+                    bytesRead += nodeCode.length;
+                    return decoder.similarityTo(nodeCode, 0);
+                }
+                catch (IOException e) {
+                    throw new UncheckedIOException(e);
+                }
+            }
+
+            @Override
+            public boolean supportsEdgeLoadingSimilarity() {
+                return true;
+            }
+
+            @Override
+            public float[] edgeLoadingSimilarityTo(int origin) {
+                try {
+                    loadNeighborCodes(origin);
+                }
+                catch (IOException e) {
+                    throw new UncheckedIOException(e);
+                }
+                decoder.similarityTo(neighborCodes, 0, cachedNeighborCount, neighborSimilarities);
+                return neighborSimilarities;
+            }
+        }
     }
 
     @Override
@@ -164,7 +555,21 @@ public class OnDiskGraphIndex<T> implements GraphIndex<T>, AutoCloseable, Accoun
 
     @Override
     public long ramBytesUsed() {
-        return Long.BYTES + 4 * Integer.BYTES;
+        long fields = Long.BYTES // nodesOffset
+                      + Long.BYTES // recordSize
+                      + Long.BYTES // adjacencyOffset
+                      + Integer.BYTES // version
+                      + Integer.BYTES // size
+                      + Integer.BYTES // entryNode
+                      + Integer.BYTES // maxDegree
+                      + Integer.BYTES // dimension
+                      + Integer.BYTES // pqCodeSize
+                      + Integer.BYTES // maxAdjacencySize
+                      + 1; // compressedAdjacency
+        return fields
+               + RamUsageEstimator.sizeOf(entryPoints)
+               + (adjacencyIndex == null ? 0 : RamUsageEstimator.sizeOf(adjacencyIndex))
+               + (pq == null ? 0 : pq.memorySize());
     }
 
     public void close() throws IOException {
@@ -205,6 +610,62 @@ public class OnDiskGraphIndex<T> implements GraphIndex<T>, AutoCloseable, Accoun
                                  DataOutput out)
             throws IOException
     {
+        write(graph, vectors, null, oldToNewOrdinals, out);
+    }
+
+    /**
+     * @param graph the graph to write
+     * @param vectors the vectors associated with each node
+     * @param pqVectors if not null, the PQ codes of each node (by original ordinal) are written into
+     *                  the node's record, followed by the codes of its neighbors, so that the graph
+     *                  can be searched with {@link OnDiskView#approximateScoreFunctionFor} instead of
+     *                  keeping pqVectors in memory
+     * @param oldToNewOrdinals A map from old to new ordinals. If ordinal numbering does not matter,
+     *                         you can use `getSequentialRenumbering`, which will "fill in" holes left by
+     *                         any deleted nodes.
+     * @param out the output to write to
+     */
+    public static <T> void write(GraphIndex<T> graph,
+                                 RandomAccessVectorValues<T> vectors,
+                                 PQVectors pqVectors,
+                                 Map<Integer, Integer> oldToNewOrdinals,
+                                 DataOutput out)
+            throws IOException
+    {
+        write(graph, vectors, pqVectors, oldToNewOrdinals, VectorEncoding.FLOAT32, out);
+    }
+
+    /**
+     * As {@link #write(GraphIndex, RandomAccessVectorValues, PQVectors, Map, DataOutput)}, storing the vectors
+     * with `vectorEncoding`: FLOAT32, or FLOAT16 to round them to half precision and halve their size.
+     */
+    public static <T> void write(GraphIndex<T> graph,
+                                 RandomAccessVectorValues<T> vectors,
+                                 PQVectors pqVectors,
+                                 Map<Integer, Integer> oldToNewOrdinals,
+                                 VectorEncoding vectorEncoding,
+                                 DataOutput out)
+            throws IOException
+    {
+        write(graph, vectors, pqVectors, oldToNewOrdinals, vectorEncoding, false, out);
+    }
+
+    /**
+     * As {@link #write(GraphIndex, RandomAccessVectorValues, PQVectors, Map, VectorEncoding, DataOutput)}.  If
+     * `compressedAdjacency` is true, the adjacency lists (and neighbor codes) are written after the node records,
+     * sorted and delta-encoded instead of padded out to the max degree.  This is most effective with a
+     * renumbering that gives neighbors nearby ordinals, such as {@link #getBreadthFirstRenumbering}.
+     */
+    public static <T> void write(GraphIndex<T> graph,
+                                 RandomAccessVectorValues<T> vectors,
+                                 PQVectors pqVectors,
+                                 Map<Integer, Integer> oldToNewOrdinals,
+                                 VectorEncoding vectorEncoding,
+                                 boolean compressedAdjacency,
+                                 DataOutput out)
+            throws IOException
+    {
+        checkVectorEncoding(vectorEncoding);
         if (graph instanceof OnHeapGraphIndex) {
             var ohgi = (OnHeapGraphIndex<T>) graph;
             if (ohgi.getDeletedNodes().cardinality() > 0) {
@@ -225,10 +686,35 @@ public class OnDiskGraphIndex<T> implements GraphIndex<T>, AutoCloseable, Accoun
 
         try (var view = graph.getView()) {
             // graph-level properties
+            out.writeInt(MAGIC);
+            out.writeInt(CURRENT_VERSION);
             out.writeInt(graph.size());
             out.writeInt(vectors.dimension());
-            out.writeInt(view.entryNode());
+            out.writeInt(view.entryNode() < 0 ? -1 : oldToNewOrdinals.get(view.entryNode()));
             out.writeInt(graph.maxDegree());
+            out.writeInt(vectorEncoding.byteSize);
+            var entryPoints = Arrays.stream(view.entryPoints())
+                                    .filter(graph::containsNode)
+                                    .map(oldToNewOrdinals::get)
+                                    .toArray();
+            out.writeInt(entryPoints.length);
+            for (int entryPoint : entryPoints) {
+                out.writeInt(entryPoint);
+            }
+            out.writeInt(compressedAdjacency ? COMPRESSED_ADJACENCY : FIXED_ADJACENCY);
+
+            // codebooks for the inline PQ codes, prefixed by their serialized length
+            byte[] emptyCode = null;
+            if (pqVectors == null) {
+                out.writeInt(0);
+            } else {
+                var pqBytes = new ByteArrayOutputStream();
+                pqVectors.getProductQuantization().write(new DataOutputStream(pqBytes));
+                out.writeInt(pqBytes.size());
+                out.write(pqBytes.toByteArray());
+                emptyCode = new byte[pqVectors.getProductQuantization().getSubspaceCount()];
+            }
+            int[] originalNeighbors = new int[graph.maxDegree()];
 
             // for each graph node, write the associated vector and its neighbors
             for (int i = 0; i < oldToNewOrdinals.size(); i++) {
@@ -240,13 +726,25 @@ public class OnDiskGraphIndex<T> implements GraphIndex<T>, AutoCloseable, Accoun
                 }
 
                 out.writeInt(newOrdinal); // unnecessary, but a reasonable sanity check
-                Io.writeFloats(out, (float[]) vectors.vectorValue(originalOrdinal));
+                if (vectorEncoding == VectorEncoding.FLOAT16) {
+                    Io.writeFloat16s(out, (float[]) vectors.vectorValue(originalOrdinal));
+                } else {
+                    Io.writeFloats(out, (float[]) vectors.vectorValue(originalOrdinal));
+                }
+                if (pqVectors != null) {
+                    out.write(pqVectors.getCompressedVectors(), pqVectors.get(originalOrdinal), emptyCode.length);
+                }
+                if (compressedAdjacency) {
+                    continue;
+                }
 
                 var neighbors = view.getNeighborsIterator(originalOrdinal);
-                out.writeInt(neighbors.size());
+                int neighborCount = neighbors.size();
+                out.writeInt(neighborCount);
                 int n = 0;
-                for (; n < neighbors.size(); n++) {
-                    out.writeInt(oldToNewOrdinals.get(neighbors.nextInt()));
+                for (; n < neighborCount; n++) {
+                    originalNeighbors[n] = neighbors.nextInt();
+                    out.writeInt(oldToNewOrdinals.get(originalNeighbors[n]));
                 }
                 assert !neighbors.hasNext();
 
@@ -254,9 +752,61 @@ public class OnDiskGraphIndex<T> implements GraphIndex<T>, AutoCloseable, Accoun
                 for (; n < graph.maxDegree(); n++) {
                     out.writeInt(-1);
                 }
+
+                // neighbor codes, in the same order as the neighbors themselves
+                if (pqVectors != null) {
+                    for (n = 0; n < neighborCount; n++) {
+                        out.write(pqVectors.getCompressedVectors(), pqVectors.get(originalNeighbors[n]), emptyCode.length);
+                    }
+                    for (; n < graph.maxDegree(); n++) {
+                        out.write(emptyCode);
+                    }
+                }
+            }
+
+            if (compressedAdjacency) {
+                writeCompressedAdjacency(graph, view, pqVectors, oldToNewOrdinals, entriesByNewOrdinal, out);
             }
         } catch (Exception e) {
             throw new IOException(e);
         }
     }
+
+    /**
+     * Writes the offset index and then the adjacency lists, in new ordinal order.  The index precedes the lists,
+     * so each list is encoded twice: once to find its length and once to write it.
+     */
+    private static <T> void writeCompressedAdjacency(GraphIndex<T> graph,
+                                                     GraphIndex.View<T> view,
+                                                     PQVectors pqVectors,
+                                                     Map<Integer, Integer> oldToNewOrdinals,
+                                                     List<Map.Entry<Integer, Integer>> entriesByNewOrdinal,
+                                                     DataOutput out)
+            throws IOException
+    {
+        int maxDegree = graph.maxDegree();
+        int pqCodeSize = pqVectors == null ? 0 : pqVectors.getProductQuantization().getSubspaceCount();
+        var encoded = new byte[maxAdjacencySize(maxDegree, pqCodeSize)];
+        var scratch = new long[maxDegree];
+        var neighbors = new int[maxDegree];
+        IntUnaryOperator oldToNew = oldToNewOrdinals::get;
+
+        // skip the same ordinals as the node records do
+        long position = 0;
+        out.writeLong(position);
+        for (var entry : entriesByNewOrdinal) {
+            if (!graph.containsNode(entry.getKey())) {
+                continue;
+            }
+            position += AdjacencyCodec.encodeNode(view, entry.getKey(), maxDegree, oldToNew, pqVectors, scratch, neighbors, encoded);
+            out.writeLong(position);
+        }
+        for (var entry : entriesByNewOrdinal) {
+            if (!graph.containsNode(entry.getKey())) {
+                continue;
+            }
+            int length = AdjacencyCodec.encodeNode(view, entry.getKey(), maxDegree, oldToNew, pqVectors, scratch, neighbors, encoded);
+            out.write(encoded, 0, length);
+        }
+    }
 }
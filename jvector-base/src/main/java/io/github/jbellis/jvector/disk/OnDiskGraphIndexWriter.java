@@ -0,0 +1,518 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.disk;
+
+import io.github.jbellis.jvector.graph.GraphIndex;
+import io.github.jbellis.jvector.graph.OnHeapGraphIndex;
+import io.github.jbellis.jvector.graph.RandomAccessVectorValues;
+import io.github.jbellis.jvector.pq.PQVectors;
+import io.github.jbellis.jvector.util.FixedBitSet;
+import io.github.jbellis.jvector.vector.Float16;
+import io.github.jbellis.jvector.vector.VectorEncoding;
+
+import java.io.ByteArrayOutputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
+import java.io.UncheckedIOException;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.file.Path;
+import java.nio.file.StandardOpenOption;
+import java.util.Arrays;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.ForkJoinPool;
+import java.util.function.Supplier;
+import java.util.stream.IntStream;
+
+/**
+ * Writes a graph in the layout read by {@link OnDiskGraphIndex}, producing the same bytes as
+ * {@link OnDiskGraphIndex#write}, but in parallel.
+ * <p>
+ * Node records are fixed-size, so the file position of each record follows from its new ordinal.
+ * The records are divided into batches that are serialized concurrently into per-thread direct
+ * buffers and written with positional FileChannel writes, so there is no single-threaded pass over
+ * the graph and no ordering between batches.  Compressed adjacency lists vary in size, so they take a
+ * parallel pass to measure each batch of lists, and then one to write them at the offsets that follow.
+ */
+public final class OnDiskGraphIndexWriter {
+    // large enough to amortize the cost of a write call, small enough that each thread's buffer is cheap
+    private static final int TARGET_BATCH_BYTES = 4 << 20;
+
+    private OnDiskGraphIndexWriter() {
+    }
+
+    /**
+     * @return a mapping of old to new graph ordinals where the new ordinals are sequential starting at 0,
+     * while preserving the original relative ordering in `graph`.  Old ordinals that are not in the graph
+     * map to -1.  This is the array equivalent of {@link OnDiskGraphIndex#getSequentialRenumbering}.
+     */
+    public static int[] getSequentialRenumbering(GraphIndex<?> graph) {
+        try (var view = graph.getView()) {
+            int[] oldToNew = new int[view.getIdUpperBound()];
+            int nextOrdinal = 0;
+            for (int i = 0; i < oldToNew.length; i++) {
+                oldToNew[i] = graph.containsNode(i) ? nextOrdinal++ : -1;
+            }
+            return oldToNew;
+        } catch (Exception e) {
+            throw new RuntimeException(e);
+        }
+    }
+
+    /**
+     * @return a mapping of old to new graph ordinals in breadth-first order from the entry node, so that a
+     * node's neighbors (which are sorted closest-first) get ordinals near its own, and nodes that are expanded
+     * one after another during a search are likely to share a page on disk.  Nodes that are not reachable from
+     * the entry node are numbered by further breadth-first traversals starting from each of them in their
+     * original order.  Old ordinals that are not in the graph map to -1.
+     */
+    public static int[] getBreadthFirstRenumbering(GraphIndex<?> graph) {
+        try (var view = graph.getView()) {
+            int[] oldToNew = new int[view.getIdUpperBound()];
+            Arrays.fill(oldToNew, -1);
+            int[] queue = new int[graph.size()];
+            int nextOrdinal = 0;
+            if (view.entryNode() >= 0) {
+                nextOrdinal = breadthFirst(graph, view, view.entryNode(), oldToNew, queue, nextOrdinal);
+            }
+            for (int i = 0; i < oldToNew.length; i++) {
+                if (oldToNew[i] < 0 && graph.containsNode(i)) {
+                    nextOrdinal = breadthFirst(graph, view, i, oldToNew, queue, nextOrdinal);
+                }
+            }
+            assert nextOrdinal == graph.size() : String.format("renumbered %d nodes but graph size is %d", nextOrdinal, graph.size());
+            return oldToNew;
+        } catch (Exception e) {
+            throw new RuntimeException(e);
+        }
+    }
+
+    /**
+     * Numbers the nodes reachable from `root` that have not been numbered yet, starting at `nextOrdinal`.
+     * Ordinals are assigned in the order that nodes are enqueued, so `queue` is the new-to-old mapping.
+     *
+     * @return the next unassigned ordinal
+     */
+    private static int breadthFirst(GraphIndex<?> graph, GraphIndex.View<?> view, int root, int[] oldToNew, int[] queue, int nextOrdinal) {
+        int head = nextOrdinal;
+        oldToNew[root] = nextOrdinal;
+        queue[nextOrdinal++] = root;
+        while (head < nextOrdinal) {
+            for (var it = view.getNeighborsIterator(queue[head++]); it.hasNext(); ) {
+                int neighbor = it.nextInt();
+                if (oldToNew[neighbor] < 0 && graph.containsNode(neighbor)) {
+                    oldToNew[neighbor] = nextOrdinal;
+                    queue[nextOrdinal++] = neighbor;
+                }
+            }
+        }
+        return nextOrdinal;
+    }
+
+    /**
+     * Writes `graph` to `outputPath` using the common ForkJoinPool.
+     *
+     * @see #write(GraphIndex, RandomAccessVectorValues, PQVectors, int[], Path, ForkJoinPool)
+     */
+    public static <T> void write(GraphIndex<T> graph,
+                                 RandomAccessVectorValues<T> vectors,
+                                 PQVectors pqVectors,
+                                 int[] oldToNewOrdinals,
+                                 Path outputPath)
+            throws IOException
+    {
+        write(graph, vectors, pqVectors, oldToNewOrdinals, outputPath, ForkJoinPool.commonPool());
+    }
+
+    /**
+     * @param graph the graph to write
+     * @param vectors the vectors associated with each node
+     * @param pqVectors if not null, the PQ codes to store inline with each node; see
+     *                  {@link OnDiskGraphIndex#write(GraphIndex, RandomAccessVectorValues, PQVectors, java.util.Map, java.io.DataOutput)}
+     * @param oldToNewOrdinals the new ordinal of each old ordinal, or -1 for ordinals that are not in the graph.
+     *                         {@link #getSequentialRenumbering} will "fill in" holes left by any deleted nodes.
+     * @param outputPath the file to write; it is created or replaced
+     * @param executor the pool that serializes and writes the node records
+     */
+    public static <T> void write(GraphIndex<T> graph,
+                                 RandomAccessVectorValues<T> vectors,
+                                 PQVectors pqVectors,
+                                 int[] oldToNewOrdinals,
+                                 Path outputPath,
+                                 ForkJoinPool executor)
+            throws IOException
+    {
+        write(graph, vectors, pqVectors, oldToNewOrdinals, VectorEncoding.FLOAT32, outputPath, executor);
+    }
+
+    /**
+     * As {@link #write(GraphIndex, RandomAccessVectorValues, PQVectors, int[], Path, ForkJoinPool)}, storing the
+     * vectors with `vectorEncoding`: FLOAT32, or FLOAT16 to round them to half precision and halve their size.
+     */
+    public static <T> void write(GraphIndex<T> graph,
+                                 RandomAccessVectorValues<T> vectors,
+                                 PQVectors pqVectors,
+                                 int[] oldToNewOrdinals,
+                                 VectorEncoding vectorEncoding,
+                                 Path outputPath,
+                                 ForkJoinPool executor)
+            throws IOException
+    {
+        write(graph, vectors, pqVectors, oldToNewOrdinals, vectorEncoding, false, outputPath, executor);
+    }
+
+    /**
+     * As {@link #write(GraphIndex, RandomAccessVectorValues, PQVectors, int[], VectorEncoding, Path, ForkJoinPool)},
+     * optionally with compressed adjacency lists; see
+     * {@link OnDiskGraphIndex#write(GraphIndex, RandomAccessVectorValues, PQVectors, java.util.Map, VectorEncoding, boolean, java.io.DataOutput)}
+     */
+    public static <T> void write(GraphIndex<T> graph,
+                                 RandomAccessVectorValues<T> vectors,
+                                 PQVectors pqVectors,
+                                 int[] oldToNewOrdinals,
+                                 VectorEncoding vectorEncoding,
+                                 boolean compressedAdjacency,
+                                 Path outputPath,
+                                 ForkJoinPool executor)
+            throws IOException
+    {
+        OnDiskGraphIndex.checkVectorEncoding(vectorEncoding);
+        if (graph instanceof OnHeapGraphIndex) {
+            var ohgi = (OnHeapGraphIndex<T>) graph;
+            if (ohgi.getDeletedNodes().cardinality() > 0) {
+                throw new IllegalArgumentException("Run builder.cleanup() before writing the graph");
+            }
+        }
+        int size = graph.size();
+        int[] newToOldOrdinals = invert(oldToNewOrdinals, size);
+
+        int dimension = vectors.dimension();
+        int maxDegree = graph.maxDegree();
+        int pqCodeSize = pqVectors == null ? 0 : pqVectors.getProductQuantization().getSubspaceCount();
+        long recordSize = OnDiskGraphIndex.recordSize(dimension, vectorEncoding, pqCodeSize, maxDegree, compressedAdjacency);
+        int maxAdjacencySize = OnDiskGraphIndex.maxAdjacencySize(maxDegree, pqCodeSize);
+        if (recordSize > TARGET_BATCH_BYTES || maxAdjacencySize > TARGET_BATCH_BYTES) {
+            throw new IllegalArgumentException("Node records of " + recordSize + " bytes are too large");
+        }
+        int recordsPerBatch = (int) (TARGET_BATCH_BYTES / recordSize);
+        // compressed lists are batched by their largest possible size, so a batch always fits in the buffer
+        int listsPerBatch = TARGET_BATCH_BYTES / maxAdjacencySize;
+        int bufferSize = Math.max((int) (recordsPerBatch * recordSize), compressedAdjacency ? listsPerBatch * maxAdjacencySize : 0);
+
+        try (var channel = FileChannel.open(outputPath, StandardOpenOption.CREATE, StandardOpenOption.WRITE, StandardOpenOption.TRUNCATE_EXISTING)) {
+            int entryNode;
+            int[] entryPoints;
+            try (var view = graph.getView()) {
+                entryNode = view.entryNode() < 0 ? -1 : oldToNewOrdinals[view.entryNode()];
+                entryPoints = Arrays.stream(view.entryPoints())
+                                    .filter(graph::containsNode)
+                                    .map(node -> oldToNewOrdinals[node])
+                                    .toArray();
+            } catch (Exception e) {
+                throw new IOException(e);
+            }
+            var header = header(size, dimension, entryNode, entryPoints, maxDegree, vectorEncoding, compressedAdjacency, pqVectors);
+            writeFully(channel, header, 0);
+            long nodesOffset = header.capacity();
+
+            // idle RecordWriters; there will be about as many as there are threads in the executor
+            var writers = new ConcurrentLinkedQueue<RecordWriter<T>>();
+            int batchCount = (size + recordsPerBatch - 1) / recordsPerBatch;
+            try {
+                executor.submit(() -> IntStream.range(0, batchCount).parallel().forEach(batch -> {
+                    int start = batch * recordsPerBatch;
+                    int end = Math.min(size, start + recordsPerBatch);
+                    var writer = writers.poll();
+                    if (writer == null) {
+                        writer = new RecordWriter<>(graph, vectors, pqVectors, vectorEncoding, compressedAdjacency, bufferSize);
+                    }
+                    try {
+                        var buffer = writer.serialize(start, end, newToOldOrdinals, oldToNewOrdinals);
+                        writeFully(channel, buffer, nodesOffset + start * recordSize);
+                    } catch (IOException e) {
+                        throw new UncheckedIOException(e);
+                    } finally {
+                        writers.offer(writer);
+                    }
+                })).join();
+
+                if (compressedAdjacency) {
+                    writeCompressedAdjacency(channel, nodesOffset + size * recordSize, size, listsPerBatch, writers,
+                                             () -> new RecordWriter<>(graph, vectors, pqVectors, vectorEncoding, true, bufferSize),
+                                             newToOldOrdinals, oldToNewOrdinals, executor);
+                }
+            } catch (UncheckedIOException e) {
+                throw e.getCause();
+            } finally {
+                writers.forEach(RecordWriter::close);
+            }
+        }
+    }
+
+    /**
+     * Writes the offset index of the compressed adjacency lists at `indexOffset`, followed by the lists.  The
+     * first pass measures each batch of lists, so that the second can write each batch at its final position.
+     */
+    private static <T> void writeCompressedAdjacency(FileChannel channel,
+                                                     long indexOffset,
+                                                     int size,
+                                                     int listsPerBatch,
+                                                     ConcurrentLinkedQueue<RecordWriter<T>> writers,
+                                                     Supplier<RecordWriter<T>> newWriter,
+                                                     int[] newToOldOrdinals,
+                                                     int[] oldToNewOrdinals,
+                                                     ForkJoinPool executor)
+            throws IOException
+    {
+        var positions = new long[size + 1];
+        int batchCount = (size + listsPerBatch - 1) / listsPerBatch;
+        forEachBatch(batchCount, writers, newWriter, executor, (writer, batch) -> {
+            int start = batch * listsPerBatch;
+            int end = Math.min(size, start + listsPerBatch);
+            for (int newOrdinal = start; newOrdinal < end; newOrdinal++) {
+                // the length of each list, until it is summed into the positions
+                positions[newOrdinal + 1] = writer.encodeAdjacency(newToOldOrdinals[newOrdinal], oldToNewOrdinals);
+            }
+        });
+        for (int i = 1; i <= size; i++) {
+            positions[i] += positions[i - 1];
+        }
+
+        var index = ByteBuffer.allocate((int) Math.min((long) positions.length * Long.BYTES, TARGET_BATCH_BYTES));
+        long position = indexOffset;
+        for (int i = 0; i < positions.length; ) {
+            index.clear();
+            for (; i < positions.length && index.remaining() >= Long.BYTES; i++) {
+                index.putLong(positions[i]);
+            }
+            index.flip();
+            int length = index.remaining();
+            writeFully(channel, index, position);
+            position += length;
+        }
+
+        long listsOffset = indexOffset + (long) positions.length * Long.BYTES;
+        forEachBatch(batchCount, writers, newWriter, executor, (writer, batch) -> {
+            int start = batch * listsPerBatch;
+            int end = Math.min(size, start + listsPerBatch);
+            var buffer = writer.serializeAdjacency(start, end, newToOldOrdinals, oldToNewOrdinals);
+            writeFully(channel, buffer, listsOffset + positions[start]);
+        });
+    }
+
+    private interface BatchTask<T> {
+        void run(RecordWriter<T> writer, int batch) throws IOException;
+    }
+
+    private static <T> void forEachBatch(int batchCount,
+                                         ConcurrentLinkedQueue<RecordWriter<T>> writers,
+                                         Supplier<RecordWriter<T>> newWriter,
+                                         ForkJoinPool executor,
+                                         BatchTask<T> task)
+    {
+        executor.submit(() -> IntStream.range(0, batchCount).parallel().forEach(batch -> {
+            var writer = writers.poll();
+            if (writer == null) {
+                writer = newWriter.get();
+            }
+            try {
+                task.run(writer, batch);
+            } catch (IOException e) {
+                throw new UncheckedIOException(e);
+            } finally {
+                writers.offer(writer);
+            }
+        })).join();
+    }
+
+    private static int[] invert(int[] oldToNewOrdinals, int size) {
+        int[] newToOld = new int[size];
+        var seen = new FixedBitSet(Math.max(1, size));
+        int count = 0;
+        for (int oldOrdinal = 0; oldOrdinal < oldToNewOrdinals.length; oldOrdinal++) {
+            int newOrdinal = oldToNewOrdinals[oldOrdinal];
+            if (newOrdinal < 0) {
+                continue;
+            }
+            if (newOrdinal >= size || seen.getAndSet(newOrdinal)) {
+                throw new IllegalArgumentException(String.format("oldToNewOrdinals maps %d to invalid or duplicate ordinal %d",
+                                                                 oldOrdinal, newOrdinal));
+            }
+            newToOld[newOrdinal] = oldOrdinal;
+            count++;
+        }
+        if (count != size) {
+            throw new IllegalArgumentException(String.format("oldToNewOrdinals maps %d nodes but graph size is %d", count, size));
+        }
+        return newToOld;
+    }
+
+    private static ByteBuffer header(int size, int dimension, int entryNode, int[] entryPoints, int maxDegree,
+                                     VectorEncoding vectorEncoding, boolean compressedAdjacency, PQVectors pqVectors)
+            throws IOException
+    {
+        var bytes = new ByteArrayOutputStream();
+        var out = new DataOutputStream(bytes);
+        out.writeInt(OnDiskGraphIndex.MAGIC);
+        out.writeInt(OnDiskGraphIndex.CURRENT_VERSION);
+        out.writeInt(size);
+        out.writeInt(dimension);
+        out.writeInt(entryNode);
+        out.writeInt(maxDegree);
+        out.writeInt(vectorEncoding.byteSize);
+        out.writeInt(entryPoints.length);
+        for (int entryPoint : entryPoints) {
+            out.writeInt(entryPoint);
+        }
+        out.writeInt(compressedAdjacency ? OnDiskGraphIndex.COMPRESSED_ADJACENCY : OnDiskGraphIndex.FIXED_ADJACENCY);
+        if (pqVectors == null) {
+            out.writeInt(0);
+        } else {
+            var pqBytes = new ByteArrayOutputStream();
+            pqVectors.getProductQuantization().write(new DataOutputStream(pqBytes));
+            out.writeInt(pqBytes.size());
+            pqBytes.writeTo(out);
+        }
+        out.flush();
+        return ByteBuffer.wrap(bytes.toByteArray());
+    }
+
+    private static void writeFully(FileChannel channel, ByteBuffer buffer, long position) throws IOException {
+        while (buffer.hasRemaining()) {
+            position += channel.write(buffer, position);
+        }
+    }
+
+    /**
+     * Per-thread state for serializing batches of records.  ByteBuffer's default byte order is
+     * big-endian, matching the DataOutput used by OnDiskGraphIndex.write.
+     */
+    private static final class RecordWriter<T> {
+        private final GraphIndex.View<T> view;
+        private final RandomAccessVectorValues<T> vectors;
+        private final PQVectors pqVectors;
+        private final boolean float16;
+        private final boolean compressedAdjacency;
+        private final int maxDegree;
+        private final ByteBuffer buffer;
+        private final byte[] emptyCode;
+        private final int[] originalNeighbors;
+        // scratch for encoding compressed adjacency lists
+        private final long[] sortScratch;
+        private final byte[] encoded;
+
+        RecordWriter(GraphIndex<T> graph,
+                     RandomAccessVectorValues<T> vectors,
+                     PQVectors pqVectors,
+                     VectorEncoding vectorEncoding,
+                     boolean compressedAdjacency,
+                     int bufferSize)
+        {
+            this.view = graph.getView();
+            this.vectors = vectors.isValueShared() ? vectors.copy() : vectors;
+            this.pqVectors = pqVectors;
+            this.float16 = vectorEncoding == VectorEncoding.FLOAT16;
+            this.compressedAdjacency = compressedAdjacency;
+            this.maxDegree = graph.maxDegree();
+            this.buffer = ByteBuffer.allocateDirect(bufferSize);
+            this.emptyCode = pqVectors == null ? null : new byte[pqVectors.getProductQuantization().getSubspaceCount()];
+            this.originalNeighbors = new int[maxDegree];
+            this.sortScratch = compressedAdjacency ? new long[maxDegree] : null;
+            this.encoded = compressedAdjacency ? new byte[OnDiskGraphIndex.maxAdjacencySize(maxDegree, emptyCode == null ? 0 : emptyCode.length)] : null;
+        }
+
+        /**
+         * @return a buffer holding the records for new ordinals [start, end), ready to be written
+         */
+        ByteBuffer serialize(int start, int end, int[] newToOldOrdinals, int[] oldToNewOrdinals) {
+            buffer.clear();
+            for (int newOrdinal = start; newOrdinal < end; newOrdinal++) {
+                int originalOrdinal = newToOldOrdinals[newOrdinal];
+                buffer.putInt(newOrdinal);
+                for (float f : (float[]) vectors.vectorValue(originalOrdinal)) {
+                    if (float16) {
+                        buffer.putShort(Float16.fromFloat(f));
+                    } else {
+                        buffer.putFloat(f);
+                    }
+                }
+                if (pqVectors != null) {
+                    buffer.put(pqVectors.getCompressedVectors(), pqVectors.get(originalOrdinal), emptyCode.length);
+                }
+                if (compressedAdjacency) {
+                    continue;
+                }
+
+                var neighbors = view.getNeighborsIterator(originalOrdinal);
+                int neighborCount = neighbors.size();
+                if (neighborCount > maxDegree) {
+                    throw new IllegalStateException(String.format("Node %d has %d neighbors, more than the max degree %d",
+                                                                  originalOrdinal, neighborCount, maxDegree));
+                }
+                buffer.putInt(neighborCount);
+                int n = 0;
+                for (; n < neighborCount; n++) {
+                    originalNeighbors[n] = neighbors.nextInt();
+                    buffer.putInt(oldToNewOrdinals[originalNeighbors[n]]);
+                }
+                for (; n < maxDegree; n++) {
+                    buffer.putInt(-1);
+                }
+
+                if (pqVectors != null) {
+                    for (n = 0; n < neighborCount; n++) {
+                        buffer.put(pqVectors.getCompressedVectors(), pqVectors.get(originalNeighbors[n]), emptyCode.length);
+                    }
+                    for (; n < maxDegree; n++) {
+                        buffer.put(emptyCode);
+                    }
+                }
+            }
+            return buffer.flip();
+        }
+
+        /**
+         * Encodes the compressed adjacency list of `originalOrdinal` into `encoded`
+         *
+         * @return its length
+         */
+        int encodeAdjacency(int originalOrdinal, int[] oldToNewOrdinals) {
+            return AdjacencyCodec.encodeNode(view, originalOrdinal, maxDegree, node -> oldToNewOrdinals[node], pqVectors,
+                                             sortScratch, originalNeighbors, encoded);
+        }
+
+        /**
+         * @return a buffer holding the compressed adjacency lists of new ordinals [start, end), ready to be written
+         */
+        ByteBuffer serializeAdjacency(int start, int end, int[] newToOldOrdinals, int[] oldToNewOrdinals) {
+            buffer.clear();
+            for (int newOrdinal = start; newOrdinal < end; newOrdinal++) {
+                int length = encodeAdjacency(newToOldOrdinals[newOrdinal], oldToNewOrdinals);
+                buffer.put(encoded, 0, length);
+            }
+            return buffer.flip();
+        }
+
+        void close() {
+            try {
+                view.close();
+            } catch (Exception e) {
+                throw new RuntimeException(e);
+            }
+        }
+    }
+}
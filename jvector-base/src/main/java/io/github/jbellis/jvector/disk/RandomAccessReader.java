@@ -16,6 +16,8 @@
 
 package io.github.jbellis.jvector.disk;
 
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
+
 import java.io.IOException;
 
 /**
@@ -33,7 +35,51 @@ public interface RandomAccessReader extends AutoCloseable {
 
     void readFully(long[] vector) throws IOException;
 
+    /**
+     * Reads big-endian shorts, e.g. half-precision vectors.  The default implementation reads them as bytes
+     * and assembles them; readers with direct access to their storage should override it.
+     */
+    default void readFully(short[] shorts) throws IOException {
+        var bytes = new byte[shorts.length * Short.BYTES];
+        readFully(bytes);
+        for (int i = 0; i < shorts.length; i++) {
+            shorts[i] = (short) ((bytes[2 * i] << 8) | (bytes[2 * i + 1] & 0xff));
+        }
+    }
+
     void read(int[] ints, int offset, int count) throws IOException;
 
+    /**
+     * Reads `count` bytes into `bytes` starting at `offset`, e.g. a variable-length record into a reusable buffer.
+     * The default implementation reads them into a temporary array; readers should override it to copy directly.
+     */
+    default void read(byte[] bytes, int offset, int count) throws IOException {
+        var temp = new byte[count];
+        readFully(temp);
+        System.arraycopy(temp, 0, bytes, offset, count);
+    }
+
+    /**
+     * Computes the similarity between `query` and the float vector of the same dimension stored at `offset`.
+     * The position of the reader afterwards is unspecified.
+     * <p>
+     * The default implementation reads the vector into `scratch`, which must be the same length as `query`;
+     * readers whose storage can be scored in place override this to avoid the copy.
+     */
+    default float similarityTo(float[] query, long offset, VectorSimilarityFunction similarityFunction, float[] scratch) throws IOException {
+        seek(offset);
+        readFully(scratch);
+        return similarityFunction.compare(query, scratch);
+    }
+
+    /**
+     * Hint that the `length` bytes at each of the first `count` entries of `offsets` will be read soon.
+     * Readers backed by storage with high latency can use this to issue all the reads at once
+     * (e.g. madvise, or asynchronous reads into a buffer) instead of serially as they are requested.
+     * The position of the reader is unaffected.  The default implementation does nothing.
+     */
+    default void prefetch(long[] offsets, int count, int length) throws IOException {
+    }
+
     void close() throws IOException;
 }
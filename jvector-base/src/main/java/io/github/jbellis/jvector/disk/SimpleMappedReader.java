@@ -78,11 +78,23 @@ public class SimpleMappedReader implements RandomAccessReader {
         }
     }
 
+    @Override
+    public void readFully(short[] buffer) {
+        for (int i = 0; i < buffer.length; i++) {
+            buffer[i] = mbb.getShort();
+        }
+    }
+
     @Override
     public void readFully(byte[] b) {
         mbb.get(b);
     }
 
+    @Override
+    public void read(byte[] bytes, int offset, int count) {
+        mbb.get(bytes, offset, count);
+    }
+
     @Override
     public void readFully(long[] vector) throws IOException {
         for (int i = 0; i < vector.length; i++) {
@@ -0,0 +1,316 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.graph;
+
+import io.github.jbellis.jvector.util.Bits;
+import io.github.jbellis.jvector.util.PhysicalCoreExecutor;
+
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.ForkJoinTask;
+import java.util.concurrent.atomic.AtomicIntegerArray;
+import java.util.concurrent.atomic.AtomicReferenceArray;
+
+/**
+ * Searches a graph for a batch of queries at once.
+ * <p>
+ * Each query is its own task on the executor, so idle threads steal queries from busy ones and a slow query
+ * holds up only itself.  Searchers (and their Views) are reused across the queries that run on a thread.
+ * Unless the graph is an OnHeapGraphIndex, whose adjacency lists are already in memory, the queries of a batch
+ * also share the adjacency lists they read: the first query to expand a node fetches its neighbors, and the
+ * others reuse them.  Queries in a batch tend to be related and to start from the same entry point, so they
+ * expand many of the same nodes near it.  The shared lists live only as long as the batch.
+ * <p>
+ * Each query's score function is built by a {@link QueryScorer} on the thread that searches for it, because
+ * many score functions are only safe on the thread (and View) they were built for: those of
+ * {@link io.github.jbellis.jvector.pq.PQDecoder#newDecoder} share a per-thread lookup table, and those of an
+ * on-disk graph with inline PQ codes share the scratch of their View.  For PQ-compressed searches, the score
+ * functions from {@link io.github.jbellis.jvector.pq.PQVectors#approximateScoreFunctionsFor} own their lookup
+ * tables, which are built in one pass over the codebooks for the whole batch, so they may be built beforehand
+ * and passed as the queries themselves.
+ *
+ * @param <T> the type of vector
+ */
+public class BatchSearcher<T> {
+    // the number of distinct nodes a query is expected to expand, to size the shared adjacency lists
+    private static final int EXPANDED_PER_QUERY = 512;
+    // the most adjacency lists a batch shares
+    private static final int MAX_SHARED_NEIGHBORS = 1 << 20;
+
+    private final GraphIndex<T> graph;
+    private final ForkJoinPool executor;
+    private final boolean shareNeighbors;
+
+    public BatchSearcher(GraphIndex<T> graph) {
+        this(graph, PhysicalCoreExecutor.pool());
+    }
+
+    public BatchSearcher(GraphIndex<T> graph, ForkJoinPool executor) {
+        this.graph = graph;
+        this.executor = executor;
+        this.shareNeighbors = !(graph instanceof OnHeapGraphIndex);
+    }
+
+    /**
+     * Builds the score function (and reranker) for a query of a batch.  Both methods are called on the
+     * thread that searches for the query, just before it does, with the View of the graph that thread uses,
+     * and what they return is used only by that thread.
+     *
+     * @param <T> the type of vector
+     * @param <Q> the type of query
+     */
+    public interface QueryScorer<T, Q> {
+        NodeSimilarity.ScoreFunction scoreFunctionFor(Q query, GraphIndex.View<T> view);
+
+        /**
+         * @return the reranker for `query`, or null if its score function is exact
+         */
+        default NodeSimilarity.ReRanker rerankerFor(Q query, GraphIndex.View<T> view) {
+            return null;
+        }
+    }
+
+    /**
+     * Searches for each query, as {@link GraphSearcher#search(NodeSimilarity.ScoreFunction, NodeSimilarity.ReRanker, int, Bits)}
+     * with the score function and reranker built for it by `scorer`.
+     *
+     * @return the results of each query, in the same order as queries
+     */
+    public <Q> SearchResult[] search(List<Q> queries, QueryScorer<T, Q> scorer, int topK, Bits acceptOrds)
+    {
+        var results = new SearchResult[queries.size()];
+        var sharedNeighbors = shareNeighbors
+                              ? new SharedNeighbors((int) Math.min(Math.min((long) queries.size() * EXPANDED_PER_QUERY, graph.size()), MAX_SHARED_NEIGHBORS))
+                              : null;
+        var searchers = new ConcurrentLinkedQueue<ThreadSearcher<T>>();
+        var views = new ConcurrentLinkedQueue<GraphIndex.View<T>>();
+        var tasks = new ArrayList<ForkJoinTask<?>>(results.length);
+        for (int i = 0; i < results.length; i++) {
+            int query = i;
+            tasks.add(ForkJoinTask.adapt(() -> {
+                var searcher = searchers.poll();
+                if (searcher == null) {
+                    GraphIndex.View<T> view = graph.getView();
+                    views.add(view);
+                    var searchedView = sharedNeighbors == null ? view : new SharedNeighborsView<>(view, sharedNeighbors);
+                    searcher = new ThreadSearcher<>(view, new GraphSearcher.Builder<>(searchedView).withConcurrentUpdates().build());
+                }
+                try {
+                    var q = queries.get(query);
+                    var scoreFunction = scorer.scoreFunctionFor(q, searcher.view);
+                    var reRanker = scorer.rerankerFor(q, searcher.view);
+                    results[query] = searcher.searcher.search(scoreFunction, reRanker, topK, acceptOrds);
+                } finally {
+                    searchers.offer(searcher);
+                }
+            }));
+        }
+
+        try {
+            executor.submit(() -> ForkJoinTask.invokeAll(tasks)).join();
+        } finally {
+            for (var view : views) {
+                try {
+                    view.close();
+                } catch (Exception e) {
+                    throw new RuntimeException(e);
+                }
+            }
+        }
+        return results;
+    }
+
+    /**
+     * A searcher and the View of the graph (without the shared adjacency lists) that score functions are built for
+     */
+    private static class ThreadSearcher<T> {
+        final GraphIndex.View<T> view;
+        final GraphSearcher<T> searcher;
+
+        ThreadSearcher(GraphIndex.View<T> view, GraphSearcher<T> searcher) {
+            this.view = view;
+            this.searcher = searcher;
+        }
+    }
+
+    /**
+     * The adjacency lists read by a batch, by node: an open-addressed table of primitive keys, so that looking up
+     * a node neither boxes it nor allocates.  The capacity is fixed; lists that do not fit within a few probes of
+     * their slot are not shared.
+     */
+    private static class SharedNeighbors {
+        private static final int MAX_PROBES = 8;
+
+        // node + 1 in each used slot, so that 0 marks an empty one
+        private final AtomicIntegerArray keys;
+        private final AtomicReferenceArray<int[]> values;
+        private final int shift;
+        private final int mask;
+
+        SharedNeighbors(int expectedNodes) {
+            // at most half full
+            int capacity = Integer.highestOneBit(Math.max(8, expectedNodes)) << 2;
+            keys = new AtomicIntegerArray(capacity);
+            values = new AtomicReferenceArray<>(capacity);
+            shift = Integer.numberOfLeadingZeros(capacity) + 1;
+            mask = capacity - 1;
+        }
+
+        private int slot(int node) {
+            // Fibonacci hashing, since neighboring nodes often have close ordinals
+            return (node * 0x9E3779B9) >>> shift;
+        }
+
+        /**
+         * @return the neighbors of `node`, or null if no query has shared them (yet)
+         */
+        int[] get(int node) {
+            int key = node + 1;
+            int slot = slot(node);
+            for (int i = 0; i < MAX_PROBES; i++, slot = (slot + 1) & mask) {
+                int k = keys.get(slot);
+                if (k == key) {
+                    // null if the thread that claimed the slot has not stored the list yet
+                    return values.get(slot);
+                }
+                if (k == 0) {
+                    return null;
+                }
+            }
+            return null;
+        }
+
+        /**
+         * Shares `fetched` as the neighbors of `node`, unless another query already has.
+         *
+         * @return the shared neighbors of `node`, or `fetched` if there is no room to share them
+         */
+        int[] putIfAbsent(int node, int[] fetched) {
+            int key = node + 1;
+            int slot = slot(node);
+            for (int i = 0; i < MAX_PROBES; i++, slot = (slot + 1) & mask) {
+                if (keys.compareAndSet(slot, 0, key)) {
+                    values.set(slot, fetched);
+                    return fetched;
+                }
+                if (keys.get(slot) == key) {
+                    var shared = values.get(slot);
+                    return shared == null ? fetched : shared;
+                }
+            }
+            return fetched;
+        }
+    }
+
+    /**
+     * A View that reads each node's neighbors from the underlying View at most once for all the
+     * SharedNeighborsViews built on the same SharedNeighbors
+     */
+    private static class SharedNeighborsView<T> implements GraphIndex.View<T> {
+        private final GraphIndex.View<T> view;
+        private final SharedNeighbors neighbors;
+        private int[] unfetched = new int[0];
+
+        SharedNeighborsView(GraphIndex.View<T> view, SharedNeighbors neighbors) {
+            this.view = view;
+            this.neighbors = neighbors;
+        }
+
+        @Override
+        public NodesIterator getNeighborsIterator(int node) {
+            var cached = neighbors.get(node);
+            if (cached == null) {
+                var it = view.getNeighborsIterator(node);
+                var fetched = new int[it.size()];
+                for (int i = 0; i < fetched.length; i++) {
+                    fetched[i] = it.nextInt();
+                }
+                cached = neighbors.putIfAbsent(node, fetched);
+            }
+            return new NodesIterator.ArrayNodesIterator(cached, cached.length);
+        }
+
+        @Override
+        public void prefetchNeighbors(int[] nodes, int count) {
+            // only prefetch what no query in the batch has read yet
+            if (unfetched.length < count) {
+                unfetched = new int[count];
+            }
+            int unfetchedCount = 0;
+            for (int i = 0; i < count; i++) {
+                if (neighbors.get(nodes[i]) == null) {
+                    unfetched[unfetchedCount++] = nodes[i];
+                }
+            }
+            if (unfetchedCount > 1) {
+                view.prefetchNeighbors(unfetched, unfetchedCount);
+            }
+        }
+
+        @Override
+        public int size() {
+            return view.size();
+        }
+
+        @Override
+        public int entryNode() {
+            return view.entryNode();
+        }
+
+        @Override
+        public int[] entryPoints() {
+            return view.entryPoints();
+        }
+
+        @Override
+        public T getVector(int node) {
+            return view.getVector(node);
+        }
+
+        @Override
+        public Bits liveNodes() {
+            return view.liveNodes();
+        }
+
+        @Override
+        public int getIdUpperBound() {
+            return view.getIdUpperBound();
+        }
+
+        @Override
+        public boolean containsNode(int node) {
+            return view.containsNode(node);
+        }
+
+        @Override
+        public long bytesRead() {
+            return view.bytesRead();
+        }
+
+        @Override
+        public long cacheHits() {
+            return view.cacheHits();
+        }
+
+        @Override
+        public void close() throws Exception {
+            view.close();
+        }
+    }
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.graph;
+
+import io.github.jbellis.jvector.annotations.Experimental;
+
+import java.util.concurrent.atomic.LongAccumulator;
+import java.util.concurrent.atomic.LongAdder;
+
+/**
+ * Where a GraphIndexBuilder spends its time, and how much its inserts contend with each other, to find
+ * what limits a build's scaling.  See {@link GraphIndexBuilder#enableCounters()}.
+ * <p>
+ * Times are summed across threads, so with N build threads they add up to about N times the wall-clock
+ * time of the build.
+ */
+@Experimental
+public class BuildCounters {
+    /** the phases of {@link GraphIndexBuilder#addGraphNode} */
+    public enum Phase {
+        /** acquiring the pooled searcher, vectors, and scratch */
+        POOLING,
+        /** snapshotting the set of inserts in progress */
+        IN_PROGRESS_SNAPSHOT,
+        /** searching the graph for neighbor candidates */
+        SEARCH,
+        /** scoring the inserts in progress as candidates */
+        CONCURRENT_CANDIDATES,
+        /** pruning the candidates to a diverse set of neighbors */
+        INSERT_DIVERSE,
+        /** adding the new node to the neighbors of its neighbors */
+        BACKLINK
+    }
+
+    private final LongAdder inserts = new LongAdder();
+    private final LongAdder[] phaseNanos = new LongAdder[Phase.values().length];
+    private final LongAdder concurrentCandidates = new LongAdder();
+    private final LongAccumulator maxConcurrentCandidates = new LongAccumulator(Math::max, 0);
+    private final LongAdder neighborUpdateRetries = new LongAdder();
+    private final LongAdder cleanupNanos = new LongAdder();
+
+    BuildCounters() {
+        for (int i = 0; i < phaseNanos.length; i++) {
+            phaseNanos[i] = new LongAdder();
+        }
+    }
+
+    void addPhase(Phase phase, long nanos) {
+        phaseNanos[phase.ordinal()].add(nanos);
+    }
+
+    void addInsert(int concurrentCandidateCount) {
+        inserts.increment();
+        concurrentCandidates.add(concurrentCandidateCount);
+        maxConcurrentCandidates.accumulate(concurrentCandidateCount);
+    }
+
+    void addNeighborUpdateRetries(int retries) {
+        if (retries > 0) {
+            neighborUpdateRetries.add(retries);
+        }
+    }
+
+    void addCleanup(long nanos) {
+        cleanupNanos.add(nanos);
+    }
+
+    public long insertCount() {
+        return inserts.sum();
+    }
+
+    /**
+     * @return the time spent in `phase`, summed across threads
+     */
+    public long phaseNanos(Phase phase) {
+        return phaseNanos[phase.ordinal()].sum();
+    }
+
+    /**
+     * @return the total, across inserts, of the other inserts that were in progress when each one started
+     */
+    public long concurrentCandidateCount() {
+        return concurrentCandidates.sum();
+    }
+
+    public long maxConcurrentCandidateCount() {
+        return maxConcurrentCandidates.get();
+    }
+
+    /**
+     * @return how many times an update of a node's neighbors was retried (for ConcurrentNeighborSet) or
+     * deferred (for InPlaceNeighborSet) because another thread was updating the same node
+     */
+    public long neighborUpdateRetryCount() {
+        return neighborUpdateRetries.sum();
+    }
+
+    public long cleanupNanos() {
+        return cleanupNanos.sum();
+    }
+
+    @Override
+    public String toString() {
+        var sb = new StringBuilder();
+        long n = Math.max(1, insertCount());
+        sb.append(String.format("BuildCounters(inserts=%d, concurrent candidates avg=%.1f max=%d, neighbor update retries=%d (%.3f/insert), cleanup=%.2fs",
+                                insertCount(), concurrentCandidateCount() / (double) n, maxConcurrentCandidateCount(),
+                                neighborUpdateRetryCount(), neighborUpdateRetryCount() / (double) n, cleanupNanos() / 1e9));
+        for (var phase : Phase.values()) {
+            sb.append(String.format(", %s=%.1fus/insert", phase.name().toLowerCase(), phaseNanos(phase) / 1e3 / n));
+        }
+        return sb.append(')').toString();
+    }
+}
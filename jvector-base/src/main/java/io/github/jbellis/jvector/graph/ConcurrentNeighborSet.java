@@ -25,13 +25,19 @@ import java.util.HashSet;
 import java.util.concurrent.atomic.AtomicBoolean;
 import java.util.concurrent.atomic.AtomicReference;
 import java.util.function.Function;
+import java.util.function.UnaryOperator;
 
 import static java.lang.Math.min;
 
-/** A concurrent set of neighbors that encapsulates diversity/pruning mechanics. */
+/**
+ * A concurrent set of neighbors that encapsulates diversity/pruning mechanics.
+ * <p>
+ * Updates are copy-on-write; see {@link InPlaceNeighborSet} for an alternative that updates the
+ * neighbors in place, which scales better when many threads update the same nodes.
+ */
 public class ConcurrentNeighborSet {
     /** the node id whose neighbors we are storing */
-    private final int nodeId;
+    final int nodeId;
 
     /**
      * We use a copy-on-write NeighborArray to store the neighbors. Even though updating this is
@@ -39,15 +45,17 @@ public class ConcurrentNeighborSet {
      * node's neighbors" is a hot loop in adding to the graph, and NeighborArray can do that much
      * faster: no boxing/unboxing, all the data is stored sequentially instead of having to follow
      * references, and no fancy encoding necessary for node/score.
+     * <p>
+     * Null for subclasses that store the neighbors themselves.
      */
     private final AtomicReference<NodeArray> neighborsRef;
 
-    private final float alpha;
+    final float alpha;
 
-    private final NodeSimilarity similarity;
+    final NodeSimilarity similarity;
 
     /** the maximum number of neighbors we can store */
-    private final int maxConnections;
+    final int maxConnections;
 
     /** the proportion of edges that are diverse at alpha=1.0.  updated by removeAllNonDiverse */
     private float shortEdges = Float.NaN;
@@ -70,15 +78,28 @@ public class ConcurrentNeighborSet {
         this.maxConnections = maxConnections;
         this.similarity = similarity;
         this.alpha = alpha;
-        this.neighborsRef = new AtomicReference<>(neighbors);
+        this.neighborsRef = neighbors == null ? null : new AtomicReference<>(neighbors);
     }
 
     private ConcurrentNeighborSet(ConcurrentNeighborSet old) {
-        this.nodeId = old.nodeId;
-        this.maxConnections = old.maxConnections;
-        this.similarity = old.similarity;
-        this.alpha = old.alpha;
-        neighborsRef = new AtomicReference<>(old.neighborsRef.get());
+        this(old.nodeId, old.maxConnections, old.similarity, old.alpha, old.neighborsRef.get());
+    }
+
+    /**
+     * Replaces the neighbors with `update` applied to them.  `update` must not modify the NodeArray it is
+     * given, and may be called more than once.
+     *
+     * @return the number of times `update` was retried because of a concurrent update
+     */
+    int update(UnaryOperator<NodeArray> update) {
+        int retries = 0;
+        while (true) {
+            var current = neighborsRef.get();
+            if (neighborsRef.compareAndSet(current, update.apply(current))) {
+                return retries;
+            }
+            retries++;
+        }
     }
 
     public float getShortEdges() {
@@ -92,15 +113,19 @@ public class ConcurrentNeighborSet {
     /**
      * For every neighbor X that this node Y connects to, add a reciprocal link from X to Y.
      * If overflow is > 1.0, allow the number of neighbors to exceed maxConnections temporarily.
+     *
+     * @return the total of {@link #insert}'s retries
      */
-    public void backlink(Function<Integer, ConcurrentNeighborSet> neighborhoodOf, float overflow) {
-        NodeArray neighbors = neighborsRef.get();
+    public int backlink(Function<Integer, ConcurrentNeighborSet> neighborhoodOf, float overflow) {
+        NodeArray neighbors = getCurrent();
+        int retries = 0;
         for (int i = 0; i < neighbors.size(); i++) {
             int nbr = neighbors.node[i];
             float nbrScore = neighbors.score[i];
             ConcurrentNeighborSet nbrNbr = neighborhoodOf.apply(nbr);
-            nbrNbr.insert(nodeId, nbrScore, overflow);
+            retries += nbrNbr.insert(nodeId, nbrScore, overflow);
         }
+        return retries;
     }
 
     /**
@@ -109,7 +134,7 @@ public class ConcurrentNeighborSet {
      * the limit may end up being exceeded again.
      */
     public void cleanup() {
-        neighborsRef.getAndUpdate(this::removeAllNonDiverse);
+        update(this::removeAllNonDiverse);
     }
 
     /**
@@ -117,7 +142,7 @@ public class ConcurrentNeighborSet {
      */
     public boolean removeDeletedNeighbors(Bits deletedNodes) {
         AtomicBoolean found = new AtomicBoolean();
-        neighborsRef.getAndUpdate(current -> {
+        update(current -> {
             // build a set of the entries we want to retain
             var toRetain = new FixedBitSet(current.size);
             for (int i = 0; i < current.size; i++) {
@@ -175,13 +200,15 @@ public class ConcurrentNeighborSet {
      * is to any of the already-selected candidates. This is maintained whether those other neighbors
      * were selected by this method, or were added as a "backlink" to a node inserted concurrently
      * that chose this one as a neighbor.
+     *
+     * @return the number of times the update was retried because of a concurrent update
      */
-    public void insertDiverse(NodeArray natural, NodeArray concurrent) {
+    public int insertDiverse(NodeArray natural, NodeArray concurrent) {
         if (natural.size() == 0 && concurrent.size() == 0) {
-            return;
+            return 0;
         }
 
-        neighborsRef.getAndUpdate(current -> {
+        return update(current -> {
             // if either natural or concurrent is empty, skip the merge
             NodeArray toMerge;
             if (concurrent.size == 0) {
@@ -208,7 +235,7 @@ public class ConcurrentNeighborSet {
         // we deliberately do not perform diversity checks here
         // (it will be invoked when the cleanup code calls insertDiverse later
         // with the results of the nn descent rebuild)
-        neighborsRef.getAndUpdate(current -> mergeNeighbors(current, connections));
+        update(current -> mergeNeighbors(current, connections));
     }
 
     void insertNotDiverse(int node, float score, boolean limitConnections) {
@@ -241,7 +268,7 @@ public class ConcurrentNeighborSet {
         return next;
     }
 
-    private BitSet selectDiverse(NodeArray neighbors) {
+    BitSet selectDiverse(NodeArray neighbors) {
         BitSet selected = new FixedBitSet(neighbors.size());
         int nSelected = 0;
 
@@ -360,10 +387,12 @@ public class ConcurrentNeighborSet {
     /**
      * Insert a new neighbor, maintaining our size cap by removing the least diverse neighbor if
      * necessary. "Overflow" is the factor by which to allow going over the size cap temporarily.
+     *
+     * @return the number of times the insert was retried because of a concurrent update
      */
-    public void insert(int neighborId, float score, float overflow) {
+    public int insert(int neighborId, float score, float overflow) {
         assert neighborId != nodeId : "can't add self as neighbor at node " + nodeId;
-        neighborsRef.getAndUpdate(
+        return update(
                 current -> {
                     NodeArray next = current.copy();
                     next.insertSorted(neighborId, score);
@@ -403,7 +432,7 @@ public class ConcurrentNeighborSet {
         return true;
     }
 
-    private NodeArray removeAllNonDiverse(NodeArray neighbors) {
+    NodeArray removeAllNonDiverse(NodeArray neighbors) {
         if (neighbors.size <= maxConnections) {
             return neighbors;
         }
@@ -0,0 +1,114 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.graph;
+
+import io.github.jbellis.jvector.util.Accountable;
+import io.github.jbellis.jvector.util.RamUsageEstimator;
+import io.github.jbellis.jvector.vector.Float16;
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
+
+/**
+ * Float vectors stored at half precision (see {@link io.github.jbellis.jvector.vector.VectorEncoding#FLOAT16}),
+ * in one contiguous array, taking half the memory of float[] vectors.
+ * <p>
+ * vectorValue decodes into a buffer that is shared by this instance, so use a copy per thread.  Searches
+ * should prefer {@link #scoreFunctionFor}, which scores the half-precision values directly.
+ */
+public class Float16VectorValues implements RandomAccessVectorValues<float[]>, Accountable {
+    private final short[] vectors;
+    private final int size;
+    private final int dimension;
+    private final float[] buffer;
+
+    /**
+     * Rounds each of `ravv`'s vectors to half precision.
+     */
+    public static Float16VectorValues encode(RandomAccessVectorValues<float[]> ravv) {
+        int dimension = ravv.dimension();
+        var vectors = new short[Math.multiplyExact(ravv.size(), dimension)];
+        for (int i = 0; i < ravv.size(); i++) {
+            Float16.encode(ravv.vectorValue(i), vectors, i * dimension);
+        }
+        return new Float16VectorValues(vectors, ravv.size(), dimension);
+    }
+
+    /**
+     * @param vectors the half-precision values of `size` vectors of `dimension` values each, one after another
+     */
+    public Float16VectorValues(short[] vectors, int size, int dimension) {
+        if (vectors.length != (long) size * dimension) {
+            throw new IllegalArgumentException(String.format("Expected %d values for %d vectors of dimension %d, got %d",
+                                                             (long) size * dimension, size, dimension, vectors.length));
+        }
+        this.vectors = vectors;
+        this.size = size;
+        this.dimension = dimension;
+        this.buffer = new float[dimension];
+    }
+
+    @Override
+    public int size() {
+        return size;
+    }
+
+    @Override
+    public int dimension() {
+        return dimension;
+    }
+
+    /**
+     * @return the vector, converted to floats in a buffer that is overwritten by the next call
+     */
+    @Override
+    public float[] vectorValue(int targetOrd) {
+        Float16.decode(vectors, targetOrd * dimension, buffer);
+        return buffer;
+    }
+
+    @Override
+    public boolean isValueShared() {
+        return true;
+    }
+
+    @Override
+    public Float16VectorValues copy() {
+        return new Float16VectorValues(vectors, size, dimension);
+    }
+
+    /**
+     * @return the half-precision values of all the vectors; vector i starts at i * dimension()
+     */
+    public short[] getVectors() {
+        return vectors;
+    }
+
+    /**
+     * @return a score function comparing `query` to the stored vectors without converting them to floats.
+     * Unlike vectorValue, it shares no state, so it may be used from any thread.
+     */
+    public NodeSimilarity.ExactScoreFunction scoreFunctionFor(float[] query, VectorSimilarityFunction similarityFunction) {
+        if (query.length != dimension) {
+            throw new IllegalArgumentException(String.format("Query dimension %d does not match %d", query.length, dimension));
+        }
+        return node2 -> similarityFunction.compareFloat16(query, vectors, node2 * dimension);
+    }
+
+    @Override
+    public long ramBytesUsed() {
+        return RamUsageEstimator.sizeOf(vectors) + RamUsageEstimator.sizeOf(buffer) + 2 * Integer.BYTES;
+    }
+}
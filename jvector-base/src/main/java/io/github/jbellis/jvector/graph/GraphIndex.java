@@ -39,6 +39,8 @@ import java.io.IOException;
  * in a View that should be created per accessing thread.
  */
 public interface GraphIndex<T> extends AutoCloseable {
+    int[] NO_ENTRY_POINTS = new int[0];
+
     /** Returns the number of nodes in the graph */
     int size();
 
@@ -95,6 +97,16 @@ public interface GraphIndex<T> extends AutoCloseable {
          */
         int entryNode();
 
+        /**
+         * @return nodes spread across the graph that searches score alongside entryNode() before they start,
+         * so that they begin near the query instead of working their way out from a single entry node.  The
+         * array must not be modified.  The default implementation, for graphs without them, returns an
+         * empty array.
+         */
+        default int[] entryPoints() {
+            return NO_ENTRY_POINTS;
+        }
+
         /**
          * Retrieve the vector associated with a given node.
          * <p>
@@ -116,6 +128,39 @@ public interface GraphIndex<T> extends AutoCloseable {
         default int getIdUpperBound() {
             return size();
         }
+
+        /**
+         * @return true if `node` is an ordinal in the graph.  Searches that enumerate ordinals below
+         * getIdUpperBound instead of following edges use this to skip the holes (if any) in the ordinal
+         * sequence.  The default implementation, for graphs without holes, returns true.
+         */
+        default boolean containsNode(int node) {
+            return true;
+        }
+
+        /**
+         * @return the bytes this view has read from storage since it was created, for {@link SearchStats}.
+         * The default implementation, for views that do not read from storage, returns 0.
+         */
+        default long bytesRead() {
+            return 0;
+        }
+
+        /**
+         * @return the reads this view has served from a cache since it was created, for {@link SearchStats}.
+         * The default implementation, for views without a cache, returns 0.
+         */
+        default long cacheHits() {
+            return 0;
+        }
+
+        /**
+         * Hint that the neighbors of the first `count` entries of `nodes` are about to be read, so
+         * that a disk-backed View can fetch them all concurrently instead of one at a time as
+         * getNeighborsIterator is called.  The default implementation does nothing.
+         */
+        default void prefetchNeighbors(int[] nodes, int count) {
+        }
     }
 
     static <T> String prettyPrint(GraphIndex<T> graph) {
@@ -16,19 +16,32 @@
 
 package io.github.jbellis.jvector.graph;
 
+import io.github.jbellis.jvector.annotations.Experimental;
 import io.github.jbellis.jvector.annotations.VisibleForTesting;
 import io.github.jbellis.jvector.disk.RandomAccessReader;
+import io.github.jbellis.jvector.pq.CompressedVectors;
+import io.github.jbellis.jvector.pq.MiniBatchKMeansClusterer;
 import io.github.jbellis.jvector.util.AtomicFixedBitSet;
 import io.github.jbellis.jvector.util.Bits;
+import io.github.jbellis.jvector.util.FixedBitSet;
 import io.github.jbellis.jvector.util.PhysicalCoreExecutor;
 import io.github.jbellis.jvector.util.PoolingSupport;
+import io.github.jbellis.jvector.util.SynchronizedGrowableBitSet;
 import io.github.jbellis.jvector.vector.VectorEncoding;
 import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
 import io.github.jbellis.jvector.vector.VectorUtil;
 
+import java.io.ByteArrayOutputStream;
+import java.io.DataOutput;
+import java.io.DataOutputStream;
 import java.io.IOException;
+import java.nio.ByteBuffer;
 import java.util.ArrayDeque;
+import java.util.Arrays;
+import java.util.ArrayList;
 import java.util.HashSet;
+import java.util.LinkedHashSet;
+import java.util.List;
 import java.util.Objects;
 import java.util.Random;
 import java.util.Set;
@@ -36,6 +49,8 @@ import java.util.concurrent.ConcurrentSkipListSet;
 import java.util.concurrent.ForkJoinPool;
 import java.util.concurrent.ThreadLocalRandom;
 import java.util.concurrent.atomic.AtomicInteger;
+import java.util.function.IntSupplier;
+import java.util.zip.CRC32;
 import java.util.stream.IntStream;
 
 import static io.github.jbellis.jvector.util.DocIdSetIterator.NO_MORE_DOCS;
@@ -47,6 +62,12 @@ import static io.github.jbellis.jvector.util.DocIdSetIterator.NO_MORE_DOCS;
  * @param <T> the type of vector
  */
 public class GraphIndexBuilder<T> {
+    // cleanup() clusters at most this many vectors per entry point to choose them
+    private static final int ENTRY_POINT_SAMPLES_PER_CLUSTER = 256;
+    private static final int ENTRY_POINT_K_MEANS_EPOCHS = 6;
+    // begins each record written by checkpoint()
+    private static final int CHECKPOINT_MAGIC = 0xC4EC9017;
+
     private final int beamWidth;
     private final PoolingSupport<NodeArray> naturalScratch;
     private final PoolingSupport<NodeArray> concurrentScratch;
@@ -69,11 +90,31 @@ public class GraphIndexBuilder<T> {
     private final PoolingSupport<RandomAccessVectorValues<T>> vectorsCopy;
     private final int dimension; // for convenience so we don't have to go to the pool for this
     private final NodeSimilarity similarity;
+    // if not null, searches for neighbor candidates are scored against these instead of the full vectors
+    private final CompressedVectors compressedVectors;
 
     private final ForkJoinPool simdExecutor;
     private final ForkJoinPool parallelExecutor;
 
     private final AtomicInteger updateEntryNodeIn = new AtomicInteger(10_000);
+    // how many entry points cleanup() chooses in addition to the medoid
+    private volatile int entryPointCount;
+
+    // if set, neighbors are stored in InPlaceNeighborSets instead of copy-on-write ConcurrentNeighborSets,
+    // which scales better with many build threads
+    private final boolean inPlaceNeighbors;
+
+    // null unless enableCounters() has been called
+    private volatile BuildCounters counters;
+
+    // nodes whose insert has finished, which are the ones a checkpoint includes
+    private final SynchronizedGrowableBitSet completedNodes = new SynchronizedGrowableBitSet(0);
+    // hash of the neighbors of each node as of the last checkpoint, or 0 if it was not in it
+    private long[] checkpointedHashes = new long[0];
+
+    // state of an in-progress repairDeletions pass: the deleted nodes being removed, and the next node to examine
+    private FixedBitSet repairing;
+    private int repairCursor;
 
     /**
      * Reads all the vectors from vector values, builds a graph connecting them by their dense
@@ -128,6 +169,72 @@ public class GraphIndexBuilder<T> {
             float alpha,
             ForkJoinPool simdExecutor,
             ForkJoinPool parallelExecutor) {
+        this(vectorValues, vectorEncoding, similarityFunction, M, beamWidth, neighborOverflow, alpha, null,
+                simdExecutor, parallelExecutor);
+    }
+
+    /**
+     * Builds a graph whose searches for neighbor candidates traverse the graph using `compressedVectors`,
+     * reading the full-precision vectors from `vectorValues` only to rerank the candidates that are found and
+     * to prune them to a diverse set of neighbors.  This bounds the random reads of full vectors per insert to
+     * roughly beamWidth * M, so `vectorValues` can be backed by disk while only the compressed vectors are held
+     * in memory.
+     *
+     * @param compressedVectors compressed versions of all the vectors in `vectorValues`, e.g. a
+     *                          {@link io.github.jbellis.jvector.pq.PQVectors}.  Only FLOAT32 vectors are supported.
+     * @see #GraphIndexBuilder(RandomAccessVectorValues, VectorEncoding, VectorSimilarityFunction, int, int, float, float)
+     */
+    public GraphIndexBuilder(
+            RandomAccessVectorValues<T> vectorValues,
+            VectorEncoding vectorEncoding,
+            VectorSimilarityFunction similarityFunction,
+            int M,
+            int beamWidth,
+            float neighborOverflow,
+            float alpha,
+            CompressedVectors compressedVectors) {
+        this(vectorValues, vectorEncoding, similarityFunction, M, beamWidth, neighborOverflow, alpha, compressedVectors,
+                PhysicalCoreExecutor.pool(), ForkJoinPool.commonPool());
+    }
+
+    /**
+     * @param compressedVectors if not null, compressed versions of all the vectors in `vectorValues`, to use
+     *                          when searching for neighbor candidates; see
+     *                          {@link #GraphIndexBuilder(RandomAccessVectorValues, VectorEncoding, VectorSimilarityFunction, int, int, float, float, CompressedVectors)}
+     * @see #GraphIndexBuilder(RandomAccessVectorValues, VectorEncoding, VectorSimilarityFunction, int, int, float, float, ForkJoinPool, ForkJoinPool)
+     */
+    public GraphIndexBuilder(
+            RandomAccessVectorValues<T> vectorValues,
+            VectorEncoding vectorEncoding,
+            VectorSimilarityFunction similarityFunction,
+            int M,
+            int beamWidth,
+            float neighborOverflow,
+            float alpha,
+            CompressedVectors compressedVectors,
+            ForkJoinPool simdExecutor,
+            ForkJoinPool parallelExecutor) {
+        this(vectorValues, vectorEncoding, similarityFunction, M, beamWidth, neighborOverflow, alpha, compressedVectors,
+                simdExecutor, parallelExecutor, false);
+    }
+
+    /**
+     * @param inPlaceNeighbors if true, neighbors are stored in {@link InPlaceNeighborSet}s, which update in place
+     *                         under a lock instead of copy-on-write and scale better with many build threads
+     * @see #GraphIndexBuilder(RandomAccessVectorValues, VectorEncoding, VectorSimilarityFunction, int, int, float, float, CompressedVectors, ForkJoinPool, ForkJoinPool)
+     */
+    public GraphIndexBuilder(
+            RandomAccessVectorValues<T> vectorValues,
+            VectorEncoding vectorEncoding,
+            VectorSimilarityFunction similarityFunction,
+            int M,
+            int beamWidth,
+            float neighborOverflow,
+            float alpha,
+            CompressedVectors compressedVectors,
+            ForkJoinPool simdExecutor,
+            ForkJoinPool parallelExecutor,
+            boolean inPlaceNeighbors) {
         vectors = vectorValues.isValueShared() ? PoolingSupport.newThreadBased(vectorValues::copy) : PoolingSupport.newNoPooling(vectorValues);
         vectorsCopy = vectorValues.isValueShared() ? PoolingSupport.newThreadBased(vectorValues::copy) : PoolingSupport.newNoPooling(vectorValues);
         dimension = vectorValues.dimension();
@@ -141,9 +248,14 @@ public class GraphIndexBuilder<T> {
         if (beamWidth <= 0) {
             throw new IllegalArgumentException("beamWidth must be positive");
         }
+        if (compressedVectors != null && vectorEncoding == VectorEncoding.BYTE) {
+            throw new IllegalArgumentException("Compressed vectors are only supported for float vectors");
+        }
         this.beamWidth = beamWidth;
+        this.compressedVectors = compressedVectors;
         this.simdExecutor = simdExecutor;
         this.parallelExecutor = parallelExecutor;
+        this.inPlaceNeighbors = inPlaceNeighbors;
 
         similarity = node1 -> {
             try (var v = vectors.get(); var vc = vectorsCopy.get()) {
@@ -153,8 +265,10 @@ public class GraphIndexBuilder<T> {
         };
         this.graph =
                 new OnHeapGraphIndex<>(
-                        M, (node, m) -> new ConcurrentNeighborSet(node, m, similarity, alpha));
-        this.graphSearcher = PoolingSupport.newThreadBased(() -> new GraphSearcher.Builder<>(graph.getView()).withConcurrentUpdates().build());
+                        M, (node, m) -> inPlaceNeighbors
+                                        ? new InPlaceNeighborSet(node, m, similarity, alpha, neighborOverflow)
+                                        : new ConcurrentNeighborSet(node, m, similarity, alpha));
+        this.graphSearcher = PoolingSupport.newThreadBased(() -> new GraphSearcher.Builder<>(graph.getView()).withConcurrentUpdates().withFilterThresholds(0, 0).build());
 
         // in scratch we store candidates in reverse order: worse candidates are first
         this.naturalScratch = PoolingSupport.newThreadBased(() -> new NodeArray(Math.max(beamWidth, M + 1)));
@@ -169,6 +283,9 @@ public class GraphIndexBuilder<T> {
 
         simdExecutor.submit(() -> {
             IntStream.range(0, size).parallel().forEach(i -> {
+                if (graph.containsNode(i)) {
+                    return; // restored by resume()
+                }
                 try (var v1 = vectors.get()) {
                     addGraphNode(i, v1.get());
                 }
@@ -188,11 +305,14 @@ public class GraphIndexBuilder<T> {
      * Must be called before writing to disk.
      * <p>
      * May be called multiple times, but should not be called during concurrent modifications to the graph.
+     * To remove deleted nodes while the graph is being modified, see {@link #repairDeletions}.
      */
     public void cleanup() {
         if (graph.size() == 0) {
             return;
         }
+        var c = counters;
+        long start = c == null ? 0 : System.nanoTime();
         graph.validateEntryNode(); // sanity check before we start
 
         // purge deleted nodes.
@@ -218,7 +338,11 @@ public class GraphIndexBuilder<T> {
 
         // optimize entry node
         graph.updateEntryNode(approximateMedioid());
+        graph.updateEntryPoints(chooseEntryPoints());
         updateEntryNodeIn.set(graph.size()); // in case the user goes on to add more nodes after cleanup()
+        if (c != null) {
+            c.addCleanup(System.nanoTime() - start);
+        }
     }
 
     private void reconnectOrphanedNodes() {
@@ -246,8 +370,7 @@ public class GraphIndexBuilder<T> {
                         // search for the closest neighbors
                         var notSelfBits = createNotSelfBits(node);
                         var value = v1.get().vectorValue(node);
-                        NodeSimilarity.ExactScoreFunction scoreFunction = i1 -> scoreBetween(v2.get().vectorValue(i1), value);
-                        var result = gs.get().searchInternal(scoreFunction, null, beamWidth, 0.0f, graph.entry(), notSelfBits).getNodes();
+                        var result = searchForCandidates(gs.get(), v2.get(), value, notSelfBits).getNodes();
                         // connect this node to the closest neighbor that hasn't already been used as a connection target
                         // (since this edge is likely to be the "worst" one in that target's neighborhood, it's likely to be
                         // overwritten by the next node to need reconnection if we don't enforce uniqueness)
@@ -287,6 +410,46 @@ public class GraphIndexBuilder<T> {
         return graph;
     }
 
+    /**
+     * Has cleanup() choose `count` entry points in addition to the medoid entry node: the nodes nearest the
+     * centroids of a k-means clustering of the vectors.  Searches score all of them before they start, and so
+     * begin in the query's region of the graph instead of spending their first hops leaving the medoid's,
+     * which matters most on clustered datasets.  The entry points are written with the graph by
+     * OnDiskGraphIndex.write and OnDiskGraphIndexWriter.  Byte vectors are not supported, and 0, the default,
+     * disables them.
+     */
+    @Experimental
+    public void setEntryPointCount(int count) {
+        if (count < 0) {
+            throw new IllegalArgumentException("entry point count must be non-negative, got " + count);
+        }
+        entryPointCount = count;
+    }
+
+    /**
+     * Starts counting where inserts spend their time and how much they contend with each other, for
+     * profiling.  This adds a few timer calls to each insert, so it is off by default.
+     *
+     * @return the counters, which are updated by the inserts and cleanups that follow
+     */
+    @Experimental
+    public BuildCounters enableCounters() {
+        var c = counters;
+        if (c == null) {
+            c = new BuildCounters();
+            counters = c;
+        }
+        return c;
+    }
+
+    /**
+     * @return the counters started by {@link #enableCounters()}, or null
+     */
+    @Experimental
+    public BuildCounters getCounters() {
+        return counters;
+    }
+
     /**
      * Number of inserts in progress, across all threads.
      */
@@ -307,25 +470,27 @@ public class GraphIndexBuilder<T> {
      */
     public long addGraphNode(int node, RandomAccessVectorValues<T> vectors) {
         final T value = vectors.vectorValue(node);
+        var c = counters;
 
         // do this before adding to in-progress, so a concurrent writer checking
         // the in-progress set doesn't have to worry about uninitialized neighbor sets
         var newNodeNeighbors = graph.addNode(node);
 
+        long start = c == null ? 0 : System.nanoTime();
         insertionsInProgress.add(node);
         ConcurrentSkipListSet<Integer> inProgressBefore = insertionsInProgress.clone();
+        start = endPhase(c, BuildCounters.Phase.IN_PROGRESS_SNAPSHOT, start);
         try (var gs = graphSearcher.get();
              var vc = vectorsCopy.get();
              var naturalScratchPooled = naturalScratch.get();
              var concurrentScratchPooled = concurrentScratch.get())
         {
-            // find ANN of the new node by searching the graph
-            int ep = graph.entry();
-            NodeSimilarity.ExactScoreFunction scoreFunction = i -> scoreBetween(vc.get().vectorValue(i), value);
+            start = endPhase(c, BuildCounters.Phase.POOLING, start);
 
-            var bits = new ExcludingBits(node);
             // find best "natural" candidates with a beam search
-            var result = gs.get().searchInternal(scoreFunction, null, beamWidth, 0.0f, ep, bits);
+            var bits = new ExcludingBits(node);
+            var result = searchForCandidates(gs.get(), vc.get(), value, bits);
+            start = endPhase(c, BuildCounters.Phase.SEARCH, start);
 
             // Update neighbors with these candidates.
             // The DiskANN paper calls for using the entire set of visited nodes along the search path as
@@ -336,7 +501,17 @@ public class GraphIndexBuilder<T> {
             // TODO if we made NeighborArray an interface we could wrap the NodeScore[] directly instead of copying
             var natural = toScratchCandidates(result.getNodes(), result.getNodes().length, naturalScratchPooled.get());
             var concurrent = getConcurrentCandidates(node, inProgressBefore, concurrentScratchPooled.get(), vectors, vc.get());
-            updateNeighbors(newNodeNeighbors, natural, concurrent);
+            start = endPhase(c, BuildCounters.Phase.CONCURRENT_CANDIDATES, start);
+
+            int retries = newNodeNeighbors.insertDiverse(natural, concurrent);
+            start = endPhase(c, BuildCounters.Phase.INSERT_DIVERSE, start);
+            retries += newNodeNeighbors.backlink(graph::getNeighbors, neighborOverflow);
+            endPhase(c, BuildCounters.Phase.BACKLINK, start);
+            if (c != null) {
+                c.addInsert(concurrent.size());
+                c.addNeighborUpdateRetries(retries);
+            }
+            completedNodes.set(node);
 
             maybeUpdateEntryPoint(node);
             maybeImproveOlderNode();
@@ -347,6 +522,20 @@ public class GraphIndexBuilder<T> {
         return graph.ramBytesUsedOneNode();
     }
 
+    /**
+     * Adds the time since `start` to `phase`, if counting
+     *
+     * @return the start of the next phase
+     */
+    private static long endPhase(BuildCounters c, BuildCounters.Phase phase, long start) {
+        if (c == null) {
+            return 0;
+        }
+        long end = System.nanoTime();
+        c.addPhase(phase, end - start);
+        return end;
+    }
+
     /**
      * Improve edge quality on very low-d indexes.  This makes a big difference
      * in the ability of search to escape local maxima to find better options.
@@ -364,7 +553,7 @@ public class GraphIndexBuilder<T> {
             // which generates very sparse ids due to how spliterator works)
             for (int i = 0; i < 3; i++) {
                 var olderNode = ThreadLocalRandom.current().nextInt(graph.size());
-                if (graph.containsNode(olderNode)) {
+                if (graph.containsNode(olderNode) && !graph.getDeletedNodes().get(olderNode)) {
                     improveConnections(olderNode);
                     break;
                 }
@@ -392,15 +581,23 @@ public class GraphIndexBuilder<T> {
             final T value = pv.get().vectorValue(node);
 
             // find ANN of the new node by searching the graph
-            int ep = graph.entry();
-            NodeSimilarity.ExactScoreFunction scoreFunction = i -> scoreBetween(vc.get().vectorValue(i), value);
             var bits = new ExcludingBits(node);
-            var result = gs.get().searchInternal(scoreFunction, null, beamWidth, 0.0f, ep, bits);
+            var result = searchForCandidates(gs.get(), vc.get(), value, bits);
             var natural = toScratchCandidates(result.getNodes(), result.getNodes().length, naturalScratchPooled.get());
             updateNeighbors(graph.getNeighbors(node), natural, NodeArray.EMPTY);
         }
     }
 
+    /**
+     * Adds `candidates` to the neighbors of `node`, which must already be in the graph, as if they had been
+     * found by a search: they are pruned for diversity along with the existing neighbors, and backlinked.
+     * Used by GraphIndexMerger to seed nodes with their adjacency lists from the graphs being merged.
+     */
+    void insertCandidates(int node, NodeArray candidates) {
+        updateNeighbors(graph.getNeighbors(node), candidates, NodeArray.EMPTY);
+        completedNodes.set(node);
+    }
+
     public void markNodeDeleted(int node) {
         graph.markDeleted(node);
     }
@@ -435,34 +632,14 @@ public class GraphIndexBuilder<T> {
             for (var node : liveNodes) {
                 assert !deletedNodes.get(node);
 
-                ConcurrentNeighborSet neighbors = graph.getNeighbors(node);
-                if (!neighbors.removeDeletedNeighbors(deletedNodes)) {
-                    continue;
-                }
-                affectedLiveNodes.add(node);
-
-                // add random connections if we've dropped below minimum
-                int minConnections = 1 + graph.maxDegree() / 2;
-                if (neighbors.size() < minConnections) {
-                    // create a NeighborArray of random connections
-                    NodeArray randomConnections = new NodeArray(graph.maxDegree() - neighbors.size());
-                    // doing actual sampling-without-replacement is expensive so we'll loop a fixed number of times instead
-                    for (int i = 0; i < 2 * graph.maxDegree(); i++) {
-                        int randomNode = liveNodes[R.nextInt(liveNodes.length)];
-                        if (randomNode != node && !randomConnections.contains(randomNode)) {
-                            float score = scoreBetween(v1.get().vectorValue(node), v2.get().vectorValue(randomNode));
-                            randomConnections.insertSorted(randomNode, score);
-                        }
-                        if (randomConnections.size == randomConnections.node.length) {
-                            break;
-                        }
-                    }
-                    neighbors.padWithRandom(randomConnections);
+                if (removeNeighbors(node, deletedNodes, () -> liveNodes[R.nextInt(liveNodes.length)], v1.get(), v2.get())) {
+                    affectedLiveNodes.add(node);
                 }
             }
         }
 
         // update entry node if old one was deleted
+        graph.removeEntryPoints(deletedNodes);
         if (deletedNodes.get(graph.entry())) {
             if (graph.size() > 0) {
                 graph.updateEntryNode(graph.getNodes().nextInt());
@@ -480,6 +657,158 @@ public class GraphIndexBuilder<T> {
         return nRemoved * graph.ramBytesUsedOneNode();
     }
 
+    /**
+     * Removes the neighbors of `node` that are in `toRemove`.  If that leaves it with fewer than the minimum
+     * number of connections, adds random connections to preserve connectivity until it can be repaired.
+     *
+     * @param randomNode supplies candidates for the random connections; ones that are not live are skipped
+     * @return true if any neighbors were removed
+     */
+    private boolean removeNeighbors(int node, Bits toRemove, IntSupplier randomNode, RandomAccessVectorValues<T> v1, RandomAccessVectorValues<T> v2) {
+        ConcurrentNeighborSet neighbors = graph.getNeighbors(node);
+        if (!neighbors.removeDeletedNeighbors(toRemove)) {
+            return false;
+        }
+
+        int minConnections = 1 + graph.maxDegree() / 2;
+        if (neighbors.size() < minConnections) {
+            // create a NeighborArray of random connections
+            NodeArray randomConnections = new NodeArray(graph.maxDegree() - neighbors.size());
+            // doing actual sampling-without-replacement is expensive so we'll loop a fixed number of times instead
+            for (int i = 0; i < 2 * graph.maxDegree(); i++) {
+                int candidate = randomNode.getAsInt();
+                if (candidate != node
+                    && graph.containsNode(candidate)
+                    && !toRemove.get(candidate)
+                    && !randomConnections.contains(candidate))
+                {
+                    float score = scoreBetween(v1.vectorValue(node), v2.vectorValue(candidate));
+                    randomConnections.insertSorted(candidate, score);
+                }
+                if (randomConnections.size == randomConnections.node.length) {
+                    break;
+                }
+            }
+            neighbors.padWithRandom(randomConnections);
+        }
+        return true;
+    }
+
+    /**
+     * Removes nodes marked for deletion a bounded amount of work at a time, so that it can be interleaved
+     * with concurrent inserts and searches instead of stalling them the way {@link #cleanup} does.
+     * <p>
+     * Each pass removes the nodes that were marked deleted when it began.  The pass walks the graph a slice
+     * of `maxNodes` ordinals per call, and only the nodes that have deleted neighbors -- the in-neighbors of
+     * the deleted nodes -- are repaired, by dropping those edges and searching for replacements.  Deleted
+     * nodes are excluded from search results, so no new edges to them are created while the pass is in
+     * progress, and they remain traversable until the pass finishes and removes them from the graph.
+     * Nodes deleted during a pass are removed by the next one.
+     * <p>
+     * Concurrent inserts do not block, but the first and last calls of a pass wait for the inserts already
+     * in progress to finish: at the start, so that every insert running during the pass excludes the
+     * deleted nodes, and at the end, after the nodes are removed, so that they stay excluded (by their
+     * deleted mark) from any insert that may still reach them.
+     * <p>
+     * Unlike cleanup() this does not trim overflowed neighbor lists, reconnect orphaned nodes, or optimize
+     * the entry node, so cleanup() should still be called before writing the graph to disk.
+     *
+     * @param executor the pool in which to repair the nodes of each slice
+     * @param maxNodes the number of ordinals to examine in this call
+     * @return true if there are no more deleted nodes to remove
+     */
+    public synchronized boolean repairDeletions(ForkJoinPool executor, int maxNodes) {
+        if (maxNodes <= 0) {
+            throw new IllegalArgumentException("maxNodes must be positive");
+        }
+        var deletedNodes = graph.getDeletedNodes();
+        if (repairing == null) {
+            if (deletedNodes.cardinality() == 0) {
+                return true;
+            }
+            repairing = new FixedBitSet(graph.getIdUpperBound());
+            for (int i = deletedNodes.nextSetBit(0); i != NO_MORE_DOCS && i < repairing.length(); i = deletedNodes.nextSetBit(i + 1)) {
+                repairing.set(i);
+            }
+            repairCursor = 0;
+            // an insert that started before the nodes were deleted may not be excluding them, and could link to
+            // one after its in-neighbors have been repaired
+            awaitInsertionsInProgress();
+        }
+
+        var toRemove = repairing;
+        // nodes added after the pass began are past the end of `repairing`, and cannot be in it
+        Bits toRemoveBits = new Bits() {
+            @Override
+            public boolean get(int index) {
+                return index < toRemove.length() && toRemove.get(index);
+            }
+
+            @Override
+            public int length() {
+                throw new UnsupportedOperationException();
+            }
+        };
+        int start = repairCursor;
+        int end = (int) Math.min((long) start + maxNodes, toRemove.length());
+        executor.submit(() -> IntStream.range(start, end).parallel().forEach(node -> {
+            if (toRemove.get(node) || !graph.containsNode(node)) {
+                return;
+            }
+            boolean removed;
+            try (var v1 = vectors.get();
+                 var v2 = vectorsCopy.get())
+            {
+                int idUpperBound = graph.getIdUpperBound();
+                removed = removeNeighbors(node, toRemoveBits, () -> ThreadLocalRandom.current().nextInt(idUpperBound), v1.get(), v2.get());
+            }
+            if (removed) {
+                addNNDescentConnections(node);
+            }
+        })).join();
+        repairCursor = end;
+        if (end < toRemove.length()) {
+            return false;
+        }
+
+        // every in-neighbor has been repaired, so nothing links to the nodes being removed
+        graph.removeEntryPoints(toRemoveBits);
+        if (graph.entry() >= 0 && toRemoveBits.get(graph.entry())) {
+            int newEntry = -1;
+            for (var it = graph.getNodes(); it.hasNext(); ) {
+                int node = it.nextInt();
+                if (!deletedNodes.get(node)) {
+                    newEntry = node;
+                    break;
+                }
+            }
+            graph.updateEntryNode(newEntry);
+        }
+        for (int i = toRemove.nextSetBit(0); i != NO_MORE_DOCS; i = i + 1 < toRemove.length() ? toRemove.nextSetBit(i + 1) : NO_MORE_DOCS) {
+            graph.removeNode(i);
+        }
+        // an insert in progress may have reached a removed node before it was unlinked; it is only the deleted
+        // mark that keeps such an insert from linking to it, so the mark stays until those inserts finish
+        awaitInsertionsInProgress();
+        for (int i = toRemove.nextSetBit(0); i != NO_MORE_DOCS; i = i + 1 < toRemove.length() ? toRemove.nextSetBit(i + 1) : NO_MORE_DOCS) {
+            deletedNodes.clear(i);
+        }
+        repairing = null;
+        return deletedNodes.cardinality() == 0;
+    }
+
+    /**
+     * Waits for the inserts in progress when this is called to finish.  Inserts started afterwards are not
+     * waited for.
+     */
+    private void awaitInsertionsInProgress() {
+        for (int node : insertionsInProgress.clone()) {
+            while (insertionsInProgress.contains(node)) {
+                Thread.yield();
+            }
+        }
+    }
+
     /**
      * Search for the given node, then submit all nodes along the search path as candidates for
      * new neighbors.  Standard diversity pruning applies.
@@ -493,8 +822,7 @@ public class GraphIndexBuilder<T> {
              var scratch = naturalScratch.get())
         {
             var value = v1.get().vectorValue(node);
-            NodeSimilarity.ExactScoreFunction scoreFunction = i -> scoreBetween(v2.get().vectorValue(i), value);
-            var result = gs.get().searchInternal(scoreFunction, null, beamWidth, 0.0f, graph.entry(), notSelfBits);
+            var result = searchForCandidates(gs.get(), v2.get(), value, notSelfBits);
             var candidates = toScratchCandidates(result.getNodes(), result.getNodes().length, scratch.get());
             // We use just the topK results as candidates, which is much less expensive than computing scores for
             // the other visited nodes.  See comments in addGraphNode.
@@ -520,7 +848,7 @@ public class GraphIndexBuilder<T> {
     private int approximateMedioid() {
         assert graph.size() > 0;
 
-        if (vectorEncoding != VectorEncoding.FLOAT32) {
+        if (vectorEncoding == VectorEncoding.BYTE) {
             // fill this in when/if we care about byte[] vectors
             return graph.entry();
         }
@@ -537,15 +865,71 @@ public class GraphIndexBuilder<T> {
             VectorUtil.divInPlace(centroid, graph.size());
 
             // search for the node closest to the centroid
-            NodeSimilarity.ExactScoreFunction scoreFunction = i -> scoreBetween(vc.get().vectorValue(i), (T) centroid);
-            var result = gs.get().searchInternal(scoreFunction, null, beamWidth, 0.0f, graph.entry(), Bits.ALL);
+            var result = searchForCandidates(gs.get(), vc.get(), (T) centroid, Bits.ALL);
             return result.getNodes()[0].node;
         }
     }
 
+    /**
+     * @return the nodes nearest the centroids of a k-means clustering of (a sample of) the vectors, excluding
+     * the entry node, or an empty array if entry points are disabled
+     */
+    private int[] chooseEntryPoints() {
+        int k = entryPointCount;
+        if (k == 0 || vectorEncoding == VectorEncoding.BYTE || graph.size() <= k) {
+            return GraphIndex.NO_ENTRY_POINTS;
+        }
+
+        try (var gs = graphSearcher.get();
+             var vc = vectorsCopy.get())
+        {
+            // take every stride-th node, which leaves at least k
+            int stride = (int) Math.max(1, graph.size() / ((long) k * ENTRY_POINT_SAMPLES_PER_CLUSTER));
+            var points = new float[(graph.size() + stride - 1) / stride * dimension];
+            int pointCount = 0;
+            int i = 0;
+            for (var it = graph.getNodes(); it.hasNext(); i++) {
+                int node = it.nextInt();
+                if (i % stride == 0) {
+                    System.arraycopy((float[]) vc.get().vectorValue(node), 0, points, pointCount++ * dimension, dimension);
+                }
+            }
+            points = Arrays.copyOf(points, pointCount * dimension);
+            var centroids = new MiniBatchKMeansClusterer(points, dimension, k).cluster(ENTRY_POINT_K_MEANS_EPOCHS);
+
+            var entryPoints = new LinkedHashSet<Integer>();
+            for (int c = 0; c < k; c++) {
+                var centroid = Arrays.copyOfRange(centroids, c * dimension, (c + 1) * dimension);
+                var result = searchForCandidates(gs.get(), vc.get(), (T) centroid, Bits.ALL).getNodes();
+                if (result.length > 0 && result[0].node != graph.entry()) {
+                    entryPoints.add(result[0].node);
+                }
+            }
+            return entryPoints.stream().mapToInt(Integer::intValue).toArray();
+        }
+    }
+
+    /**
+     * Beam search for the nearest neighbors of `value`.  The results always have exact scores: if the builder
+     * has compressed vectors, the graph is traversed with approximate scores and only the results are
+     * reranked against the full-precision vectors in `vc`.
+     */
+    private SearchResult searchForCandidates(GraphSearcher<?> searcher, RandomAccessVectorValues<T> vc, T value, Bits acceptOrds) {
+        NodeSimilarity.ExactScoreFunction exact = i -> scoreBetween(vc.vectorValue(i), value);
+        if (compressedVectors == null) {
+            return searcher.searchInternal(exact, null, beamWidth, 0.0f, graph.entry(), acceptOrds);
+        }
+        var approximate = compressedVectors.approximateScoreFunctionFor((float[]) value, similarityFunction);
+        return searcher.searchInternal(approximate, exact::similarityTo, beamWidth, 0.0f, graph.entry(), acceptOrds);
+    }
+
     private void updateNeighbors(ConcurrentNeighborSet neighbors, NodeArray natural, NodeArray concurrent) {
-        neighbors.insertDiverse(natural, concurrent);
-        neighbors.backlink(graph::getNeighbors, neighborOverflow);
+        int retries = neighbors.insertDiverse(natural, concurrent);
+        retries += neighbors.backlink(graph::getNeighbors, neighborOverflow);
+        var c = counters;
+        if (c != null) {
+            c.addNeighborUpdateRetries(retries);
+        }
     }
 
     private NodeArray toScratchCandidates(SearchResult.NodeScore[] candidates, int count, NodeArray scratch) {
@@ -584,6 +968,7 @@ public class GraphIndexBuilder<T> {
             case BYTE:
                 return similarityFunction.compare((byte[]) v1, (byte[]) v2);
             case FLOAT32:
+            case FLOAT16: // half-precision vectors are presented as float[], e.g. by Float16VectorValues
                 return similarityFunction.compare((float[]) v1, (float[]) v2);
             default:
                 throw new IllegalArgumentException();
@@ -625,9 +1010,247 @@ public class GraphIndexBuilder<T> {
                 int neighbor = in.readInt();
                 ca.addInOrder(neighbor, similarity.score(node, neighbor));
             }
-            graph.addNode(node, new ConcurrentNeighborSet(node, maxDegree, similarity, alpha, ca));
+            var neighbors = inPlaceNeighbors
+                            ? new InPlaceNeighborSet(node, maxDegree, similarity, alpha, ca)
+                            : new ConcurrentNeighborSet(node, maxDegree, similarity, alpha, ca);
+            graph.addNode(node, neighbors);
+            completedNodes.set(node);
         }
 
         graph.updateEntryNode(entryNode);
     }
+
+    /**
+     * Appends to `out` the changes to the graph since the previous checkpoint: the neighbors of the nodes
+     * that were added or whose neighbors changed, the nodes that were removed, and the entry node, entry
+     * points, and deleted nodes.  The first checkpoint of a builder writes every node.  Successive calls
+     * should append to the same output, which {@link #resume} replays to restore the graph.
+     * <p>
+     * Inserts may continue while a checkpoint is taken.  It includes the nodes whose inserts have finished,
+     * and each node's neighbors are as they were when it was written; on resume, neighbors that are not in
+     * the checkpoint are dropped, so the restored graph is always consistent.  Each checkpoint is written
+     * with a single call to {@link DataOutput#write(byte[])}, and ends with a checksum so that resume
+     * ignores a checkpoint that was only partly written.
+     * <p>
+     * Only one checkpoint is taken at a time.  The neighbors of each node are compared with those of the
+     * previous checkpoint by a 64-bit hash, so a node whose neighbors changed is skipped only if its hash
+     * collides.
+     *
+     * @return the number of nodes whose neighbors were written
+     */
+    @Experimental
+    public synchronized int checkpoint(DataOutput out) throws IOException {
+        int upperBound = graph.getIdUpperBound();
+        if (checkpointedHashes.length < upperBound) {
+            checkpointedHashes = Arrays.copyOf(checkpointedHashes, Math.max(upperBound, checkpointedHashes.length * 3 / 2));
+        }
+
+        var nodes = new ByteArrayOutputStream();
+        var nodesOut = new DataOutputStream(nodes);
+        var removed = new ArrayList<Integer>();
+        var deleted = new ArrayList<Integer>();
+        int nodeCount = 0;
+        int[] neighbors = new int[graph.maxDegree()];
+        for (int node = 0; node < checkpointedHashes.length; node++) {
+            var neighborSet = node < upperBound && completedNodes.get(node) ? graph.getNeighbors(node) : null;
+            if (neighborSet == null) {
+                if (checkpointedHashes[node] != 0) {
+                    removed.add(node);
+                    checkpointedHashes[node] = 0;
+                }
+                continue;
+            }
+            if (graph.getDeletedNodes().get(node)) {
+                deleted.add(node);
+            }
+
+            int n = 0;
+            for (var it = neighborSet.iterator(); it.hasNext(); ) {
+                if (n == neighbors.length) {
+                    neighbors = Arrays.copyOf(neighbors, 2 * n);
+                }
+                neighbors[n++] = it.nextInt();
+            }
+            long hash = neighborsHash(neighbors, n);
+            if (hash == checkpointedHashes[node]) {
+                continue;
+            }
+            checkpointedHashes[node] = hash;
+            nodesOut.writeInt(node);
+            nodesOut.writeInt(n);
+            for (int i = 0; i < n; i++) {
+                nodesOut.writeInt(neighbors[i]);
+            }
+            nodeCount++;
+        }
+        nodesOut.flush();
+
+        var payload = new ByteArrayOutputStream();
+        var payloadOut = new DataOutputStream(payload);
+        payloadOut.writeInt(updateEntryNodeIn.get());
+        payloadOut.writeInt(graph.entry());
+        var entryPoints = graph.getView().entryPoints();
+        payloadOut.writeInt(entryPoints.length);
+        for (int entryPoint : entryPoints) {
+            payloadOut.writeInt(entryPoint);
+        }
+        for (var list : List.of(deleted, removed)) {
+            payloadOut.writeInt(list.size());
+            for (int node : list) {
+                payloadOut.writeInt(node);
+            }
+        }
+        payloadOut.writeInt(nodeCount);
+        nodes.writeTo(payloadOut);
+        payloadOut.flush();
+
+        var crc = new CRC32();
+        crc.update(payload.toByteArray());
+        var record = new ByteArrayOutputStream(payload.size() + 3 * Integer.BYTES);
+        var recordOut = new DataOutputStream(record);
+        recordOut.writeInt(CHECKPOINT_MAGIC);
+        recordOut.writeInt(payload.size());
+        payload.writeTo(recordOut);
+        recordOut.writeInt((int) crc.getValue());
+        recordOut.flush();
+        out.write(record.toByteArray());
+        return nodeCount;
+    }
+
+    /**
+     * @return the payload of the checkpoint at `position`, or null if there is no complete checkpoint there
+     */
+    private static byte[] readCheckpoint(RandomAccessReader in, long position, long length) throws IOException {
+        in.seek(position);
+        if (in.readInt() != CHECKPOINT_MAGIC) {
+            return null;
+        }
+        int payloadLength = in.readInt();
+        if (payloadLength < 0 || position + 3L * Integer.BYTES + payloadLength > length) {
+            return null;
+        }
+        var payload = new byte[payloadLength];
+        in.readFully(payload);
+        var crc = new CRC32();
+        crc.update(payload);
+        return in.readInt() == (int) crc.getValue() ? payload : null;
+    }
+
+    private static long neighborsHash(int[] neighbors, int count) {
+        long hash = count;
+        for (int i = 0; i < count; i++) {
+            hash = (hash + neighbors[i] + 1) * 0x9E3779B97F4A7C15L;
+            hash ^= hash >>> 31;
+        }
+        // 0 means "not checkpointed"
+        return hash == 0 ? 1 : hash;
+    }
+
+    /**
+     * Restores the graph from the checkpoints that {@link #checkpoint} appended to `in`, which must hold
+     * `length` bytes.  A checkpoint that was cut short, e.g. by the process being killed while it was written,
+     * is skipped, but the checkpoints that a resumed builder appended after it are still replayed.  The vectors
+     * of the restored nodes must be available from this builder's vector values, since their neighbors are
+     * rescored.
+     * <p>
+     * To carry on with the build, add the nodes that the restored graph does not contain ({@link #build} skips
+     * those that it does), and go on taking checkpoints by appending to the same output.
+     *
+     * @return the smallest ordinal that the restored graph does not contain: the next node to add, for a build
+     * that inserts its nodes in order
+     */
+    @Experimental
+    public synchronized int resume(RandomAccessReader in, long length) throws IOException {
+        if (graph.size() != 0) {
+            throw new IllegalStateException("Cannot resume into a non-empty graph");
+        }
+
+        // replay the checkpoints: the last neighbors written for each node win
+        int[][] neighbors = new int[0][];
+        var deleted = new HashSet<Integer>();
+        int[] entryPoints = GraphIndex.NO_ENTRY_POINTS;
+        int entryNode = -1;
+        int entryNodeIn = updateEntryNodeIn.get();
+        long position = 0;
+        while (position + 3L * Integer.BYTES <= length) {
+            var payload = readCheckpoint(in, position, length);
+            if (payload == null) {
+                // not the start of a complete checkpoint; look for the next one
+                position++;
+                continue;
+            }
+            position += 3L * Integer.BYTES + payload.length;
+
+            var p = ByteBuffer.wrap(payload);
+            entryNodeIn = p.getInt();
+            entryNode = p.getInt();
+            entryPoints = new int[p.getInt()];
+            p.asIntBuffer().get(entryPoints);
+            p.position(p.position() + entryPoints.length * Integer.BYTES);
+            deleted.clear();
+            for (int i = p.getInt(); i > 0; i--) {
+                deleted.add(p.getInt());
+            }
+            for (int i = p.getInt(); i > 0; i--) {
+                int node = p.getInt();
+                if (node < neighbors.length) {
+                    neighbors[node] = null;
+                }
+            }
+            for (int i = p.getInt(); i > 0; i--) {
+                int node = p.getInt();
+                var nodeNeighbors = new int[p.getInt()];
+                p.asIntBuffer().get(nodeNeighbors);
+                p.position(p.position() + nodeNeighbors.length * Integer.BYTES);
+                if (node >= neighbors.length) {
+                    neighbors = Arrays.copyOf(neighbors, Math.max(node + 1, neighbors.length * 3 / 2));
+                }
+                neighbors[node] = nodeNeighbors;
+            }
+        }
+
+        // rebuild the nodes, dropping neighbors that did not make it into a checkpoint
+        checkpointedHashes = new long[neighbors.length];
+        int[] kept = new int[graph.maxDegree()];
+        for (int node = 0; node < neighbors.length; node++) {
+            if (neighbors[node] == null) {
+                continue;
+            }
+            var ca = new NodeArray(graph.maxDegree());
+            int n = 0;
+            for (int neighbor : neighbors[node]) {
+                if (neighbor < neighbors.length && neighbors[neighbor] != null) {
+                    if (n == kept.length) {
+                        kept = Arrays.copyOf(kept, 2 * n);
+                    }
+                    kept[n++] = neighbor;
+                    ca.addInOrder(neighbor, similarity.score(node, neighbor));
+                }
+            }
+            var neighborSet = inPlaceNeighbors
+                              ? new InPlaceNeighborSet(node, graph.maxDegree(), similarity, alpha, ca)
+                              : new ConcurrentNeighborSet(node, graph.maxDegree(), similarity, alpha, ca);
+            graph.addNode(node, neighborSet);
+            completedNodes.set(node);
+            checkpointedHashes[node] = neighborsHash(kept, n);
+            if (deleted.contains(node)) {
+                graph.markDeleted(node);
+            }
+        }
+
+        if (graph.size() > 0) {
+            if (entryNode < 0 || !graph.containsNode(entryNode)) {
+                entryNode = graph.getNodes().nextInt();
+            }
+            graph.updateEntryNode(entryNode);
+            graph.updateEntryPoints(Arrays.stream(entryPoints).filter(graph::containsNode).toArray());
+            updateEntryNodeIn.set(Math.max(1, entryNodeIn));
+        }
+
+        int next = 0;
+        while (graph.containsNode(next)) {
+            next++;
+        }
+        return next;
+    }
 }
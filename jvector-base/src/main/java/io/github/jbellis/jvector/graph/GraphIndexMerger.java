@@ -0,0 +1,295 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.graph;
+
+import io.github.jbellis.jvector.util.PhysicalCoreExecutor;
+import io.github.jbellis.jvector.vector.VectorEncoding;
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
+
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.ForkJoinPool;
+import java.util.stream.IntStream;
+
+/**
+ * Merges several graphs (typically OnDiskGraphIndex segments) into a single graph, without rebuilding
+ * it from scratch.
+ * <p>
+ * The nodes of segment s are numbered after those of segments 0..s-1 (see {@link #getOldToNewOrdinals}).
+ * Every node is seeded with its existing adjacency list, rescored and pruned for diversity as if it had been
+ * found by a search.  That leaves one connected component per segment, so the nodes outside the largest
+ * segment are then connected to the rest of the graph with the same search that GraphIndexBuilder uses to
+ * improve a node's connections.  Nodes of the largest segment are never searched for, so when one segment
+ * dominates, as it does when compacting small segments into a large one, most of the cost of a rebuild is
+ * avoided.
+ *
+ * @param <T> the type of vector
+ */
+public final class GraphIndexMerger<T> {
+    private final List<? extends GraphIndex<T>> segments;
+    private final int[][] oldToNew;
+    // segment and ordinal within the segment of each merged ordinal
+    private final int[] segmentOf;
+    private final int[] newToOld;
+    private final int largestSegment;
+    private final MergedVectorValues vectors;
+    private final VectorEncoding vectorEncoding;
+    private final VectorSimilarityFunction similarityFunction;
+    private final GraphIndexBuilder<T> builder;
+    private final ForkJoinPool simdExecutor;
+
+    /**
+     * @param segments       the graphs to merge
+     * @param segmentVectors the vectors of each graph, indexed by that graph's ordinals
+     * @see GraphIndexBuilder#GraphIndexBuilder(RandomAccessVectorValues, VectorEncoding, VectorSimilarityFunction, int, int, float, float)
+     */
+    public GraphIndexMerger(List<? extends GraphIndex<T>> segments,
+                            List<? extends RandomAccessVectorValues<T>> segmentVectors,
+                            VectorEncoding vectorEncoding,
+                            VectorSimilarityFunction similarityFunction,
+                            int M,
+                            int beamWidth,
+                            float neighborOverflow,
+                            float alpha)
+    {
+        this(segments, segmentVectors, vectorEncoding, similarityFunction, M, beamWidth, neighborOverflow, alpha,
+             PhysicalCoreExecutor.pool(), ForkJoinPool.commonPool());
+    }
+
+    /**
+     * @see GraphIndexBuilder#GraphIndexBuilder(RandomAccessVectorValues, VectorEncoding, VectorSimilarityFunction, int, int, float, float, ForkJoinPool, ForkJoinPool)
+     */
+    public GraphIndexMerger(List<? extends GraphIndex<T>> segments,
+                            List<? extends RandomAccessVectorValues<T>> segmentVectors,
+                            VectorEncoding vectorEncoding,
+                            VectorSimilarityFunction similarityFunction,
+                            int M,
+                            int beamWidth,
+                            float neighborOverflow,
+                            float alpha,
+                            ForkJoinPool simdExecutor,
+                            ForkJoinPool parallelExecutor)
+    {
+        if (segments.isEmpty() || segments.size() != segmentVectors.size()) {
+            throw new IllegalArgumentException(String.format("Need the same, non-zero number of segments and vectors, got %d and %d",
+                                                             segments.size(), segmentVectors.size()));
+        }
+        int dimension = segmentVectors.get(0).dimension();
+        this.segments = segments;
+        this.vectorEncoding = vectorEncoding;
+        this.similarityFunction = similarityFunction;
+        this.simdExecutor = simdExecutor;
+
+        oldToNew = new int[segments.size()][];
+        long totalSize = 0;
+        int largest = 0;
+        for (int s = 0; s < segments.size(); s++) {
+            var segment = segments.get(s);
+            if (segmentVectors.get(s).dimension() != dimension) {
+                throw new IllegalArgumentException(String.format("Segment %d has dimension %d, expected %d",
+                                                                 s, segmentVectors.get(s).dimension(), dimension));
+            }
+            if (segment.size() > segments.get(largest).size()) {
+                largest = s;
+            }
+            totalSize += segment.size();
+        }
+        if (totalSize > Integer.MAX_VALUE) {
+            throw new IllegalArgumentException("Merged graph would have " + totalSize + " nodes");
+        }
+        largestSegment = largest;
+
+        segmentOf = new int[(int) totalSize];
+        newToOld = new int[(int) totalSize];
+        int nextOrdinal = 0;
+        for (int s = 0; s < segments.size(); s++) {
+            var segment = segments.get(s);
+            int idUpperBound;
+            try (var view = segment.getView()) {
+                idUpperBound = view.getIdUpperBound();
+            } catch (Exception e) {
+                throw new RuntimeException(e);
+            }
+            if (segmentVectors.get(s).size() < idUpperBound) {
+                throw new IllegalArgumentException(String.format("Segment %d has ordinals up to %d but only %d vectors",
+                                                                 s, idUpperBound, segmentVectors.get(s).size()));
+            }
+            oldToNew[s] = new int[idUpperBound];
+            for (int i = 0; i < idUpperBound; i++) {
+                if (segment.containsNode(i)) {
+                    segmentOf[nextOrdinal] = s;
+                    newToOld[nextOrdinal] = i;
+                    oldToNew[s][i] = nextOrdinal++;
+                } else {
+                    oldToNew[s][i] = -1;
+                }
+            }
+        }
+
+        vectors = new MergedVectorValues(new ArrayList<>(segmentVectors));
+        builder = new GraphIndexBuilder<>(vectors, vectorEncoding, similarityFunction, M, beamWidth, neighborOverflow, alpha,
+                                          simdExecutor, parallelExecutor);
+    }
+
+    /**
+     * @return the vectors of the merged graph, indexed by merged ordinal, e.g. for writing it to disk
+     */
+    public RandomAccessVectorValues<T> getVectors() {
+        return vectors;
+    }
+
+    /**
+     * @return the merged ordinal of each ordinal of `segment`, or -1 for ordinals not in the segment.  The
+     * merged ordinals are dense, so the merged graph can be written with
+     * {@link io.github.jbellis.jvector.disk.OnDiskGraphIndexWriter#getSequentialRenumbering} and these
+     * arrays used to translate the segments' ordinals to the written graph's.
+     */
+    public int[] getOldToNewOrdinals(int segment) {
+        return oldToNew[segment];
+    }
+
+    /**
+     * Builds the merged graph.  May only be called once.
+     */
+    public OnHeapGraphIndex<T> merge() {
+        var graph = builder.graph;
+        if (graph.size() != 0) {
+            throw new IllegalStateException("merge() has already been called");
+        }
+        // every node needs a neighbor set before any of them can be backlinked to
+        for (int node = 0; node < segmentOf.length; node++) {
+            graph.addNode(node);
+        }
+        if (segmentOf.length == 0) {
+            return graph;
+        }
+        int largestEntry;
+        try (var view = segments.get(largestSegment).getView()) {
+            largestEntry = view.entryNode();
+        } catch (Exception e) {
+            throw new RuntimeException(e);
+        }
+        graph.maybeSetInitialEntryNode(largestEntry >= 0 ? oldToNew[largestSegment][largestEntry] : 0);
+
+        // seed each node with its existing adjacency list
+        var workers = new ConcurrentLinkedQueue<SeedWorker>();
+        try {
+            simdExecutor.submit(() -> IntStream.range(0, segmentOf.length).parallel().forEach(node -> {
+                var worker = workers.poll();
+                if (worker == null) {
+                    worker = new SeedWorker();
+                }
+                try {
+                    builder.insertCandidates(node, worker.candidatesFor(node));
+                } finally {
+                    workers.offer(worker);
+                }
+            })).join();
+        } finally {
+            workers.forEach(SeedWorker::close);
+        }
+
+        // connect the other segments to the largest one
+        simdExecutor.submit(() -> IntStream.range(0, segmentOf.length).parallel().forEach(node -> {
+            if (segmentOf[node] != largestSegment) {
+                builder.improveConnections(node);
+            }
+        })).join();
+
+        builder.cleanup();
+        return graph;
+    }
+
+    /** Per-thread state for rescoring adjacency lists */
+    private final class SeedWorker {
+        private final List<GraphIndex.View<T>> views = new ArrayList<>();
+        private final RandomAccessVectorValues<T> v1 = vectors.copy();
+        private final RandomAccessVectorValues<T> v2 = vectors.copy();
+        private final NodeArray scratch = new NodeArray(builder.graph.maxDegree());
+
+        SeedWorker() {
+            for (var segment : segments) {
+                views.add(segment.getView());
+            }
+        }
+
+        NodeArray candidatesFor(int node) {
+            int s = segmentOf[node];
+            var value = v1.vectorValue(node);
+            scratch.clear();
+            for (var it = views.get(s).getNeighborsIterator(newToOld[node]); it.hasNext(); ) {
+                int neighbor = oldToNew[s][it.nextInt()];
+                if (neighbor >= 0) {
+                    scratch.insertSorted(neighbor, GraphIndexBuilder.scoreBetween(vectorEncoding, similarityFunction, value, v2.vectorValue(neighbor)));
+                }
+            }
+            return scratch;
+        }
+
+        void close() {
+            for (var view : views) {
+                try {
+                    view.close();
+                } catch (Exception e) {
+                    throw new RuntimeException(e);
+                }
+            }
+        }
+    }
+
+    /** The segments' vectors, concatenated in merged ordinal order */
+    private final class MergedVectorValues implements RandomAccessVectorValues<T> {
+        private final List<RandomAccessVectorValues<T>> segmentVectors;
+
+        MergedVectorValues(List<RandomAccessVectorValues<T>> segmentVectors) {
+            this.segmentVectors = segmentVectors;
+        }
+
+        @Override
+        public int size() {
+            return segmentOf.length;
+        }
+
+        @Override
+        public int dimension() {
+            return segmentVectors.get(0).dimension();
+        }
+
+        @Override
+        public T vectorValue(int targetOrd) {
+            return segmentVectors.get(segmentOf[targetOrd]).vectorValue(newToOld[targetOrd]);
+        }
+
+        @Override
+        public boolean isValueShared() {
+            return segmentVectors.stream().anyMatch(RandomAccessVectorValues::isValueShared);
+        }
+
+        @Override
+        public MergedVectorValues copy() {
+            if (!isValueShared()) {
+                return this;
+            }
+            var copies = new ArrayList<RandomAccessVectorValues<T>>(segmentVectors.size());
+            for (var v : segmentVectors) {
+                copies.add(v.copy());
+            }
+            return new MergedVectorValues(copies);
+        }
+    }
+}
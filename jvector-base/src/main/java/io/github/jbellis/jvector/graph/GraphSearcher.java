@@ -25,6 +25,7 @@
 package io.github.jbellis.jvector.graph;
 
 import io.github.jbellis.jvector.annotations.Experimental;
+import io.github.jbellis.jvector.util.ArrayUtil;
 import io.github.jbellis.jvector.util.BitSet;
 import io.github.jbellis.jvector.util.Bits;
 import io.github.jbellis.jvector.util.BoundedLongHeap;
@@ -37,14 +38,36 @@ import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
 import java.util.Arrays;
 import java.util.Comparator;
 
-import static java.lang.Math.min;
+import static io.github.jbellis.jvector.util.DocIdSetIterator.NO_MORE_DOCS;
 
 
 /**
  * Searches a graph to find nearest neighbors to a query vector. For more background on the
  * search algorithm, see {@link GraphIndex}.
+ * <p>
+ * Searches restricted by acceptOrds first estimate what fraction of the graph the filter accepts, and pick a
+ * {@link SearchResult.Strategy} to match: a plain graph search for permissive filters, a two-hop search that
+ * expands through rejected nodes instead of visiting them for selective ones, and a brute-force scan of the
+ * accepted nodes when there are too few of them for the graph to help.
  */
 public class GraphSearcher<T> {
+    /**
+     * by default, scan filters that accept at most this many nodes instead of searching the graph, as long as
+     * that is at most {@link #MAX_BRUTE_FORCE_SELECTIVITY} of the nodes
+     */
+    public static final int DEFAULT_BRUTE_FORCE_THRESHOLD = 1024;
+    /**
+     * never scan filters that accept more than this fraction of the nodes, whatever the brute-force threshold;
+     * otherwise every filter on a small graph would be scanned, and searching it is still cheaper
+     */
+    public static final float MAX_BRUTE_FORCE_SELECTIVITY = 0.1f;
+    /** by default, search two hops at a time when a filter accepts at most this fraction of the nodes */
+    public static final float DEFAULT_TWO_HOP_SELECTIVITY = 0.2f;
+
+    // the number of ordinals to test when estimating the selectivity of a filter that is not a BitSet
+    private static final int SELECTIVITY_SAMPLES = 1024;
+    // ...of which this many are tested first, to give up early on filters that accept most nodes
+    private static final int SELECTIVITY_FIRST_SAMPLES = 64;
 
     private final GraphIndex.View<T> view;
 
@@ -54,17 +77,67 @@ public class GraphSearcher<T> {
      */
     private final NodeQueue candidates;
 
+    // the topK best nodes found; its bound is reset to topK by each search
+    private final BoundedLongHeap resultsHeap;
+    private final NodeQueue resultsQueue;
+
     private final BitSet visited;
 
+    // the candidates being expanded together; see Builder.withBeamWidth
+    private final int[] beam;
+
+    // the unvisited neighbors of the node being expanded, and their similarities
+    private int[] friends = new int[32];
+    private float[] friendSimilarities = new float[32];
+    // in a two-hop search, the unvisited neighbors of the node being expanded that the filter rejects
+    private int[] rejected = new int[32];
+
+    private final int bruteForceThreshold;
+    private final float twoHopSelectivity;
+    // the strategy used by the last search
+    private SearchResult.Strategy strategy = SearchResult.Strategy.GRAPH;
+
+    // null unless built withInstrumentation
+    private final SearchListener listener;
+    // the nodes expanded and scored by the last traversal, for SearchStats
+    private int expandedCount;
+    private int scoredCount;
+
     /**
      * Creates a new graph searcher.
      *
      * @param visited bit set that will track nodes that have already been visited
      */
     GraphSearcher(GraphIndex.View<T> view, BitSet visited) {
+        this(view, visited, 1);
+    }
+
+    /**
+     * Creates a new graph searcher.
+     *
+     * @param visited bit set that will track nodes that have already been visited
+     * @param beamWidth the number of candidates to expand at a time
+     */
+    GraphSearcher(GraphIndex.View<T> view, BitSet visited, int beamWidth) {
+        this(view, visited, beamWidth, DEFAULT_BRUTE_FORCE_THRESHOLD, DEFAULT_TWO_HOP_SELECTIVITY, null);
+    }
+
+    GraphSearcher(GraphIndex.View<T> view,
+                  BitSet visited,
+                  int beamWidth,
+                  int bruteForceThreshold,
+                  float twoHopSelectivity,
+                  SearchListener listener)
+    {
         this.view = view;
         this.candidates = new NodeQueue(new GrowableLongHeap(100), NodeQueue.Order.MAX_HEAP);
+        this.resultsHeap = new BoundedLongHeap(100, 100);
+        this.resultsQueue = new NodeQueue(resultsHeap, NodeQueue.Order.MIN_HEAP);
         this.visited = visited;
+        this.beam = new int[beamWidth];
+        this.bruteForceThreshold = bruteForceThreshold;
+        this.twoHopSelectivity = twoHopSelectivity;
+        this.listener = listener;
     }
 
     /**
@@ -78,6 +151,7 @@ public class GraphSearcher<T> {
                 case BYTE:
                     return similarityFunction.compare((byte[]) targetVector, (byte[]) vectors.vectorValue(i));
                 case FLOAT32:
+                case FLOAT16:
                     return similarityFunction.compare((float[]) targetVector, (float[]) vectors.vectorValue(i));
                 default:
                     throw new RuntimeException("Unsupported vector encoding: " + vectorEncoding);
@@ -90,6 +164,10 @@ public class GraphSearcher<T> {
     public static class Builder<T> {
         private final GraphIndex.View<T> view;
         private boolean concurrent;
+        private int beamWidth = 1;
+        private int bruteForceThreshold = DEFAULT_BRUTE_FORCE_THRESHOLD;
+        private float twoHopSelectivity = DEFAULT_TWO_HOP_SELECTIVITY;
+        private SearchListener listener;
 
         public Builder(GraphIndex.View<T> view) {
             this.view = view;
@@ -100,10 +178,59 @@ public class GraphSearcher<T> {
             return this;
         }
 
+        /**
+         * Expand up to `beamWidth` of the best candidates at a time, telling the View to prefetch all of
+         * their neighbor lists before any of them are read.  For disk-resident graphs this keeps several
+         * reads in flight at once, instead of waiting on one read per expanded node.  The default of 1
+         * expands candidates one at a time, which visits the fewest nodes and is best for in-memory graphs.
+         */
+        public Builder<T> withBeamWidth(int beamWidth) {
+            if (beamWidth < 1) {
+                throw new IllegalArgumentException("beamWidth must be at least 1; got " + beamWidth);
+            }
+            this.beamWidth = beamWidth;
+            return this;
+        }
+
+        /**
+         * Sets when filtered searches change strategy; see {@link SearchResult.Strategy}.
+         *
+         * @param bruteForceThreshold scan the accepted nodes instead of searching the graph when a filter is
+         *                            estimated to accept at most this many, and at most
+         *                            {@link #MAX_BRUTE_FORCE_SELECTIVITY} of the nodes; 0 never scans
+         * @param twoHopSelectivity   search two hops at a time when a filter is estimated to accept at most
+         *                            this fraction of the nodes; 0 never does
+         */
+        public Builder<T> withFilterThresholds(int bruteForceThreshold, float twoHopSelectivity) {
+            if (bruteForceThreshold < 0) {
+                throw new IllegalArgumentException("bruteForceThreshold must not be negative; got " + bruteForceThreshold);
+            }
+            if (!(twoHopSelectivity >= 0 && twoHopSelectivity <= 1)) {
+                throw new IllegalArgumentException("twoHopSelectivity must be between 0 and 1; got " + twoHopSelectivity);
+            }
+            this.bruteForceThreshold = bruteForceThreshold;
+            this.twoHopSelectivity = twoHopSelectivity;
+            return this;
+        }
+
+        /**
+         * Record {@link SearchStats} for every search, attach them to its results, and pass them to `listener`
+         * when it completes.  Counting is cheap, but each search then also reads the clock twice and
+         * allocates its stats, so searchers are not instrumented by default.
+         */
+        @Experimental
+        public Builder<T> withInstrumentation(SearchListener listener) {
+            if (listener == null) {
+                throw new IllegalArgumentException("listener must not be null");
+            }
+            this.listener = listener;
+            return this;
+        }
+
         public GraphSearcher<T> build() {
             int size = view.getIdUpperBound();
             BitSet bits = concurrent ? new GrowableBitSet(size) : new SparseFixedBitSet(size);
-            return new GraphSearcher<>(view, bits);
+            return new GraphSearcher<>(view, bits, beamWidth, bruteForceThreshold, twoHopSelectivity, listener);
         }
     }
 
@@ -114,9 +241,10 @@ public class GraphSearcher<T> {
      * @param topK          the number of results to look for
      * @param threshold     the minimum similarity (0..1) to accept; 0 will accept everything. (Experimental!)
      * @param acceptOrds    a Bits instance indicating which nodes are acceptable results.
-     *                      If {@link Bits#ALL}, all nodes are acceptable.
-     *                      It is caller's responsibility to ensure that there are enough acceptable nodes
-     *                      that we don't search the entire graph trying to satisfy topK.
+     *                      If {@link Bits#ALL}, all nodes are acceptable.  Otherwise, the search strategy
+     *                      is chosen by how selective acceptOrds is; see {@link SearchResult#getStrategy()}.
+     *                      A {@link BitSet} lets both the estimate and a brute-force scan skip to the
+     *                      accepted nodes.
      * @return a SearchResult containing the topK results and the number of nodes visited during the search.
      */
     @Experimental
@@ -134,9 +262,10 @@ public class GraphSearcher<T> {
      *                      comparisons of the vectors for re-ranking at the end of the search.
      * @param topK          the number of results to look for
      * @param acceptOrds    a Bits instance indicating which nodes are acceptable results.
-     *                      If {@link Bits#ALL}, all nodes are acceptable.
-     *                      It is caller's responsibility to ensure that there are enough acceptable nodes
-     *                      that we don't search the entire graph trying to satisfy topK.
+     *                      If {@link Bits#ALL}, all nodes are acceptable.  Otherwise, the search strategy
+     *                      is chosen by how selective acceptOrds is; see {@link SearchResult#getStrategy()}.
+     *                      A {@link BitSet} lets both the estimate and a brute-force scan skip to the
+     *                      accepted nodes.
      * @return a SearchResult containing the topK results and the number of nodes visited during the search.
      */
     public SearchResult search(NodeSimilarity.ScoreFunction scoreFunction,
@@ -147,6 +276,45 @@ public class GraphSearcher<T> {
         return search(scoreFunction, reRanker, topK, 0.0f, acceptOrds);
     }
 
+    /**
+     * Like {@link #search(NodeSimilarity.ScoreFunction, NodeSimilarity.ReRanker, int, float, Bits)}, but
+     * writes the results into `results` instead of allocating a new SearchResult.  Together with a
+     * GraphSearcher that is reused across queries, nothing is allocated per query for the results once
+     * `results` has grown to hold topK nodes; iterating the neighbors of each expanded node still may be,
+     * depending on the graph.
+     */
+    @Experimental
+    public void search(NodeSimilarity.ScoreFunction scoreFunction,
+                       NodeSimilarity.ReRanker reRanker,
+                       int topK,
+                       float threshold,
+                       Bits acceptOrds,
+                       SearchResultBuffer results)
+    {
+        checkReRanker(scoreFunction, reRanker);
+        var stats = startStats();
+        int numVisited = traverse(scoreFunction, topK, threshold, view.entryNode(), acceptOrds);
+        endTraversal(stats);
+        int reranked = scoreFunction.isExact() ? 0 : resultsQueue.size();
+        extractScores(scoreFunction, reRanker, results, numVisited);
+        results.setStrategy(strategy);
+        results.setStats(stats);
+        endStats(stats, reranked);
+    }
+
+    /**
+     * Like {@link #search(NodeSimilarity.ScoreFunction, NodeSimilarity.ReRanker, int, Bits)}, but
+     * writes the results into `results` instead of allocating a new SearchResult.
+     */
+    public void search(NodeSimilarity.ScoreFunction scoreFunction,
+                       NodeSimilarity.ReRanker reRanker,
+                       int topK,
+                       Bits acceptOrds,
+                       SearchResultBuffer results)
+    {
+        search(scoreFunction, reRanker, topK, 0.0f, acceptOrds, results);
+    }
+
     /**
      * Add the closest neighbors found to a priority queue (heap). These are returned in
      * proximity order -- the closest neighbor of the topK found, i.e. the one with the highest
@@ -163,30 +331,108 @@ public class GraphSearcher<T> {
                                 int ep,
                                 Bits acceptOrds)
     {
+        checkReRanker(scoreFunction, reRanker);
+        var stats = startStats();
+        int numVisited = traverse(scoreFunction, topK, threshold, ep, acceptOrds);
+        endTraversal(stats);
+        int reranked = scoreFunction.isExact() ? 0 : resultsQueue.size();
+        SearchResult.NodeScore[] nodes = extractScores(scoreFunction, reRanker, resultsQueue);
+        endStats(stats, reranked);
+        return new SearchResult(nodes, visited, numVisited, strategy, stats);
+    }
+
+    /**
+     * Like searchInternal from the entry node, but returns the results with the scores given by
+     * scoreFunction, best-first, even if it is approximate.  Used by RerankingPipeline to rerank
+     * the results itself.  If the searcher is instrumented, the caller must finish the result's stats
+     * with {@link #endStats} once it has reranked them.
+     */
+    SearchResult searchWithoutReranking(NodeSimilarity.ScoreFunction scoreFunction, int topK, Bits acceptOrds) {
+        var stats = startStats();
+        int numVisited = traverse(scoreFunction, topK, 0.0f, view.entryNode(), acceptOrds);
+        endTraversal(stats);
+        return new SearchResult(drain(resultsQueue), visited, numVisited, strategy, stats);
+    }
+
+    /**
+     * @return new stats for the search about to start, or null if this searcher is not instrumented
+     */
+    private SearchStats startStats() {
+        return listener == null ? null : SearchStats.start(view);
+    }
+
+    private void endTraversal(SearchStats stats) {
+        if (stats != null) {
+            stats.endTraversal(expandedCount, scoredCount);
+        }
+    }
+
+    /**
+     * Records the reranking of `rerankedCount` results and the search's I/O in `stats`, and hands them
+     * to the listener.  Does nothing if `stats` is null.
+     */
+    void endStats(SearchStats stats, int rerankedCount) {
+        if (stats != null) {
+            stats.endRerank(rerankedCount, view);
+            listener.onSearch(stats);
+        }
+    }
+
+    private static void checkReRanker(NodeSimilarity.ScoreFunction scoreFunction, NodeSimilarity.ReRanker reRanker) {
         if (!scoreFunction.isExact() && reRanker == null) {
             throw new IllegalArgumentException("Either scoreFunction must be exact, or reRanker must not be null");
         }
+    }
+
+    /**
+     * Searches the graph, leaving the topK results in resultsQueue.
+     *
+     * @return the number of nodes visited
+     */
+    private int traverse(NodeSimilarity.ScoreFunction scoreFunction,
+                         int topK,
+                         float threshold,
+                         int ep,
+                         Bits acceptOrds)
+    {
         if (acceptOrds == null) {
             throw new IllegalArgumentException("Use MatchAllBits to indicate that all ordinals are accepted, instead of null");
         }
 
-        prepareScratchState(view.size());
+        // Threshold callers (and perhaps others) will be tempted to pass in a huge topK.
+        // The results heap only grows as results are actually found, so that's fine.
+        prepareScratchState(view.size(), topK);
         var scoreTracker = threshold > 0 ? new ScoreTracker.NormalDistributionTracker(threshold) : ScoreTracker.NO_OP;
+        strategy = SearchResult.Strategy.GRAPH;
+        expandedCount = 0;
+        scoredCount = 0;
         if (ep < 0) {
-            return new SearchResult(new SearchResult.NodeScore[0], visited, 0);
+            return 0;
         }
 
+        var filter = acceptOrds;
         acceptOrds = Bits.intersectionOf(acceptOrds, view.liveNodes());
-
-        // Threshold callers (and perhaps others) will be tempted to pass in a huge topK.
-        // Let's not allocate a ridiculously large heap up front in that scenario.
-        var resultsQueue = new NodeQueue(new BoundedLongHeap(min(1024, topK), topK), NodeQueue.Order.MIN_HEAP);
+        strategy = chooseStrategy(filter);
+        if (strategy == SearchResult.Strategy.BRUTE_FORCE) {
+            return bruteForce(scoreFunction, threshold, filter, acceptOrds);
+        }
+        boolean twoHop = strategy == SearchResult.Strategy.TWO_HOP;
         int numVisited = 0;
 
         float score = scoreFunction.similarityTo(ep);
+        scoredCount++;
         visited.set(ep);
         numVisited++;
         candidates.push(ep, score);
+        // start from whichever entry points are nearest the query, as well as ep
+        for (int entryPoint : view.entryPoints()) {
+            if (visited.getAndSet(entryPoint) || !view.containsNode(entryPoint)) {
+                continue;
+            }
+            candidates.push(entryPoint, scoreFunction.similarityTo(entryPoint));
+            scoredCount++;
+            numVisited++;
+        }
 
         // A bound that holds the minimum similarity to the query vector that a candidate vector must
         // have to be considered.
@@ -194,8 +440,7 @@ public class GraphSearcher<T> {
 
         while (candidates.size() > 0 && !resultsQueue.incomplete()) {
             // done when best candidate is worse than the worst result so far
-            float topCandidateScore = candidates.topScore();
-            if (topCandidateScore < minAcceptedSimilarity) {
+            if (candidates.topScore() < minAcceptedSimilarity) {
                 break;
             }
 
@@ -204,58 +449,263 @@ public class GraphSearcher<T> {
                 break;
             }
 
-            // add the top candidate to the resultset if it qualifies, and update minAcceptedSimilarity
-            int topCandidateNode = candidates.pop();
-            if (acceptOrds.get(topCandidateNode)
-                && topCandidateScore >= threshold
-                && resultsQueue.push(topCandidateNode, topCandidateScore)
-                && resultsQueue.size() >= topK)
-            {
-                minAcceptedSimilarity = resultsQueue.topScore();
+            // pop up to beam.length of the top candidates (as long as they are still competitive),
+            // adding each to the resultset if it qualifies, and updating minAcceptedSimilarity
+            int beamSize = 0;
+            do {
+                float topCandidateScore = candidates.topScore();
+                int topCandidateNode = candidates.pop();
+                if (acceptOrds.get(topCandidateNode)
+                    && topCandidateScore >= threshold
+                    && resultsQueue.push(topCandidateNode, topCandidateScore)
+                    && resultsQueue.size() >= topK)
+                {
+                    minAcceptedSimilarity = resultsQueue.topScore();
+                }
+                beam[beamSize++] = topCandidateNode;
+            } while (beamSize < beam.length && candidates.size() > 0 && candidates.topScore() >= minAcceptedSimilarity);
+
+            // let the view start fetching all the adjacency lists before we block on the first one
+            if (beamSize > 1) {
+                view.prefetchNeighbors(beam, beamSize);
             }
 
-            // add its neighbors to the candidates queue
-            for (var it = view.getNeighborsIterator(topCandidateNode); it.hasNext(); ) {
-                int friendOrd = it.nextInt();
-                if (visited.getAndSet(friendOrd)) {
-                    continue;
+            // add their neighbors to the candidates queue
+            for (int b = 0; b < beamSize; b++) {
+                int expandedNode = beam[b];
+                expandedCount++;
+                // (if the score function can score them all from the adjacency list itself, do so up front;
+                // a two-hop search also scores nodes from other adjacency lists, so it does not bother)
+                float[] edgeSimilarities = !twoHop && scoreFunction.supportsEdgeLoadingSimilarity()
+                                           ? scoreFunction.edgeLoadingSimilarityTo(expandedNode)
+                                           : null;
+                var it = view.getNeighborsIterator(expandedNode);
+
+                // collect the unvisited neighbors
+                int friendCount = 0;
+                int rejectedCount = 0;
+                for (int i = 0; it.hasNext(); i++) {
+                    int friendOrd = it.nextInt();
+                    if (visited.getAndSet(friendOrd)) {
+                        continue;
+                    }
+                    numVisited++;
+                    if (twoHop && !acceptOrds.get(friendOrd)) {
+                        // neither score nor expand it; its neighbors are collected below in its place
+                        if (rejectedCount == rejected.length) {
+                            rejected = ArrayUtil.grow(rejected, rejectedCount + 1);
+                        }
+                        rejected[rejectedCount++] = friendOrd;
+                        continue;
+                    }
+                    friendCount = addFriend(friendOrd, friendCount);
+                    if (edgeSimilarities != null) {
+                        friendSimilarities[friendCount - 1] = edgeSimilarities[i];
+                    }
+                }
+
+                // in a two-hop search, add the accepted neighbors of the rejected neighbors.  (This reads
+                // other adjacency lists, so it must wait until we are done with `it`.)  Rejected nodes two
+                // hops away are left unvisited, so that they can still be expanded through if they turn up
+                // as the neighbor of a later candidate.
+                if (rejectedCount > 1) {
+                    view.prefetchNeighbors(rejected, rejectedCount);
+                }
+                for (int r = 0; r < rejectedCount; r++) {
+                    for (var it2 = view.getNeighborsIterator(rejected[r]); it2.hasNext(); ) {
+                        int friendOrd = it2.nextInt();
+                        if (!acceptOrds.get(friendOrd) || visited.getAndSet(friendOrd)) {
+                            continue;
+                        }
+                        numVisited++;
+                        friendCount = addFriend(friendOrd, friendCount);
+                    }
+                }
+                // if that found nothing, expand through the rejected neighbors as usual, so that the
+                // search does not run out of candidates in a region the filter rejects
+                if (friendCount == 0) {
+                    for (int r = 0; r < rejectedCount; r++) {
+                        friendCount = addFriend(rejected[r], friendCount);
+                    }
                 }
-                numVisited++;
 
-                float friendSimilarity = scoreFunction.similarityTo(friendOrd);
-                scoreTracker.track(friendSimilarity);
-                if (friendSimilarity >= minAcceptedSimilarity) {
-                    candidates.push(friendOrd, friendSimilarity);
+                // otherwise, score them as a batch
+                if (edgeSimilarities == null) {
+                    scoreFunction.similarityTo(friends, friendCount, friendSimilarities);
+                }
+                scoredCount += friendCount;
+
+                for (int i = 0; i < friendCount; i++) {
+                    float friendSimilarity = friendSimilarities[i];
+                    scoreTracker.track(friendSimilarity);
+                    if (friendSimilarity >= minAcceptedSimilarity) {
+                        candidates.push(friends[i], friendSimilarity);
+                    }
                 }
             }
         }
 
         assert resultsQueue.size() <= topK;
-        SearchResult.NodeScore[] nodes = extractScores(scoreFunction, reRanker, resultsQueue);
-        return new SearchResult(nodes, visited, numVisited);
+        return numVisited;
+    }
+
+    /**
+     * Appends `node` to friends, growing it (and friendSimilarities) if necessary
+     *
+     * @return the new number of friends
+     */
+    private int addFriend(int node, int friendCount) {
+        if (friendCount == friends.length) {
+            friends = ArrayUtil.grow(friends, friendCount + 1);
+            friendSimilarities = ArrayUtil.growExact(friendSimilarities, friends.length);
+        }
+        friends[friendCount] = node;
+        return friendCount + 1;
+    }
+
+    /**
+     * Picks the search strategy for `filter` from an estimate of how many nodes it accepts.
+     */
+    private SearchResult.Strategy chooseStrategy(Bits filter) {
+        if (filter instanceof Bits.MatchAllBits) {
+            return SearchResult.Strategy.GRAPH;
+        }
+
+        int upperBound = view.getIdUpperBound();
+        double selectivity;
+        if (filter instanceof BitSet) {
+            var bits = (BitSet) filter;
+            selectivity = bits.approximateCardinality() / (double) Math.max(1, upperBound);
+        } else {
+            // test evenly spaced ordinals, stopping early if the first few show that most nodes are accepted
+            int samples = Math.min(SELECTIVITY_SAMPLES, upperBound);
+            int accepted = 0;
+            int tested = 0;
+            for (; tested < samples; tested++) {
+                if (tested == SELECTIVITY_FIRST_SAMPLES && accepted > 2 * twoHopSelectivity * tested) {
+                    break;
+                }
+                if (filter.get((int) ((long) tested * upperBound / samples))) {
+                    accepted++;
+                }
+            }
+            selectivity = tested == 0 ? 1 : accepted / (double) tested;
+        }
+
+        if (selectivity * upperBound <= bruteForceThreshold && selectivity <= MAX_BRUTE_FORCE_SELECTIVITY) {
+            return SearchResult.Strategy.BRUTE_FORCE;
+        }
+        if (selectivity <= twoHopSelectivity) {
+            return SearchResult.Strategy.TWO_HOP;
+        }
+        return SearchResult.Strategy.GRAPH;
+    }
+
+    /**
+     * Scores every node accepted by `acceptOrds`, leaving the topK in resultsQueue.  `filter` is the caller's
+     * half of acceptOrds; if it is a BitSet, only its set bits are tested.
+     *
+     * @return the number of nodes scored
+     */
+    private int bruteForce(NodeSimilarity.ScoreFunction scoreFunction, float threshold, Bits filter, Bits acceptOrds) {
+        int upperBound = view.getIdUpperBound();
+        var filterBits = filter instanceof BitSet ? (BitSet) filter : null;
+        int numVisited = 0;
+        int friendCount = 0;
+        for (int node = 0; node < upperBound; node++) {
+            if (filterBits != null) {
+                node = node < filterBits.length() ? filterBits.nextSetBit(node) : NO_MORE_DOCS;
+                if (node == NO_MORE_DOCS || node >= upperBound) {
+                    break;
+                }
+            }
+            if (!acceptOrds.get(node) || !view.containsNode(node)) {
+                continue;
+            }
+            visited.set(node);
+            numVisited++;
+            friends[friendCount++] = node;
+            if (friendCount == friends.length) {
+                pushScored(scoreFunction, threshold, friendCount);
+                friendCount = 0;
+            }
+        }
+        pushScored(scoreFunction, threshold, friendCount);
+        return numVisited;
+    }
+
+    /**
+     * Scores the first `count` friends as a batch and adds those that meet `threshold` to the results
+     */
+    private void pushScored(NodeSimilarity.ScoreFunction scoreFunction, float threshold, int count) {
+        if (count == 0) {
+            return;
+        }
+        scoreFunction.similarityTo(friends, count, friendSimilarities);
+        scoredCount += count;
+        for (int i = 0; i < count; i++) {
+            if (friendSimilarities[i] >= threshold) {
+                resultsQueue.push(friends[i], friendSimilarities[i]);
+            }
+        }
     }
 
     private static SearchResult.NodeScore[] extractScores(NodeSimilarity.ScoreFunction sf,
                                                           NodeSimilarity.ReRanker reRanker,
                                                           NodeQueue resultsQueue)
     {
-        SearchResult.NodeScore[] nodes;
         if (sf.isExact()) {
-            nodes = new SearchResult.NodeScore[resultsQueue.size()];
-            for (int i = nodes.length - 1; i >= 0; i--) {
-                var nScore = resultsQueue.topScore();
-                var n = resultsQueue.pop();
-                nodes[i] = new SearchResult.NodeScore(n, nScore);
-            }
-        } else {
-            nodes = resultsQueue.nodesCopy(reRanker::similarityTo);
-            Arrays.sort(nodes, 0, resultsQueue.size(), Comparator.comparingDouble((SearchResult.NodeScore nodeScore) -> nodeScore.score).reversed());
+            return drain(resultsQueue);
         }
+        var nodes = resultsQueue.nodesCopy(reRanker::similarityTo);
+        Arrays.sort(nodes, 0, resultsQueue.size(), Comparator.comparingDouble((SearchResult.NodeScore nodeScore) -> nodeScore.score).reversed());
         return nodes;
     }
 
-    private void prepareScratchState(int capacity) {
+    /**
+     * @return the contents of resultsQueue with their queued scores, best-first
+     */
+    private static SearchResult.NodeScore[] drain(NodeQueue resultsQueue) {
+        var nodes = new SearchResult.NodeScore[resultsQueue.size()];
+        for (int i = nodes.length - 1; i >= 0; i--) {
+            var nScore = resultsQueue.topScore();
+            var n = resultsQueue.pop();
+            nodes[i] = new SearchResult.NodeScore(n, nScore);
+        }
+        return nodes;
+    }
+
+    /**
+     * Drains resultsQueue into `results`, best-first.  Approximate scores are replaced by the reRanker's,
+     * and the results re-sorted by pushing them back through resultsQueue so that nothing is allocated.
+     */
+    private void extractScores(NodeSimilarity.ScoreFunction sf,
+                               NodeSimilarity.ReRanker reRanker,
+                               SearchResultBuffer results,
+                               int numVisited)
+    {
+        int size = resultsQueue.size();
+        results.reset(size, numVisited);
+        if (!sf.isExact()) {
+            for (int i = 0; i < size; i++) {
+                int n = resultsQueue.pop();
+                results.set(i, n, reRanker.similarityTo(n));
+            }
+            for (int i = 0; i < size; i++) {
+                resultsQueue.push(results.node(i), results.score(i));
+            }
+        }
+        for (int i = size - 1; i >= 0; i--) {
+            var nScore = resultsQueue.topScore();
+            var n = resultsQueue.pop();
+            results.set(i, n, nScore);
+        }
+    }
+
+    private void prepareScratchState(int capacity, int topK) {
         candidates.clear();
+        resultsQueue.clear();
+        resultsHeap.setMaxSize(topK);
         if (visited.length() < capacity) {
             // this happens during graph construction; otherwise the size of the vector values should
             // be constant, and it will be a SparseFixedBitSet instead of FixedBitSet
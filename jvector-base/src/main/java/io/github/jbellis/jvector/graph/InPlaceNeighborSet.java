@@ -0,0 +1,257 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.graph;
+
+import java.util.concurrent.atomic.AtomicReferenceFieldUpdater;
+import java.util.concurrent.locks.StampedLock;
+import java.util.function.UnaryOperator;
+
+import static java.lang.Math.max;
+import static java.lang.Math.min;
+
+/**
+ * A ConcurrentNeighborSet that updates a single, preallocated NodeArray in place instead of copying it on
+ * every write.
+ * <p>
+ * Writers hold a StampedLock's write lock, so an update happens once instead of being retried
+ * until a CAS succeeds.  Readers never take the lock.  They copy the neighbors out under an optimistic read
+ * and retry if a write overlapped, like a seqlock.
+ * <p>
+ * A single insert (as done by {@link #backlink}) that finds another thread updating the node does not wait.
+ * It leaves the insert on a lock-free stack, and whichever thread holds the lock applies every pending insert
+ * in one batch before it is done.  The size cap is then enforced once per batch rather than once per insert.
+ * So the threads backlinking to a popular node do not pile up behind each other.  Every insert has been
+ * applied by the time all the calls that touch this set have returned.
+ */
+public class InPlaceNeighborSet extends ConcurrentNeighborSet {
+    private static final AtomicReferenceFieldUpdater<InPlaceNeighborSet, PendingInsert> PENDING =
+            AtomicReferenceFieldUpdater.newUpdater(InPlaceNeighborSet.class, PendingInsert.class, "pending");
+
+    private final StampedLock lock = new StampedLock();
+
+    /** modified only under the write lock */
+    private final NodeArray neighbors;
+
+    /** inserts left for the lock holder to apply, most recent first */
+    private volatile PendingInsert pending;
+
+    /**
+     * @param overflow the largest overflow that {@link #insert} will be called with, to size the neighbors
+     *                 so that they do not need to grow
+     */
+    public InPlaceNeighborSet(int nodeId, int maxConnections, NodeSimilarity similarity, float alpha, float overflow) {
+        this(nodeId, maxConnections, similarity, alpha, new NodeArray((int) (maxConnections * max(1.0f, overflow)) + 1));
+    }
+
+    InPlaceNeighborSet(int nodeId, int maxConnections, NodeSimilarity similarity, float alpha, NodeArray neighbors) {
+        super(nodeId, maxConnections, similarity, alpha, null);
+        this.neighbors = neighbors;
+    }
+
+    @Override
+    public NodesIterator iterator() {
+        while (true) {
+            long stamp = optimisticRead();
+            int[] node = neighbors.node;
+            int size = min(neighbors.size, node.length);
+            var copy = new int[size];
+            System.arraycopy(node, 0, copy, 0, size);
+            if (lock.validate(stamp)) {
+                return new NodesIterator.ArrayNodesIterator(copy, size);
+            }
+        }
+    }
+
+    @Override
+    NodeArray getCurrent() {
+        while (true) {
+            long stamp = optimisticRead();
+            int[] node = neighbors.node;
+            float[] score = neighbors.score;
+            int size = min(neighbors.size, min(node.length, score.length));
+            var copy = new NodeArray(size);
+            System.arraycopy(node, 0, copy.node, 0, size);
+            System.arraycopy(score, 0, copy.score, 0, size);
+            copy.size = size;
+            if (lock.validate(stamp)) {
+                return copy;
+            }
+        }
+    }
+
+    @Override
+    public int size() {
+        while (true) {
+            long stamp = optimisticRead();
+            int size = neighbors.size;
+            if (lock.validate(stamp)) {
+                return size;
+            }
+        }
+    }
+
+    @Override
+    public int arrayLength() {
+        while (true) {
+            long stamp = optimisticRead();
+            int length = neighbors.node.length;
+            if (lock.validate(stamp)) {
+                return length;
+            }
+        }
+    }
+
+    /**
+     * @return a stamp for an optimistic read, waiting out a writer if there is one
+     */
+    private long optimisticRead() {
+        long stamp;
+        while ((stamp = lock.tryOptimisticRead()) == 0) {
+            Thread.onSpinWait();
+        }
+        return stamp;
+    }
+
+    /**
+     * Applies `update` once, under the write lock.
+     *
+     * @return 0, since the update is never retried
+     */
+    @Override
+    int update(UnaryOperator<NodeArray> update) {
+        long stamp = lock.writeLock();
+        try {
+            var next = update.apply(neighbors);
+            if (next != neighbors) {
+                replaceWith(next);
+            }
+        } finally {
+            lock.unlockWrite(stamp);
+        }
+        applyPending();
+        return 0;
+    }
+
+    private void replaceWith(NodeArray next) {
+        if (next.size > neighbors.node.length) {
+            neighbors.node = new int[next.size];
+            neighbors.score = new float[next.size];
+        }
+        System.arraycopy(next.node, 0, neighbors.node, 0, next.size);
+        System.arraycopy(next.score, 0, neighbors.score, 0, next.size);
+        neighbors.size = next.size;
+    }
+
+    /**
+     * @return 1 if another thread was updating this node, and the insert was left for it to apply; otherwise 0
+     */
+    @Override
+    public int insert(int neighborId, float score, float overflow) {
+        assert neighborId != nodeId : "can't add self as neighbor at node " + nodeId;
+        long stamp = lock.tryWriteLock();
+        int deferred = 0;
+        if (stamp == 0) {
+            push(new PendingInsert(neighborId, score, overflow));
+            deferred = 1;
+        } else {
+            try {
+                neighbors.insertSorted(neighborId, score);
+                enforceMaxConnections(overflow);
+            } finally {
+                lock.unlockWrite(stamp);
+            }
+        }
+        applyPending();
+        return deferred;
+    }
+
+    @Override
+    void insertNotDiverse(int node, float score, boolean limitConnections) {
+        long stamp = lock.writeLock();
+        try {
+            if (limitConnections) {
+                // remove the worst edge to make room for the new one
+                neighbors.size = min(neighbors.size, maxConnections - 1);
+            }
+            neighbors.insertSorted(node, score);
+        } finally {
+            lock.unlockWrite(stamp);
+        }
+        applyPending();
+    }
+
+    private void push(PendingInsert insert) {
+        PendingInsert head;
+        do {
+            head = pending;
+            insert.next = head;
+        } while (!PENDING.compareAndSet(this, head, insert));
+    }
+
+    /**
+     * Applies the pending inserts, unless another thread holds the write lock, in which case it will
+     * apply them once it releases the lock.  Must be called after every release of the write lock.
+     */
+    private void applyPending() {
+        while (pending != null) {
+            long stamp = lock.tryWriteLock();
+            if (stamp == 0) {
+                return;
+            }
+            try {
+                float overflow = 0;
+                for (var insert = PENDING.getAndSet(this, null); insert != null; insert = insert.next) {
+                    neighbors.insertSorted(insert.node, insert.score);
+                    overflow = max(overflow, insert.overflow);
+                }
+                enforceMaxConnections(overflow);
+            } finally {
+                lock.unlockWrite(stamp);
+            }
+        }
+    }
+
+    /** prunes the neighbors in place, as {@link ConcurrentNeighborSet#insert} does on its copy */
+    private void enforceMaxConnections(float overflow) {
+        if (neighbors.size > overflow * maxConnections && neighbors.size > maxConnections) {
+            neighbors.retain(selectDiverse(neighbors));
+        }
+    }
+
+    @Override
+    public ConcurrentNeighborSet copy() {
+        var current = getCurrent();
+        var copy = new NodeArray(max(arrayLength(), current.size));
+        copy.size = current.size;
+        System.arraycopy(current.node, 0, copy.node, 0, current.size);
+        System.arraycopy(current.score, 0, copy.score, 0, current.size);
+        return new InPlaceNeighborSet(nodeId, maxConnections, similarity, alpha, copy);
+    }
+
+    private static final class PendingInsert {
+        final int node;
+        final float score;
+        final float overflow;
+        PendingInsert next;
+
+        PendingInsert(int node, float score, float overflow) {
+            this.node = node;
+            this.score = score;
+            this.overflow = overflow;
+        }
+    }
+}
@@ -43,6 +43,36 @@ public interface NodeSimilarity {
         boolean isExact();
 
         float similarityTo(int node2);
+
+        /**
+         * Computes the similarity to each of the first `count` entries of `nodes`, writing them to
+         * results[0, count).  Implementations that can score several nodes faster than one at a time
+         * (e.g. with a SIMD kernel over their compressed vectors) should override this; the default
+         * calls {@link #similarityTo(int)} for each node.
+         */
+        default void similarityTo(int[] nodes, int count, float[] results) {
+            for (int i = 0; i < count; i++) {
+                results[i] = similarityTo(nodes[i]);
+            }
+        }
+
+        /**
+         * @return true if this ScoreFunction can compute the similarities of all of a node's neighbors
+         * at once from data stored alongside its adjacency list, via {@link #edgeLoadingSimilarityTo}.
+         */
+        default boolean supportsEdgeLoadingSimilarity() {
+            return false;
+        }
+
+        /**
+         * @return the similarities of the query to each neighbor of `origin`, in the order in which
+         * they are returned by the View's getNeighborsIterator.  The returned array is scratch space
+         * that will be overwritten by the next call, and may be longer than the neighbor count.
+         * Only valid if {@link #supportsEdgeLoadingSimilarity} is true.
+         */
+        default float[] edgeLoadingSimilarityTo(int origin) {
+            throw new UnsupportedOperationException();
+        }
     }
 
     interface ExactScoreFunction extends ScoreFunction {
@@ -34,6 +34,7 @@ import io.github.jbellis.jvector.util.SynchronizedGrowableBitSet;
 
 import java.io.DataOutput;
 import java.io.IOException;
+import java.util.Arrays;
 import java.util.concurrent.atomic.AtomicInteger;
 import java.util.function.BiFunction;
 import java.util.stream.IntStream;
@@ -49,6 +50,8 @@ public class OnHeapGraphIndex<T> implements GraphIndex<T>, Accountable {
 
     // the current graph entry node, -1 if not set
     private final AtomicInteger entryPoint = new AtomicInteger(-1);
+    // extra entry points chosen by GraphIndexBuilder.cleanup, replaced (never modified) as a whole
+    private volatile int[] entryPoints = NO_ENTRY_POINTS;
 
     private final DenseIntMap<ConcurrentNeighborSet> nodes;
     private final BitSet deletedNodes = new SynchronizedGrowableBitSet(0);
@@ -131,6 +134,19 @@ public class OnHeapGraphIndex<T> implements GraphIndex<T>, Accountable {
         entryPoint.set(node);
     }
 
+    void updateEntryPoints(int[] nodes) {
+        entryPoints = nodes;
+    }
+
+    /** drops the entry points in `removed` */
+    void removeEntryPoints(Bits removed) {
+        var current = entryPoints;
+        var remaining = Arrays.stream(current).filter(node -> !removed.get(node)).toArray();
+        if (remaining.length < current.length) {
+            entryPoints = remaining;
+        }
+    }
+
     @Override
     public int maxDegree() {
         return maxDegree;
@@ -255,7 +271,12 @@ public class OnHeapGraphIndex<T> implements GraphIndex<T>, Accountable {
         }
 
         public NodesIterator getNeighborsIterator(int node) {
-            return getNeighbors(node).iterator();
+            var neighbors = getNeighbors(node);
+            if (neighbors == null) {
+                // removed by GraphIndexBuilder.repairDeletions after a concurrent search reached it
+                return new NodesIterator.ArrayNodesIterator(new int[0], 0);
+            }
+            return neighbors.iterator();
         }
 
         @Override
@@ -268,6 +289,11 @@ public class OnHeapGraphIndex<T> implements GraphIndex<T>, Accountable {
             return entryPoint.get();
         }
 
+        @Override
+        public int[] entryPoints() {
+            return entryPoints;
+        }
+
         @Override
         public String toString() {
             return "OnHeapGraphIndexView(size=" + size() + ", entryPoint=" + entryPoint.get();
@@ -280,6 +306,11 @@ public class OnHeapGraphIndex<T> implements GraphIndex<T>, Accountable {
             return deletedNodes.cardinality() == 0 ? Bits.ALL : Bits.inverseOf(deletedNodes);
         }
 
+        @Override
+        public boolean containsNode(int node) {
+            return OnHeapGraphIndex.this.containsNode(node);
+        }
+
         @Override
         public int getIdUpperBound() {
             return OnHeapGraphIndex.this.getIdUpperBound();
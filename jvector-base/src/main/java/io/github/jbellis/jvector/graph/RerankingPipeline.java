@@ -0,0 +1,162 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.graph;
+
+import io.github.jbellis.jvector.annotations.Experimental;
+import io.github.jbellis.jvector.util.Bits;
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Comparator;
+import java.util.List;
+
+/**
+ * A search that traverses the graph with a cheap approximate score function and then narrows the results
+ * down through a sequence of increasingly expensive rerankers, e.g. BQ for the traversal, PQ for the first
+ * rerank, and the exact vectors on disk for the last:
+ * <pre>
+ *     var pipeline = RerankingPipeline.traverseWith(bqScoreFunction)
+ *                                     .thenRerank(pqReRanker, 20)
+ *                                     .thenRerank(exactReRanker, 2)
+ *                                     .build();
+ *     var result = pipeline.search(searcher, topK, Bits.ALL);
+ * </pre>
+ * Each stage's over-fetch factor is how many candidates, as a multiple of topK, the previous stage hands to
+ * it.  Above, the traversal keeps 20 * topK candidates, PQ rescores those and keeps 2 * topK of them, and the
+ * exact scores of those decide the topK results.  The final stage's scores are the ones returned.
+ * <p>
+ * Pipelines are immutable and hold no per-query state, but the score functions and rerankers they are built
+ * from are for a single query.
+ */
+@Experimental
+public final class RerankingPipeline {
+    private final NodeSimilarity.ScoreFunction traversal;
+    private final NodeSimilarity.ReRanker[] rerankers;
+    private final float[] overFetch;
+
+    private RerankingPipeline(NodeSimilarity.ScoreFunction traversal, List<NodeSimilarity.ReRanker> rerankers, List<Float> overFetch) {
+        this.traversal = traversal;
+        this.rerankers = rerankers.toArray(new NodeSimilarity.ReRanker[0]);
+        this.overFetch = new float[overFetch.size()];
+        for (int i = 0; i < this.overFetch.length; i++) {
+            this.overFetch[i] = overFetch.get(i);
+        }
+    }
+
+    /**
+     * @param scoreFunction the (approximate) score function to search the graph with
+     */
+    public static Builder traverseWith(NodeSimilarity.ScoreFunction scoreFunction) {
+        return new Builder(scoreFunction);
+    }
+
+    /**
+     * @return the number of stages, counting the traversal
+     */
+    public int stageCount() {
+        return rerankers.length + 1;
+    }
+
+    public SearchResult search(GraphSearcher<?> searcher, int topK, Bits acceptOrds) {
+        return search(searcher, topK, acceptOrds, null);
+    }
+
+    /**
+     * @param stageNanos if not null, the time spent in each stage (the traversal first, then each reranker in
+     *                   order) is added to stageNanos[0, {@link #stageCount()})
+     * @return the topK results, scored by the last stage, and the number of nodes visited by the traversal
+     */
+    public SearchResult search(GraphSearcher<?> searcher, int topK, Bits acceptOrds, long[] stageNanos) {
+        if (stageNanos != null && stageNanos.length < stageCount()) {
+            throw new IllegalArgumentException(String.format("Need room for %d stage timings, got %d", stageCount(), stageNanos.length));
+        }
+
+        long start = System.nanoTime();
+        var traversed = searcher.searchWithoutReranking(traversal, candidateCount(0, topK), acceptOrds);
+        var nodes = traversed.getNodes();
+        long end = System.nanoTime();
+        if (stageNanos != null) {
+            stageNanos[0] += end - start;
+        }
+
+        int rerankedCount = 0;
+        for (int i = 0; i < rerankers.length; i++) {
+            start = end;
+            // nodes is sorted best-first by the previous stage's scores
+            int count = Math.min(nodes.length, candidateCount(i, topK));
+            rerankedCount += count;
+            var reranked = new SearchResult.NodeScore[count];
+            for (int j = 0; j < count; j++) {
+                int node = nodes[j].node;
+                reranked[j] = new SearchResult.NodeScore(node, rerankers[i].similarityTo(node));
+            }
+            Arrays.sort(reranked, Comparator.comparingDouble((SearchResult.NodeScore ns) -> ns.score).reversed());
+            nodes = reranked;
+            end = System.nanoTime();
+            if (stageNanos != null) {
+                stageNanos[i + 1] += end - start;
+            }
+        }
+
+        if (nodes.length > topK) {
+            nodes = Arrays.copyOf(nodes, topK);
+        }
+        searcher.endStats(traversed.getStats(), rerankedCount);
+        return new SearchResult(nodes, traversed.getVisited(), traversed.getVisitedCount(), traversed.getStrategy(), traversed.getStats());
+    }
+
+    /**
+     * @return how many candidates stage `stage` hands to the next (or returns, for the last)
+     */
+    private int candidateCount(int stage, int topK) {
+        if (stage >= overFetch.length) {
+            return topK;
+        }
+        return (int) Math.min(Integer.MAX_VALUE, Math.ceil(topK * (double) overFetch[stage]));
+    }
+
+    public static final class Builder {
+        private final NodeSimilarity.ScoreFunction traversal;
+        private final List<NodeSimilarity.ReRanker> rerankers = new ArrayList<>();
+        private final List<Float> overFetch = new ArrayList<>();
+
+        private Builder(NodeSimilarity.ScoreFunction traversal) {
+            this.traversal = traversal;
+        }
+
+        /**
+         * Adds a stage that rescores the best overFetch * topK candidates of the previous stage with `reRanker`.
+         *
+         * @param overFetch at least 1; 1 reranks exactly as many candidates as will be returned
+         */
+        public Builder thenRerank(NodeSimilarity.ReRanker reRanker, float overFetch) {
+            if (!(overFetch >= 1)) {
+                throw new IllegalArgumentException("overFetch must be at least 1, got " + overFetch);
+            }
+            rerankers.add(reRanker);
+            this.overFetch.add(overFetch);
+            return this;
+        }
+
+        public RerankingPipeline build() {
+            if (!traversal.isExact() && rerankers.isEmpty()) {
+                throw new IllegalArgumentException("An approximate traversal needs at least one reranking stage");
+            }
+            return new RerankingPipeline(traversal, rerankers, overFetch);
+        }
+    }
+}
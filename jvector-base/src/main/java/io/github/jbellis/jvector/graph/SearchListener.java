@@ -0,0 +1,106 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.graph;
+
+import io.github.jbellis.jvector.annotations.Experimental;
+
+import java.util.concurrent.atomic.LongAdder;
+
+/**
+ * Receives the {@link SearchStats} of every search made by an instrumented GraphSearcher, e.g. to
+ * export them to a metrics system.  See {@link GraphSearcher.Builder#withInstrumentation}.
+ * <p>
+ * onSearch is called on the searching thread, before the search returns, so it should be cheap.
+ * A listener shared by several searchers must be threadsafe.
+ */
+@Experimental
+@FunctionalInterface
+public interface SearchListener {
+    void onSearch(SearchStats stats);
+
+    /**
+     * A threadsafe SearchListener that sums the stats of the searches it is given.
+     */
+    final class Totals implements SearchListener {
+        private final LongAdder searches = new LongAdder();
+        private final LongAdder expanded = new LongAdder();
+        private final LongAdder scored = new LongAdder();
+        private final LongAdder reranked = new LongAdder();
+        private final LongAdder bytesRead = new LongAdder();
+        private final LongAdder cacheHits = new LongAdder();
+        private final LongAdder[] phaseNanos = new LongAdder[SearchStats.Phase.values().length];
+
+        public Totals() {
+            for (int i = 0; i < phaseNanos.length; i++) {
+                phaseNanos[i] = new LongAdder();
+            }
+        }
+
+        @Override
+        public void onSearch(SearchStats stats) {
+            searches.increment();
+            expanded.add(stats.expandedCount());
+            scored.add(stats.scoredCount());
+            reranked.add(stats.rerankedCount());
+            bytesRead.add(stats.bytesRead());
+            cacheHits.add(stats.cacheHits());
+            for (var phase : SearchStats.Phase.values()) {
+                phaseNanos[phase.ordinal()].add(stats.phaseNanos(phase));
+            }
+        }
+
+        public long searchCount() {
+            return searches.sum();
+        }
+
+        public long expandedCount() {
+            return expanded.sum();
+        }
+
+        public long scoredCount() {
+            return scored.sum();
+        }
+
+        public long rerankedCount() {
+            return reranked.sum();
+        }
+
+        public long bytesRead() {
+            return bytesRead.sum();
+        }
+
+        public long cacheHits() {
+            return cacheHits.sum();
+        }
+
+        /**
+         * @return the time spent in `phase`, summed across searches
+         */
+        public long phaseNanos(SearchStats.Phase phase) {
+            return phaseNanos[phase.ordinal()].sum();
+        }
+
+        @Override
+        public String toString() {
+            long n = Math.max(1, searchCount());
+            return String.format("SearchListener.Totals(searches=%d, per search: expanded=%.1f, scored=%.1f, reranked=%.1f, bytesRead=%.0f, cacheHits=%.1f, traversal=%.1fus, rerank=%.1fus)",
+                                 searchCount(), expandedCount() / (double) n, scoredCount() / (double) n, rerankedCount() / (double) n,
+                                 bytesRead() / (double) n, cacheHits() / (double) n,
+                                 phaseNanos(SearchStats.Phase.TRAVERSAL) / 1e3 / n, phaseNanos(SearchStats.Phase.RERANK) / 1e3 / n);
+        }
+    }
+}
@@ -25,11 +25,23 @@ public final class SearchResult {
     private final NodeScore[] nodes;
     private final BitSet visited;
     private final int visitedCount;
+    private final Strategy strategy;
+    private final SearchStats stats;
 
     public SearchResult(NodeScore[] nodes, BitSet visited, int visitedCount) {
+        this(nodes, visited, visitedCount, Strategy.GRAPH);
+    }
+
+    public SearchResult(NodeScore[] nodes, BitSet visited, int visitedCount, Strategy strategy) {
+        this(nodes, visited, visitedCount, strategy, null);
+    }
+
+    public SearchResult(NodeScore[] nodes, BitSet visited, int visitedCount, Strategy strategy, SearchStats stats) {
         this.nodes = nodes;
         this.visited = visited;
         this.visitedCount = visitedCount;
+        this.strategy = strategy;
+        this.stats = stats;
     }
 
     /**
@@ -54,6 +66,37 @@ public final class SearchResult {
         return visitedCount;
     }
 
+    /**
+     * @return how the search dealt with its acceptOrds filter
+     */
+    public Strategy getStrategy() {
+        return strategy;
+    }
+
+    /**
+     * @return the counters and timings of the search, or null if the searcher was not built
+     * {@link GraphSearcher.Builder#withInstrumentation withInstrumentation}
+     */
+    public SearchStats getStats() {
+        return stats;
+    }
+
+    /**
+     * How GraphSearcher searched, chosen from an estimate of the fraction of nodes accepted by the filter.
+     * The thresholds are set by {@link GraphSearcher.Builder#withFilterThresholds}.
+     */
+    public enum Strategy {
+        /** the usual graph search, which visits and expands rejected nodes like any other */
+        GRAPH,
+        /**
+         * a graph search for selective filters that does not score rejected neighbors, but replaces them with
+         * their own accepted neighbors, so that it keeps moving through the graph while skipping rejected nodes
+         */
+        TWO_HOP,
+        /** the filter accepts so few nodes that all of them were scored, without searching the graph */
+        BRUTE_FORCE
+    }
+
     public static final class NodeScore {
         public final int node;
         public final float score;
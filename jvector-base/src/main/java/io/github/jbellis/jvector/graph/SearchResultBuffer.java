@@ -0,0 +1,141 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.graph;
+
+import io.github.jbellis.jvector.util.ArrayUtil;
+
+/**
+ * A reusable holder for the results of an ANN search, filled in by the GraphSearcher.search
+ * overloads that take one.
+ * Nodes and scores are kept in parallel arrays that are only reallocated when a search returns more
+ * results than any previous one, so a buffer reused across searches allocates nothing in steady state.
+ * <p>
+ * Like GraphSearcher, a buffer is not threadsafe; use one per thread.
+ */
+public final class SearchResultBuffer {
+    private int[] nodes;
+    private float[] scores;
+    private int size;
+    private int visitedCount;
+    private SearchResult.Strategy strategy = SearchResult.Strategy.GRAPH;
+    private SearchStats stats;
+
+    public SearchResultBuffer() {
+        this(16);
+    }
+
+    /**
+     * @param initialCapacity the number of results to allocate space for up front
+     */
+    public SearchResultBuffer(int initialCapacity) {
+        nodes = new int[initialCapacity];
+        scores = new float[initialCapacity];
+    }
+
+    /**
+     * @return the number of results
+     */
+    public int size() {
+        return size;
+    }
+
+    /**
+     * @return the i-th best node found by the search
+     */
+    public int node(int i) {
+        assert i < size : String.format("%d >= %d", i, size);
+        return nodes[i];
+    }
+
+    /**
+     * @return the score of the i-th best node found by the search
+     */
+    public float score(int i) {
+        assert i < size : String.format("%d >= %d", i, size);
+        return scores[i];
+    }
+
+    /**
+     * @return the backing array of result nodes, sorted best-first.  Only the first size() entries are valid,
+     * and the array is overwritten (or replaced) by the next search using this buffer.
+     */
+    public int[] nodes() {
+        return nodes;
+    }
+
+    /**
+     * @return the backing array of result scores, parallel to nodes()
+     */
+    public float[] scores() {
+        return scores;
+    }
+
+    /**
+     * @return the total number of graph nodes visited while performing the search
+     */
+    public int getVisitedCount() {
+        return visitedCount;
+    }
+
+    /**
+     * @return how the search dealt with its acceptOrds filter; see {@link SearchResult#getStrategy()}
+     */
+    public SearchResult.Strategy getStrategy() {
+        return strategy;
+    }
+
+    /**
+     * @return the counters and timings of the search; see {@link SearchResult#getStats()}
+     */
+    public SearchStats getStats() {
+        return stats;
+    }
+
+    /**
+     * @return a copy of the results, e.g. for handing off to code that expects NodeScore objects
+     */
+    public SearchResult.NodeScore[] toNodeScores() {
+        var ns = new SearchResult.NodeScore[size];
+        for (int i = 0; i < size; i++) {
+            ns[i] = new SearchResult.NodeScore(nodes[i], scores[i]);
+        }
+        return ns;
+    }
+
+    /** Prepare for `count` results, and record the number of nodes visited to find them. */
+    void reset(int count, int visitedCount) {
+        if (nodes.length < count) {
+            nodes = ArrayUtil.growExact(nodes, ArrayUtil.oversize(count, Integer.BYTES));
+            scores = ArrayUtil.growExact(scores, nodes.length);
+        }
+        this.size = count;
+        this.visitedCount = visitedCount;
+    }
+
+    void setStrategy(SearchResult.Strategy strategy) {
+        this.strategy = strategy;
+    }
+
+    void setStats(SearchStats stats) {
+        this.stats = stats;
+    }
+
+    void set(int i, int node, float score) {
+        nodes[i] = node;
+        scores[i] = score;
+    }
+}
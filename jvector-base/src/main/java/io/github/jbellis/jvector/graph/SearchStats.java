@@ -0,0 +1,118 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.graph;
+
+import io.github.jbellis.jvector.annotations.Experimental;
+
+/**
+ * Where a single search spent its time and I/O, recorded by GraphSearchers built with
+ * {@link GraphSearcher.Builder#withInstrumentation}.  Available from {@link SearchResult#getStats()}
+ * and {@link SearchResultBuffer#getStats()}, and passed to the searcher's {@link SearchListener}
+ * when the search completes.
+ * <p>
+ * Bytes read and cache hits are as reported by the View (see {@link GraphIndex.View#bytesRead()}), so
+ * they are only nonzero for disk-backed and caching views.
+ */
+@Experimental
+public final class SearchStats {
+    /** the phases of a search */
+    public enum Phase {
+        /** searching the graph (or the accepted nodes, for a brute-force search) with the score function */
+        TRAVERSAL,
+        /** rescoring the results with the reRanker */
+        RERANK
+    }
+
+    private final long startNanos;
+    private final long startBytesRead;
+    private final long startCacheHits;
+    private long traversalNanos;
+    private long rerankNanos;
+    private int expandedCount;
+    private int scoredCount;
+    private int rerankedCount;
+    private long bytesRead;
+    private long cacheHits;
+
+    private SearchStats(long startNanos, long startBytesRead, long startCacheHits) {
+        this.startNanos = startNanos;
+        this.startBytesRead = startBytesRead;
+        this.startCacheHits = startCacheHits;
+    }
+
+    static SearchStats start(GraphIndex.View<?> view) {
+        return new SearchStats(System.nanoTime(), view.bytesRead(), view.cacheHits());
+    }
+
+    void endTraversal(int expandedCount, int scoredCount) {
+        this.traversalNanos = System.nanoTime() - startNanos;
+        this.expandedCount = expandedCount;
+        this.scoredCount = scoredCount;
+    }
+
+    void endRerank(int rerankedCount, GraphIndex.View<?> view) {
+        this.rerankNanos = System.nanoTime() - startNanos - traversalNanos;
+        this.rerankedCount = rerankedCount;
+        this.bytesRead = view.bytesRead() - startBytesRead;
+        this.cacheHits = view.cacheHits() - startCacheHits;
+    }
+
+    /**
+     * @return the number of nodes whose neighbors were read
+     */
+    public int expandedCount() {
+        return expandedCount;
+    }
+
+    /**
+     * @return the number of nodes scored by the score function
+     */
+    public int scoredCount() {
+        return scoredCount;
+    }
+
+    /**
+     * @return the number of results rescored by the reRanker; 0 if the score function was exact
+     */
+    public int rerankedCount() {
+        return rerankedCount;
+    }
+
+    /**
+     * @return the bytes of adjacency lists, codes, and vectors read from storage
+     */
+    public long bytesRead() {
+        return bytesRead;
+    }
+
+    /**
+     * @return the reads of adjacency lists and vectors served from a cache instead of storage
+     */
+    public long cacheHits() {
+        return cacheHits;
+    }
+
+    public long phaseNanos(Phase phase) {
+        return phase == Phase.TRAVERSAL ? traversalNanos : rerankNanos;
+    }
+
+    @Override
+    public String toString() {
+        return String.format("SearchStats(expanded=%d, scored=%d, reranked=%d, bytesRead=%d, cacheHits=%d, traversal=%.1fus, rerank=%.1fus)",
+                             expandedCount, scoredCount, rerankedCount, bytesRead, cacheHits, traversalNanos / 1e3, rerankNanos / 1e3);
+    }
+}
@@ -0,0 +1,333 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.graph;
+
+import io.github.jbellis.jvector.annotations.Experimental;
+import io.github.jbellis.jvector.util.Bits;
+import io.github.jbellis.jvector.util.NumaTopology;
+import io.github.jbellis.jvector.util.PoolingSupport;
+import io.github.jbellis.jvector.vector.VectorEncoding;
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
+
+import java.util.ArrayList;
+import java.util.Comparator;
+import java.util.List;
+import java.util.Objects;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.ForkJoinTask;
+
+/**
+ * An index split into shards by ordinal, one or more per NUMA node, each searched by a pool of that node's
+ * threads.  A query is searched in every shard in parallel, and the shards' results are merged into the
+ * overall topK.  Ordinals are global: shard i holds the nodes [base(i), base(i) + size of shard i).
+ * <p>
+ * There is a pool per node of the {@link NumaTopology}, sized to that node's physical cores, and shard i is
+ * assigned to node i % nodeCount.  {@link #build} also builds each shard, and copies its vectors, on the pool of
+ * the shard's node, so that with -XX:+UseNUMA a shard's graph and vectors are on the node whose threads search
+ * them.  See NumaTopology for what the JVM can and cannot do about binding those threads.
+ * <p>
+ * Each shard is a smaller graph, so a search visits somewhat more nodes in total than a search of a single
+ * graph would, but the shards are searched concurrently and from local memory.
+ *
+ * @param <T> the type of vector
+ */
+@Experimental
+public class ShardedGraphIndex<T> implements AutoCloseable {
+    private final List<GraphIndex<T>> graphs;
+    private final int[] bases;
+    private final VectorEncoding vectorEncoding;
+    private final VectorSimilarityFunction similarityFunction;
+    private final ForkJoinPool[] pools;
+    private final List<PoolingSupport<ShardSearcher>> searchers;
+
+    /**
+     * @param graphs  the shards, whose ordinals follow on from each other in this order
+     * @param vectors the vectors of each shard, by the shard's own ordinals; or null to read the vectors of each
+     *                shard from its View, e.g. for OnDiskGraphIndex shards
+     */
+    public ShardedGraphIndex(List<? extends GraphIndex<T>> graphs,
+                             List<? extends RandomAccessVectorValues<T>> vectors,
+                             VectorEncoding vectorEncoding,
+                             VectorSimilarityFunction similarityFunction,
+                             NumaTopology topology)
+    {
+        this(graphs, vectors, vectorEncoding, similarityFunction, newPools(topology));
+    }
+
+    private ShardedGraphIndex(List<? extends GraphIndex<T>> graphs,
+                              List<? extends RandomAccessVectorValues<T>> vectors,
+                              VectorEncoding vectorEncoding,
+                              VectorSimilarityFunction similarityFunction,
+                              ForkJoinPool[] pools)
+    {
+        if (graphs.isEmpty()) {
+            throw new IllegalArgumentException("At least one shard is required");
+        }
+        if (vectors != null && vectors.size() != graphs.size()) {
+            throw new IllegalArgumentException(String.format("%d shards but %d sets of vectors", graphs.size(), vectors.size()));
+        }
+        this.graphs = List.copyOf(graphs);
+        this.vectorEncoding = Objects.requireNonNull(vectorEncoding);
+        this.similarityFunction = Objects.requireNonNull(similarityFunction);
+        this.pools = pools;
+
+        bases = new int[graphs.size() + 1];
+        searchers = new ArrayList<>(graphs.size());
+        for (int i = 0; i < graphs.size(); i++) {
+            var graph = graphs.get(i);
+            // a shard's ordinals must not overlap the next one's, even if it has holes
+            bases[i + 1] = bases[i] + (vectors == null ? graph.getIdUpperBound() : vectors.get(i).size());
+            var shardVectors = vectors == null ? null : vectors.get(i);
+            searchers.add(PoolingSupport.newThreadBased(() -> new ShardSearcher(graph, shardVectors)));
+        }
+    }
+
+    /**
+     * Splits `vectors` into one shard of consecutive ordinals per node of `topology`, and builds each shard's
+     * graph with the given {@link GraphIndexBuilder} parameters.  The shards are built concurrently, each on the
+     * pool of its node.
+     */
+    public static <T> ShardedGraphIndex<T> build(RandomAccessVectorValues<T> vectors,
+                                                 VectorEncoding vectorEncoding,
+                                                 VectorSimilarityFunction similarityFunction,
+                                                 int M,
+                                                 int beamWidth,
+                                                 float neighborOverflow,
+                                                 float alpha,
+                                                 NumaTopology topology)
+    {
+        var pools = newPools(topology);
+        int shardCount = pools.length;
+        int size = vectors.size();
+        var tasks = new ArrayList<ForkJoinTask<Shard<T>>>(shardCount);
+        for (int i = 0; i < shardCount; i++) {
+            int start = (int) ((long) i * size / shardCount);
+            int end = (int) ((long) (i + 1) * size / shardCount);
+            var source = vectors.copy();
+            var pool = pools[i];
+            tasks.add(pool.submit(() -> {
+                // copied by this node's threads, so that the copy is allocated on this node
+                var local = new ArrayList<T>(end - start);
+                for (int node = start; node < end; node++) {
+                    local.add(copyOf(source.vectorValue(node)));
+                }
+                var shardVectors = new ListVectorValues<>(local, vectors.dimension());
+                var builder = new GraphIndexBuilder<>(shardVectors, vectorEncoding, similarityFunction, M, beamWidth,
+                                                      neighborOverflow, alpha, pool, pool);
+                return new Shard<>(builder.build(), shardVectors);
+            }));
+        }
+
+        var graphs = new ArrayList<GraphIndex<T>>(shardCount);
+        var shardVectors = new ArrayList<RandomAccessVectorValues<T>>(shardCount);
+        try {
+            for (var task : tasks) {
+                var shard = task.join();
+                graphs.add(shard.graph);
+                shardVectors.add(shard.vectors);
+            }
+        } catch (RuntimeException e) {
+            for (var pool : pools) {
+                pool.shutdownNow();
+            }
+            throw e;
+        }
+        return new ShardedGraphIndex<>(graphs, shardVectors, vectorEncoding, similarityFunction, pools);
+    }
+
+    /**
+     * @return the number of shards
+     */
+    public int shardCount() {
+        return graphs.size();
+    }
+
+    /**
+     * @return the shard holding the nodes [base(shard), base(shard + 1))
+     */
+    public GraphIndex<T> getShard(int shard) {
+        return graphs.get(shard);
+    }
+
+    /**
+     * @return the global ordinal of the first node of `shard`; base(shardCount()) is one past the last ordinal
+     */
+    public int base(int shard) {
+        return bases[shard];
+    }
+
+    /**
+     * @return the NUMA node whose threads search `shard`
+     */
+    public int numaNode(int shard) {
+        return shard % pools.length;
+    }
+
+    /**
+     * Searches every shard for the topK nodes closest to `query`, by exact comparison of the vectors.
+     *
+     * @param acceptOrds the acceptable results, by global ordinal
+     * @return the overall topK, by global ordinal, and the total number of nodes visited in all the shards
+     */
+    public SearchResult search(T query, int topK, Bits acceptOrds) {
+        var tasks = new ArrayList<ForkJoinTask<SearchResult>>(graphs.size());
+        for (int i = 0; i < graphs.size(); i++) {
+            int shard = i;
+            tasks.add(pools[numaNode(shard)].submit(() -> {
+                try (var pooled = searchers.get(shard).get()) {
+                    return pooled.get().search(query, topK, shardAcceptOrds(acceptOrds, bases[shard]));
+                }
+            }));
+        }
+
+        var merged = new ArrayList<SearchResult.NodeScore>(graphs.size() * topK);
+        int visitedCount = 0;
+        SearchResult.Strategy strategy = null;
+        for (int shard = 0; shard < tasks.size(); shard++) {
+            var result = tasks.get(shard).join();
+            for (var ns : result.getNodes()) {
+                merged.add(new SearchResult.NodeScore(bases[shard] + ns.node, ns.score));
+            }
+            visitedCount += result.getVisitedCount();
+            // if the shards did not all search the same way, report the ordinary graph search
+            strategy = strategy == null || strategy == result.getStrategy() ? result.getStrategy() : SearchResult.Strategy.GRAPH;
+        }
+        merged.sort(Comparator.comparingDouble((SearchResult.NodeScore ns) -> ns.score).reversed());
+        var nodes = merged.subList(0, Math.min(topK, merged.size())).toArray(new SearchResult.NodeScore[0]);
+        return new SearchResult(nodes, null, visitedCount, strategy);
+    }
+
+    private static Bits shardAcceptOrds(Bits acceptOrds, int base) {
+        if (acceptOrds == Bits.ALL || acceptOrds == Bits.NONE) {
+            return acceptOrds;
+        }
+        return new Bits() {
+            @Override
+            public boolean get(int index) {
+                return acceptOrds.get(base + index);
+            }
+
+            @Override
+            public int length() {
+                return Math.max(0, acceptOrds.length() - base);
+            }
+        };
+    }
+
+    /**
+     * Shuts down the pools that search the shards.  The shards themselves are not closed.
+     */
+    @Override
+    public void close() {
+        for (var pool : pools) {
+            pool.shutdown();
+        }
+    }
+
+    private static ForkJoinPool[] newPools(NumaTopology topology) {
+        var pools = new ForkJoinPool[topology.nodeCount()];
+        for (int i = 0; i < pools.length; i++) {
+            pools[i] = topology.newPool(i);
+        }
+        return pools;
+    }
+
+    @SuppressWarnings("unchecked")
+    private static <T> T copyOf(T vector) {
+        if (vector instanceof float[]) {
+            return (T) ((float[]) vector).clone();
+        }
+        if (vector instanceof byte[]) {
+            return (T) ((byte[]) vector).clone();
+        }
+        throw new IllegalArgumentException("Unsupported vector type " + vector.getClass());
+    }
+
+    private static final class Shard<T> {
+        final GraphIndex<T> graph;
+        final RandomAccessVectorValues<T> vectors;
+
+        Shard(GraphIndex<T> graph, RandomAccessVectorValues<T> vectors) {
+            this.graph = graph;
+            this.vectors = vectors;
+        }
+    }
+
+    /**
+     * The per-thread state for searching one shard: a searcher, and the vectors it scores
+     */
+    private final class ShardSearcher {
+        private final GraphIndex.View<T> view;
+        private final GraphSearcher<T> searcher;
+        private final RandomAccessVectorValues<T> vectors;
+
+        ShardSearcher(GraphIndex<T> graph, RandomAccessVectorValues<T> vectors) {
+            this.view = graph.getView();
+            this.searcher = new GraphSearcher.Builder<>(view).withConcurrentUpdates().build();
+            this.vectors = vectors == null ? null : vectors.copy();
+        }
+
+        SearchResult search(T query, int topK, Bits acceptOrds) {
+            NodeSimilarity.ExactScoreFunction scoreFunction = node -> {
+                Object vector = vectors == null ? view.getVector(node) : vectors.vectorValue(node);
+                if (vectorEncoding == VectorEncoding.BYTE) {
+                    return similarityFunction.compare((byte[]) query, (byte[]) vector);
+                }
+                return similarityFunction.compare((float[]) query, (float[]) vector);
+            };
+            return searcher.search(scoreFunction, null, topK, acceptOrds);
+        }
+    }
+
+    /**
+     * Vectors held in a List, of either type
+     */
+    private static final class ListVectorValues<T> implements RandomAccessVectorValues<T> {
+        private final List<T> vectors;
+        private final int dimension;
+
+        ListVectorValues(List<T> vectors, int dimension) {
+            this.vectors = vectors;
+            this.dimension = dimension;
+        }
+
+        @Override
+        public int size() {
+            return vectors.size();
+        }
+
+        @Override
+        public int dimension() {
+            return dimension;
+        }
+
+        @Override
+        public T vectorValue(int targetOrd) {
+            return vectors.get(targetOrd);
+        }
+
+        @Override
+        public boolean isValueShared() {
+            return false;
+        }
+
+        @Override
+        public RandomAccessVectorValues<T> copy() {
+            return this;
+        }
+    }
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.pq;
+
+import io.github.jbellis.jvector.vector.VectorUtil;
+
+import java.util.Random;
+
+/**
+ * Mini-batch k-means (Sculley, "Web-Scale K-Means Clustering") for float vectors, seeded with KMeans++.
+ * <p>
+ * Points and centroids are stored in flat arrays, `dimension` floats apiece, and compared with the
+ * offset-based SIMD distance kernels.  Each step assigns a random batch of points to their nearest centroids
+ * and moves each centroid towards its points with a per-centroid learning rate of 1 / (points seen so far).
+ * Clustering stops early once a smoothed average of the batches' distances to their centroids stops improving.
+ * <p>
+ * Not threadsafe; to cluster several sets of points concurrently, use one clusterer per set.
+ */
+public class MiniBatchKMeansClusterer {
+    private static final int MIN_BATCH_SIZE = 1024;
+    private static final int BATCH_POINTS_PER_CLUSTER = 16;
+    // KMeans++ seeding considers this many batches' worth of points
+    private static final int SEEDING_BATCHES = 3;
+    // stop once the smoothed inertia has not improved by TOLERANCE (relative) in PATIENCE batches
+    private static final float TOLERANCE = 1e-3f;
+    private static final int PATIENCE = 10;
+
+    private final float[] points;
+    private final int dimension;
+    private final int pointCount;
+    private final int k;
+    private final int batchSize;
+    private final Random random;
+    private final float[] centroids;
+    private final int[] counts;
+    private int batchCount;
+
+    /**
+     * @param points    the points to cluster, `dimension` floats apiece
+     * @param dimension the dimension of each point
+     * @param k         number of clusters
+     */
+    public MiniBatchKMeansClusterer(float[] points, int dimension, int k) {
+        this(points, dimension, k, new Random());
+    }
+
+    /**
+     * @param points    the points to cluster, `dimension` floats apiece
+     * @param dimension the dimension of each point
+     * @param k         number of clusters
+     * @param random    source of the seeding and batch choices
+     */
+    public MiniBatchKMeansClusterer(float[] points, int dimension, int k, Random random) {
+        if (dimension <= 0 || points.length % dimension != 0) {
+            throw new IllegalArgumentException(String.format("%d floats is not a whole number of %d-dimensional points", points.length, dimension));
+        }
+        if (k <= 0) {
+            throw new IllegalArgumentException("Number of clusters must be positive.");
+        }
+        this.pointCount = points.length / dimension;
+        if (k > pointCount) {
+            throw new IllegalArgumentException(String.format("Number of clusters %d cannot exceed number of points %d", k, pointCount));
+        }
+
+        this.points = points;
+        this.dimension = dimension;
+        this.k = k;
+        this.random = random;
+        batchSize = Math.min(pointCount, Math.max(MIN_BATCH_SIZE, BATCH_POINTS_PER_CLUSTER * k));
+        centroids = new float[k * dimension];
+        counts = new int[k];
+        chooseInitialCentroids();
+    }
+
+    /**
+     * Runs mini-batch steps until the clustering converges, or until the batches have covered
+     * `maxEpochs` times as many points as there are.
+     *
+     * @return the centroids, `dimension` floats apiece
+     */
+    public float[] cluster(int maxEpochs) {
+        int maxBatches = (int) Math.min(Integer.MAX_VALUE, ((long) maxEpochs * pointCount + batchSize - 1) / batchSize);
+        var batch = new int[batchSize];
+        var assignments = new int[batchSize];
+        // weight of each batch in the smoothed inertia, roughly averaging over two epochs
+        float alpha = Math.min(1.0f, 2.0f * batchSize / (pointCount + 1));
+        double smoothedInertia = 0;
+        double bestInertia = Double.MAX_VALUE;
+        int staleBatches = 0;
+
+        for (int b = 0; b < maxBatches; b++) {
+            chooseBatch(batch);
+            double inertia = 0;
+            for (int i = 0; i < batchSize; i++) {
+                int offset = batch[i] * dimension;
+                int nearest = 0;
+                float nearestDistance = Float.MAX_VALUE;
+                for (int c = 0; c < k; c++) {
+                    float distance = VectorUtil.squareDistance(points, offset, centroids, c * dimension, dimension);
+                    if (distance < nearestDistance) {
+                        nearestDistance = distance;
+                        nearest = c;
+                    }
+                }
+                assignments[i] = nearest;
+                inertia += nearestDistance;
+            }
+
+            for (int i = 0; i < batchSize; i++) {
+                int c = assignments[i];
+                float eta = 1.0f / ++counts[c];
+                int pointOffset = batch[i] * dimension;
+                int centroidOffset = c * dimension;
+                for (int j = 0; j < dimension; j++) {
+                    centroids[centroidOffset + j] += eta * (points[pointOffset + j] - centroids[centroidOffset + j]);
+                }
+            }
+            batchCount++;
+
+            inertia /= batchSize;
+            smoothedInertia = b == 0 ? inertia : (1 - alpha) * smoothedInertia + alpha * inertia;
+            if (smoothedInertia < bestInertia * (1 - TOLERANCE)) {
+                bestInertia = smoothedInertia;
+                staleBatches = 0;
+            } else if (++staleBatches >= PATIENCE) {
+                break;
+            }
+        }
+        return centroids;
+    }
+
+    /**
+     * @return the number of mini-batch steps run so far
+     */
+    public int getBatchCount() {
+        return batchCount;
+    }
+
+    private void chooseBatch(int[] batch) {
+        if (batchSize == pointCount) {
+            for (int i = 0; i < batchSize; i++) {
+                batch[i] = i;
+            }
+        } else {
+            for (int i = 0; i < batchSize; i++) {
+                batch[i] = random.nextInt(pointCount);
+            }
+        }
+    }
+
+    /**
+     * KMeans++ seeding over a random sample of the points: each centroid after the first is chosen with
+     * probability proportional to its squared distance to the nearest centroid chosen so far.  Points that
+     * coincide with a chosen centroid are never chosen again, so k distinct points give k distinct centroids.
+     */
+    private void chooseInitialCentroids() {
+        int sampleSize = (int) Math.min(pointCount, (long) SEEDING_BATCHES * batchSize);
+        var sample = new int[pointCount];
+        for (int i = 0; i < pointCount; i++) {
+            sample[i] = i;
+        }
+        // partial Fisher-Yates shuffle
+        for (int i = 0; i < sampleSize; i++) {
+            int j = i + random.nextInt(pointCount - i);
+            int t = sample[i];
+            sample[i] = sample[j];
+            sample[j] = t;
+        }
+
+        var distances = new float[sampleSize];
+        int chosen = sample[random.nextInt(sampleSize)];
+        for (int c = 0; c < k; c++) {
+            System.arraycopy(points, chosen * dimension, centroids, c * dimension, dimension);
+            if (c == k - 1) {
+                break;
+            }
+
+            double total = 0;
+            for (int i = 0; i < sampleSize; i++) {
+                float distance = VectorUtil.squareDistance(points, sample[i] * dimension, centroids, c * dimension, dimension);
+                distances[i] = c == 0 ? distance : Math.min(distances[i], distance);
+                total += distances[i];
+            }
+
+            double r = random.nextDouble() * total;
+            chosen = -1;
+            for (int i = 0; i < sampleSize; i++) {
+                if (distances[i] > 0) {
+                    chosen = sample[i];
+                    r -= distances[i];
+                    if (r <= 0) {
+                        break;
+                    }
+                }
+            }
+            if (chosen < 0) {
+                // fewer distinct points than clusters
+                chosen = sample[random.nextInt(sampleSize)];
+            }
+        }
+    }
+}
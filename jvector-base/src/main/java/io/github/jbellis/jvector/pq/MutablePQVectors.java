@@ -0,0 +1,275 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.pq;
+
+import io.github.jbellis.jvector.disk.RandomAccessReader;
+import io.github.jbellis.jvector.graph.NodeSimilarity;
+import io.github.jbellis.jvector.util.ArrayUtil;
+import io.github.jbellis.jvector.util.PhysicalCoreExecutor;
+import io.github.jbellis.jvector.util.RamUsageEstimator;
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
+
+import java.io.DataOutput;
+import java.io.IOException;
+import java.util.Arrays;
+import java.util.List;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.stream.IntStream;
+
+/**
+ * PQ-encoded vectors that can be added to after the quantization has been trained, e.g. as vectors are
+ * inserted into a graph:
+ * <pre>
+ *     var pqv = new MutablePQVectors(pq);
+ *     var builder = new GraphIndexBuilder&lt;&gt;(ravv, VectorEncoding.FLOAT32, similarityFunction, M, beamWidth,
+ *                                              1.2f, 1.2f, pqv);
+ *     // for each new vector
+ *     pqv.add(ordinal, vector);
+ *     builder.addGraphNode(ordinal, ravv);
+ * </pre>
+ * The codes are stored back to back, as in {@link PQVectors}, in chunks of a fixed number of vectors.  Growing
+ * the store allocates new chunks without copying the existing ones, so adds do not block each other or
+ * searches.  Adds are thread-safe and score functions need no external locking: the code of a vector is
+ * visible to any thread that learns of its ordinal after `add` returns, e.g. from the graph it was added to.
+ * Only ordinals that have been added may be scored.
+ */
+public class MutablePQVectors implements CompressedVectors {
+    // aim for chunks of about this many bytes
+    private static final int CHUNK_BYTES = 1 << 20;
+    // addAll encodes this many vectors at a time; see ProductQuantization.encodeTo(List, byte[], int)
+    private static final int ENCODE_BATCH = 32;
+
+    final ProductQuantization pq;
+    private final int subspaceCount;
+    private final int chunkShift;
+    private final int chunkMask;
+    // replaced (not modified) when chunks are added, so readers always see fully allocated chunks
+    private volatile byte[][] chunks = new byte[0][];
+    // one more than the largest ordinal added
+    private final AtomicInteger count = new AtomicInteger();
+
+    public MutablePQVectors(ProductQuantization pq) {
+        this(pq, defaultVectorsPerChunk(pq));
+    }
+
+    /**
+     * @param vectorsPerChunk a power of two
+     */
+    MutablePQVectors(ProductQuantization pq, int vectorsPerChunk) {
+        if (vectorsPerChunk <= 0 || Integer.bitCount(vectorsPerChunk) != 1) {
+            throw new IllegalArgumentException("vectorsPerChunk must be a power of two, got " + vectorsPerChunk);
+        }
+        this.pq = pq;
+        this.subspaceCount = pq.getSubspaceCount();
+        this.chunkShift = Integer.numberOfTrailingZeros(vectorsPerChunk);
+        this.chunkMask = vectorsPerChunk - 1;
+    }
+
+    /**
+     * Reads the codes of ordinals [0, count), stored back to back at the position of `in`, one chunk at a time.
+     * This is how {@link PQVectors#load} loads codes too large for a single array.
+     */
+    static MutablePQVectors load(ProductQuantization pq, RandomAccessReader in, int count, int vectorsPerChunk) throws IOException {
+        var pqv = new MutablePQVectors(pq, vectorsPerChunk);
+        if (count == 0) {
+            return pqv;
+        }
+        pqv.ensureCapacity(count - 1);
+        var allChunks = pqv.chunks;
+        for (int first = 0; first < count; first += vectorsPerChunk) {
+            int vectorCount = Math.min(vectorsPerChunk, count - first);
+            in.read(allChunks[first >>> pqv.chunkShift], 0, vectorCount * pqv.subspaceCount);
+        }
+        pqv.count.set(count);
+        return pqv;
+    }
+
+    /**
+     * Encodes `vector` and stores its code as that of `ordinal`, replacing any earlier code.
+     */
+    public void add(int ordinal, float[] vector) {
+        if (ordinal < 0) {
+            throw new IllegalArgumentException("Invalid ordinal " + ordinal);
+        }
+        ensureCapacity(ordinal);
+        pq.encodeTo(vector, chunks[ordinal >>> chunkShift], offset(ordinal));
+        count.accumulateAndGet(ordinal + 1, Math::max);
+    }
+
+    /**
+     * Encodes `vectors` as the ordinals starting at `firstOrdinal`, in parallel on the
+     * {@link PhysicalCoreExecutor} pool.
+     */
+    public void addAll(int firstOrdinal, List<float[]> vectors) {
+        addAll(firstOrdinal, vectors, PhysicalCoreExecutor.pool());
+    }
+
+    /**
+     * Encodes `vectors` as the ordinals starting at `firstOrdinal`, in parallel on `simdExecutor`.  Vectors are
+     * encoded in batches that share each centroid load, straight into the chunks that hold their codes.
+     */
+    public void addAll(int firstOrdinal, List<float[]> vectors, ForkJoinPool simdExecutor) {
+        if (firstOrdinal < 0 || (long) firstOrdinal + vectors.size() > Integer.MAX_VALUE) {
+            throw new IllegalArgumentException(String.format("Invalid ordinals [%d, %d)", firstOrdinal, (long) firstOrdinal + vectors.size()));
+        }
+        if (vectors.isEmpty()) {
+            return;
+        }
+        int end = firstOrdinal + vectors.size();
+        ensureCapacity(end - 1);
+        var allChunks = chunks;
+        // batches are aligned to a power of two no larger than a chunk, so none of them spans two chunks
+        int batchSize = Math.min(ENCODE_BATCH, chunkMask + 1);
+        simdExecutor.submit(() -> IntStream.rangeClosed(firstOrdinal / batchSize, (end - 1) / batchSize).parallel().forEach(batch -> {
+            int first = Math.max(firstOrdinal, batch * batchSize);
+            int last = Math.min(end, (batch + 1) * batchSize);
+            pq.encodeTo(vectors.subList(first - firstOrdinal, last - firstOrdinal), allChunks[first >>> chunkShift], offset(first));
+        })).join();
+        count.accumulateAndGet(end, Math::max);
+    }
+
+    static int defaultVectorsPerChunk(ProductQuantization pq) {
+        return Integer.highestOneBit(Math.max(1, CHUNK_BYTES / pq.getSubspaceCount()));
+    }
+
+    private int offset(int ordinal) {
+        return (ordinal & chunkMask) * subspaceCount;
+    }
+
+    private void ensureCapacity(int ordinal) {
+        int chunk = ordinal >>> chunkShift;
+        if (chunk < chunks.length) {
+            return;
+        }
+        synchronized (this) {
+            var current = chunks;
+            if (chunk < current.length) {
+                return;
+            }
+            // the directory is only references, so copying it for each new chunk is cheap
+            var grown = Arrays.copyOf(current, chunk + 1);
+            for (int i = current.length; i < grown.length; i++) {
+                grown[i] = new byte[subspaceCount << chunkShift];
+            }
+            chunks = grown;
+        }
+    }
+
+    /**
+     * @return one more than the largest ordinal added
+     */
+    public int count() {
+        return count.get();
+    }
+
+    public ProductQuantization getProductQuantization() {
+        return pq;
+    }
+
+    /**
+     * @return an immutable copy of the codes of ordinals [0, {@link #count()}), e.g. to write with a graph
+     */
+    public PQVectors toPQVectors() {
+        int n = count();
+        if ((long) n * subspaceCount > ArrayUtil.MAX_ARRAY_LENGTH) {
+            throw new IllegalStateException(String.format("%d codes of %d bytes do not fit in a single array", n, subspaceCount));
+        }
+        var flat = new byte[n * subspaceCount];
+        var allChunks = chunks;
+        int vectorsPerChunk = chunkMask + 1;
+        for (int first = 0; first < n; first += vectorsPerChunk) {
+            int vectorCount = Math.min(vectorsPerChunk, n - first);
+            System.arraycopy(allChunks[first >>> chunkShift], 0, flat, first * subspaceCount, vectorCount * subspaceCount);
+        }
+        return new PQVectors(pq, flat, n);
+    }
+
+    /**
+     * Writes the codes of ordinals [0, {@link #count()}) in the format of {@link PQVectors#write}, so they can be
+     * read back with {@link PQVectors#load}.
+     */
+    @Override
+    public void write(DataOutput out) throws IOException {
+        int n = count();
+        var allChunks = chunks;
+        int vectorsPerChunk = chunkMask + 1;
+
+        pq.write(out);
+        out.writeInt(n);
+        out.writeInt(subspaceCount);
+        for (int first = 0; first < n; first += vectorsPerChunk) {
+            int vectorCount = Math.min(vectorsPerChunk, n - first);
+            out.write(allChunks[first >>> chunkShift], 0, vectorCount * subspaceCount);
+        }
+    }
+
+    @Override
+    public NodeSimilarity.ApproximateScoreFunction approximateScoreFunctionFor(float[] q, VectorSimilarityFunction similarityFunction) {
+        return new PQScoreFunction(PQDecoder.newDecoder(pq, q, similarityFunction));
+    }
+
+    private class PQScoreFunction implements NodeSimilarity.ApproximateScoreFunction {
+        private final PQDecoder decoder;
+        // the chunk holding each node of a batch, and the offset of its encoding there
+        private byte[][] batchChunks = new byte[0][];
+        private int[] batchOffsets = new int[0];
+
+        private PQScoreFunction(PQDecoder decoder) {
+            this.decoder = decoder;
+        }
+
+        @Override
+        public float similarityTo(int node2) {
+            return decoder.similarityTo(chunk(node2), offset(node2));
+        }
+
+        @Override
+        public void similarityTo(int[] nodes, int count, float[] results) {
+            if (batchOffsets.length < count) {
+                batchChunks = new byte[count][];
+                batchOffsets = new int[count];
+            }
+            for (int i = 0; i < count; i++) {
+                batchChunks[i] = chunk(nodes[i]);
+                batchOffsets[i] = offset(nodes[i]);
+            }
+            decoder.similarityTo(batchChunks, batchOffsets, count, results);
+        }
+
+        private byte[] chunk(int node) {
+            return chunks[node >>> chunkShift];
+        }
+    }
+
+    @Override
+    public int getOriginalSize() {
+        return pq.originalDimension * Float.BYTES;
+    }
+
+    @Override
+    public int getCompressedSize() {
+        return pq.codebooks.length;
+    }
+
+    @Override
+    public long ramBytesUsed() {
+        var allChunks = chunks;
+        long chunkBytes = allChunks.length == 0 ? 0 : allChunks.length * RamUsageEstimator.sizeOf(allChunks[0]);
+        return pq.memorySize() + RamUsageEstimator.shallowSizeOf(allChunks) + chunkBytes;
+    }
+}
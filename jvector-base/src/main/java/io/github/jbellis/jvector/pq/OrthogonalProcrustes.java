@@ -0,0 +1,163 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.pq;
+
+import java.util.List;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.ThreadLocalRandom;
+import java.util.stream.IntStream;
+
+/**
+ * The rotation updates used by optimized product quantization.
+ * <p>
+ * The closest orthogonal matrix to a square matrix A is the orthogonal factor of its polar decomposition,
+ * U V^T where A = U S V^T.  Rather than computing an SVD, we find it with the Newton-Schulz iteration
+ * Z <- Z (3I - Z^T Z) / 2, which converges to the polar factor for any nonsingular Z whose singular values
+ * are below sqrt(3).  Each step costs two dense d x d multiplications, done in double precision.
+ */
+final class OrthogonalProcrustes {
+    private static final int MAX_ITERATIONS = 100;
+    private static final double TOLERANCE = 1e-8;
+    // relative size of the identity added to A so that rank-deficient inputs (e.g. a dimension that is
+    // constant across the training set) still have a well-defined, slightly arbitrary, polar factor
+    private static final double SHIFT = 1e-7;
+
+    private OrthogonalProcrustes() {
+    }
+
+    /**
+     * @return the orthogonal R minimizing sum ||R x_n - y_n||^2, as rows, or null if the iteration
+     * did not converge
+     */
+    static float[][] solve(List<float[]> x, List<float[]> y, ForkJoinPool executor) {
+        int d = x.get(0).length;
+        // A = sum y_n x_n^T
+        var a = executor.submit(() -> IntStream.range(0, d).parallel().mapToObj(i -> {
+            var row = new double[d];
+            for (int n = 0; n < x.size(); n++) {
+                double yi = y.get(n)[i];
+                if (yi == 0) {
+                    continue;
+                }
+                float[] xn = x.get(n);
+                for (int j = 0; j < d; j++) {
+                    row[j] += yi * xn[j];
+                }
+            }
+            return row;
+        }).toArray(double[][]::new)).join();
+        return orthogonalFactor(a, executor);
+    }
+
+    /**
+     * @return a uniformly random rotation of the given dimension, as rows
+     */
+    static float[][] randomRotation(int d, ForkJoinPool executor) {
+        var random = ThreadLocalRandom.current();
+        var a = new double[d][d];
+        for (int i = 0; i < d; i++) {
+            for (int j = 0; j < d; j++) {
+                a[i][j] = random.nextGaussian();
+            }
+        }
+        var r = orthogonalFactor(a, executor);
+        // a Gaussian matrix is singular with probability zero, and the shift covers the rest
+        assert r != null;
+        return r;
+    }
+
+    /**
+     * @return the orthogonal factor of the polar decomposition of `a`, or null if it did not converge
+     */
+    static float[][] orthogonalFactor(double[][] a, ForkJoinPool executor) {
+        int d = a.length;
+        double norm = 0;
+        for (var row : a) {
+            for (var v : row) {
+                norm += v * v;
+            }
+        }
+        norm = Math.sqrt(norm);
+        if (norm == 0) {
+            return null;
+        }
+
+        // scaling by the Frobenius norm bounds the singular values by 1
+        var z = new double[d][d];
+        for (int i = 0; i < d; i++) {
+            for (int j = 0; j < d; j++) {
+                z[i][j] = a[i][j] / norm + (i == j ? SHIFT : 0);
+            }
+        }
+        for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++) {
+            var g = multiply(transpose(z), z, executor);
+            double error = 0;
+            for (int i = 0; i < d; i++) {
+                for (int j = 0; j < d; j++) {
+                    double e = g[i][j] - (i == j ? 1 : 0);
+                    error += e * e;
+                }
+            }
+            if (error < TOLERANCE * TOLERANCE * d) {
+                return toFloats(z);
+            }
+            for (int i = 0; i < d; i++) {
+                for (int j = 0; j < d; j++) {
+                    g[i][j] = (i == j ? 1.5 : 0) - 0.5 * g[i][j];
+                }
+            }
+            z = multiply(z, g, executor);
+        }
+        return null;
+    }
+
+    private static double[][] transpose(double[][] m) {
+        int d = m.length;
+        var t = new double[d][d];
+        for (int i = 0; i < d; i++) {
+            for (int j = 0; j < d; j++) {
+                t[j][i] = m[i][j];
+            }
+        }
+        return t;
+    }
+
+    private static double[][] multiply(double[][] p, double[][] q, ForkJoinPool executor) {
+        int d = p.length;
+        return executor.submit(() -> IntStream.range(0, d).parallel().mapToObj(i -> {
+            var row = new double[d];
+            for (int k = 0; k < d; k++) {
+                double pik = p[i][k];
+                var qk = q[k];
+                for (int j = 0; j < d; j++) {
+                    row[j] += pik * qk[j];
+                }
+            }
+            return row;
+        }).toArray(double[][]::new)).join();
+    }
+
+    private static float[][] toFloats(double[][] m) {
+        var f = new float[m.length][m.length];
+        for (int i = 0; i < m.length; i++) {
+            for (int j = 0; j < m.length; j++) {
+                f[i][j] = (float) m[i][j];
+            }
+        }
+        return f;
+    }
+}
@@ -15,73 +15,222 @@
  */
 package io.github.jbellis.jvector.pq;
 
-import io.github.jbellis.jvector.graph.NodeSimilarity;
 import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
 import io.github.jbellis.jvector.vector.VectorUtil;
 
 /**
- * Performs similarity comparisons with compressed vectors without decoding them
+ * Performs similarity comparisons with compressed vectors without decoding them.
+ * <p>
+ * Decoders are not tied to a particular PQVectors instance, so encodings that live elsewhere
+ * (for instance, colocated with the adjacency lists of an on-disk graph) can be scored as well.
+ * The lookup tables of decoders from {@link #newDecoder} are per-thread scratch owned by the
+ * ProductQuantization, so such a decoder should not outlive the next call to newDecoder on the same
+ * thread; decoders from {@link #newDecoders} own their tables.
  */
-abstract class PQDecoder implements NodeSimilarity.ApproximateScoreFunction {
-    protected final PQVectors cv;
+public abstract class PQDecoder {
+    protected final ProductQuantization pq;
+    // scratch for the offsets of a batch of packed encodings
+    private int[] packedOffsets = new int[0];
 
-    protected PQDecoder(PQVectors cv) {
-        this.cv = cv;
+    protected PQDecoder(ProductQuantization pq) {
+        this.pq = pq;
     }
 
-    protected static abstract class CachingDecoder extends PQDecoder {
-        protected final float[] partialSums;
+    /**
+     * @return a decoder computing the similarity of `query` to vectors encoded by `pq`
+     */
+    public static PQDecoder newDecoder(ProductQuantization pq, float[] query, VectorSimilarityFunction similarityFunction) {
+        var centeredQueries = new float[][] {pq.transform(query)};
+        var partialSums = new float[][] {pq.reusablePartialSums()};
+        float[] aMagnitude = similarityFunction == VectorSimilarityFunction.COSINE ? pq.reusablePartialMagnitudes() : null;
+        return newDecoders(pq, centeredQueries, similarityFunction, partialSums, aMagnitude)[0];
+    }
+
+    /**
+     * Equivalent to calling {@link #newDecoder} for each of `queries`, but the lookup tables are built together
+     * in a single pass over the codebooks, so that each centroid is loaded once for the whole batch.  The
+     * decoders own their lookup tables (rather than sharing per-thread scratch), so they may all be in
+     * use at once, on any threads, for as long as needed.  Each decoder is still for one thread at a time.
+     */
+    public static PQDecoder[] newDecoders(ProductQuantization pq, float[][] queries, VectorSimilarityFunction similarityFunction) {
+        var centeredQueries = new float[queries.length][];
+        var partialSums = new float[queries.length][];
+        for (int i = 0; i < queries.length; i++) {
+            centeredQueries[i] = pq.transform(queries[i]);
+            partialSums[i] = new float[pq.getSubspaceCount() * ProductQuantization.CLUSTERS];
+        }
+        // the centroid magnitudes do not depend on the query, so they are shared by the batch
+        float[] aMagnitude = similarityFunction == VectorSimilarityFunction.COSINE
+                             ? new float[pq.getSubspaceCount() * ProductQuantization.CLUSTERS]
+                             : null;
+        return newDecoders(pq, centeredQueries, similarityFunction, partialSums, aMagnitude);
+    }
+
+    private static PQDecoder[] newDecoders(ProductQuantization pq,
+                                           float[][] centeredQueries,
+                                           VectorSimilarityFunction similarityFunction,
+                                           float[][] partialSums,
+                                           float[] aMagnitude)
+    {
+        if (similarityFunction != VectorSimilarityFunction.DOT_PRODUCT
+            && similarityFunction != VectorSimilarityFunction.EUCLIDEAN
+            && similarityFunction != VectorSimilarityFunction.COSINE)
+        {
+            throw new IllegalArgumentException("Unsupported similarity function " + similarityFunction);
+        }
 
-        protected CachingDecoder(PQVectors cv, float[] query, VectorSimilarityFunction vsf) {
-            super(cv);
-            var pq = this.cv.pq;
-            partialSums = cv.reusablePartialSums();
-
-            float[] center = pq.getCenter();
-            var centeredQuery = center == null ? query : VectorUtil.sub(query, center);
-            for (var i = 0; i < pq.getSubspaceCount(); i++) {
-                int offset = pq.subvectorSizesAndOffsets[i][1];
-                int baseOffset = i * ProductQuantization.CLUSTERS;
-                for (var j = 0; j < ProductQuantization.CLUSTERS; j++) {
-                    float[] centroidSubvector = pq.codebooks[i][j];
-                    switch (vsf) {
-                        case DOT_PRODUCT:
-                            partialSums[baseOffset + j] = VectorUtil.dotProduct(centroidSubvector, 0, centeredQuery, offset, centroidSubvector.length);
-                            break;
-                        case EUCLIDEAN:
-                            partialSums[baseOffset + j] = VectorUtil.squareDistance(centroidSubvector, 0, centeredQuery, offset, centroidSubvector.length);
-                            break;
-                        default:
-                            throw new UnsupportedOperationException("Unsupported similarity function " + vsf);
-                    }
+        boolean euclidean = similarityFunction == VectorSimilarityFunction.EUCLIDEAN;
+        for (var m = 0; m < pq.getSubspaceCount(); m++) {
+            int offset = pq.subvectorSizesAndOffsets[m][1];
+            int baseOffset = m * ProductQuantization.CLUSTERS;
+            for (var j = 0; j < ProductQuantization.CLUSTERS; j++) {
+                float[] centroidSubvector = pq.codebooks[m][j];
+                if (aMagnitude != null) {
+                    aMagnitude[baseOffset + j] = VectorUtil.dotProduct(centroidSubvector, 0, centroidSubvector, 0, centroidSubvector.length);
                 }
+                for (int i = 0; i < centeredQueries.length; i++) {
+                    partialSums[i][baseOffset + j] = euclidean
+                                                     ? VectorUtil.squareDistance(centroidSubvector, 0, centeredQueries[i], offset, centroidSubvector.length)
+                                                     : VectorUtil.dotProduct(centroidSubvector, 0, centeredQueries[i], offset, centroidSubvector.length);
+                }
+            }
+        }
+
+        var decoders = new PQDecoder[centeredQueries.length];
+        for (int i = 0; i < decoders.length; i++) {
+            switch (similarityFunction) {
+                case DOT_PRODUCT:
+                    decoders[i] = new DotProductDecoder(pq, partialSums[i]);
+                    break;
+                case EUCLIDEAN:
+                    decoders[i] = new EuclideanDecoder(pq, partialSums[i]);
+                    break;
+                default:
+                    float bMagnitude = VectorUtil.dotProduct(centeredQueries[i], centeredQueries[i]);
+                    decoders[i] = new CosineDecoder(pq, partialSums[i], aMagnitude, bMagnitude);
             }
         }
+        return decoders;
+    }
+
+    /**
+     * @return the similarity of the query to the vector whose encoding is found at
+     * encoded[offset, offset + pq.getSubspaceCount())
+     */
+    public abstract float similarityTo(byte[] encoded, int offset);
+
+    /**
+     * Computes the similarity of the query to each of the `count` encodings packed one after another
+     * starting at encoded[offset], writing them to results[0, count).  The results are identical to
+     * calling {@link #similarityTo(byte[], int)} on each encoding, but are computed a batch at a time.
+     */
+    public void similarityTo(byte[] encoded, int offset, int count, float[] results) {
+        if (packedOffsets.length < count) {
+            packedOffsets = new int[count];
+        }
+        int subspaceCount = pq.getSubspaceCount();
+        for (int i = 0; i < count; i++) {
+            packedOffsets[i] = offset + i * subspaceCount;
+        }
+        similarityTo(encoded, packedOffsets, count, results);
+    }
+
+    /**
+     * Computes the similarity of the query to each of the `count` encodings starting at encoded[offsets[i]],
+     * writing them to results[0, count).  The encodings are scored in place, without copying them together
+     * first.  The results are identical to calling {@link #similarityTo(byte[], int)} on each encoding.
+     */
+    public void similarityTo(byte[] encoded, int[] offsets, int count, float[] results) {
+        for (int i = 0; i < count; i++) {
+            results[i] = similarityTo(encoded, offsets[i]);
+        }
+    }
 
-        protected float decodedSimilarity(byte[] encoded) {
-            return VectorUtil.assembleAndSum(partialSums, ProductQuantization.CLUSTERS, encoded);
+    /**
+     * As {@link #similarityTo(byte[], int[], int, float[])}, but the i-th encoding starts at
+     * encoded[i][offsets[i]], so encodings stored across several arrays are scored in place too.
+     */
+    public void similarityTo(byte[][] encoded, int[] offsets, int count, float[] results) {
+        for (int i = 0; i < count; i++) {
+            results[i] = similarityTo(encoded[i], offsets[i]);
+        }
+    }
+
+    protected static abstract class CachingDecoder extends PQDecoder {
+        protected final float[] partialSums;
+
+        /**
+         * @param partialSums the similarity of the query's subvector to each centroid, subspace by subspace
+         */
+        protected CachingDecoder(ProductQuantization pq, float[] partialSums) {
+            super(pq);
+            this.partialSums = partialSums;
+        }
+
+        protected float decodedSimilarity(byte[] encoded, int offset) {
+            return VectorUtil.assembleAndSum(partialSums, ProductQuantization.CLUSTERS, encoded, offset, pq.getSubspaceCount());
+        }
+
+        protected void decodedSimilarities(byte[] encoded, int[] offsets, int count, float[] results) {
+            VectorUtil.bulkAssembleAndSum(partialSums, ProductQuantization.CLUSTERS, encoded, offsets, pq.getSubspaceCount(), count, results);
+        }
+
+        protected void decodedSimilarities(byte[][] encoded, int[] offsets, int count, float[] results) {
+            VectorUtil.bulkAssembleAndSum(partialSums, ProductQuantization.CLUSTERS, encoded, offsets, pq.getSubspaceCount(), count, results);
         }
     }
 
     static class DotProductDecoder extends CachingDecoder {
-        public DotProductDecoder(PQVectors cv, float[] query) {
-            super(cv, query, VectorSimilarityFunction.DOT_PRODUCT);
+        DotProductDecoder(ProductQuantization pq, float[] partialSums) {
+            super(pq, partialSums);
+        }
+
+        @Override
+        public float similarityTo(byte[] encoded, int offset) {
+            return (1 + decodedSimilarity(encoded, offset)) / 2;
+        }
+
+        @Override
+        public void similarityTo(byte[] encoded, int[] offsets, int count, float[] results) {
+            decodedSimilarities(encoded, offsets, count, results);
+            for (int i = 0; i < count; i++) {
+                results[i] = (1 + results[i]) / 2;
+            }
         }
 
         @Override
-        public float similarityTo(int node2) {
-            return (1 + decodedSimilarity(cv.get(node2))) / 2;
+        public void similarityTo(byte[][] encoded, int[] offsets, int count, float[] results) {
+            decodedSimilarities(encoded, offsets, count, results);
+            for (int i = 0; i < count; i++) {
+                results[i] = (1 + results[i]) / 2;
+            }
         }
     }
 
     static class EuclideanDecoder extends CachingDecoder {
-        public EuclideanDecoder(PQVectors cv, float[] query) {
-            super(cv, query, VectorSimilarityFunction.EUCLIDEAN);
+        EuclideanDecoder(ProductQuantization pq, float[] partialSums) {
+            super(pq, partialSums);
+        }
+
+        @Override
+        public float similarityTo(byte[] encoded, int offset) {
+            return 1 / (1 + decodedSimilarity(encoded, offset));
         }
 
         @Override
-        public float similarityTo(int node2) {
-            return 1 / (1 + decodedSimilarity(cv.get(node2)));
+        public void similarityTo(byte[] encoded, int[] offsets, int count, float[] results) {
+            decodedSimilarities(encoded, offsets, count, results);
+            for (int i = 0; i < count; i++) {
+                results[i] = 1 / (1 + results[i]);
+            }
+        }
+
+        @Override
+        public void similarityTo(byte[][] encoded, int[] offsets, int count, float[] results) {
+            decodedSimilarities(encoded, offsets, count, results);
+            for (int i = 0; i < count; i++) {
+                results[i] = 1 / (1 + results[i]);
+            }
         }
     }
 
@@ -89,46 +238,62 @@ abstract class PQDecoder implements NodeSimilarity.ApproximateScoreFunction {
         protected final float[] partialSums;
         protected final float[] aMagnitude;
         protected final float bMagnitude;
+        // scratch for the magnitudes of a batch of encodings
+        private float[] aMagnitudeSums = new float[0];
 
-        public CosineDecoder(PQVectors cv, float[] query) {
-            super(cv);
-            var pq = this.cv.pq;
+        /**
+         * @param aMagnitude the squared magnitude of each centroid, subspace by subspace
+         * @param bMagnitude the squared magnitude of the centered query
+         */
+        CosineDecoder(ProductQuantization pq, float[] partialSums, float[] aMagnitude, float bMagnitude) {
+            super(pq);
+            this.partialSums = partialSums;
+            this.aMagnitude = aMagnitude;
+            this.bMagnitude = bMagnitude;
+        }
 
-            // Compute and cache partial sums and magnitudes for query vector
-            partialSums = cv.reusablePartialSums();
-            aMagnitude = cv.reusablePartialMagnitudes();
-            float bMagSum = 0.0f;
+        @Override
+        public float similarityTo(byte[] encoded, int offset) {
+            return (1 + decodedCosine(encoded, offset)) / 2;
+        }
 
-            float[] center = pq.getCenter();
-            float[] centeredQuery = center == null ? query : VectorUtil.sub(query, center);
+        @Override
+        public void similarityTo(byte[] encoded, int[] offsets, int count, float[] results) {
+            int subspaceCount = pq.getSubspaceCount();
+            VectorUtil.bulkAssembleAndSum(partialSums, ProductQuantization.CLUSTERS, encoded, offsets, subspaceCount, count, results);
+            VectorUtil.bulkAssembleAndSum(aMagnitude, ProductQuantization.CLUSTERS, encoded, offsets, subspaceCount, count, magnitudeSums(count));
+            toCosineSimilarities(count, results);
+        }
 
-            for (int m = 0; m < pq.getSubspaceCount(); ++m) {
-                int offset = pq.subvectorSizesAndOffsets[m][1];
-                for (int j = 0; j < ProductQuantization.CLUSTERS; ++j) {
-                    float[] centroidSubvector = pq.codebooks[m][j];
-                    partialSums[(m * ProductQuantization.CLUSTERS) + j] = VectorUtil.dotProduct(centroidSubvector, 0, centeredQuery, offset, centroidSubvector.length);
-                    aMagnitude[(m * ProductQuantization.CLUSTERS) + j] = VectorUtil.dotProduct(centroidSubvector, 0, centroidSubvector, 0, centroidSubvector.length);
-                }
+        @Override
+        public void similarityTo(byte[][] encoded, int[] offsets, int count, float[] results) {
+            int subspaceCount = pq.getSubspaceCount();
+            VectorUtil.bulkAssembleAndSum(partialSums, ProductQuantization.CLUSTERS, encoded, offsets, subspaceCount, count, results);
+            VectorUtil.bulkAssembleAndSum(aMagnitude, ProductQuantization.CLUSTERS, encoded, offsets, subspaceCount, count, magnitudeSums(count));
+            toCosineSimilarities(count, results);
+        }
 
-                bMagSum += VectorUtil.dotProduct(centeredQuery, offset, centeredQuery, offset, pq.subvectorSizesAndOffsets[m][0]);
+        private float[] magnitudeSums(int count) {
+            if (aMagnitudeSums.length < count) {
+                aMagnitudeSums = new float[count];
             }
-
-            this.bMagnitude = bMagSum;
+            return aMagnitudeSums;
         }
 
-        @Override
-        public float similarityTo(int node2) {
-            return (1 + decodedCosine(node2)) / 2;
+        // turns the dot products in results[0, count) into similarities, using the magnitudes in aMagnitudeSums
+        private void toCosineSimilarities(int count, float[] results) {
+            for (int i = 0; i < count; i++) {
+                float cosine = (float) (results[i] / Math.sqrt(aMagnitudeSums[i] * bMagnitude));
+                results[i] = (1 + cosine) / 2;
+            }
         }
 
-        protected float decodedCosine(int node2) {
+        protected float decodedCosine(byte[] encoded, int offset) {
             float sum = 0.0f;
             float aMag = 0.0f;
 
-            byte[] encoded = cv.get(node2);
-
-            for (int m = 0; m < encoded.length; ++m) {
-                int centroidIndex = Byte.toUnsignedInt(encoded[m]);
+            for (int m = 0; m < pq.getSubspaceCount(); ++m) {
+                int centroidIndex = Byte.toUnsignedInt(encoded[offset + m]);
                 sum += partialSums[(m * ProductQuantization.CLUSTERS) + centroidIndex];
                 aMag += aMagnitude[(m * ProductQuantization.CLUSTERS) + centroidIndex];
             }
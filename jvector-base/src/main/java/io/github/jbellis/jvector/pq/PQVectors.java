@@ -18,6 +18,7 @@ package io.github.jbellis.jvector.pq;
 
 import io.github.jbellis.jvector.disk.RandomAccessReader;
 import io.github.jbellis.jvector.graph.NodeSimilarity;
+import io.github.jbellis.jvector.util.ArrayUtil;
 import io.github.jbellis.jvector.util.RamUsageEstimator;
 import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
 
@@ -26,18 +27,46 @@ import java.io.IOException;
 import java.util.Arrays;
 import java.util.Objects;
 
+/**
+ * PQ-encoded vectors, stored back to back in a single array so that there is no per-vector
+ * object overhead and a vector's code is found with a multiplication instead of a pointer chase.
+ */
 public class PQVectors implements CompressedVectors {
     final ProductQuantization pq;
-    private final byte[][] compressedVectors;
-    private final ThreadLocal<float[]> partialSums; // for dot product, euclidean, and cosine
-    private final ThreadLocal<float[]> partialMagnitudes; // for cosine
+    // the codes of all the vectors, each pq.getSubspaceCount() bytes long
+    private final byte[] compressedVectors;
+    private final int vectorCount;
 
     public PQVectors(ProductQuantization pq, byte[][] compressedVectors)
     {
+        this(pq, flatten(compressedVectors, pq.getSubspaceCount()), compressedVectors.length);
+    }
+
+    /**
+     * @param compressedVectors the codes of `vectorCount` vectors, concatenated
+     */
+    public PQVectors(ProductQuantization pq, byte[] compressedVectors, int vectorCount)
+    {
+        if ((long) vectorCount * pq.getSubspaceCount() != compressedVectors.length) {
+            throw new IllegalArgumentException(String.format("Expected %d codes of %d bytes but got %d bytes",
+                                                             vectorCount, pq.getSubspaceCount(), compressedVectors.length));
+        }
         this.pq = pq;
         this.compressedVectors = compressedVectors;
-        this.partialSums = ThreadLocal.withInitial(() -> new float[pq.getSubspaceCount() * ProductQuantization.CLUSTERS]);
-        this.partialMagnitudes = ThreadLocal.withInitial(() -> new float[pq.getSubspaceCount() * ProductQuantization.CLUSTERS]);
+        this.vectorCount = vectorCount;
+    }
+
+    private static byte[] flatten(byte[][] compressedVectors, int subspaceCount) {
+        long totalBytes = (long) compressedVectors.length * subspaceCount;
+        if (totalBytes > ArrayUtil.MAX_ARRAY_LENGTH) {
+            throw new IllegalArgumentException(String.format("%d codes of %d bytes do not fit in a single array",
+                                                             compressedVectors.length, subspaceCount));
+        }
+        var flat = new byte[(int) totalBytes];
+        for (int i = 0; i < compressedVectors.length; i++) {
+            System.arraycopy(compressedVectors[i], 0, flat, i * subspaceCount, subspaceCount);
+        }
+        return flat;
     }
 
     @Override
@@ -47,13 +76,15 @@ public class PQVectors implements CompressedVectors {
         pq.write(out);
 
         // compressed vectors
-        out.writeInt(compressedVectors.length);
+        out.writeInt(vectorCount);
         out.writeInt(pq.getSubspaceCount());
-        for (var v : compressedVectors) {
-            out.write(v);
-        }
+        out.write(compressedVectors);
     }
 
+    /**
+     * @return the vectors written by {@link #write} at `offset`.  Usually this is a PQVectors, but codes too
+     * large for a single array (2GB) are loaded in chunks, as a {@link MutablePQVectors}.
+     */
     public static CompressedVectors load(RandomAccessReader in, long offset) throws IOException
     {
         in.seek(offset);
@@ -66,21 +97,21 @@ public class PQVectors implements CompressedVectors {
         if (size < 0) {
             throw new IOException("Invalid compressed vector count " + size);
         }
-        var compressedVectors = new byte[size][];
 
         int compressedDimension = in.readInt();
-        if (compressedDimension < 0) {
-            throw new IOException("Invalid compressed vector dimension " + compressedDimension);
+        if (compressedDimension != pq.getSubspaceCount()) {
+            throw new IOException(String.format("Invalid compressed vector dimension %d for %d subspaces",
+                                                compressedDimension, pq.getSubspaceCount()));
         }
-
-        for (int i = 0; i < size; i++)
-        {
-            byte[] vector = new byte[compressedDimension];
-            in.readFully(vector);
-            compressedVectors[i] = vector;
+        if ((long) size * compressedDimension > ArrayUtil.MAX_ARRAY_LENGTH) {
+            return MutablePQVectors.load(pq, in, size, MutablePQVectors.defaultVectorsPerChunk(pq));
         }
 
-        return new PQVectors(pq, compressedVectors);
+        // the codes are contiguous on disk, so read them with a single bulk copy
+        var compressedVectors = new byte[size * compressedDimension];
+        in.readFully(compressedVectors);
+
+        return new PQVectors(pq, compressedVectors, size);
     }
 
     @Override
@@ -90,39 +121,82 @@ public class PQVectors implements CompressedVectors {
 
         PQVectors that = (PQVectors) o;
         if (!Objects.equals(pq, that.pq)) return false;
-        if (compressedVectors.length != that.compressedVectors.length) return false;
-        return Arrays.deepEquals(compressedVectors, that.compressedVectors);
+        if (vectorCount != that.vectorCount) return false;
+        return Arrays.equals(compressedVectors, that.compressedVectors);
     }
 
     @Override
     public int hashCode() {
-        return Objects.hash(pq, Arrays.deepHashCode(compressedVectors));
+        return Objects.hash(pq, vectorCount, Arrays.hashCode(compressedVectors));
     }
 
     @Override
     public NodeSimilarity.ApproximateScoreFunction approximateScoreFunctionFor(float[] q, VectorSimilarityFunction similarityFunction) {
-        switch (similarityFunction) {
-            case DOT_PRODUCT:
-                return new PQDecoder.DotProductDecoder(this, q);
-            case EUCLIDEAN:
-                return new PQDecoder.EuclideanDecoder(this, q);
-            case COSINE:
-                return new PQDecoder.CosineDecoder(this, q);
-            default:
-                throw new IllegalArgumentException("Unsupported similarity function " + similarityFunction);
+        return new PQScoreFunction(PQDecoder.newDecoder(pq, q, similarityFunction));
+    }
+
+    /**
+     * @return score functions for each of `queries`, like {@link #approximateScoreFunctionFor}, with their
+     * lookup tables built in a single pass over the codebooks; see {@link PQDecoder#newDecoders}
+     */
+    public NodeSimilarity.ApproximateScoreFunction[] approximateScoreFunctionsFor(float[][] queries, VectorSimilarityFunction similarityFunction) {
+        var decoders = PQDecoder.newDecoders(pq, queries, similarityFunction);
+        var scoreFunctions = new NodeSimilarity.ApproximateScoreFunction[decoders.length];
+        for (int i = 0; i < decoders.length; i++) {
+            scoreFunctions[i] = new PQScoreFunction(decoders[i]);
         }
+        return scoreFunctions;
+    }
+
+    /**
+     * @return the offset in {@link #getCompressedVectors()} of the code for `ordinal`
+     */
+    public int get(int ordinal) {
+        return ordinal * pq.getSubspaceCount();
+    }
+
+    /**
+     * @return the codes of all the vectors, concatenated.  This is the backing array, not a copy.
+     */
+    public byte[] getCompressedVectors() {
+        return compressedVectors;
     }
 
-    byte[] get(int ordinal) {
-        return compressedVectors[ordinal];
+    /**
+     * @return the number of vectors
+     */
+    public int count() {
+        return vectorCount;
     }
 
-    float[] reusablePartialSums() {
-        return partialSums.get();
+    public ProductQuantization getProductQuantization() {
+        return pq;
     }
 
-    float[] reusablePartialMagnitudes() {
-        return partialMagnitudes.get();
+    private class PQScoreFunction implements NodeSimilarity.ApproximateScoreFunction {
+        private final PQDecoder decoder;
+        // the offsets of the encodings of a batch of nodes, which are scored in place
+        private int[] offsets = new int[0];
+
+        private PQScoreFunction(PQDecoder decoder) {
+            this.decoder = decoder;
+        }
+
+        @Override
+        public float similarityTo(int node2) {
+            return decoder.similarityTo(compressedVectors, get(node2));
+        }
+
+        @Override
+        public void similarityTo(int[] nodes, int count, float[] results) {
+            if (offsets.length < count) {
+                offsets = new int[count];
+            }
+            for (int i = 0; i < count; i++) {
+                offsets[i] = get(nodes[i]);
+            }
+            decoder.similarityTo(compressedVectors, offsets, count, results);
+        }
     }
 
     @Override
@@ -137,8 +211,6 @@ public class PQVectors implements CompressedVectors {
 
     @Override
     public long ramBytesUsed() {
-        long codebooksSize = pq.memorySize();
-        long compressedVectorSize = RamUsageEstimator.sizeOf(compressedVectors[0]);
-        return codebooksSize + (compressedVectorSize * compressedVectors.length);
+        return pq.memorySize() + RamUsageEstimator.sizeOf(compressedVectors);
     }
 }
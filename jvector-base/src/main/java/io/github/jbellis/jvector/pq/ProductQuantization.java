@@ -45,14 +45,20 @@ import static java.lang.Math.min;
  */
 public class ProductQuantization implements VectorCompressor<byte[]> {
     static final int CLUSTERS = 256; // number of clusters per subspace = one byte's worth
-    static final int K_MEANS_ITERATIONS = 6;
+    static final int K_MEANS_ITERATIONS = 6; // upper bound, in passes over the training set
     static final int MAX_PQ_TRAINING_SET_SIZE = 128000;
+    static final int OPQ_ITERATIONS = 8;
+    // written in place of the global centroid length when a rotation follows
+    private static final int ROTATION_MARKER = -1;
 
     final float[][][] codebooks;
     private final int M; // codebooks.length, redundantly reproduced for convenience
     final int originalDimension;
     private final float[] globalCentroid;
+    private final float[][] rotation; // rows of the OPQ rotation, or null
     final int[][] subvectorSizesAndOffsets;
+    private final ThreadLocal<float[]> partialSums; // for dot product, euclidean, and cosine
+    private final ThreadLocal<float[]> partialMagnitudes; // for cosine
 
     /**
      * Initializes the codebooks by clustering the input data using Product Quantization.
@@ -83,11 +89,91 @@ public class ProductQuantization implements VectorCompressor<byte[]> {
             boolean globallyCenter,
             ForkJoinPool simdExecutor,
             ForkJoinPool parallelExecutor) {
+        var vectors = sampleTrainingVectors(ravv, parallelExecutor);
+        var globalCentroid = globallyCenter ? KMeansPlusPlusClusterer.centroidOf(vectors) : null;
+        if (globalCentroid != null) {
+            vectors = center(vectors, globalCentroid, simdExecutor);
+        }
+
+        // derive the codebooks
+        var subvectorSizesAndOffsets = getSubvectorSizesAndOffsets(ravv.dimension(), M);
+        var codebooks = createCodebooks(vectors, M, subvectorSizesAndOffsets, simdExecutor);
+        return new ProductQuantization(codebooks, globalCentroid);
+    }
+
+    /**
+     * Initializes the codebooks using Optimized Product Quantization (Ge et al.), which learns a rotation
+     * of the vectors alongside the codebooks.  The rotation spreads the variance of the vectors, and the
+     * correlation between their dimensions, across the subspaces, which lowers the quantization error
+     * for the same code size; the cost is a d x d matrix multiplication per encoded vector and query.
+     *
+     * @param ravv the vectors to quantize
+     * @param M number of subspaces
+     * @param globallyCenter whether to center the vectors globally before quantization
+     *                       (not recommended when using the quantization for dot product)
+     */
+    public static ProductQuantization computeOptimized(RandomAccessVectorValues<float[]> ravv, int M, boolean globallyCenter) {
+        return computeOptimized(ravv, M, globallyCenter, OPQ_ITERATIONS, PhysicalCoreExecutor.pool(), ForkJoinPool.commonPool());
+    }
+
+    /**
+     * Initializes the codebooks using Optimized Product Quantization.  Starting from a random rotation, each
+     * iteration clusters the rotated vectors, then replaces the rotation with the one that best maps the
+     * vectors onto their quantized reconstructions (an orthogonal Procrustes problem).  Training costs
+     * iterations + 1 times as much clustering as {@link #compute}, plus O(d^3) per iteration for the rotation.
+     *
+     * @param ravv the vectors to quantize
+     * @param M number of subspaces
+     * @param globallyCenter whether to center the vectors globally before quantization
+     *                       (not recommended when using the quantization for dot product)
+     * @param iterations number of rotation updates
+     * @param simdExecutor     ForkJoinPool instance for SIMD operations, best is to use a pool with the size of
+     *                         the number of physical cores.
+     * @param parallelExecutor ForkJoinPool instance for parallel stream operations
+     */
+    public static ProductQuantization computeOptimized(
+            RandomAccessVectorValues<float[]> ravv,
+            int M,
+            boolean globallyCenter,
+            int iterations,
+            ForkJoinPool simdExecutor,
+            ForkJoinPool parallelExecutor) {
+        if (iterations < 0) {
+            throw new IllegalArgumentException("iterations must be non-negative, got " + iterations);
+        }
+        var vectors = sampleTrainingVectors(ravv, parallelExecutor);
+        var globalCentroid = globallyCenter ? KMeansPlusPlusClusterer.centroidOf(vectors) : null;
+        if (globalCentroid != null) {
+            vectors = center(vectors, globalCentroid, simdExecutor);
+        }
+
+        var subvectorSizesAndOffsets = getSubvectorSizesAndOffsets(ravv.dimension(), M);
+        // the identity is a fixed point of the rotation update once the codebooks fit the data, so start elsewhere
+        var rotation = OrthogonalProcrustes.randomRotation(ravv.dimension(), simdExecutor);
+        for (int i = 0; i < iterations; i++) {
+            var rotated = rotate(vectors, rotation, simdExecutor);
+            var pq = new ProductQuantization(createCodebooks(rotated, M, subvectorSizesAndOffsets, simdExecutor), null);
+            var reconstructed = simdExecutor.submit(() -> rotated.stream().parallel().map(v -> {
+                var target = new float[v.length];
+                pq.decodeCentered(pq.encode(v), target);
+                return target;
+            }).collect(Collectors.toList())).join();
+            var updated = OrthogonalProcrustes.solve(vectors, reconstructed, simdExecutor);
+            if (updated == null) {
+                break;
+            }
+            rotation = updated;
+        }
+
+        var codebooks = createCodebooks(rotate(vectors, rotation, simdExecutor), M, subvectorSizesAndOffsets, simdExecutor);
+        return new ProductQuantization(codebooks, globalCentroid, rotation);
+    }
+
+    static List<float[]> sampleTrainingVectors(RandomAccessVectorValues<float[]> ravv, ForkJoinPool parallelExecutor) {
         // limit the number of vectors we train on
         var P = min(1.0f, MAX_PQ_TRAINING_SET_SIZE / (float) ravv.size());
         var ravvCopy = ravv.isValueShared() ? PoolingSupport.newThreadBased(ravv::copy) : PoolingSupport.newNoPooling(ravv);
-        var subvectorSizesAndOffsets = getSubvectorSizesAndOffsets(ravv.dimension(), M);
-        var vectors = parallelExecutor.submit(() -> IntStream.range(0, ravv.size()).parallel()
+        return parallelExecutor.submit(() -> IntStream.range(0, ravv.size()).parallel()
                 .filter(i -> ThreadLocalRandom.current().nextFloat() < P)
                 .mapToObj(targetOrd -> {
                     try (var pooledRavv = ravvCopy.get()) {
@@ -98,27 +184,35 @@ public class ProductQuantization implements VectorCompressor<byte[]> {
                 })
                 .collect(Collectors.toList()))
                 .join();
+    }
 
-        // subtract the centroid from each training vector
-        float[] globalCentroid;
-        if (globallyCenter) {
-            globalCentroid = KMeansPlusPlusClusterer.centroidOf(vectors);
-            // subtract the centroid from each vector
-            List<float[]> finalVectors = vectors;
-            vectors = simdExecutor.submit(() -> finalVectors.stream().parallel().map(v -> VectorUtil.sub(v, globalCentroid)).collect(Collectors.toList())).join();
-        } else {
-            globalCentroid = null;
-        }
+    private static List<float[]> center(List<float[]> vectors, float[] globalCentroid, ForkJoinPool simdExecutor) {
+        // subtract the centroid from each vector
+        return simdExecutor.submit(() -> vectors.stream().parallel().map(v -> VectorUtil.sub(v, globalCentroid)).collect(Collectors.toList())).join();
+    }
 
-        // derive the codebooks
-        var codebooks = createCodebooks(vectors, M, subvectorSizesAndOffsets, simdExecutor);
-        return new ProductQuantization(codebooks, globalCentroid);
+    private static List<float[]> rotate(List<float[]> vectors, float[][] rotation, ForkJoinPool simdExecutor) {
+        return simdExecutor.submit(() -> vectors.stream().parallel().map(v -> rotate(v, rotation)).collect(Collectors.toList())).join();
+    }
+
+    private static float[] rotate(float[] vector, float[][] rotation) {
+        var rotated = new float[rotation.length];
+        for (int i = 0; i < rotation.length; i++) {
+            rotated[i] = VectorUtil.dotProduct(rotation[i], vector);
+        }
+        return rotated;
     }
 
     ProductQuantization(float[][][] codebooks, float[] globalCentroid)
+    {
+        this(codebooks, globalCentroid, null);
+    }
+
+    ProductQuantization(float[][][] codebooks, float[] globalCentroid, float[][] rotation)
     {
         this.codebooks = codebooks;
         this.globalCentroid = globalCentroid;
+        this.rotation = rotation;
         this.M = codebooks.length;
         this.subvectorSizesAndOffsets = new int[M][];
         int offset = 0;
@@ -128,6 +222,12 @@ public class ProductQuantization implements VectorCompressor<byte[]> {
             offset += size;
         }
         this.originalDimension = Arrays.stream(subvectorSizesAndOffsets).mapToInt(m -> m[0]).sum();
+        if (rotation != null && (rotation.length != originalDimension || rotation[0].length != originalDimension)) {
+            throw new IllegalArgumentException(String.format("Rotation must be %d x %d, got %d x %d",
+                                                             originalDimension, originalDimension, rotation.length, rotation[0].length));
+        }
+        this.partialSums = ThreadLocal.withInitial(() -> new float[M * CLUSTERS]);
+        this.partialMagnitudes = ThreadLocal.withInitial(() -> new float[M * CLUSTERS]);
     }
 
     @Override
@@ -150,16 +250,64 @@ public class ProductQuantization implements VectorCompressor<byte[]> {
      */
     @Override
     public byte[] encode(float[] vector) {
-        if (globalCentroid != null) {
-            vector = VectorUtil.sub(vector, globalCentroid);
+        byte[] encoded = new byte[M];
+        encodeTo(vector, encoded, 0);
+        return encoded;
+    }
+
+    /**
+     * Encodes the input vector into dest[offset, offset + {@link #getSubspaceCount()}).  Each subvector is
+     * compared with its centroids where it lies in the vector, without copying it out.
+     */
+    public void encodeTo(float[] vector, byte[] dest, int offset) {
+        float[] finalVector = transform(vector);
+        for (int m = 0; m < M; m++) {
+            int size = subvectorSizesAndOffsets[m][0];
+            int subvectorOffset = subvectorSizesAndOffsets[m][1];
+            float[][] codebook = codebooks[m];
+            int index = 0;
+            float minDist = Float.MAX_VALUE;
+            for (int i = 0; i < codebook.length; i++) {
+                float dist = VectorUtil.squareDistance(finalVector, subvectorOffset, codebook[i], 0, size);
+                if (dist < minDist) {
+                    minDist = dist;
+                    index = i;
+                }
+            }
+            dest[offset + m] = (byte) index;
         }
+    }
 
-        float[] finalVector = vector;
-        byte[] encoded = new byte[M];
+    /**
+     * Encodes `vectors` back to back into dest starting at dest[offset], with the same results as calling
+     * {@link #encodeTo} on each.  Each centroid is compared with the whole batch while it is in cache,
+     * instead of reloading the codebook for every vector, so a few dozen vectors at a time encode faster.
+     */
+    public void encodeTo(List<float[]> vectors, byte[] dest, int offset) {
+        int n = vectors.size();
+        var transformed = new float[n][];
+        for (int j = 0; j < n; j++) {
+            transformed[j] = transform(vectors.get(j));
+        }
+        var minDist = new float[n];
         for (int m = 0; m < M; m++) {
-            encoded[m] = (byte) closetCentroidIndex(getSubVector(finalVector, m, subvectorSizesAndOffsets), codebooks[m]);
+            int size = subvectorSizesAndOffsets[m][0];
+            int subvectorOffset = subvectorSizesAndOffsets[m][1];
+            float[][] codebook = codebooks[m];
+            Arrays.fill(minDist, Float.MAX_VALUE);
+            for (int j = 0; j < n; j++) {
+                dest[offset + j * M + m] = 0;
+            }
+            for (int i = 0; i < codebook.length; i++) {
+                for (int j = 0; j < n; j++) {
+                    float dist = VectorUtil.squareDistance(transformed[j], subvectorOffset, codebook[i], 0, size);
+                    if (dist < minDist[j]) {
+                        minDist[j] = dist;
+                        dest[offset + j * M + m] = (byte) i;
+                    }
+                }
+            }
         }
-        return encoded;
     }
 
     /**
@@ -178,13 +326,35 @@ public class ProductQuantization implements VectorCompressor<byte[]> {
      * Decodes the quantized representation (byte array) to its approximate original vector, relative to the global centroid.
      */
     void decodeCentered(byte[] encoded, float[] target) {
+        float[] rotated = rotation == null ? target : new float[originalDimension];
         for (int m = 0; m < M; m++) {
             int centroidIndex = Byte.toUnsignedInt(encoded[m]);
             float[] centroidSubvector = codebooks[m][centroidIndex];
-            System.arraycopy(centroidSubvector, 0, target, subvectorSizesAndOffsets[m][1], subvectorSizesAndOffsets[m][0]);
+            System.arraycopy(centroidSubvector, 0, rotated, subvectorSizesAndOffsets[m][1], subvectorSizesAndOffsets[m][0]);
+        }
+        if (rotation != null) {
+            // the rotation is orthogonal, so its inverse is its transpose
+            Arrays.fill(target, 0, originalDimension, 0);
+            for (int i = 0; i < originalDimension; i++) {
+                float r = rotated[i];
+                float[] row = rotation[i];
+                for (int j = 0; j < originalDimension; j++) {
+                    target[j] += r * row[j];
+                }
+            }
         }
     }
 
+    /**
+     * @return `vector` centered and rotated into the space the codebooks were trained in.  May return `vector` itself.
+     */
+    float[] transform(float[] vector) {
+        if (globalCentroid != null) {
+            vector = VectorUtil.sub(vector, globalCentroid);
+        }
+        return rotation == null ? vector : rotate(vector, rotation);
+    }
+
     /**
      * @return how many bytes we are compressing to
      */
@@ -192,6 +362,14 @@ public class ProductQuantization implements VectorCompressor<byte[]> {
         return M;
     }
 
+    float[] reusablePartialSums() {
+        return partialSums.get();
+    }
+
+    float[] reusablePartialMagnitudes() {
+        return partialMagnitudes.get();
+    }
+
     // for testing
     static void printCodebooks(List<List<float[]>> codebooks) {
         List<List<String>> strings = codebooks.stream()
@@ -215,40 +393,27 @@ public class ProductQuantization implements VectorCompressor<byte[]> {
     }
 
     static float[][][] createCodebooks(List<float[]> vectors, int M, int[][] subvectorSizeAndOffset, ForkJoinPool simdExecutor) {
+        // one subspace per task; the subspaces are independent, so there is no need to parallelize within them
         return simdExecutor.submit(() -> IntStream.range(0, M).parallel()
                 .mapToObj(m -> {
-                    float[][] subvectors = vectors.stream().parallel()
-                            .map(vector -> getSubVector(vector, m, subvectorSizeAndOffset))
-                            .toArray(float[][]::new);
-                    var clusterer = new KMeansPlusPlusClusterer(subvectors, CLUSTERS, VectorUtil::squareDistance);
-                    return clusterer.cluster(K_MEANS_ITERATIONS);
+                    int size = subvectorSizeAndOffset[m][0];
+                    int offset = subvectorSizeAndOffset[m][1];
+                    float[] subvectors = new float[vectors.size() * size];
+                    for (int i = 0; i < vectors.size(); i++) {
+                        System.arraycopy(vectors.get(i), offset, subvectors, i * size, size);
+                    }
+                    var clusterer = new MiniBatchKMeansClusterer(subvectors, size, CLUSTERS);
+                    float[] centroids = clusterer.cluster(K_MEANS_ITERATIONS);
+                    float[][] codebook = new float[CLUSTERS][];
+                    for (int c = 0; c < CLUSTERS; c++) {
+                        codebook[c] = Arrays.copyOfRange(centroids, c * size, (c + 1) * size);
+                    }
+                    return codebook;
                 })
                 .toArray(float[][][]::new))
                 .join();
     }
     
-    static int closetCentroidIndex(float[] subvector, float[][] codebook) {
-        int index = 0;
-        float minDist = Integer.MAX_VALUE;
-        for (int i = 0; i < codebook.length; i++) {
-            float dist = VectorUtil.squareDistance(subvector, codebook[i]);
-            if (dist < minDist) {
-                minDist = dist;
-                index = i;
-            }
-        }
-        return index;
-    }
-
-    /**
-     * Extracts the m-th subvector from a single vector.
-     */
-    static float[] getSubVector(float[] vector, int m, int[][] subvectorSizeAndOffset) {
-        float[] subvector = new float[subvectorSizeAndOffset[m][0]];
-        System.arraycopy(vector, subvectorSizeAndOffset[m][1], subvector, 0, subvectorSizeAndOffset[m][0]);
-        return subvector;
-    }
-
     /**
      * Splits the vector dimension into M subvectors of roughly equal size.
      */
@@ -268,6 +433,13 @@ public class ProductQuantization implements VectorCompressor<byte[]> {
 
     public void write(DataOutput out) throws IOException
     {
+        if (rotation != null) {
+            out.writeInt(ROTATION_MARKER);
+            out.writeInt(rotation.length);
+            for (var row : rotation) {
+                Io.writeFloats(out, row);
+            }
+        }
         if (globalCentroid == null) {
             out.writeInt(0);
         } else {
@@ -294,6 +466,15 @@ public class ProductQuantization implements VectorCompressor<byte[]> {
 
     public static ProductQuantization load(RandomAccessReader in) throws IOException {
         int globalCentroidLength = in.readInt();
+        float[][] rotation = null;
+        if (globalCentroidLength == ROTATION_MARKER) {
+            int dimension = in.readInt();
+            rotation = new float[dimension][dimension];
+            for (var row : rotation) {
+                in.readFully(row);
+            }
+            globalCentroidLength = in.readInt();
+        }
         float[] globalCentroid = null;
         if (globalCentroidLength > 0) {
             globalCentroid = new float[globalCentroidLength];
@@ -324,7 +505,7 @@ public class ProductQuantization implements VectorCompressor<byte[]> {
             codebooks[m] = codebook;
         }
 
-        return new ProductQuantization(codebooks, globalCentroid);
+        return new ProductQuantization(codebooks, globalCentroid, rotation);
     }
 
     @Override
@@ -336,6 +517,7 @@ public class ProductQuantization implements VectorCompressor<byte[]> {
                && originalDimension == that.originalDimension
                && Arrays.deepEquals(codebooks, that.codebooks)
                && Arrays.equals(globalCentroid, that.globalCentroid)
+               && Arrays.deepEquals(rotation, that.rotation)
                && Arrays.deepEquals(subvectorSizesAndOffsets, that.subvectorSizesAndOffsets);
     }
 
@@ -344,6 +526,7 @@ public class ProductQuantization implements VectorCompressor<byte[]> {
         int result = Objects.hash(M, originalDimension);
         result = 31 * result + Arrays.deepHashCode(codebooks);
         result = 31 * result + Arrays.hashCode(globalCentroid);
+        result = 31 * result + Arrays.deepHashCode(rotation);
         result = 31 * result + Arrays.deepHashCode(subvectorSizesAndOffsets);
         return result;
     }
@@ -352,6 +535,13 @@ public class ProductQuantization implements VectorCompressor<byte[]> {
         return globalCentroid;
     }
 
+    /**
+     * @return the rows of the rotation applied after centering, or null if this is not an OPQ quantization
+     */
+    public float[][] getRotation() {
+        return rotation;
+    }
+
     public long memorySize() {
         long size = 0;
         for (float[][] codebook : codebooks) {
@@ -359,12 +549,17 @@ public class ProductQuantization implements VectorCompressor<byte[]> {
                 size += RamUsageEstimator.sizeOf(floats);
             }
         }
+        if (rotation != null) {
+            for (float[] row : rotation) {
+                size += RamUsageEstimator.sizeOf(row);
+            }
+        }
 
         return size;
     }
 
     @Override
     public String toString() {
-        return String.format("ProductQuantization(%s)", M);
+        return String.format(rotation == null ? "ProductQuantization(%s)" : "ProductQuantization(%s, rotated)", M);
     }
 }
@@ -0,0 +1,221 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.pq;
+
+import io.github.jbellis.jvector.disk.RandomAccessReader;
+import io.github.jbellis.jvector.graph.NodeSimilarity;
+import io.github.jbellis.jvector.util.ArrayUtil;
+import io.github.jbellis.jvector.util.RamUsageEstimator;
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
+import io.github.jbellis.jvector.vector.VectorUtil;
+
+import java.io.DataOutput;
+import java.io.IOException;
+import java.util.Arrays;
+import java.util.Objects;
+
+/**
+ * SQ-encoded vectors, stored back to back in a single array like {@link PQVectors}.
+ * <p>
+ * Similarities are computed on the codes, without decoding them.  Euclidean and cosine similarity also need
+ * the magnitude of each decoded vector, which is computed once when the vectors are created (or loaded)
+ * rather than stored.  The scores are cheap enough, and usually close enough to the exact ones, that
+ * {@link #rerankerFor} can stand in for the full-resolution vectors when reranking another approximate search.
+ */
+public class SQVectors implements CompressedVectors {
+    private final ScalarQuantization sq;
+    // the codes of all the vectors, each sq.getCompressedSize() bytes long
+    private final byte[] compressedVectors;
+    private final int vectorCount;
+    // squared magnitude of each decoded vector
+    private final float[] squaredMagnitudes;
+
+    public SQVectors(ScalarQuantization sq, byte[][] compressedVectors) {
+        this(sq, flatten(compressedVectors, sq.getCompressedSize()), compressedVectors.length);
+    }
+
+    /**
+     * @param compressedVectors the codes of `vectorCount` vectors, concatenated
+     */
+    public SQVectors(ScalarQuantization sq, byte[] compressedVectors, int vectorCount) {
+        int codeSize = sq.getCompressedSize();
+        if ((long) vectorCount * codeSize != compressedVectors.length) {
+            throw new IllegalArgumentException(String.format("Expected %d codes of %d bytes but got %d bytes",
+                                                             vectorCount, codeSize, compressedVectors.length));
+        }
+        this.sq = sq;
+        this.compressedVectors = compressedVectors;
+        this.vectorCount = vectorCount;
+
+        squaredMagnitudes = new float[vectorCount];
+        var decoded = new float[sq.getOriginalDimension()];
+        for (int i = 0; i < vectorCount; i++) {
+            sq.decode(compressedVectors, i * codeSize, decoded);
+            squaredMagnitudes[i] = VectorUtil.dotProduct(decoded, decoded);
+        }
+    }
+
+    private static byte[] flatten(byte[][] compressedVectors, int codeSize) {
+        long totalBytes = (long) compressedVectors.length * codeSize;
+        if (totalBytes > ArrayUtil.MAX_ARRAY_LENGTH) {
+            throw new IllegalArgumentException(String.format("%d codes of %d bytes do not fit in a single array",
+                                                             compressedVectors.length, codeSize));
+        }
+        var flat = new byte[(int) totalBytes];
+        for (int i = 0; i < compressedVectors.length; i++) {
+            System.arraycopy(compressedVectors[i], 0, flat, i * codeSize, codeSize);
+        }
+        return flat;
+    }
+
+    @Override
+    public void write(DataOutput out) throws IOException {
+        // quantization ranges
+        sq.write(out);
+
+        // compressed vectors
+        out.writeInt(vectorCount);
+        out.writeInt(sq.getCompressedSize());
+        out.write(compressedVectors);
+    }
+
+    public static SQVectors load(RandomAccessReader in, long offset) throws IOException {
+        in.seek(offset);
+
+        var sq = ScalarQuantization.load(in);
+
+        int size = in.readInt();
+        if (size < 0) {
+            throw new IOException("Invalid compressed vector count " + size);
+        }
+        int codeSize = in.readInt();
+        if (codeSize != sq.getCompressedSize()) {
+            throw new IOException(String.format("Invalid compressed vector size %d for %d dimensions at %d bits",
+                                                codeSize, sq.getOriginalDimension(), sq.getBits()));
+        }
+        if ((long) size * codeSize > ArrayUtil.MAX_ARRAY_LENGTH) {
+            throw new IOException(String.format("%d codes of %d bytes do not fit in a single array", size, codeSize));
+        }
+
+        var compressedVectors = new byte[size * codeSize];
+        in.readFully(compressedVectors);
+        return new SQVectors(sq, compressedVectors, size);
+    }
+
+    @Override
+    public NodeSimilarity.ApproximateScoreFunction approximateScoreFunctionFor(float[] q, VectorSimilarityFunction similarityFunction) {
+        var scorer = new Scorer(q, similarityFunction);
+        return scorer::similarityTo;
+    }
+
+    /**
+     * @return a ReRanker scoring `q` against the decoded vectors, computed on the codes as by
+     * {@link #approximateScoreFunctionFor}
+     */
+    public NodeSimilarity.ReRanker rerankerFor(float[] q, VectorSimilarityFunction similarityFunction) {
+        var scorer = new Scorer(q, similarityFunction);
+        return scorer::similarityTo;
+    }
+
+    private class Scorer {
+        private final VectorSimilarityFunction similarityFunction;
+        private final float[] weights;
+        private final float offset;
+        private final float querySquaredMagnitude;
+
+        Scorer(float[] q, VectorSimilarityFunction similarityFunction) {
+            if (q.length != sq.getOriginalDimension()) {
+                throw new IllegalArgumentException(String.format("Query has dimension %d, expected %d", q.length, sq.getOriginalDimension()));
+            }
+            this.similarityFunction = similarityFunction;
+            this.weights = sq.weightsFor(q);
+            this.offset = sq.offsetFor(q);
+            this.querySquaredMagnitude = VectorUtil.dotProduct(q, q);
+        }
+
+        float similarityTo(int node) {
+            float dot = offset + sq.codeDotProduct(weights, compressedVectors, get(node));
+            switch (similarityFunction) {
+                case DOT_PRODUCT:
+                    return (1 + dot) / 2;
+                case EUCLIDEAN:
+                    float distance = querySquaredMagnitude - 2 * dot + squaredMagnitudes[node];
+                    return 1 / (1 + Math.max(0, distance));
+                case COSINE:
+                    float cosine = (float) (dot / Math.sqrt(querySquaredMagnitude * squaredMagnitudes[node]));
+                    return (1 + cosine) / 2;
+                default:
+                    throw new IllegalArgumentException("Unsupported similarity function " + similarityFunction);
+            }
+        }
+    }
+
+    /**
+     * @return the offset in {@link #getCompressedVectors()} of the code for `ordinal`
+     */
+    public int get(int ordinal) {
+        return ordinal * sq.getCompressedSize();
+    }
+
+    /**
+     * @return the codes of all the vectors, concatenated.  This is the backing array, not a copy.
+     */
+    public byte[] getCompressedVectors() {
+        return compressedVectors;
+    }
+
+    /**
+     * @return the number of vectors
+     */
+    public int count() {
+        return vectorCount;
+    }
+
+    public ScalarQuantization getScalarQuantization() {
+        return sq;
+    }
+
+    @Override
+    public int getOriginalSize() {
+        return sq.getOriginalDimension() * Float.BYTES;
+    }
+
+    @Override
+    public int getCompressedSize() {
+        return sq.getCompressedSize();
+    }
+
+    @Override
+    public long ramBytesUsed() {
+        return RamUsageEstimator.sizeOf(compressedVectors) + RamUsageEstimator.sizeOf(squaredMagnitudes);
+    }
+
+    @Override
+    public boolean equals(Object o) {
+        if (this == o) return true;
+        if (o == null || getClass() != o.getClass()) return false;
+        SQVectors that = (SQVectors) o;
+        return vectorCount == that.vectorCount
+               && Objects.equals(sq, that.sq)
+               && Arrays.equals(compressedVectors, that.compressedVectors);
+    }
+
+    @Override
+    public int hashCode() {
+        return Objects.hash(sq, vectorCount, Arrays.hashCode(compressedVectors));
+    }
+}
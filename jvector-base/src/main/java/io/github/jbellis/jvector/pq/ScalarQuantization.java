@@ -0,0 +1,246 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.pq;
+
+import io.github.jbellis.jvector.disk.Io;
+import io.github.jbellis.jvector.disk.RandomAccessReader;
+import io.github.jbellis.jvector.graph.RandomAccessVectorValues;
+import io.github.jbellis.jvector.vector.VectorUtil;
+
+import java.io.DataOutput;
+import java.io.IOException;
+import java.util.Arrays;
+import java.util.List;
+import java.util.Objects;
+import java.util.concurrent.ForkJoinPool;
+
+/**
+ * Scalar Quantization of float vectors: each dimension is mapped linearly from the range it spans in the
+ * training set onto 8-bit (SQ8) or 4-bit (SQ4) unsigned integer codes.
+ * <p>
+ * SQ8 codes are one byte per dimension.  SQ4 codes are two dimensions per byte: with h = ceil(dimension / 2),
+ * byte i holds dimension i in its low nibble and dimension h + i in its high nibble.
+ * <p>
+ * Since the decoded value of dimension j is min[j] + step[j] * code[j], the dot product of a query q with a
+ * decoded vector is sum(q[j] * min[j]) + sum(q[j] * step[j] * code[j]).  The first term and the weights
+ * q[j] * step[j] only depend on the query, so similarities are computed directly on the codes with a
+ * single float-by-integer dot product; see {@link SQVectors}.
+ */
+public class ScalarQuantization implements VectorCompressor<byte[]> {
+    private final int bits;
+    private final float[] min;
+    private final float[] step;
+
+    /**
+     * @param bits 8 or 4
+     * @param min  the decoded value of code 0 for each dimension
+     * @param step the difference between the decoded values of consecutive codes for each dimension
+     */
+    public ScalarQuantization(int bits, float[] min, float[] step) {
+        if (bits != 8 && bits != 4) {
+            throw new IllegalArgumentException("Scalar quantization supports 8 or 4 bits, not " + bits);
+        }
+        if (min.length != step.length) {
+            throw new IllegalArgumentException(String.format("%d minimums for %d steps", min.length, step.length));
+        }
+        this.bits = bits;
+        this.min = min;
+        this.step = step;
+    }
+
+    /**
+     * Learns the range of each dimension from (a sample of) the given vectors.
+     *
+     * @param bits 8 or 4
+     */
+    public static ScalarQuantization compute(RandomAccessVectorValues<float[]> ravv, int bits) {
+        return compute(ravv, bits, ForkJoinPool.commonPool());
+    }
+
+    public static ScalarQuantization compute(RandomAccessVectorValues<float[]> ravv, int bits, ForkJoinPool parallelExecutor) {
+        var vectors = ProductQuantization.sampleTrainingVectors(ravv, parallelExecutor);
+        int dimension = ravv.dimension();
+        var min = new float[dimension];
+        var max = new float[dimension];
+        Arrays.fill(min, Float.POSITIVE_INFINITY);
+        Arrays.fill(max, Float.NEGATIVE_INFINITY);
+        for (var v : vectors) {
+            for (int j = 0; j < dimension; j++) {
+                min[j] = Math.min(min[j], v[j]);
+                max[j] = Math.max(max[j], v[j]);
+            }
+        }
+
+        int levels = (1 << bits) - 1;
+        var step = new float[dimension];
+        for (int j = 0; j < dimension; j++) {
+            if (vectors.isEmpty()) {
+                min[j] = 0;
+            } else {
+                step[j] = (max[j] - min[j]) / levels;
+            }
+        }
+        return new ScalarQuantization(bits, min, step);
+    }
+
+    @Override
+    public CompressedVectors createCompressedVectors(Object[] compressedVectors) {
+        return new SQVectors(this, (byte[][]) compressedVectors);
+    }
+
+    @Override
+    public byte[][] encodeAll(List<float[]> vectors, ForkJoinPool simdExecutor) {
+        return simdExecutor.submit(() -> vectors.stream().parallel().map(this::encode).toArray(byte[][]::new)).join();
+    }
+
+    /**
+     * Encodes the input vector, clamping values outside the training range to its ends.
+     *
+     * @return {@link #getCompressedSize()} bytes
+     */
+    @Override
+    public byte[] encode(float[] v) {
+        var encoded = new byte[getCompressedSize()];
+        if (bits == 8) {
+            for (int j = 0; j < min.length; j++) {
+                encoded[j] = (byte) code(v, j);
+            }
+        } else {
+            int half = encoded.length;
+            for (int i = 0; i < half; i++) {
+                int high = half + i < min.length ? code(v, half + i) : 0;
+                encoded[i] = (byte) (code(v, i) | (high << 4));
+            }
+        }
+        return encoded;
+    }
+
+    private int code(float[] v, int j) {
+        if (step[j] == 0) {
+            return 0;
+        }
+        int levels = (1 << bits) - 1;
+        return Math.max(0, Math.min(levels, Math.round((v[j] - min[j]) / step[j])));
+    }
+
+    /**
+     * Decodes the code found at encoded[offset, offset + getCompressedSize()) to its approximate original vector.
+     */
+    public void decode(byte[] encoded, int offset, float[] target) {
+        if (bits == 8) {
+            for (int j = 0; j < min.length; j++) {
+                target[j] = min[j] + step[j] * Byte.toUnsignedInt(encoded[offset + j]);
+            }
+        } else {
+            int half = getCompressedSize();
+            for (int j = 0; j < min.length; j++) {
+                int b = Byte.toUnsignedInt(encoded[offset + j % half]);
+                int code = j < half ? b & 0x0f : b >>> 4;
+                target[j] = min[j] + step[j] * code;
+            }
+        }
+    }
+
+    /**
+     * @return the per-code weights for computing dot products with `q` on the codes, laid out as
+     * {@link #codeDotProduct} expects
+     */
+    float[] weightsFor(float[] q) {
+        var weights = new float[bits == 8 ? min.length : 2 * getCompressedSize()];
+        for (int j = 0; j < min.length; j++) {
+            weights[j] = q[j] * step[j];
+        }
+        return weights;
+    }
+
+    /**
+     * @return the part of the dot product of `q` with any decoded vector that does not depend on the code
+     */
+    float offsetFor(float[] q) {
+        return VectorUtil.dotProduct(q, min);
+    }
+
+    /**
+     * @return sum(weights[j] * code[j]) for the code at encoded[offset, offset + getCompressedSize())
+     */
+    float codeDotProduct(float[] weights, byte[] encoded, int offset) {
+        return bits == 8
+               ? VectorUtil.uint8DotProduct(weights, encoded, offset, min.length)
+               : VectorUtil.uint4DotProduct(weights, encoded, offset, getCompressedSize());
+    }
+
+    public int getBits() {
+        return bits;
+    }
+
+    public int getOriginalDimension() {
+        return min.length;
+    }
+
+    /**
+     * @return the size of each code, in bytes
+     */
+    public int getCompressedSize() {
+        return bits == 8 ? min.length : (min.length + 1) / 2;
+    }
+
+    @Override
+    public void write(DataOutput out) throws IOException {
+        out.writeInt(bits);
+        out.writeInt(min.length);
+        Io.writeFloats(out, min);
+        Io.writeFloats(out, step);
+    }
+
+    public static ScalarQuantization load(RandomAccessReader in) throws IOException {
+        int bits = in.readInt();
+        int dimension = in.readInt();
+        if (dimension < 0) {
+            throw new IOException("Invalid scalar quantization dimension " + dimension);
+        }
+        var min = new float[dimension];
+        in.readFully(min);
+        var step = new float[dimension];
+        in.readFully(step);
+        try {
+            return new ScalarQuantization(bits, min, step);
+        } catch (IllegalArgumentException e) {
+            throw new IOException(e);
+        }
+    }
+
+    @Override
+    public boolean equals(Object o) {
+        if (this == o) return true;
+        if (o == null || getClass() != o.getClass()) return false;
+        ScalarQuantization that = (ScalarQuantization) o;
+        return bits == that.bits && Arrays.equals(min, that.min) && Arrays.equals(step, that.step);
+    }
+
+    @Override
+    public int hashCode() {
+        int result = Objects.hash(bits);
+        result = 31 * result + Arrays.hashCode(min);
+        result = 31 * result + Arrays.hashCode(step);
+        return result;
+    }
+
+    @Override
+    public String toString() {
+        return String.format("ScalarQuantization(%d bits)", bits);
+    }
+}
@@ -31,7 +31,7 @@ import io.github.jbellis.jvector.annotations.VisibleForTesting;
  */
 public class BoundedLongHeap extends AbstractLongHeap {
 
-    private final int maxSize;
+    private int maxSize;
 
     /**
      * Create an empty Heap of the configured initial size.
@@ -47,6 +47,20 @@ public class BoundedLongHeap extends AbstractLongHeap {
         this.maxSize = maxSize;
     }
 
+    /**
+     * Change the maximum size of the heap, so that it can be reused for a different bound.
+     * Storage is grown lazily as values are added, so this never allocates.
+     *
+     * @param maxSize the new maximum size; must be at least 1, and not less than the number of values in the heap
+     */
+    public void setMaxSize(int maxSize) {
+        if (maxSize < 1 || maxSize < size) {
+            throw new IllegalArgumentException(
+                    String.format("maxSize must be > 0 and >= current size %d; got: %d", size, maxSize));
+        }
+        this.maxSize = maxSize;
+    }
+
     @Override
     public boolean push(long value) {
         if (size >= maxSize) {
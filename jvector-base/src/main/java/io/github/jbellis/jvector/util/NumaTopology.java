@@ -0,0 +1,184 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package io.github.jbellis.jvector.util;
+
+import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.Paths;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.concurrent.ForkJoinPool;
+import java.util.regex.Pattern;
+import java.util.stream.IntStream;
+import java.util.stream.Stream;
+
+/**
+ * The NUMA nodes of the machine and the CPUs that belong to each, as reported by Linux under
+ * /sys/devices/system/node.  Where that is not available, the machine is a single node with all of its CPUs.
+ * <p>
+ * The JVM cannot bind a thread to a CPU, so {@link #newPool} only sizes a pool to a node and names its threads
+ * after it ("jvector-numa-N-..."), so that they can be bound externally.  What it does control is where memory
+ * is placed: with -XX:+UseNUMA, objects are allocated on the node of the thread that allocates them, so data
+ * built by a node's pool lives on that node.
+ */
+public final class NumaTopology {
+    private static final Path NODE_ROOT = Paths.get("/sys/devices/system/node");
+    private static final Pattern NODE_NAME = Pattern.compile("node\\d+");
+
+    private final int[][] cpus;
+
+    private NumaTopology(int[][] cpus) {
+        if (cpus.length == 0) {
+            throw new IllegalArgumentException("A topology needs at least one node");
+        }
+        for (int[] nodeCpus : cpus) {
+            if (nodeCpus.length == 0) {
+                throw new IllegalArgumentException("Every node needs at least one CPU");
+            }
+        }
+        this.cpus = cpus;
+    }
+
+    /**
+     * @return the topology of this machine, or {@link #singleNode()} if it cannot be determined
+     */
+    public static NumaTopology detect() {
+        if (!Files.isDirectory(NODE_ROOT)) {
+            return singleNode();
+        }
+
+        var nodes = new ArrayList<int[]>();
+        try (Stream<Path> entries = Files.list(NODE_ROOT)) {
+            List<Path> nodeDirs = new ArrayList<>();
+            entries.filter(p -> NODE_NAME.matcher(p.getFileName().toString()).matches()).forEach(nodeDirs::add);
+            nodeDirs.sort((a, b) -> Integer.compare(nodeNumber(a), nodeNumber(b)));
+            for (var dir : nodeDirs) {
+                var nodeCpus = parseCpuList(Files.readString(dir.resolve("cpulist")));
+                // memory-only nodes have no CPUs to search with
+                if (nodeCpus.length > 0) {
+                    nodes.add(nodeCpus);
+                }
+            }
+        } catch (IOException | IllegalArgumentException e) {
+            return singleNode();
+        }
+        return nodes.isEmpty() ? singleNode() : new NumaTopology(nodes.toArray(new int[0][]));
+    }
+
+    /**
+     * @return a topology of one node holding all the CPUs available to the JVM
+     */
+    public static NumaTopology singleNode() {
+        return new NumaTopology(new int[][] { IntStream.range(0, Runtime.getRuntime().availableProcessors()).toArray() });
+    }
+
+    /**
+     * @return a topology of `nodeCount` nodes that split the CPUs available to the JVM between them, e.g. to
+     * compare sharded and unsharded searches on a single-node machine
+     */
+    public static NumaTopology uniform(int nodeCount) {
+        int cpuCount = Runtime.getRuntime().availableProcessors();
+        if (nodeCount <= 0 || nodeCount > cpuCount) {
+            throw new IllegalArgumentException(String.format("Cannot split %d CPUs into %d nodes", cpuCount, nodeCount));
+        }
+        var cpus = new int[nodeCount][];
+        for (int i = 0; i < nodeCount; i++) {
+            cpus[i] = IntStream.range(i * cpuCount / nodeCount, (i + 1) * cpuCount / nodeCount).toArray();
+        }
+        return new NumaTopology(cpus);
+    }
+
+    /**
+     * @return a topology of the first `nodeCount` nodes of this one, e.g. to measure how searches scale with
+     * the number of sockets
+     */
+    public NumaTopology limit(int nodeCount) {
+        if (nodeCount <= 0 || nodeCount > cpus.length) {
+            throw new IllegalArgumentException(String.format("Cannot take %d of %d nodes", nodeCount, cpus.length));
+        }
+        return new NumaTopology(Arrays.copyOf(cpus, nodeCount));
+    }
+
+    public int nodeCount() {
+        return cpus.length;
+    }
+
+    /**
+     * @return the ids of the CPUs of `node`, in increasing order
+     */
+    public int[] cpus(int node) {
+        return cpus[node].clone();
+    }
+
+    /**
+     * @return the number of physical cores of `node`, in the same proportion to its CPUs as
+     * {@link PhysicalCoreExecutor#getPhysicalCoreCount()} is to the CPUs of the machine
+     */
+    public int physicalCoreCount(int node) {
+        long cores = (long) cpus[node].length * PhysicalCoreExecutor.getPhysicalCoreCount() / Runtime.getRuntime().availableProcessors();
+        // the JVM may be restricted to fewer CPUs than the node has
+        return (int) Math.max(1, Math.min(PhysicalCoreExecutor.getPhysicalCoreCount(), Math.min(cpus[node].length, cores)));
+    }
+
+    /**
+     * @return a new pool with a thread for each physical core of `node`.  The caller is responsible for shutting
+     * it down.
+     */
+    public ForkJoinPool newPool(int node) {
+        var prefix = "jvector-numa-" + node + "-";
+        ForkJoinPool.ForkJoinWorkerThreadFactory factory = pool -> {
+            var thread = ForkJoinPool.defaultForkJoinWorkerThreadFactory.newThread(pool);
+            thread.setName(prefix + thread.getPoolIndex());
+            thread.setDaemon(true);
+            return thread;
+        };
+        return new ForkJoinPool(physicalCoreCount(node), factory, null, false);
+    }
+
+    @Override
+    public String toString() {
+        return String.format("NumaTopology(%s)", Arrays.deepToString(cpus));
+    }
+
+    private static int nodeNumber(Path dir) {
+        return Integer.parseInt(dir.getFileName().toString().substring("node".length()));
+    }
+
+    /**
+     * Parses a Linux CPU list, e.g. "0-3,8-11,16".
+     */
+    static int[] parseCpuList(String list) {
+        list = list.trim();
+        if (list.isEmpty()) {
+            return new int[0];
+        }
+        var cpus = IntStream.builder();
+        for (var range : list.split(",")) {
+            int dash = range.indexOf('-');
+            int first = Integer.parseInt(range.substring(0, dash < 0 ? range.length() : dash));
+            int last = dash < 0 ? first : Integer.parseInt(range.substring(dash + 1));
+            if (last < first) {
+                throw new IllegalArgumentException("Invalid CPU range " + range);
+            }
+            for (int cpu = first; cpu <= last; cpu++) {
+                cpus.add(cpu);
+            }
+        }
+        return cpus.build().toArray();
+    }
+}
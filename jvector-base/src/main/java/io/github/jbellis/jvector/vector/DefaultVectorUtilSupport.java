@@ -257,14 +257,50 @@ final class DefaultVectorUtilSupport implements VectorUtilSupport {
 
   @Override
   public float assembleAndSum(float[] data, int dataBase, byte[] baseOffsets)
+  {
+      return assembleAndSum(data, dataBase, baseOffsets, 0, baseOffsets.length);
+  }
+
+  @Override
+  public float assembleAndSum(float[] data, int dataBase, byte[] baseOffsets, int baseOffsetsOffset, int length)
   {
       float sum = 0f;
-      for (int i = 0; i < baseOffsets.length; i++) {
-          sum += data[dataBase * i + Byte.toUnsignedInt(baseOffsets[i])];
+      for (int i = 0; i < length; i++) {
+          sum += data[dataBase * i + Byte.toUnsignedInt(baseOffsets[baseOffsetsOffset + i])];
       }
       return sum;
   }
 
+  @Override
+  public void bulkAssembleAndSum(float[] data, int dataBase, byte[] baseOffsets, int[] offsets, int length, int count, float[] results)
+  {
+      for (int j = 0; j < count; j++) {
+          results[j] = 0f;
+      }
+      // one subspace at a time across all the encodings, so each row of the table stays in cache
+      // and the additions into different results are independent
+      for (int i = 0; i < length; i++) {
+          int rowBase = dataBase * i;
+          for (int j = 0; j < count; j++) {
+              results[j] += data[rowBase + Byte.toUnsignedInt(baseOffsets[offsets[j] + i])];
+          }
+      }
+  }
+
+  @Override
+  public void bulkAssembleAndSum(float[] data, int dataBase, byte[][] encodings, int[] offsets, int length, int count, float[] results)
+  {
+      for (int j = 0; j < count; j++) {
+          results[j] = 0f;
+      }
+      for (int i = 0; i < length; i++) {
+          int rowBase = dataBase * i;
+          for (int j = 0; j < count; j++) {
+              results[j] += data[rowBase + Byte.toUnsignedInt(encodings[j][offsets[j] + i])];
+          }
+      }
+  }
+
   @Override
   public int hammingDistance(long[] v1, long[] v2) {
     int hd = 0;
@@ -273,4 +309,57 @@ final class DefaultVectorUtilSupport implements VectorUtilSupport {
     }
     return hd;
   }
+
+  @Override
+  public float uint8DotProduct(float[] a, byte[] b, int boffset, int length) {
+    float res = 0f;
+    for (int i = 0; i < length; i++) {
+      res += a[i] * Byte.toUnsignedInt(b[boffset + i]);
+    }
+    return res;
+  }
+
+  @Override
+  public float uint4DotProduct(float[] a, byte[] b, int boffset, int length) {
+    float res = 0f;
+    for (int i = 0; i < length; i++) {
+      int codes = Byte.toUnsignedInt(b[boffset + i]);
+      res += a[i] * (codes & 0x0f) + a[length + i] * (codes >>> 4);
+    }
+    return res;
+  }
+
+  @Override
+  public float float16DotProduct(float[] a, short[] b, int boffset, int length) {
+    float res = 0f;
+    for (int i = 0; i < length; i++) {
+      res += a[i] * Float16.toFloat(b[boffset + i]);
+    }
+    return res;
+  }
+
+  @Override
+  public float float16SquareDistance(float[] a, short[] b, int boffset, int length) {
+    float res = 0f;
+    for (int i = 0; i < length; i++) {
+      float diff = a[i] - Float16.toFloat(b[boffset + i]);
+      res += diff * diff;
+    }
+    return res;
+  }
+
+  @Override
+  public float float16Cosine(float[] a, short[] b, int boffset, int length) {
+    float sum = 0.0f;
+    float norm1 = 0.0f;
+    float norm2 = 0.0f;
+    for (int i = 0; i < length; i++) {
+      float elem1 = a[i];
+      float elem2 = Float16.toFloat(b[boffset + i]);
+      sum += elem1 * elem2;
+      norm1 += elem1 * elem1;
+      norm2 += elem2 * elem2;
+    }
+    return (float) (sum / Math.sqrt((double) norm1 * (double) norm2));
+  }
 }
@@ -0,0 +1,103 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.vector;
+
+/**
+ * Conversions between float and IEEE 754 half-precision (binary16) values, stored in the bits of a short.
+ * These are the same conversions as Float.floatToFloat16 and float16ToFloat, which are not available
+ * before Java 20.
+ * <p>
+ * Half precision keeps 11 significant bits and covers magnitudes up to 65504, which is plenty for
+ * embedding vectors; see {@link VectorEncoding#FLOAT16}.
+ */
+public final class Float16 {
+    /** the largest finite half-precision value */
+    public static final float MAX_VALUE = 65504f;
+
+    private Float16() {
+    }
+
+    /**
+     * @return the float value of the half-precision `bits`.  The conversion is exact.
+     */
+    public static float toFloat(short bits) {
+        int h = bits & 0xffff;
+        int sign = (h & 0x8000) << 16;
+        int exponentAndMantissa = h & 0x7fff;
+        if (exponentAndMantissa >= 0x7c00) {
+            // infinity or NaN
+            return Float.intBitsToFloat(sign | 0x7f800000 | ((exponentAndMantissa & 0x3ff) << 13));
+        }
+        // shifting lines the mantissa up with a float's, and scaling by 2^112 corrects the exponent bias
+        // (127 - 15); this handles subnormals and zero as well as normal values
+        return Float.intBitsToFloat(sign | (exponentAndMantissa << 13)) * 0x1p112f;
+    }
+
+    /**
+     * @return `f` rounded to the nearest half-precision value (ties to even), as its bits.  Magnitudes
+     * too large to represent become infinite.
+     */
+    public static short fromFloat(float f) {
+        int bits = Float.floatToRawIntBits(f);
+        int sign = (bits >>> 16) & 0x8000;
+        int magnitude = bits & 0x7fffffff;
+        if (magnitude >= 0x7f800000) {
+            // infinity, or NaN (kept quiet and non-zero)
+            int nan = magnitude > 0x7f800000 ? 0x200 | ((magnitude >>> 13) & 0x3ff) : 0;
+            return (short) (sign | 0x7c00 | nan);
+        }
+        if (magnitude >= 0x477ff000) {
+            // at or above 65520, which rounds up past the largest finite value
+            return (short) (sign | 0x7c00);
+        }
+        if (magnitude < 0x38800000) {
+            // below the smallest normal value, 2^-14: a multiple of 2^-24, which rint rounds ties-to-even
+            return (short) (sign | (int) Math.rint(Float.intBitsToFloat(magnitude) * 0x1p24f));
+        }
+        // round the 13 bits that are dropped to nearest even, letting a carry propagate into the exponent,
+        // then rebias the exponent
+        int rounded = magnitude + 0xfff + ((magnitude >>> 13) & 1);
+        return (short) (sign | ((rounded - (112 << 23)) >>> 13));
+    }
+
+    /**
+     * @return `v` rounded to half precision
+     */
+    public static short[] encode(float[] v) {
+        var encoded = new short[v.length];
+        encode(v, encoded, 0);
+        return encoded;
+    }
+
+    /**
+     * Rounds `v` to half precision, into dest[offset, offset + v.length)
+     */
+    public static void encode(float[] v, short[] dest, int offset) {
+        for (int i = 0; i < v.length; i++) {
+            dest[offset + i] = fromFloat(v[i]);
+        }
+    }
+
+    /**
+     * Converts src[offset, offset + dest.length) to floats, into `dest`
+     */
+    public static void decode(short[] src, int offset, float[] dest) {
+        for (int i = 0; i < dest.length; i++) {
+            dest[i] = toFloat(src[offset + i]);
+        }
+    }
+}
@@ -36,7 +36,15 @@ public enum VectorEncoding {
   BYTE(1),
 
   /** Encodes vector using 32 bits of precision per sample in IEEE floating point format. */
-  FLOAT32(4);
+  FLOAT32(4),
+
+  /**
+   * Encodes vector using 16 bits of precision per sample in IEEE half-precision floating point format
+   * (see {@link Float16}).  Vectors are still presented as float[]; only their storage is halved, e.g.
+   * by {@link io.github.jbellis.jvector.graph.Float16VectorValues} or an OnDiskGraphIndex written with
+   * this encoding.  Scores are computed on the half-precision values against full-precision queries.
+   */
+  FLOAT16(2);
 
   /**
    * The number of bytes required to encode a scalar in this format. A vector will nominally require
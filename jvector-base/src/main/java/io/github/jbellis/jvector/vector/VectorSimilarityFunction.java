@@ -42,6 +42,11 @@ public enum VectorSimilarityFunction {
     public float compare(byte[] v1, byte[] v2) {
       return 1 / (1f + VectorUtil.squareDistance(v1, v2));
     }
+
+    @Override
+    public float compareFloat16(float[] v1, short[] v2, int v2offset) {
+      return 1 / (1 + VectorUtil.float16SquareDistance(v1, v2, v2offset, v1.length));
+    }
   },
 
   /**
@@ -61,6 +66,11 @@ public enum VectorSimilarityFunction {
     public float compare(byte[] v1, byte[] v2) {
       return VectorUtil.dotProductScore(v1, v2);
     }
+
+    @Override
+    public float compareFloat16(float[] v1, short[] v2, int v2offset) {
+      return (1 + VectorUtil.float16DotProduct(v1, v2, v2offset, v1.length)) / 2;
+    }
   },
 
   /**
@@ -79,6 +89,11 @@ public enum VectorSimilarityFunction {
     public float compare(byte[] v1, byte[] v2) {
       return (1 + VectorUtil.cosine(v1, v2)) / 2;
     }
+
+    @Override
+    public float compareFloat16(float[] v1, short[] v2, int v2offset) {
+      return (1 + VectorUtil.float16Cosine(v1, v2, v2offset, v1.length)) / 2;
+    }
   };
 
   /**
@@ -101,4 +116,15 @@ public enum VectorSimilarityFunction {
    * @return the value of the similarity function applied to the two vectors
    */
   public abstract float compare(byte[] v1, byte[] v2);
+
+  /**
+   * Calculates a similarity score between a vector and a half-precision vector (see {@link Float16}),
+   * without converting the latter to floats first.  The score is that of compare(v1, the floats of v2).
+   *
+   * @param v1 a vector
+   * @param v2 holds the half-precision values of another vector of the same dimension
+   * @param v2offset the index in v2 of the other vector's first value
+   * @return the value of the similarity function applied to the two vectors
+   */
+  public abstract float compareFloat16(float[] v1, short[] v2, int v2offset);
 }
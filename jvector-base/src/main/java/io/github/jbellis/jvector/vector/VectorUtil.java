@@ -239,7 +239,54 @@ public final class VectorUtil {
     return impl.assembleAndSum(data, dataBase, dataOffsets);
   }
 
+  public static float assembleAndSum(float[] data, int dataBase, byte[] dataOffsets, int dataOffsetsOffset, int length) {
+    return impl.assembleAndSum(data, dataBase, dataOffsets, dataOffsetsOffset, length);
+  }
+
+  public static void bulkAssembleAndSum(float[] data, int dataBase, byte[] dataOffsets, int[] offsets, int length, int count, float[] results) {
+    impl.bulkAssembleAndSum(data, dataBase, dataOffsets, offsets, length, count, results);
+  }
+
+  public static void bulkAssembleAndSum(float[] data, int dataBase, byte[][] encodings, int[] offsets, int length, int count, float[] results) {
+    impl.bulkAssembleAndSum(data, dataBase, encodings, offsets, length, count, results);
+  }
+
   public static int hammingDistance(long[] v1, long[] v2) {
     return impl.hammingDistance(v1, v2);
   }
+
+  /**
+   * @see VectorUtilSupport#uint8DotProduct(float[], byte[], int, int)
+   */
+  public static float uint8DotProduct(float[] a, byte[] b, int boffset, int length) {
+    return impl.uint8DotProduct(a, b, boffset, length);
+  }
+
+  /**
+   * @see VectorUtilSupport#uint4DotProduct(float[], byte[], int, int)
+   */
+  public static float uint4DotProduct(float[] a, byte[] b, int boffset, int length) {
+    return impl.uint4DotProduct(a, b, boffset, length);
+  }
+
+  /**
+   * @see VectorUtilSupport#float16DotProduct(float[], short[], int, int)
+   */
+  public static float float16DotProduct(float[] a, short[] b, int boffset, int length) {
+    return impl.float16DotProduct(a, b, boffset, length);
+  }
+
+  /**
+   * @see VectorUtilSupport#float16SquareDistance(float[], short[], int, int)
+   */
+  public static float float16SquareDistance(float[] a, short[] b, int boffset, int length) {
+    return impl.float16SquareDistance(a, b, boffset, length);
+  }
+
+  /**
+   * @see VectorUtilSupport#float16Cosine(float[], short[], int, int)
+   */
+  public static float float16Cosine(float[] a, short[] b, int boffset, int length) {
+    return impl.float16Cosine(a, b, boffset, length);
+  }
 }
@@ -88,5 +88,57 @@ public interface VectorUtilSupport {
    */
   public float assembleAndSum(float[] data, int baseIndex, byte[] baseOffsets);
 
+  /**
+   * As {@link #assembleAndSum(float[], int, byte[])}, but only considers the `length` offsets
+   * starting at baseOffsets[baseOffsetsOffset].  This allows summing encodings that are packed
+   * together into a larger array without copying them out first.
+   */
+  public float assembleAndSum(float[] data, int baseIndex, byte[] baseOffsets, int baseOffsetsOffset, int length);
+
+  /**
+   * Computes {@link #assembleAndSum(float[], int, byte[], int, int)} for `count` encodings of `length`
+   * bytes each, the j-th starting at baseOffsets[offsets[j]], writing the sums to results[0, count).
+   * The encodings are read in place, wherever they are in the array.  Scoring a batch at once lets
+   * implementations work on several encodings in parallel.  Each sum is accumulated in offset order,
+   * so results match assembleAndSum exactly.
+   */
+  public void bulkAssembleAndSum(float[] data, int baseIndex, byte[] baseOffsets, int[] offsets, int length, int count, float[] results);
+
+  /**
+   * As {@link #bulkAssembleAndSum(float[], int, byte[], int[], int, int, float[])}, but the j-th encoding
+   * starts at encodings[j][offsets[j]], so encodings spread over several arrays (such as the chunks of a
+   * growable store) are also read in place.
+   */
+  public void bulkAssembleAndSum(float[] data, int baseIndex, byte[][] encodings, int[] offsets, int length, int count, float[] results);
+
   public int hammingDistance(long[] v1, long[] v2);
+
+  /**
+   * @return the dot product of a[0, length) with the unsigned bytes b[boffset, boffset + length)
+   */
+  public float uint8DotProduct(float[] a, byte[] b, int boffset, int length);
+
+  /**
+   * @return the dot product of a[0, 2 * length) with the 4-bit unsigned codes packed into the bytes
+   * b[boffset, boffset + length).  The low nibble of byte i is the code for a[i], and the high nibble
+   * is the code for a[length + i].
+   */
+  public float uint4DotProduct(float[] a, byte[] b, int boffset, int length);
+
+  /**
+   * @return the dot product of a[0, length) with the half-precision values b[boffset, boffset + length)
+   * (see {@link Float16})
+   */
+  public float float16DotProduct(float[] a, short[] b, int boffset, int length);
+
+  /**
+   * @return the sum of squared differences of a[0, length) and the half-precision values
+   * b[boffset, boffset + length)
+   */
+  public float float16SquareDistance(float[] a, short[] b, int boffset, int length);
+
+  /**
+   * @return the cosine similarity of a[0, length) and the half-precision values b[boffset, boffset + length)
+   */
+  public float float16Cosine(float[] a, short[] b, int boffset, int length);
 }
@@ -22,6 +22,7 @@ import io.github.jbellis.jvector.example.util.DataSet;
 import io.github.jbellis.jvector.example.util.DataSetCreator;
 import io.github.jbellis.jvector.example.util.DownloadHelper;
 import io.github.jbellis.jvector.example.util.Hdf5Loader;
+import io.github.jbellis.jvector.example.util.LoadGenerator;
 import io.github.jbellis.jvector.example.util.ReaderSupplierFactory;
 import io.github.jbellis.jvector.example.util.SiftLoader;
 import io.github.jbellis.jvector.graph.GraphIndex;
@@ -59,6 +60,9 @@ import java.util.stream.IntStream;
  * Tests GraphIndexes against vectors from various datasets
  */
 public class Bench {
+    // each configuration is also run under these loads; see LoadGenerator.Config.fromSystemProperties
+    private static final List<LoadGenerator.Config> loadConfigs = LoadGenerator.Config.fromSystemProperties();
+
     private static void testRecall(int M,
                                    int efConstruction,
                                    List<Function<DataSet, VectorCompressor<?>>> compressionGrid,
@@ -80,7 +84,8 @@ public class Bench {
             try (var outputStream = new DataOutputStream(new BufferedOutputStream(Files.newOutputStream(graphPath)))) {
                 OnDiskGraphIndex.write(onHeapGraph, floatVectors, outputStream);
             }
-            try (var onDiskGraph = new CachingGraphIndex(new OnDiskGraphIndex<>(ReaderSupplierFactory.open(graphPath), 0))) {
+            try (var onDiskGraph = new CachingGraphIndex(new OnDiskGraphIndex<>(ReaderSupplierFactory.open(graphPath), 0));
+                 var uncachedGraph = loadConfigs.isEmpty() ? null : new OnDiskGraphIndex<float[]>(ReaderSupplierFactory.open(graphPath), 0)) {
                 for (var cf : compressionGrid) {
                     var compressor = getCompressor(cf, ds);
                     CompressedVectors cv;
@@ -109,6 +114,16 @@ public class Bench {
                         System.out.format("  Query %stop %d/%d recall %.4f in %.2fs after %,d nodes visited%n",
                                           compressor == null ? "(disk) " : "", topK, overquery, recall, (System.nanoTime() - start) / 1_000_000_000.0, pqr.nodesVisited);
                     }
+
+                    for (var load : loadConfigs) {
+                        for (int overquery : efSearchOptions) {
+                            if (compressor == null) {
+                                generateLoad(load, "memory", ds, floatVectors, null, onHeapGraph, topK, overquery);
+                            }
+                            generateLoad(load, "disk", ds, floatVectors, cv, uncachedGraph, topK, overquery);
+                            generateLoad(load, "cached", ds, floatVectors, cv, onDiskGraph, topK, overquery);
+                        }
+                    }
                 }
             }
         } finally {
@@ -183,6 +198,37 @@ public class Bench {
         return new ResultSummary((int) topKfound.sum(), nodesVisited.sum());
     }
 
+    /**
+     * Runs the queries under `load`, and prints a line like
+     * "  Load (disk) top 100/2 closed threads=16: qps 1234.5 p50 ... ms"
+     */
+    private static void generateLoad(LoadGenerator.Config load, String configuration, DataSet ds, RandomAccessVectorValues<float[]> exactVv, CompressedVectors cv, GraphIndex<float[]> index, int topK, int overquery) {
+        int efSearch = topK * overquery;
+        var result = LoadGenerator.run(load, ds.queryVectors.size(), () -> new LoadGenerator.QueryRunner() {
+            // reused for every query of the thread
+            private final GraphIndex.View<float[]> view = index.getView();
+            private final GraphSearcher<float[]> searcher = new GraphSearcher.Builder<>(view).build();
+            private final RandomAccessVectorValues<float[]> vectors = exactVv.copy();
+
+            @Override
+            public void run(int query) {
+                var queryVector = ds.queryVectors.get(query);
+                NodeSimilarity.ReRanker rr = j -> ds.similarityFunction.compare(queryVector, vectors.vectorValue(j));
+                if (cv != null) {
+                    searcher.search(cv.approximateScoreFunctionFor(queryVector, ds.similarityFunction), rr, efSearch, Bits.ALL);
+                } else {
+                    searcher.search((NodeSimilarity.ExactScoreFunction) rr::similarityTo, null, efSearch, Bits.ALL);
+                }
+            }
+
+            @Override
+            public void close() throws Exception {
+                view.close();
+            }
+        });
+        System.out.format("  Load (%s) top %d/%d %s: %s%n", configuration, topK, overquery, load, result);
+    }
+
     public static void main(String[] args) throws IOException {
         System.out.println("Heap space available is " + Runtime.getRuntime().maxMemory());
 
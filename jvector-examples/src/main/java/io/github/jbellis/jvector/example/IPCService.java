@@ -21,12 +21,24 @@ import java.io.DataOutputStream;
 import java.io.File;
 import java.io.IOError;
 import java.io.IOException;
-import java.io.InputStream;
-import java.io.OutputStream;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.channels.SelectionKey;
+import java.nio.channels.Selector;
+import java.nio.channels.SocketChannel;
 import java.nio.charset.StandardCharsets;
 import java.nio.file.Files;
 import java.nio.file.Path;
-import java.util.concurrent.ForkJoinPool;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.Set;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.stream.Collectors;
 import java.util.stream.IntStream;
 
 import io.github.jbellis.jvector.disk.CachingGraphIndex;
@@ -34,14 +46,13 @@ import io.github.jbellis.jvector.disk.OnDiskGraphIndex;
 import io.github.jbellis.jvector.example.util.MMapRandomAccessVectorValues;
 import io.github.jbellis.jvector.example.util.ReaderSupplierFactory;
 import io.github.jbellis.jvector.example.util.UpdatableRandomAccessVectorValues;
+import io.github.jbellis.jvector.graph.BatchSearcher;
 import io.github.jbellis.jvector.graph.GraphIndex;
 import io.github.jbellis.jvector.graph.GraphIndexBuilder;
-import io.github.jbellis.jvector.graph.GraphSearcher;
 import io.github.jbellis.jvector.graph.NodeSimilarity;
 import io.github.jbellis.jvector.graph.OnHeapGraphIndex;
 import io.github.jbellis.jvector.graph.RandomAccessVectorValues;
 import io.github.jbellis.jvector.graph.SearchResult;
-import io.github.jbellis.jvector.pq.CompressedVectors;
 import io.github.jbellis.jvector.pq.PQVectors;
 import io.github.jbellis.jvector.pq.ProductQuantization;
 import io.github.jbellis.jvector.util.Bits;
@@ -49,18 +60,54 @@ import io.github.jbellis.jvector.util.PhysicalCoreExecutor;
 import io.github.jbellis.jvector.util.PoolingSupport;
 import io.github.jbellis.jvector.vector.VectorEncoding;
 import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
-import org.newsclub.net.unix.AFUNIXServerSocket;
-import org.newsclub.net.unix.AFUNIXSocket;
+import org.newsclub.net.unix.AFUNIXServerSocketChannel;
 import org.newsclub.net.unix.AFUNIXSocketAddress;
 
 /**
  * Simple local service to use for interaction with JVector over IPC.
- * Only handles a single connection at a time.
+ * <p>
+ * Connections are multiplexed by a single selector thread, and their requests are executed on a pool of
+ * worker threads.  Each connection has its own session (its own index).  A connection speaks one of two
+ * protocols, chosen by its first byte:
+ * <ul>
+ * <li>Text: newline-terminated commands, as documented in the README, answered one at a time in order.</li>
+ * <li>Binary: a connection that begins with the byte 0x00 sends length-prefixed frames, and may have any
+ * number of requests in flight.  All integers and floats are little-endian.  A request frame is
+ * <pre>
+ *     int32 length (of the rest of the frame), int32 request id, int8 command (Command ordinal), payload
+ * </pre>
+ * and each request is answered with one response frame, in completion order:
+ * <pre>
+ *     int32 length (of the rest of the frame), int32 request id, int8 status (Response ordinal), payload
+ * </pre>
+ * Request payloads are
+ * <pre>
+ *     CREATE    int32 dimensions, int8 similarity (VectorSimilarityFunction ordinal), int32 M, int32 EF
+ *     WRITE     int32 count, count * dimensions float32
+ *     BULKLOAD  UTF-8 path (the rest of the frame)
+ *     OPTIMIZE  (empty)
+ *     SEARCH    int32 EF-search, int32 top-k, int32 count, count * dimensions float32
+ *     MEMORY    (empty)
+ * </pre>
+ * OK responses are empty, ERROR responses carry a UTF-8 message, and RESULT responses carry
+ * <pre>
+ *     SEARCH    int32 count, then for each query int32 n, n * int32 ordinals
+ *     MEMORY    int64 kb
+ * </pre>
+ * Searches run concurrently with each other, and other commands run once the requests before them have
+ * finished, so a connection can pipeline WRITEs followed by SEARCHes.  SEARCHes with the same parameters that
+ * arrive together are executed as a single BatchSearcher batch.</li>
+ * </ul>
  */
 public class IPCService
 {
     // How each command message is marked as finished
     private static final String DELIM = "\n";
+    // Sent as the first byte of a connection to select the binary protocol
+    private static final byte BINARY_PROTOCOL = 0;
+    // Frames are int32 length, int32 request id, int8 command or status
+    private static final int FRAME_HEADER_BYTES = Integer.BYTES + Integer.BYTES + 1;
+    private static final int MAX_FRAME_BYTES = 1 << 30;
 
     class SessionContext {
         boolean isBulkLoad = false;
@@ -70,11 +117,10 @@ public class IPCService
         int efConstruction;
         VectorSimilarityFunction similarityFunction;
         RandomAccessVectorValues<float[]> ravv;
-        CompressedVectors cv;
+        PQVectors cv;
         GraphIndexBuilder<float[]> indexBuilder;
         GraphIndex<float[]> index;
-        GraphSearcher<float[]> searcher;
-        StringBuffer result = new StringBuffer(1024);
+        BatchSearcher<float[]> searcher;
     }
 
     enum Command {
@@ -92,12 +138,96 @@ public class IPCService
         RESULT
     }
 
+    enum Protocol {
+        UNKNOWN,
+        TEXT,
+        BINARY
+    }
+
+    /**
+     * A client connection and its session.  Its buffers and request ordering belong to the selector thread;
+     * responses are queued by the worker threads.
+     */
+    class Connection {
+        final SocketChannel channel;
+        final SessionContext context = new SessionContext();
+        Protocol protocol = Protocol.UNKNOWN;
+        ByteBuffer readBuffer = ByteBuffer.allocate(64 * 1024);
+        final StringBuilder line = new StringBuilder(1024);
+        final ConcurrentLinkedQueue<ByteBuffer> responses = new ConcurrentLinkedQueue<>();
+        SelectionKey key;
+
+        // the last request that had to run alone, and the searches still in flight; see submitExclusive.
+        // searches remove themselves when they complete, so a connection that only searches stays bounded
+        CompletableFuture<Void> lastExclusive = CompletableFuture.completedFuture(null);
+        final Set<CompletableFuture<Void>> searchesInFlight = ConcurrentHashMap.newKeySet();
+
+        Connection(SocketChannel channel) {
+            this.channel = channel;
+        }
+
+        /** Runs `task` after every request submitted before it */
+        void submitExclusive(Runnable task) {
+            var pending = new ArrayList<CompletableFuture<Void>>(searchesInFlight);
+            pending.add(lastExclusive);
+            lastExclusive = CompletableFuture.allOf(pending.toArray(new CompletableFuture[0]))
+                                             .thenRunAsync(task, workers);
+        }
+
+        /** Runs `task` after the exclusive requests submitted before it, concurrently with other searches */
+        void submitSearch(Runnable task) {
+            var search = lastExclusive.thenRunAsync(task, workers);
+            searchesInFlight.add(search);
+            // runs inline if the search already finished, so it can never be left behind in the set
+            search.whenComplete((r, t) -> searchesInFlight.remove(search));
+        }
+
+        /** Queues `response` to be written by the selector thread */
+        void respond(ByteBuffer response) {
+            if (channel.isOpen()) {
+                responses.add(response);
+                writable.add(this);
+                selector.wakeup();
+            }
+        }
+    }
+
+    /** A binary request */
+    static class Frame {
+        final int requestId;
+        final byte command;
+        final ByteBuffer payload;
+
+        Frame(int requestId, byte command, ByteBuffer payload) {
+            this.requestId = requestId;
+            this.command = command;
+            this.payload = payload;
+        }
+
+        boolean isSearch() {
+            return command == Command.SEARCH.ordinal();
+        }
+
+        /** whether this and `other` are searches that can run in the same batch */
+        boolean batchesWith(Frame other) {
+            return isSearch() && other.isSearch() && payload.remaining() >= 2 * Integer.BYTES
+                   && other.payload.remaining() >= 2 * Integer.BYTES
+                   && payload.getInt(0) == other.payload.getInt(0)
+                   && payload.getInt(Integer.BYTES) == other.payload.getInt(Integer.BYTES);
+        }
+    }
+
     final Path socketFile;
-    final AFUNIXServerSocket unixSocket;
+    final AFUNIXServerSocketChannel serverChannel;
+    final ExecutorService workers = Executors.newCachedThreadPool();
+    // connections with responses to write
+    final ConcurrentLinkedQueue<Connection> writable = new ConcurrentLinkedQueue<>();
+    volatile Selector selector;
+
     IPCService(Path socketFile) throws IOException {
         this.socketFile = socketFile;
-        this.unixSocket = AFUNIXServerSocket.newInstance();
-        this.unixSocket.bind(AFUNIXSocketAddress.of(socketFile));
+        this.serverChannel = AFUNIXServerSocketChannel.open();
+        this.serverChannel.bind(AFUNIXSocketAddress.of(socketFile));
     }
 
     void create(String input, SessionContext ctx) {
@@ -106,10 +236,12 @@ public class IPCService
         if (args.length != 4)
             throw new IllegalArgumentException("Illegal CREATE statement. Expecting 'CREATE [DIMENSIONS] [SIMILARITY_TYPE] [M] [EF]'");
 
-        int dimensions = Integer.valueOf(args[0]);
-        VectorSimilarityFunction sim = VectorSimilarityFunction.valueOf(args[1]);
-        int M = Integer.valueOf(args[2]);
-        int efConstruction = Integer.valueOf(args[3]);
+        create(Integer.parseInt(args[0]), VectorSimilarityFunction.valueOf(args[1]), Integer.parseInt(args[2]), Integer.parseInt(args[3]), ctx);
+    }
+
+    void create(int dimensions, VectorSimilarityFunction sim, int M, int efConstruction, SessionContext ctx) {
+        if (dimensions <= 0)
+            throw new IllegalArgumentException("Invalid dimensions: " + dimensions);
 
         ctx.ravv = new UpdatableRandomAccessVectorValues(dimensions);
         ctx.indexBuilder =  new GraphIndexBuilder<>(ctx.ravv, VectorEncoding.FLOAT32, sim, M, efConstruction, 1.2f, 1.4f);
@@ -118,26 +250,24 @@ public class IPCService
         ctx.efConstruction = efConstruction;
         ctx.similarityFunction = sim;
         ctx.isBulkLoad = false;
+        setIndex(ctx, null, null);
     }
 
     void write(String input, SessionContext ctx) {
-        if (ctx.isBulkLoad)
-            throw new IllegalStateException("Session is for bulk loading.  To reset call CREATE again");
-
         String[] args = input.split("\\s+");
-        for (int i = 0; i < args.length; i++) {
-            String vStr = args[i];
-            if (!vStr.startsWith("[") || !vStr.endsWith("]"))
-                throw new IllegalArgumentException("Invalid vector encountered. Expecting 'WRITE [F1,F2...] [F3,F4...] ...' but got " + vStr);
-
-            String[] values = vStr.substring(1, vStr.length() - 1).split(",");
-            if (values.length != ctx.ravv.dimension())
-                throw new IllegalArgumentException(String.format("Invalid vector dimension: %d %d!=%d", i, values.length, ctx.ravv.dimension()));
+        float[][] vectors = new float[args.length][];
+        for (int i = 0; i < args.length; i++)
+            vectors[i] = parseVector(args[i], ctx.dimension);
+        write(vectors, ctx);
+    }
 
-            float[] vector = new float[ctx.ravv.dimension()];
-            for (int k = 0; k < vector.length; k++)
-                vector[k] = Float.parseFloat(values[k]);
+    void write(float[][] vectors, SessionContext ctx) {
+        if (ctx.isBulkLoad)
+            throw new IllegalStateException("Session is for bulk loading.  To reset call CREATE again");
+        if (ctx.indexBuilder == null)
+            throw new IllegalStateException("No index to write to.  Call CREATE first");
 
+        for (float[] vector : vectors) {
             ((UpdatableRandomAccessVectorValues)ctx.ravv).add(vector);
             ctx.indexBuilder.addGraphNode(ctx.ravv.size() - 1, ctx.ravv);
         }
@@ -151,12 +281,14 @@ public class IPCService
         File f = new File(args[0]);
         if (!f.exists())
             throw new IllegalArgumentException("No file at: " + f);
+        if (ctx.dimension <= 0)
+            throw new IllegalStateException("Call CREATE before BULKLOAD");
 
         long length = f.length();
         if (length % ((long) ctx.dimension * Float.BYTES) != 0)
             throw new IllegalArgumentException("File is not encoded correctly");
 
-        ctx.index = null;
+        setIndex(ctx, null, null);
         ctx.ravv = null;
         ctx.indexBuilder = null;
         ctx.isBulkLoad = true;
@@ -164,15 +296,15 @@ public class IPCService
         var ravv = new MMapRandomAccessVectorValues(f, ctx.dimension);
         var indexBuilder = new GraphIndexBuilder<>(ravv, VectorEncoding.FLOAT32, ctx.similarityFunction, ctx.M, ctx.efConstruction, 1.2f, 1.4f);
         System.out.println("BulkIndexing " + ravv.size());
-        ctx.index = flushGraphIndex(indexBuilder.build(), ravv);
-        ctx.cv = pqIndex(ravv, ctx);
+        var index = flushGraphIndex(indexBuilder.build(), ravv);
+        var cv = pqIndex(ravv, ctx);
 
         //Finished with raw data we can close/cleanup
         ravv.close();
-        ctx.searcher = new GraphSearcher.Builder<>(ctx.index.getView()).build();
+        setIndex(ctx, index, cv);
     }
 
-    private CompressedVectors pqIndex(RandomAccessVectorValues<float[]> ravv, SessionContext ctx) {
+    private PQVectors pqIndex(RandomAccessVectorValues<float[]> ravv, SessionContext ctx) {
         var pqDims = ctx.dimension > 10 ? Math.max(ctx.dimension / 4, 10) : ctx.dimension;
         long start = System.nanoTime();
         ProductQuantization pq = ProductQuantization.compute(ravv, pqDims, ctx.similarityFunction == VectorSimilarityFunction.EUCLIDEAN);
@@ -209,28 +341,39 @@ public class IPCService
         }
     }
 
+    /** Makes `index` (and its PQ codes, if not null) the one searched by the session */
+    private void setIndex(SessionContext ctx, GraphIndex<float[]> index, PQVectors cv) {
+        ctx.index = index;
+        ctx.cv = cv;
+        ctx.searcher = index == null ? null : new BatchSearcher<>(index);
+    }
+
     void optimize(SessionContext ctx) {
         if (!ctx.isBulkLoad) {
+            if (ctx.indexBuilder == null)
+                throw new IllegalStateException("No index to optimize.  Call CREATE first");
+
             if (ctx.ravv.size() > 256) {
                 ctx.indexBuilder.cleanup();
-                ctx.index = flushGraphIndex(ctx.indexBuilder.getGraph(), ctx.ravv);
-                ctx.cv = pqIndex(ctx.ravv, ctx);
+                var index = flushGraphIndex(ctx.indexBuilder.getGraph(), ctx.ravv);
+                setIndex(ctx, index, pqIndex(ctx.ravv, ctx));
                 ctx.indexBuilder = null;
                 ctx.ravv = null;
             } else { //Not enough data for PQ
                 ctx.indexBuilder.cleanup();
-                ctx.index = ctx.indexBuilder.getGraph();
-                ctx.cv = null;
+                setIndex(ctx, ctx.indexBuilder.getGraph(), null);
             }
 
         }
     }
 
+    long memoryKb(SessionContext ctx) {
+        var cv = ctx.cv;
+        return cv == null ? 0 : cv.ramBytesUsed() / 1024;
+    }
+
     String memory(SessionContext ctx) {
-        long kb = 0;
-        if (ctx.cv != null)
-            kb = ctx.cv.ramBytesUsed() / 1024;
-        return String.format("%s %d\n", Response.RESULT, kb);
+        return String.format("%s %d\n", Response.RESULT, memoryKb(ctx));
     }
 
     String search(String input, SessionContext ctx) {
@@ -242,56 +385,84 @@ public class IPCService
         int searchEf = Integer.parseInt(args[0]);
         int topK = Integer.parseInt(args[1]);
 
-        float[] queryVector = new float[ctx.dimension];
-        ctx.result.setLength(0);
-        ctx.result.append(Response.RESULT);
-        int[][] results = new int[args.length - 2][];
-        IntStream loopStream = IntStream.range(0, args.length-2);
-
-        //Only use parallel path if we have > 1 core
-        if (ForkJoinPool.commonPool().getPoolSize() > 1)
-            loopStream = loopStream.parallel();
-
-        loopStream.forEach(i -> {
-            String vStr = args[i + 2]; //Skipping first 2 args which are not vectors
-            if (!vStr.startsWith("[") || !vStr.endsWith("]"))
-                throw new IllegalArgumentException("Invalid query vector encountered:" + vStr);
-
-            String[] values = vStr.substring(1, vStr.length() - 1).split(",");
-            if (values.length != ctx.dimension)
-                throw new IllegalArgumentException(String.format("Invalid vector dimension: %d!=%d", values.length, ctx.dimension));
-
-            for (int k = 0; k < queryVector.length; k++)
-                queryVector[k] = Float.parseFloat(values[k]);
-
-            SearchResult r;
-            if (ctx.cv != null) {
-                NodeSimilarity.ApproximateScoreFunction sf = ctx.cv.approximateScoreFunctionFor(queryVector, ctx.similarityFunction);
-                NodeSimilarity.ReRanker rr = (j) -> ctx.similarityFunction.compare(queryVector, ctx.ravv.vectorValue(j));
-                r = new GraphSearcher.Builder<>(ctx.index.getView()).build().search(sf, rr, searchEf, Bits.ALL);
-            } else {
-                r = GraphSearcher.search(queryVector, topK, ctx.ravv, VectorEncoding.FLOAT32, ctx.similarityFunction, ctx.index, Bits.ALL);
-            }
-
-            var resultNodes = r.getNodes();
-            int count = Math.min(resultNodes.length, topK);
-
-            results[i] = new int[count];
-            for (int k = 0; k < count; k++)
-                results[i][k] = resultNodes[k].node;
-        });
+        float[][] queries = new float[args.length - 2][];
+        for (int i = 0; i < queries.length; i++)
+            queries[i] = parseVector(args[i + 2], ctx.dimension); //Skipping first 2 args which are not vectors
+        int[][] results = search(searchEf, topK, queries, ctx);
 
         //Format Response
+        var sb = new StringBuilder(1024);
+        sb.append(Response.RESULT);
         for (int i = 0; i < results.length; i++) {
-            ctx.result.append(" [");
+            sb.append(" [");
             for (int k = 0; k < results[i].length; k++) {
-                if (k > 0) ctx.result.append(",");
-                ctx.result.append(results[i][k]);
+                if (k > 0) sb.append(",");
+                sb.append(results[i][k]);
             }
-            ctx.result.append("]");
+            sb.append("]");
+        }
+        sb.append("\n");
+        return sb.toString();
+    }
+
+    /**
+     * Searches for all of `queries` as one batch
+     *
+     * @return the ordinals of the top-k results for each query
+     */
+    int[][] search(int searchEf, int topK, float[][] queries, SessionContext ctx) {
+        if (ctx.searcher == null)
+            throw new IllegalStateException("No index to search.  Call OPTIMIZE or BULKLOAD first");
+
+        var sim = ctx.similarityFunction;
+        SearchResult[] results;
+        if (ctx.cv != null) {
+            // the batched score functions own their lookup tables, so they can be built here and passed as the
+            // queries; the reranker reads vectors through the View of the thread that searches
+            var scoreFunctions = ctx.cv.approximateScoreFunctionsFor(queries, sim);
+            var queryIndexes = IntStream.range(0, queries.length).boxed().collect(Collectors.toList());
+            results = ctx.searcher.search(queryIndexes, new BatchSearcher.QueryScorer<float[], Integer>() {
+                @Override
+                public NodeSimilarity.ScoreFunction scoreFunctionFor(Integer query, GraphIndex.View<float[]> view) {
+                    return scoreFunctions[query];
+                }
+
+                @Override
+                public NodeSimilarity.ReRanker rerankerFor(Integer query, GraphIndex.View<float[]> view) {
+                    float[] q = queries[query];
+                    return j -> sim.compare(q, view.getVector(j));
+                }
+            }, searchEf, Bits.ALL);
+        } else {
+            var ravv = ctx.ravv;
+            results = ctx.searcher.search(Arrays.asList(queries),
+                                          (q, view) -> (NodeSimilarity.ExactScoreFunction) j -> sim.compare(q, ravv.vectorValue(j)),
+                                          topK,
+                                          Bits.ALL);
         }
-        ctx.result.append("\n");
-        return ctx.result.toString();
+
+        int[][] ordinals = new int[results.length][];
+        for (int i = 0; i < results.length; i++) {
+            var resultNodes = results[i].getNodes();
+            ordinals[i] = new int[Math.min(resultNodes.length, topK)];
+            for (int k = 0; k < ordinals[i].length; k++)
+                ordinals[i][k] = resultNodes[k].node;
+        }
+        return ordinals;
+    }
+
+    private static float[] parseVector(String vStr, int dimension) {
+        if (!vStr.startsWith("[") || !vStr.endsWith("]"))
+            throw new IllegalArgumentException("Invalid vector encountered. Expecting '[F1,F2...]' but got " + vStr);
+
+        String[] values = vStr.substring(1, vStr.length() - 1).split(",");
+        if (values.length != dimension)
+            throw new IllegalArgumentException(String.format("Invalid vector dimension: %d!=%d", values.length, dimension));
+
+        float[] vector = new float[dimension];
+        for (int k = 0; k < vector.length; k++)
+            vector[k] = Float.parseFloat(values[k]);
+        return vector;
     }
 
     String process(String input, SessionContext ctx) {
@@ -311,49 +482,298 @@ public class IPCService
         return response;
     }
 
+    /** Executes a binary request other than SEARCH */
+    ByteBuffer process(Frame frame, SessionContext ctx) {
+        var p = frame.payload;
+        ByteBuffer response;
+        switch (command(frame)) {
+            case CREATE:
+                int dimensions = p.getInt();
+                var sim = VectorSimilarityFunction.values()[p.get()];
+                create(dimensions, sim, p.getInt(), p.getInt(), ctx);
+                response = responseFrame(frame.requestId, Response.OK, 0);
+                break;
+            case WRITE:
+                write(readVectors(p, ctx.dimension), ctx);
+                response = responseFrame(frame.requestId, Response.OK, 0);
+                break;
+            case BULKLOAD:
+                bulkLoad(StandardCharsets.UTF_8.decode(p).toString(), ctx);
+                response = responseFrame(frame.requestId, Response.OK, 0);
+                break;
+            case OPTIMIZE:
+                optimize(ctx);
+                response = responseFrame(frame.requestId, Response.OK, 0);
+                break;
+            case MEMORY:
+                response = responseFrame(frame.requestId, Response.RESULT, Long.BYTES);
+                response.putLong(memoryKb(ctx));
+                break;
+            default: throw new UnsupportedOperationException("No support for: '" + command(frame) + "'");
+        }
+        return response.flip();
+    }
+
+    /** Executes a batch of SEARCH requests with the same EF-search and top-k, responding to each */
+    void search(List<Frame> frames, Connection connection) {
+        var ctx = connection.context;
+        var valid = new ArrayList<Frame>(frames.size());
+        var queries = new ArrayList<float[]>();
+        for (var frame : frames) {
+            try {
+                frame.payload.position(2 * Integer.BYTES);
+                queries.addAll(List.of(readVectors(frame.payload, ctx.dimension)));
+                valid.add(frame);
+            } catch (Throwable t) {
+                connection.respond(errorFrame(frame.requestId, t));
+            }
+        }
+        if (valid.isEmpty()) {
+            return;
+        }
+
+        int[][] results;
+        try {
+            var p = valid.get(0).payload;
+            results = search(p.getInt(0), p.getInt(Integer.BYTES), queries.toArray(new float[0][]), ctx);
+        } catch (Throwable t) {
+            t.printStackTrace();
+            for (var frame : valid)
+                connection.respond(errorFrame(frame.requestId, t));
+            return;
+        }
+
+        int next = 0;
+        for (var frame : valid) {
+            int count = frame.payload.getInt(2 * Integer.BYTES);
+            int bytes = Integer.BYTES;
+            for (int i = next; i < next + count; i++)
+                bytes += Integer.BYTES * (1 + results[i].length);
+            var response = responseFrame(frame.requestId, Response.RESULT, bytes);
+            response.putInt(count);
+            for (int i = next; i < next + count; i++) {
+                response.putInt(results[i].length);
+                for (int ordinal : results[i])
+                    response.putInt(ordinal);
+            }
+            next += count;
+            connection.respond(response.flip());
+        }
+    }
+
+    private static Command command(Frame frame) {
+        if (frame.command < 0 || frame.command >= Command.values().length)
+            throw new IllegalArgumentException("Unknown command " + frame.command);
+        return Command.values()[frame.command];
+    }
+
+    /** Reads an int32 count followed by that many vectors, which must fill the rest of `p` */
+    private static float[][] readVectors(ByteBuffer p, int dimension) {
+        int count = p.getInt();
+        if (dimension <= 0 || count < 0 || (long) count * dimension * Float.BYTES != p.remaining())
+            throw new IllegalArgumentException(String.format("Expected %d vectors of dimension %d but got %d bytes", count, dimension, p.remaining()));
+
+        float[][] vectors = new float[count][dimension];
+        var floats = p.asFloatBuffer();
+        for (float[] vector : vectors)
+            floats.get(vector);
+        return vectors;
+    }
+
+    /** @return a response frame with room for `payloadBytes` more bytes */
+    private static ByteBuffer responseFrame(int requestId, Response status, int payloadBytes) {
+        var response = ByteBuffer.allocate(FRAME_HEADER_BYTES + payloadBytes).order(ByteOrder.LITTLE_ENDIAN);
+        response.putInt(FRAME_HEADER_BYTES - Integer.BYTES + payloadBytes);
+        response.putInt(requestId);
+        response.put((byte) status.ordinal());
+        return response;
+    }
+
+    private static ByteBuffer errorFrame(int requestId, Throwable t) {
+        byte[] message = String.valueOf(t.getMessage()).getBytes(StandardCharsets.UTF_8);
+        return responseFrame(requestId, Response.ERROR, message.length).put(message).flip();
+    }
+
     void serve() throws IOException {
-        int bufferSize = unixSocket.getReceiveBufferSize();
-        byte[] buffer = new byte[bufferSize];
-        StringBuffer sb = new StringBuffer(1024);
+        selector = serverChannel.provider().openSelector();
+        serverChannel.configureBlocking(false);
+        serverChannel.register(selector, SelectionKey.OP_ACCEPT);
         System.out.println("Service listening on " + socketFile);
         while (true) {
-            AFUNIXSocket connection = unixSocket.accept();
-            System.out.println("new connection!");
-            SessionContext context = new SessionContext();
-
-            try (InputStream is = connection.getInputStream();
-                 OutputStream os = connection.getOutputStream()) {
-                int read;
-                while ((read = is.read(buffer)) != -1) {
-                    String s = new String(buffer, 0, read, StandardCharsets.UTF_8);
-                    if (s.contains(DELIM)) {
-                        int doffset;
-                        while ((doffset = s.indexOf(DELIM)) != -1) {
-                            sb.append(s, 0, doffset);
-
-                            //Save tail for next loop
-                            s = s.substring(doffset + 1);
-                            try {
-                                String cmd = sb.toString();
-                                if (!cmd.trim().isEmpty()) {
-                                    String response = process(cmd, context);
-                                    os.write(response.getBytes(StandardCharsets.UTF_8));
-                                }
-                            } catch (Throwable t) {
-                                String response = String.format("%s %s\n", Response.ERROR, t.getMessage());
-                                os.write(response.getBytes(StandardCharsets.UTF_8));
-                                t.printStackTrace();
-                            }
-
-                            //Reset buffer
-                            sb.setLength(0);
-                        }
-                    } else {
-                        sb.append(s);
-                    }
+            selector.select();
+            Connection pending;
+            while ((pending = writable.poll()) != null) {
+                try {
+                    flush(pending);
+                } catch (IOException e) {
+                    close(pending, e);
+                }
+            }
+
+            for (var it = selector.selectedKeys().iterator(); it.hasNext(); ) {
+                var key = it.next();
+                it.remove();
+                if (!key.isValid())
+                    continue;
+                if (key.isAcceptable()) {
+                    accept();
+                    continue;
+                }
+
+                var connection = (Connection) key.attachment();
+                try {
+                    if (key.isReadable())
+                        read(connection);
+                    if (key.isValid() && key.isWritable())
+                        flush(connection);
+                } catch (IOException e) {
+                    close(connection, e);
+                }
+            }
+        }
+    }
+
+    private void accept() throws IOException {
+        SocketChannel channel = serverChannel.accept();
+        if (channel == null)
+            return;
+        System.out.println("new connection!");
+        channel.configureBlocking(false);
+        var connection = new Connection(channel);
+        connection.key = channel.register(selector, SelectionKey.OP_READ, connection);
+    }
+
+    private void close(Connection connection, IOException e) {
+        if (e != null)
+            System.out.println("closing connection: " + e.getMessage());
+        connection.key.cancel();
+        try {
+            connection.channel.close();
+        } catch (IOException ignored) {
+            // already closing
+        }
+    }
+
+    private void read(Connection connection) throws IOException {
+        int read = connection.channel.read(connection.readBuffer);
+        if (read < 0) {
+            close(connection, null);
+            return;
+        }
+
+        var buffer = connection.readBuffer.flip();
+        if (connection.protocol == Protocol.UNKNOWN && buffer.hasRemaining()) {
+            if (buffer.get(buffer.position()) == BINARY_PROTOCOL) {
+                buffer.get();
+                connection.protocol = Protocol.BINARY;
+            } else {
+                connection.protocol = Protocol.TEXT;
+            }
+        }
+        if (connection.protocol == Protocol.BINARY)
+            readFrames(connection);
+        else
+            readLines(connection);
+    }
+
+    /** Submits the complete commands in the read buffer, in order */
+    private void readLines(Connection connection) {
+        var buffer = connection.readBuffer;
+        String s = StandardCharsets.UTF_8.decode(buffer).toString();
+        buffer.clear();
+        int doffset;
+        while ((doffset = s.indexOf(DELIM)) != -1) {
+            connection.line.append(s, 0, doffset);
+            //Save tail for next loop
+            s = s.substring(doffset + 1);
+
+            String cmd = connection.line.toString();
+            connection.line.setLength(0);
+            if (cmd.trim().isEmpty())
+                continue;
+            connection.submitExclusive(() -> {
+                String response;
+                try {
+                    response = process(cmd, connection.context);
+                } catch (Throwable t) {
+                    response = String.format("%s %s\n", Response.ERROR, t.getMessage());
+                    t.printStackTrace();
                 }
+                connection.respond(ByteBuffer.wrap(response.getBytes(StandardCharsets.UTF_8)));
+            });
+        }
+        connection.line.append(s);
+    }
+
+    /** Submits the complete frames in the read buffer, batching adjacent compatible searches */
+    private void readFrames(Connection connection) throws IOException {
+        var buffer = connection.readBuffer.order(ByteOrder.LITTLE_ENDIAN);
+        var frames = new ArrayList<Frame>();
+        while (buffer.remaining() >= Integer.BYTES) {
+            int length = buffer.getInt(buffer.position());
+            if (length < FRAME_HEADER_BYTES - Integer.BYTES || length > MAX_FRAME_BYTES)
+                throw new IOException("Invalid frame length " + length);
+            if (buffer.remaining() < Integer.BYTES + length) {
+                if (buffer.capacity() < Integer.BYTES + length) {
+                    // grow the buffer to hold the whole frame
+                    var larger = ByteBuffer.allocate(Math.max(2 * buffer.capacity(), Integer.BYTES + length));
+                    connection.readBuffer = larger.put(buffer).flip().order(ByteOrder.LITTLE_ENDIAN);
+                    buffer = connection.readBuffer;
+                }
+                break;
+            }
+
+            buffer.getInt();
+            int requestId = buffer.getInt();
+            byte command = buffer.get();
+            int payloadLength = length - (FRAME_HEADER_BYTES - Integer.BYTES);
+            // copied, since the read buffer is reused
+            var payload = ByteBuffer.allocate(payloadLength).order(ByteOrder.LITTLE_ENDIAN);
+            buffer.get(payload.array());
+            frames.add(new Frame(requestId, command, payload));
+        }
+        buffer.compact();
+
+        for (int i = 0; i < frames.size(); ) {
+            var frame = frames.get(i);
+            if (!frame.isSearch()) {
+                connection.submitExclusive(() -> {
+                    ByteBuffer response;
+                    try {
+                        response = process(frame, connection.context);
+                    } catch (Throwable t) {
+                        response = errorFrame(frame.requestId, t);
+                        t.printStackTrace();
+                    }
+                    connection.respond(response);
+                });
+                i++;
+                continue;
             }
+
+            int end = i + 1;
+            while (end < frames.size() && frame.batchesWith(frames.get(end)))
+                end++;
+            var batch = frames.subList(i, end);
+            connection.submitSearch(() -> search(batch, connection));
+            i = end;
+        }
+    }
+
+    /** Writes queued responses until the channel is full, then waits for it to become writable */
+    private void flush(Connection connection) throws IOException {
+        if (!connection.key.isValid())
+            return;
+        ByteBuffer response;
+        while ((response = connection.responses.peek()) != null) {
+            connection.channel.write(response);
+            if (response.hasRemaining())
+                break;
+            connection.responses.poll();
         }
+        connection.key.interestOps(connection.responses.isEmpty()
+                                   ? SelectionKey.OP_READ
+                                   : SelectionKey.OP_READ | SelectionKey.OP_WRITE);
     }
 
     static void help() {
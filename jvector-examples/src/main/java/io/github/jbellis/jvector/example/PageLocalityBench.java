@@ -0,0 +1,186 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.example;
+
+import io.github.jbellis.jvector.disk.OnDiskGraphIndex;
+import io.github.jbellis.jvector.disk.OnDiskGraphIndexWriter;
+import io.github.jbellis.jvector.disk.RandomAccessReader;
+import io.github.jbellis.jvector.example.util.ReaderSupplierFactory;
+import io.github.jbellis.jvector.example.util.SiftLoader;
+import io.github.jbellis.jvector.graph.GraphIndexBuilder;
+import io.github.jbellis.jvector.graph.GraphSearcher;
+import io.github.jbellis.jvector.graph.ListRandomAccessVectorValues;
+import io.github.jbellis.jvector.graph.NodeSimilarity;
+import io.github.jbellis.jvector.util.Bits;
+import io.github.jbellis.jvector.vector.VectorEncoding;
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
+
+import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.HashSet;
+import java.util.List;
+import java.util.Set;
+import java.util.concurrent.ForkJoinPool;
+
+/**
+ * Compares the number of distinct 4K pages of the graph file that each query touches when the graph
+ * is written in insertion order and in breadth-first order.  Every distinct page touched is a potential
+ * page fault when the index does not fit in memory, so this is a proxy for faults per query that does
+ * not depend on the state of the OS page cache.  The breadth-first graph is also measured with compressed
+ * adjacency lists, which take fewer pages than the padded lists in the node records.
+ */
+public class PageLocalityBench {
+    private static final int PAGE_SIZE = 4096;
+    private static final int TOP_K = 100;
+
+    public static void main(String[] args) throws IOException {
+        var siftPath = args.length > 0 ? args[0] : "siftsmall";
+        var baseVectors = SiftLoader.readFvecs(String.format("%s/siftsmall_base.fvecs", siftPath));
+        var queryVectors = SiftLoader.readFvecs(String.format("%s/siftsmall_query.fvecs", siftPath));
+        int dimension = baseVectors.get(0).length;
+        System.out.format("%d base and %d query vectors loaded, dimensions %d%n", baseVectors.size(), queryVectors.size(), dimension);
+
+        var ravv = new ListRandomAccessVectorValues(baseVectors, dimension);
+        var vsf = VectorSimilarityFunction.EUCLIDEAN;
+        var graph = new GraphIndexBuilder<>(ravv, VectorEncoding.FLOAT32, vsf, 32, 100, 1.2f, 1.2f).build();
+
+        var testDirectory = Files.createTempDirectory("PageLocalityBench");
+        try {
+            var sequential = testDirectory.resolve("sequential");
+            OnDiskGraphIndexWriter.write(graph, ravv, null, OnDiskGraphIndexWriter.getSequentialRenumbering(graph), sequential);
+            var breadthFirst = testDirectory.resolve("breadth_first");
+            OnDiskGraphIndexWriter.write(graph, ravv, null, OnDiskGraphIndexWriter.getBreadthFirstRenumbering(graph), breadthFirst);
+            var compressed = testDirectory.resolve("breadth_first_compressed");
+            OnDiskGraphIndexWriter.write(graph, ravv, null, OnDiskGraphIndexWriter.getBreadthFirstRenumbering(graph),
+                                         VectorEncoding.FLOAT32, true, compressed, ForkJoinPool.commonPool());
+
+            measure("sequential", sequential, queryVectors, vsf);
+            measure("breadth-first", breadthFirst, queryVectors, vsf);
+            measure("breadth-first, compressed adjacency", compressed, queryVectors, vsf);
+        } finally {
+            try (var files = Files.list(testDirectory)) {
+                for (var p : (Iterable<Path>) files::iterator) {
+                    Files.delete(p);
+                }
+            }
+            Files.delete(testDirectory);
+        }
+    }
+
+    private static void measure(String name, Path graphPath, List<float[]> queryVectors, VectorSimilarityFunction vsf) throws IOException {
+        var pages = new HashSet<Long>();
+        try (var readerSupplier = ReaderSupplierFactory.open(graphPath);
+             var onDiskGraph = new OnDiskGraphIndex<float[]>(() -> new PageCountingReader(readerSupplier.get(), pages), 0);
+             var view = onDiskGraph.getView())
+        {
+            var searcher = new GraphSearcher.Builder<>(view).build();
+            long totalPages = 0;
+            long totalVisited = 0;
+            var pagesPerQuery = new ArrayList<Integer>(queryVectors.size());
+            for (var q : queryVectors) {
+                pages.clear();
+                var rr = view.rerankerFor(q, vsf);
+                NodeSimilarity.ExactScoreFunction sf = rr::similarityTo;
+                var result = searcher.search(sf, null, TOP_K, Bits.ALL);
+                totalPages += pages.size();
+                totalVisited += result.getVisitedCount();
+                pagesPerQuery.add(pages.size());
+            }
+            pagesPerQuery.sort(null);
+            System.out.format("%s: %d KB, %.1f distinct pages/query (p50 %d, p99 %d), %.1f nodes visited/query%n",
+                              name,
+                              Files.size(graphPath) / 1024,
+                              (double) totalPages / queryVectors.size(),
+                              pagesPerQuery.get(pagesPerQuery.size() / 2),
+                              pagesPerQuery.get(pagesPerQuery.size() * 99 / 100),
+                              (double) totalVisited / queryVectors.size());
+        } catch (Exception e) {
+            throw new IOException(e);
+        }
+    }
+
+    /** Records the pages of the underlying file covered by each read */
+    private static class PageCountingReader implements RandomAccessReader {
+        private final RandomAccessReader reader;
+        private final Set<Long> pages;
+        private long position;
+
+        PageCountingReader(RandomAccessReader reader, Set<Long> pages) {
+            this.reader = reader;
+            this.pages = pages;
+        }
+
+        private void touch(long length) {
+            if (length == 0) {
+                return;
+            }
+            for (long page = position / PAGE_SIZE; page <= (position + length - 1) / PAGE_SIZE; page++) {
+                pages.add(page);
+            }
+            position += length;
+        }
+
+        @Override
+        public void seek(long offset) throws IOException {
+            reader.seek(offset);
+            position = offset;
+        }
+
+        @Override
+        public int readInt() throws IOException {
+            touch(Integer.BYTES);
+            return reader.readInt();
+        }
+
+        @Override
+        public void readFully(byte[] bytes) throws IOException {
+            touch(bytes.length);
+            reader.readFully(bytes);
+        }
+
+        @Override
+        public void read(byte[] bytes, int offset, int count) throws IOException {
+            touch(count);
+            reader.read(bytes, offset, count);
+        }
+
+        @Override
+        public void readFully(float[] floats) throws IOException {
+            touch((long) floats.length * Float.BYTES);
+            reader.readFully(floats);
+        }
+
+        @Override
+        public void readFully(long[] vector) throws IOException {
+            touch((long) vector.length * Long.BYTES);
+            reader.readFully(vector);
+        }
+
+        @Override
+        public void read(int[] ints, int offset, int count) throws IOException {
+            touch((long) count * Integer.BYTES);
+            reader.read(ints, offset, count);
+        }
+
+        @Override
+        public void close() throws IOException {
+            reader.close();
+        }
+    }
+}
@@ -0,0 +1,249 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package io.github.jbellis.jvector.example.util;
+
+import org.HdrHistogram.Histogram;
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.atomic.AtomicReference;
+import java.util.concurrent.locks.LockSupport;
+import java.util.function.Supplier;
+import java.util.stream.Collectors;
+
+/**
+ * Runs queries from a fixed number of threads for a fixed time, and records their latencies.
+ * <p>
+ * In a closed loop, each thread issues its next query as soon as the previous one returns, so the load is
+ * whatever the index can sustain.  In an open loop, queries are issued on a fixed schedule of `rate` per
+ * second, shared by the threads, and each latency is measured from when the query was scheduled rather than
+ * from when a thread got around to it.  A schedule that the threads cannot keep up with therefore shows up
+ * as growing latencies, instead of as a quietly lower rate.
+ */
+public class LoadGenerator {
+    /**
+     * The searches of one thread.  Each thread gets its own, so it can reuse its searcher across queries.
+     */
+    public interface QueryRunner extends AutoCloseable {
+        /** runs query number `query`, which is in [0, queryCount) */
+        void run(int query);
+
+        @Override
+        default void close() throws Exception { }
+    }
+
+    public static final class Config {
+        public final int threads;
+        /** queries per second, or 0 for a closed loop */
+        public final double rate;
+        public final double warmupSeconds;
+        public final double durationSeconds;
+
+        public Config(int threads, double rate, double warmupSeconds, double durationSeconds) {
+            if (threads <= 0) {
+                throw new IllegalArgumentException("threads must be positive, got " + threads);
+            }
+            if (rate < 0 || warmupSeconds < 0 || durationSeconds <= 0) {
+                throw new IllegalArgumentException(String.format("Invalid rate %s, warmup %s, or duration %s", rate, warmupSeconds, durationSeconds));
+            }
+            this.threads = threads;
+            this.rate = rate;
+            this.warmupSeconds = warmupSeconds;
+            this.durationSeconds = durationSeconds;
+        }
+
+        /**
+         * Parses -Dbench.load, a semicolon-separated list of loads to generate one after another.  Each is a
+         * comma-separated list of threads=N, rate=QPS (for an open loop), warmup=SECONDS, and duration=SECONDS,
+         * e.g. "threads=16,rate=1000;threads=16,rate=2000".  Threads default to the number of processors,
+         * warmup to 10 seconds, and duration to 30.
+         *
+         * @return the loads, or an empty list if bench.load is not set, i.e. no load should be generated
+         */
+        public static List<Config> fromSystemProperties() {
+            var spec = System.getProperty("bench.load", "").trim();
+            if (spec.isEmpty()) {
+                return List.of();
+            }
+            return Arrays.stream(spec.split(";")).map(Config::parse).collect(Collectors.toList());
+        }
+
+        public static Config parse(String spec) {
+            int threads = Runtime.getRuntime().availableProcessors();
+            double rate = 0;
+            double warmup = 10;
+            double duration = 30;
+            for (var setting : spec.split(",")) {
+                var kv = setting.trim().split("=");
+                if (kv.length != 2) {
+                    throw new IllegalArgumentException("Expected key=value, got " + setting);
+                }
+                switch (kv[0]) {
+                    case "threads":
+                        threads = Integer.parseInt(kv[1]);
+                        break;
+                    case "rate":
+                        rate = Double.parseDouble(kv[1]);
+                        break;
+                    case "warmup":
+                        warmup = Double.parseDouble(kv[1]);
+                        break;
+                    case "duration":
+                        duration = Double.parseDouble(kv[1]);
+                        break;
+                    default:
+                        throw new IllegalArgumentException("Unknown load setting " + kv[0]);
+                }
+            }
+            return new Config(threads, rate, warmup, duration);
+        }
+
+        public boolean isOpenLoop() {
+            return rate > 0;
+        }
+
+        @Override
+        public String toString() {
+            return isOpenLoop()
+                   ? String.format("open rate=%.0f threads=%d", rate, threads)
+                   : String.format("closed threads=%d", threads);
+        }
+    }
+
+    public static final class Result {
+        /** latencies in nanoseconds of the queries after warmup */
+        public final Histogram latencies;
+        public final double seconds;
+
+        Result(Histogram latencies, double seconds) {
+            this.latencies = latencies;
+            this.seconds = seconds;
+        }
+
+        public double throughput() {
+            return latencies.getTotalCount() / seconds;
+        }
+
+        public double percentileMillis(double percentile) {
+            return latencies.getValueAtPercentile(percentile) / 1_000_000.0;
+        }
+
+        /**
+         * @return "qps Q p50 A p90 B p99 C p99.9 D max E ms", which plot_output.py charts
+         */
+        @Override
+        public String toString() {
+            return String.format("qps %.1f p50 %.3f p90 %.3f p99 %.3f p99.9 %.3f max %.3f ms",
+                                 throughput(), percentileMillis(50), percentileMillis(90), percentileMillis(99),
+                                 percentileMillis(99.9), latencies.getMaxValue() / 1_000_000.0);
+        }
+    }
+
+    /**
+     * Runs `queryCount` queries round-robin, each thread with a QueryRunner from `runners`, first for the
+     * warmup and then for the duration of `config`.
+     */
+    public static Result run(Config config, int queryCount, Supplier<? extends QueryRunner> runners) {
+        long start = System.nanoTime() + TimeUnit.MILLISECONDS.toNanos(100); // let every thread start
+        long measureStart = start + (long) (config.warmupSeconds * 1e9);
+        long end = measureStart + (long) (config.durationSeconds * 1e9);
+        long interval = config.isOpenLoop() ? (long) (1e9 / config.rate) : 0;
+        var scheduled = new AtomicLong();
+
+        var histograms = new ArrayList<Histogram>(config.threads);
+        var threads = new ArrayList<Thread>(config.threads);
+        var failure = new AtomicReference<Throwable>();
+        for (int t = 0; t < config.threads; t++) {
+            var histogram = new Histogram(3);
+            histograms.add(histogram);
+            int offset = (int) ((long) t * queryCount / config.threads);
+            var thread = new Thread(() -> {
+                try (var runner = runners.get()) {
+                    if (config.isOpenLoop()) {
+                        runOpenLoop(runner, queryCount, histogram, start, measureStart, end, interval, scheduled);
+                    } else {
+                        runClosedLoop(runner, queryCount, offset, histogram, start, measureStart, end);
+                    }
+                } catch (Throwable e) {
+                    failure.compareAndSet(null, e);
+                }
+            }, "load-generator-" + t);
+            threads.add(thread);
+            thread.start();
+        }
+
+        for (var thread : threads) {
+            try {
+                thread.join();
+            } catch (InterruptedException e) {
+                Thread.currentThread().interrupt();
+                throw new RuntimeException(e);
+            }
+        }
+        if (failure.get() != null) {
+            throw new RuntimeException("Query failed", failure.get());
+        }
+
+        var total = new Histogram(3);
+        for (var histogram : histograms) {
+            total.add(histogram);
+        }
+        return new Result(total, config.durationSeconds);
+    }
+
+    private static void runClosedLoop(QueryRunner runner, int queryCount, int offset, Histogram histogram,
+                                      long start, long measureStart, long end)
+    {
+        parkUntil(start);
+        for (int i = offset; ; i++) {
+            long queryStart = System.nanoTime();
+            if (queryStart >= end) {
+                break;
+            }
+            runner.run(i % queryCount);
+            if (queryStart >= measureStart) {
+                histogram.recordValue(System.nanoTime() - queryStart);
+            }
+        }
+    }
+
+    private static void runOpenLoop(QueryRunner runner, int queryCount, Histogram histogram,
+                                    long start, long measureStart, long end, long interval, AtomicLong scheduled)
+    {
+        while (true) {
+            long i = scheduled.getAndIncrement();
+            long intended = start + i * interval;
+            if (intended >= end) {
+                break;
+            }
+            parkUntil(intended);
+            runner.run((int) (i % queryCount));
+            if (intended >= measureStart) {
+                histogram.recordValue(System.nanoTime() - intended);
+            }
+        }
+    }
+
+    private static void parkUntil(long nanoTime) {
+        long remaining;
+        while ((remaining = nanoTime - System.nanoTime()) > 0) {
+            LockSupport.parkNanos(remaining);
+        }
+    }
+}
@@ -48,7 +48,8 @@ public class MMapReader implements RandomAccessReader {
         read(bytes, 0, bytes.length);
     }
 
-    private void read(byte[] bytes, int offset, int count) {
+    @Override
+    public void read(byte[] bytes, int offset, int count) {
         try {
             buffer.memory().getBytes(position, bytes, offset, count);
         } finally {
@@ -23,7 +23,16 @@ import java.nio.file.Files;
 import java.nio.file.Path;
 
 public class ReaderSupplierFactory {
+    private static final String MEMORY_SEGMENT_SUPPLIER = "io.github.jbellis.jvector.disk.MemorySegmentReaderSupplier";
+
     public static ReaderSupplier open(Path path) throws IOException {
+        try {
+            // prefer the MemorySegment-based supplier when jvector-twentytwo is available, i.e. on JDK 22+
+            return (ReaderSupplier) Class.forName(MEMORY_SEGMENT_SUPPLIER).getConstructor(Path.class).newInstance(path);
+        } catch (ReflectiveOperationException | LinkageError e) {
+            // fall through
+        }
+
         try {
             return new MMapReaderSupplier(path);
         } catch (UnsatisfiedLinkError|NoClassDefFoundError e) {
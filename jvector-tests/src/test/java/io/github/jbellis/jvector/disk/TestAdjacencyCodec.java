@@ -0,0 +1,75 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.disk;
+
+import com.carrotsearch.randomizedtesting.RandomizedTest;
+import org.junit.Test;
+
+import java.util.Arrays;
+
+import static org.junit.Assert.assertArrayEquals;
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertThrows;
+import static org.junit.Assert.assertTrue;
+
+public class TestAdjacencyCodec extends RandomizedTest {
+    @Test
+    public void testRoundTrip() {
+        int maxDegree = 64;
+        var encoded = new byte[AdjacencyCodec.maxEncodedSize(maxDegree) + AdjacencyCodec.PADDING];
+        var decoded = new int[maxDegree];
+        for (int trial = 0; trial < 1000; trial++) {
+            int count = between(0, maxDegree);
+            // gaps of every width, from duplicates (0 bits) to the full range of ordinals
+            int max = (int) ((1L << between(0, 31)) - 1);
+            var neighbors = new int[count];
+            for (int i = 0; i < count; i++) {
+                neighbors[i] = randomIntBetween(0, max);
+            }
+            Arrays.sort(neighbors);
+
+            int length = AdjacencyCodec.encode(neighbors, count, encoded, 0);
+            assertTrue(length <= AdjacencyCodec.maxEncodedSize(maxDegree));
+            assertEquals(count, AdjacencyCodec.decode(encoded, 0, decoded));
+            assertArrayEquals(neighbors, Arrays.copyOf(decoded, count));
+        }
+    }
+
+    @Test
+    public void testExtremes() {
+        int maxDegree = 4;
+        var encoded = new byte[AdjacencyCodec.maxEncodedSize(maxDegree) + AdjacencyCodec.PADDING];
+        var decoded = new int[maxDegree];
+        var neighbors = new int[] { 0, 1, Integer.MAX_VALUE - 1, Integer.MAX_VALUE };
+        // the largest possible gap, and so the largest possible encoding
+        int length = AdjacencyCodec.encode(new int[] { 0, Integer.MAX_VALUE }, 2, encoded, 0);
+        assertTrue(length <= AdjacencyCodec.maxEncodedSize(2));
+        assertEquals(2, AdjacencyCodec.decode(encoded, 0, decoded));
+        assertEquals(Integer.MAX_VALUE, decoded[1]);
+
+        AdjacencyCodec.encode(neighbors, neighbors.length, encoded, 0);
+        assertEquals(neighbors.length, AdjacencyCodec.decode(encoded, 0, decoded));
+        assertArrayEquals(neighbors, decoded);
+
+        // nearby neighbors take about a byte each
+        var close = new int[] { 1000, 1003, 1010, 1100 };
+        assertEquals(1 + 2 + 1 + 3, AdjacencyCodec.encode(close, close.length, encoded, 0));
+
+        assertThrows(IllegalArgumentException.class, () -> AdjacencyCodec.encode(new int[] { 2, 1 }, 2, encoded, 0));
+        assertThrows(IllegalArgumentException.class, () -> AdjacencyCodec.encode(new int[] { -1 }, 1, encoded, 0));
+    }
+}
@@ -19,10 +19,22 @@ package io.github.jbellis.jvector.disk;
 import com.carrotsearch.randomizedtesting.RandomizedTest;
 import com.carrotsearch.randomizedtesting.annotations.ThreadLeakScope;
 import io.github.jbellis.jvector.TestUtil;
+import io.github.jbellis.jvector.graph.BatchSearcher;
+import io.github.jbellis.jvector.graph.Float16VectorValues;
 import io.github.jbellis.jvector.graph.GraphIndex;
 import io.github.jbellis.jvector.graph.GraphIndexBuilder;
+import io.github.jbellis.jvector.graph.GraphIndexMerger;
 import io.github.jbellis.jvector.graph.GraphIndexTestCase;
+import io.github.jbellis.jvector.graph.GraphSearcher;
+import io.github.jbellis.jvector.graph.ListRandomAccessVectorValues;
+import io.github.jbellis.jvector.graph.NodeSimilarity;
 import io.github.jbellis.jvector.graph.RandomAccessVectorValues;
+import io.github.jbellis.jvector.graph.SearchListener;
+import io.github.jbellis.jvector.graph.SearchStats;
+import io.github.jbellis.jvector.pq.PQVectors;
+import io.github.jbellis.jvector.pq.ProductQuantization;
+import io.github.jbellis.jvector.util.Bits;
+import io.github.jbellis.jvector.vector.Float16;
 import io.github.jbellis.jvector.vector.VectorEncoding;
 import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
 import org.junit.After;
@@ -32,13 +44,22 @@ import org.junit.Test;
 import java.io.IOException;
 import java.nio.file.Files;
 import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.Arrays;
 import java.util.HashMap;
 import java.util.List;
 import java.util.Map;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.stream.Collectors;
+import java.util.stream.IntStream;
 
 import static io.github.jbellis.jvector.TestUtil.getNeighborNodes;
 import static org.junit.Assert.assertArrayEquals;
 import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertNotEquals;
+import static org.junit.Assert.assertNull;
+import static org.junit.Assert.assertThrows;
 import static org.junit.Assert.assertTrue;
 
 @ThreadLeakScope(ThreadLeakScope.Scope.NONE)
@@ -156,6 +177,702 @@ public class TestOnDiskGraphIndex extends RandomizedTest {
         }
     }
 
+    @Test
+    public void testBreadthFirstRenumbering() throws Exception {
+        int dimension = 8;
+        var vectors = IntStream.range(0, 100).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+        var builder = new GraphIndexBuilder<>(ravv, VectorEncoding.FLOAT32, VectorSimilarityFunction.EUCLIDEAN, 8, 30, 1.2f, 1.2f);
+        var graph = builder.build();
+        // leave a hole, which must not be renumbered
+        builder.markNodeDeleted(17);
+        builder.cleanup();
+
+        var view = graph.getView();
+        int[] oldToNew = OnDiskGraphIndexWriter.getBreadthFirstRenumbering(graph);
+        assertEquals(-1, oldToNew[17]);
+        assertEquals(0, oldToNew[view.entryNode()]);
+        assertEquals(graph.size(), Arrays.stream(oldToNew).filter(i -> i >= 0).distinct().count());
+        // the entry node's neighbors come right after it, in order
+        int expected = 1;
+        for (var it = view.getNeighborsIterator(view.entryNode()); it.hasNext(); ) {
+            assertEquals(expected++, oldToNew[it.nextInt()]);
+        }
+
+        Map<Integer, Integer> oldToNewMap = OnDiskGraphIndex.getBreadthFirstRenumbering(graph);
+        assertEquals(graph.size(), oldToNewMap.size());
+        var outputPath = testDirectory.resolve("bfs_graph");
+        try (var out = TestUtil.openFileForWriting(outputPath)) {
+            OnDiskGraphIndex.write(graph, ravv, oldToNewMap, out);
+            out.flush();
+        }
+        try (var marr = new SimpleMappedReader(outputPath.toAbsolutePath().toString());
+             var onDiskGraph = new OnDiskGraphIndex<float[]>(marr::duplicate, 0);
+             var onDiskView = onDiskGraph.getView())
+        {
+            assertEquals(0, onDiskView.entryNode());
+            for (var entry : oldToNewMap.entrySet()) {
+                assertEquals((int) entry.getValue(), oldToNew[entry.getKey()]);
+                assertArrayEquals(ravv.vectorValue(entry.getKey()), onDiskView.getVector(entry.getValue()), 0.0f);
+                var renumberedNeighbors = getNeighborNodes(view, entry.getKey()).stream().map(oldToNewMap::get).collect(Collectors.toSet());
+                assertEquals(renumberedNeighbors, getNeighborNodes(onDiskView, entry.getValue()));
+            }
+        }
+    }
+
+    @Test
+    public void testInlinePQCodes() throws Exception {
+        int dimension = 16;
+        var graph = new TestUtil.RandomlyConnectedGraphIndex<float[]>(200, 8, getRandom());
+        var vectors = IntStream.range(0, graph.size()).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+        var pq = ProductQuantization.compute(ravv, 4, false);
+        var pqv = new PQVectors(pq, pq.encodeAll(vectors));
+
+        var outputPath = testDirectory.resolve("inline_pq_graph");
+        try (var out = TestUtil.openFileForWriting(outputPath)) {
+            OnDiskGraphIndex.write(graph, ravv, pqv, OnDiskGraphIndex.getSequentialRenumbering(graph), out);
+            out.flush();
+        }
+
+        try (var marr = new SimpleMappedReader(outputPath.toAbsolutePath().toString());
+             var onDiskGraph = new OnDiskGraphIndex<float[]>(marr::duplicate, 0);
+             var onDiskView = onDiskGraph.getView())
+        {
+            TestUtil.assertGraphEquals(graph, onDiskGraph);
+            validateVectors(onDiskView, ravv);
+            assertEquals(pq, onDiskGraph.getProductQuantization());
+
+            for (var vsf : VectorSimilarityFunction.values()) {
+                var q = TestUtil.randomVector(getRandom(), dimension);
+                var inlineSf = onDiskView.approximateScoreFunctionFor(q, vsf);
+                var expectedScores = new float[graph.size()];
+                var heapSf = pqv.approximateScoreFunctionFor(q, vsf);
+                for (int i = 0; i < graph.size(); i++) {
+                    expectedScores[i] = heapSf.similarityTo(i);
+                }
+
+                assertTrue(inlineSf.supportsEdgeLoadingSimilarity());
+                for (int i = 0; i < graph.size(); i++) {
+                    assertEquals(expectedScores[i], inlineSf.similarityTo(i), 1e-6);
+                    var neighborScores = inlineSf.edgeLoadingSimilarityTo(i);
+                    var it = onDiskView.getNeighborsIterator(i);
+                    for (int j = 0; it.hasNext(); j++) {
+                        assertEquals(expectedScores[it.nextInt()], neighborScores[j], 1e-6);
+                    }
+                }
+
+                // searching with the inline codes should find the same results as with the on-heap codes
+                NodeSimilarity.ReRanker reRanker = j -> vsf.compare(q, ravv.vectorValue(j));
+                var expected = new GraphSearcher.Builder<>(graph.getView()).build().search(heapSf, reRanker, 10, Bits.ALL);
+                var actual = new GraphSearcher.Builder<>(onDiskView).build().search(inlineSf, reRanker, 10, Bits.ALL);
+                assertEquals(expected.getNodes().length, actual.getNodes().length);
+                for (int i = 0; i < expected.getNodes().length; i++) {
+                    assertEquals(expected.getNodes()[i].node, actual.getNodes()[i].node);
+                }
+            }
+        }
+    }
+
+    @Test
+    public void testReRanker() throws Exception {
+        int dimension = 7;
+        var vectors = IntStream.range(0, randomlyConnectedGraph.size()).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+        var outputPath = testDirectory.resolve("reranker_graph");
+        TestUtil.writeGraph(randomlyConnectedGraph, ravv, outputPath);
+        try (var marr = new SimpleMappedReader(outputPath.toAbsolutePath().toString());
+             var onDiskGraph = new OnDiskGraphIndex<float[]>(marr::duplicate, 0);
+             var cachingGraph = new CachingGraphIndex(onDiskGraph, 1);
+             var onDiskView = onDiskGraph.getView();
+             var cachedView = cachingGraph.getView())
+        {
+            for (var vsf : VectorSimilarityFunction.values()) {
+                var q = TestUtil.randomVector(getRandom(), dimension);
+                var rr = onDiskView.rerankerFor(q, vsf);
+                var cachedRr = cachedView.rerankerFor(q, vsf);
+                for (int i = 0; i < ravv.size(); i++) {
+                    assertEquals(vsf.compare(q, ravv.vectorValue(i)), rr.similarityTo(i), 0.0f);
+                    assertEquals(vsf.compare(q, ravv.vectorValue(i)), cachedRr.similarityTo(i), 0.0f);
+                }
+            }
+        }
+    }
+
+    @Test
+    public void testBatchSearch() throws Exception {
+        int dimension = 16;
+        var graph = new TestUtil.RandomlyConnectedGraphIndex<float[]>(500, 8, getRandom());
+        var vectors = IntStream.range(0, graph.size()).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+        var pq = ProductQuantization.compute(ravv, 4, false);
+        var pqv = new PQVectors(pq, pq.encodeAll(vectors));
+        var outputPath = testDirectory.resolve("batch_graph");
+        TestUtil.writeGraph(graph, ravv, outputPath);
+
+        try (var marr = new SimpleMappedReader(outputPath.toAbsolutePath().toString());
+             var onDiskGraph = new OnDiskGraphIndex<float[]>(marr::duplicate, 0);
+             var onDiskView = onDiskGraph.getView())
+        {
+            for (var vsf : VectorSimilarityFunction.values()) {
+                var queries = new float[between(1, 40)][];
+                for (int i = 0; i < queries.length; i++) {
+                    queries[i] = TestUtil.randomVector(getRandom(), dimension);
+                }
+
+                // the batched lookup tables score the same as the ones built one query at a time
+                var scoreFunctions = pqv.approximateScoreFunctionsFor(queries, vsf);
+                assertEquals(queries.length, scoreFunctions.length);
+                var reRankers = new ArrayList<NodeSimilarity.ReRanker>();
+                for (int i = 0; i < queries.length; i++) {
+                    var q = queries[i];
+                    var expectedSf = pqv.approximateScoreFunctionFor(q, vsf);
+                    for (int j = 0; j < graph.size(); j++) {
+                        assertEquals(expectedSf.similarityTo(j), scoreFunctions[i].similarityTo(j), 1e-6);
+                    }
+                    reRankers.add(j -> vsf.compare(q, ravv.vectorValue(j)));
+                }
+
+                // and the batch finds what the queries find on their own, whether it is given the batched score
+                // functions or builds them one query at a time on the searching threads
+                var queryIndexes = IntStream.range(0, queries.length).boxed().collect(Collectors.toList());
+                var batched = new BatchSearcher.QueryScorer<float[], Integer>() {
+                    @Override
+                    public NodeSimilarity.ScoreFunction scoreFunctionFor(Integer query, GraphIndex.View<float[]> view) {
+                        return scoreFunctions[query];
+                    }
+
+                    @Override
+                    public NodeSimilarity.ReRanker rerankerFor(Integer query, GraphIndex.View<float[]> view) {
+                        return reRankers.get(query);
+                    }
+                };
+                var perThread = new BatchSearcher.QueryScorer<float[], Integer>() {
+                    @Override
+                    public NodeSimilarity.ScoreFunction scoreFunctionFor(Integer query, GraphIndex.View<float[]> view) {
+                        return pqv.approximateScoreFunctionFor(queries[query], vsf);
+                    }
+
+                    @Override
+                    public NodeSimilarity.ReRanker rerankerFor(Integer query, GraphIndex.View<float[]> view) {
+                        return ((OnDiskGraphIndex<float[]>.OnDiskView) view).rerankerFor(queries[query], vsf);
+                    }
+                };
+                var searcher = new GraphSearcher.Builder<>(onDiskView).build();
+                for (var scorer : List.of(batched, perThread)) {
+                    var results = new BatchSearcher<>(onDiskGraph).search(queryIndexes, scorer, 10, Bits.ALL);
+                    assertEquals(queries.length, results.length);
+                    for (int i = 0; i < queries.length; i++) {
+                        var expected = searcher.search(scoreFunctions[i], reRankers.get(i), 10, Bits.ALL).getNodes();
+                        var actual = results[i].getNodes();
+                        assertEquals(expected.length, actual.length);
+                        for (int j = 0; j < expected.length; j++) {
+                            assertEquals(expected[j].node, actual[j].node);
+                            assertEquals(expected[j].score, actual[j].score, 1e-6);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    @Test
+    public void testClockCache() throws Exception {
+        int dimension = 8;
+        var vectors = IntStream.range(0, 200).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+        var vsf = VectorSimilarityFunction.EUCLIDEAN;
+        var graph = new GraphIndexBuilder<>(ravv, VectorEncoding.FLOAT32, vsf, 8, 30, 1.2f, 1.2f).build();
+        var outputPath = testDirectory.resolve("clock_cache_graph");
+        TestUtil.writeGraph(graph, ravv, outputPath);
+
+        // room for about a quarter of the graph, to exercise eviction
+        long maxBytes = 200 * Integer.BYTES + 50 * (dimension * Float.BYTES + graph.maxDegree() * Integer.BYTES + 9);
+        try (var marr = new SimpleMappedReader(outputPath.toAbsolutePath().toString());
+             var onDiskGraph = new OnDiskGraphIndex<float[]>(marr::duplicate, 0);
+             var cachingGraph = CachingGraphIndex.withClockCache(onDiskGraph, maxBytes);
+             var onDiskView = onDiskGraph.getView();
+             var cachedView = cachingGraph.getView())
+        {
+            assertThrows(IllegalArgumentException.class, () -> CachingGraphIndex.withClockCache(onDiskGraph, 100));
+            var clockCache = cachingGraph.getClockCache();
+            assertTrue(clockCache.capacity() < ravv.size());
+            assertTrue(clockCache.ramBytesUsed() <= maxBytes + 1024);
+
+            // repeat the queries so that the second pass can hit the cache
+            for (int pass = 0; pass < 2; pass++) {
+                for (int i = 0; i < ravv.size(); i++) {
+                    var q = ravv.vectorValue(i);
+                    NodeSimilarity.ExactScoreFunction sf = j -> vsf.compare(q, ravv.vectorValue(j));
+                    var expected = new GraphSearcher.Builder<>(onDiskView).build().search(sf, null, 10, Bits.ALL);
+                    var actual = new GraphSearcher.Builder<>(cachedView).build().search(sf, null, 10, Bits.ALL);
+                    assertArrayEquals(Arrays.stream(expected.getNodes()).mapToInt(ns -> ns.node).toArray(),
+                                      Arrays.stream(actual.getNodes()).mapToInt(ns -> ns.node).toArray());
+                }
+            }
+            assertTrue(clockCache.hitCount() > 0);
+            assertTrue(clockCache.missCount() > 0);
+            assertTrue(clockCache.evictionCount() > 0);
+
+            // cached vectors and reranking agree with the disk
+            var q = TestUtil.randomVector(getRandom(), dimension);
+            var rr = cachedView.rerankerFor(q, vsf);
+            for (int i = 0; i < ravv.size(); i++) {
+                assertArrayEquals(ravv.vectorValue(i), cachedView.getVector(i), 0.0f);
+                assertEquals(vsf.compare(q, ravv.vectorValue(i)), rr.similarityTo(i), 0.0f);
+                assertEquals(getNeighborNodes(onDiskView, i), getNeighborNodes(cachedView, i));
+            }
+        }
+    }
+
+    @Test
+    public void testEntryPoints() throws Exception {
+        // clustered vectors, where a single medoid entry node is far from most queries
+        int dimension = 8;
+        var centers = IntStream.range(0, 8).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
+        var vectors = IntStream.range(0, 800).mapToObj(i -> {
+            var v = TestUtil.randomVector(getRandom(), dimension);
+            var center = centers.get(i % centers.size());
+            for (int j = 0; j < dimension; j++) {
+                v[j] = 10 * center[j] + 0.1f * v[j];
+            }
+            return v;
+        }).collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+        var vsf = VectorSimilarityFunction.EUCLIDEAN;
+        var builder = new GraphIndexBuilder<>(ravv, VectorEncoding.FLOAT32, vsf, 8, 30, 1.2f, 1.2f);
+        builder.setEntryPointCount(centers.size());
+        var graph = builder.build();
+
+        var entryPoints = graph.getView().entryPoints();
+        assertTrue(entryPoints.length > 0 && entryPoints.length <= centers.size());
+        assertEquals(entryPoints.length, Arrays.stream(entryPoints).distinct().count());
+        for (int entryPoint : entryPoints) {
+            assertTrue(graph.containsNode(entryPoint));
+            assertNotEquals(graph.getView().entryNode(), entryPoint);
+        }
+
+        // both writers persist them, renumbered
+        int[] oldToNew = OnDiskGraphIndexWriter.getBreadthFirstRenumbering(graph);
+        var sequentialPath = testDirectory.resolve("sequential_entry_points_graph");
+        try (var out = TestUtil.openFileForWriting(sequentialPath)) {
+            var oldToNewMap = new HashMap<Integer, Integer>();
+            for (int i = 0; i < oldToNew.length; i++) {
+                oldToNewMap.put(i, oldToNew[i]);
+            }
+            OnDiskGraphIndex.write(graph, ravv, oldToNewMap, out);
+            out.flush();
+        }
+        var parallelPath = testDirectory.resolve("parallel_entry_points_graph");
+        OnDiskGraphIndexWriter.write(graph, ravv, null, oldToNew, parallelPath);
+        assertArrayEquals(Files.readAllBytes(sequentialPath), Files.readAllBytes(parallelPath));
+
+        try (var marr = new SimpleMappedReader(parallelPath.toAbsolutePath().toString());
+             var onDiskGraph = new OnDiskGraphIndex<float[]>(marr::duplicate, 0);
+             var onDiskView = onDiskGraph.getView())
+        {
+            assertArrayEquals(Arrays.stream(entryPoints).map(node -> oldToNew[node]).toArray(), onDiskView.entryPoints());
+
+            var searcher = new GraphSearcher.Builder<>(onDiskView).build();
+            int found = 0;
+            for (int i = 0; i < ravv.size(); i++) {
+                var q = ravv.vectorValue(i);
+                var reranker = onDiskView.rerankerFor(q, vsf);
+                NodeSimilarity.ExactScoreFunction exact = reranker::similarityTo;
+                var result = searcher.search(exact, null, 1, Bits.ALL);
+                if (result.getNodes()[0].node == oldToNew[i]) {
+                    found++;
+                }
+            }
+            assertTrue(found > 0.95 * ravv.size());
+        }
+
+        // deleted entry points are replaced
+        builder.markNodeDeleted(entryPoints[0]);
+        builder.cleanup();
+        assertTrue(Arrays.stream(graph.getView().entryPoints()).allMatch(graph::containsNode));
+    }
+
+    @Test
+    public void testSearchStats() throws Exception {
+        int dimension = 8;
+        var vectors = IntStream.range(0, 200).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+        var vsf = VectorSimilarityFunction.EUCLIDEAN;
+        var graph = new GraphIndexBuilder<>(ravv, VectorEncoding.FLOAT32, vsf, 8, 30, 1.2f, 1.2f).build();
+        var outputPath = testDirectory.resolve("search_stats_graph");
+        TestUtil.writeGraph(graph, ravv, outputPath);
+
+        try (var marr = new SimpleMappedReader(outputPath.toAbsolutePath().toString());
+             var onDiskGraph = new OnDiskGraphIndex<float[]>(marr::duplicate, 0);
+             var cachingGraph = CachingGraphIndex.withClockCache(onDiskGraph, 1 << 20);
+             var onDiskView = onDiskGraph.getView();
+             var cachedView = cachingGraph.getView())
+        {
+            var diskTotals = new SearchListener.Totals();
+            var cachedTotals = new SearchListener.Totals();
+            var diskSearcher = new GraphSearcher.Builder<>(onDiskView).withInstrumentation(diskTotals).build();
+            var cachedSearcher = new GraphSearcher.Builder<>(cachedView).withInstrumentation(cachedTotals).build();
+            long expanded = 0;
+            for (int i = 0; i < ravv.size(); i++) {
+                var q = ravv.vectorValue(i);
+                NodeSimilarity.ExactScoreFunction exact = j -> vsf.compare(q, ravv.vectorValue(j));
+                // coarsen the exact scores to get an approximate function that needs re-ranking
+                NodeSimilarity.ApproximateScoreFunction approximate = j -> Math.round(exact.similarityTo(j) * 10) / 10.0f;
+
+                var result = diskSearcher.search(approximate, onDiskView.rerankerFor(q, vsf), 10, Bits.ALL);
+                var stats = result.getStats();
+                assertTrue(stats.expandedCount() > 0);
+                assertTrue(stats.scoredCount() >= stats.expandedCount());
+                assertEquals(result.getNodes().length, stats.rerankedCount());
+                // at least the adjacency lists and the reranked vectors were read
+                assertTrue(stats.bytesRead() >= (long) stats.rerankedCount() * dimension * Float.BYTES);
+                assertEquals(0, stats.cacheHits());
+                assertTrue(stats.phaseNanos(SearchStats.Phase.TRAVERSAL) > 0);
+                expanded += stats.expandedCount();
+
+                // exact searches rerank nothing
+                assertEquals(0, diskSearcher.search(exact, null, 10, Bits.ALL).getStats().rerankedCount());
+                cachedSearcher.search(exact, null, 10, Bits.ALL);
+            }
+            assertEquals(2L * ravv.size(), diskTotals.searchCount());
+            assertTrue(diskTotals.expandedCount() > expanded);
+            assertTrue(diskTotals.bytesRead() > 0);
+            // the clock cache has room for the whole graph, so searches after the first are mostly hits
+            assertEquals(ravv.size(), cachedTotals.searchCount());
+            assertTrue(cachedTotals.cacheHits() > 0);
+
+            // searchers are not instrumented by default
+            NodeSimilarity.ExactScoreFunction sf = j -> vsf.compare(ravv.vectorValue(0), ravv.vectorValue(j));
+            assertNull(new GraphSearcher.Builder<>(onDiskView).build().search(sf, null, 10, Bits.ALL).getStats());
+        }
+    }
+
+    @Test
+    public void testWithoutInlinePQCodes() throws Exception {
+        var outputPath = testDirectory.resolve("no_pq_graph");
+        var ravv = new GraphIndexTestCase.CircularFloatVectorValues(randomlyConnectedGraph.size());
+        TestUtil.writeGraph(randomlyConnectedGraph, ravv, outputPath);
+        try (var marr = new SimpleMappedReader(outputPath.toAbsolutePath().toString());
+             var onDiskGraph = new OnDiskGraphIndex<float[]>(marr::duplicate, 0))
+        {
+            assertNull(onDiskGraph.getProductQuantization());
+        }
+    }
+
+    @Test
+    public void testBeamSearch() throws Exception {
+        int dimension = 8;
+        var vectors = IntStream.range(0, 200).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+        var vsf = VectorSimilarityFunction.EUCLIDEAN;
+        var graph = new GraphIndexBuilder<>(ravv, VectorEncoding.FLOAT32, vsf, 8, 30, 1.2f, 1.2f).build();
+        var outputPath = testDirectory.resolve("beam_graph");
+        TestUtil.writeGraph(graph, ravv, outputPath);
+
+        assertThrows(IllegalArgumentException.class, () -> new GraphSearcher.Builder<>(graph.getView()).withBeamWidth(0));
+
+        var prefetches = new AtomicInteger();
+        try (var marr = new SimpleMappedReader(outputPath.toAbsolutePath().toString());
+             var onDiskGraph = new OnDiskGraphIndex<float[]>(() -> new PrefetchCountingReader(marr.duplicate(), prefetches), 0);
+             var onDiskView = onDiskGraph.getView())
+        {
+            var searcher = new GraphSearcher.Builder<>(onDiskView).withBeamWidth(4).build();
+            int found = 0;
+            for (int i = 0; i < ravv.size(); i++) {
+                var q = ravv.vectorValue(i);
+                NodeSimilarity.ExactScoreFunction sf = j -> vsf.compare(q, ravv.vectorValue(j));
+                var result = searcher.search(sf, null, 10, Bits.ALL);
+                for (var ns : result.getNodes()) {
+                    if (ns.node == i) {
+                        found++;
+                        break;
+                    }
+                }
+            }
+            assertTrue("found only " + found, found >= 190);
+            assertTrue(prefetches.get() > 0);
+        }
+    }
+
+    /** passes everything through to a SimpleMappedReader, counting the calls to prefetch */
+    private static class PrefetchCountingReader implements RandomAccessReader {
+        private final SimpleMappedReader reader;
+        private final AtomicInteger prefetches;
+
+        PrefetchCountingReader(SimpleMappedReader reader, AtomicInteger prefetches) {
+            this.reader = reader;
+            this.prefetches = prefetches;
+        }
+
+        @Override
+        public void seek(long offset) {
+            reader.seek(offset);
+        }
+
+        @Override
+        public int readInt() {
+            return reader.readInt();
+        }
+
+        @Override
+        public void readFully(byte[] bytes) {
+            reader.readFully(bytes);
+        }
+
+        @Override
+        public void readFully(float[] floats) {
+            reader.readFully(floats);
+        }
+
+        @Override
+        public void readFully(long[] vector) throws IOException {
+            reader.readFully(vector);
+        }
+
+        @Override
+        public void read(int[] ints, int offset, int count) {
+            reader.read(ints, offset, count);
+        }
+
+        @Override
+        public void read(byte[] bytes, int offset, int count) {
+            reader.read(bytes, offset, count);
+        }
+
+        @Override
+        public void prefetch(long[] offsets, int count, int length) {
+            assertTrue(count > 1);
+            prefetches.incrementAndGet();
+        }
+
+        @Override
+        public void close() {
+            reader.close();
+        }
+    }
+
+    @Test
+    public void testParallelWriter() throws Exception {
+        int dimension = 8;
+        var graph = new TestUtil.RandomlyConnectedGraphIndex<float[]>(between(300, 3000), 8, getRandom());
+        var vectors = IntStream.range(0, graph.size()).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+        var pq = ProductQuantization.compute(ravv, 4, false);
+        var pqv = new PQVectors(pq, pq.encodeAll(vectors));
+
+        // reverse the ordinals so that the mapping is exercised
+        int[] oldToNew = new int[graph.size()];
+        Map<Integer, Integer> oldToNewMap = new HashMap<>();
+        for (int i = 0; i < graph.size(); i++) {
+            oldToNew[i] = graph.size() - 1 - i;
+            oldToNewMap.put(i, oldToNew[i]);
+        }
+
+        for (var codes : Arrays.asList(null, pqv)) {
+            var sequentialPath = testDirectory.resolve("sequential_graph");
+            try (var out = TestUtil.openFileForWriting(sequentialPath)) {
+                OnDiskGraphIndex.write(graph, ravv, codes, oldToNewMap, out);
+                out.flush();
+            }
+            var parallelPath = testDirectory.resolve("parallel_graph");
+            OnDiskGraphIndexWriter.write(graph, ravv, codes, oldToNew, parallelPath);
+            assertArrayEquals(Files.readAllBytes(sequentialPath), Files.readAllBytes(parallelPath));
+
+            try (var marr = new SimpleMappedReader(parallelPath.toAbsolutePath().toString());
+                 var onDiskGraph = new OnDiskGraphIndex<float[]>(marr::duplicate, 0);
+                 var onDiskView = onDiskGraph.getView())
+            {
+                assertEquals(oldToNew[graph.getView().entryNode()], onDiskView.entryNode());
+                for (int i = 0; i < graph.size(); i++) {
+                    assertArrayEquals(ravv.vectorValue(i), onDiskView.getVector(oldToNew[i]), 0.0f);
+                }
+            }
+        }
+
+        assertThrows(IllegalArgumentException.class,
+                     () -> OnDiskGraphIndexWriter.write(graph, ravv, null, new int[graph.size()], testDirectory.resolve("bad_graph")));
+    }
+
+    @Test
+    public void testCompressedAdjacency() throws Exception {
+        int dimension = 8;
+        var graph = new TestUtil.RandomlyConnectedGraphIndex<float[]>(between(300, 3000), 8, getRandom());
+        var vectors = IntStream.range(0, graph.size()).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+        var pq = ProductQuantization.compute(ravv, 4, false);
+        var pqv = new PQVectors(pq, pq.encodeAll(vectors));
+        int[] oldToNew = OnDiskGraphIndexWriter.getBreadthFirstRenumbering(graph);
+        var oldToNewMap = OnDiskGraphIndex.getBreadthFirstRenumbering(graph);
+
+        for (var codes : Arrays.asList(null, pqv)) {
+            var sequentialPath = testDirectory.resolve("sequential_compressed_graph");
+            try (var out = TestUtil.openFileForWriting(sequentialPath)) {
+                OnDiskGraphIndex.write(graph, ravv, codes, oldToNewMap, VectorEncoding.FLOAT32, true, out);
+                out.flush();
+            }
+            var parallelPath = testDirectory.resolve("parallel_compressed_graph");
+            OnDiskGraphIndexWriter.write(graph, ravv, codes, oldToNew, VectorEncoding.FLOAT32, true, parallelPath, ForkJoinPool.commonPool());
+            assertArrayEquals(Files.readAllBytes(sequentialPath), Files.readAllBytes(parallelPath));
+            var fixedPath = testDirectory.resolve("fixed_graph");
+            OnDiskGraphIndexWriter.write(graph, ravv, codes, oldToNew, fixedPath);
+            assertTrue(Files.size(sequentialPath) < Files.size(fixedPath));
+
+            try (var marr = new SimpleMappedReader(parallelPath.toAbsolutePath().toString());
+                 var onDiskGraph = new OnDiskGraphIndex<float[]>(marr::duplicate, 0);
+                 var onDiskView = onDiskGraph.getView())
+            {
+                assertTrue(onDiskGraph.hasCompressedAdjacency());
+                assertEquals(oldToNew[graph.getView().entryNode()], onDiskView.entryNode());
+                var heapView = graph.getView();
+                for (int i = 0; i < graph.size(); i++) {
+                    assertArrayEquals(ravv.vectorValue(i), onDiskView.getVector(oldToNew[i]), 0.0f);
+                    var expected = getNeighborNodes(heapView, i).stream().map(n -> oldToNew[n]).collect(Collectors.toSet());
+                    assertEquals(expected, getNeighborNodes(onDiskView, oldToNew[i]));
+                }
+
+                // prefetching reads the offset index without disturbing the lists
+                int[] nodes = IntStream.range(0, 10).toArray();
+                onDiskView.prefetchNeighbors(nodes, nodes.length);
+                if (codes == null) {
+                    continue;
+                }
+
+                var q = TestUtil.randomVector(getRandom(), dimension);
+                var heapSf = pqv.approximateScoreFunctionFor(q, VectorSimilarityFunction.EUCLIDEAN);
+                var inlineSf = onDiskView.approximateScoreFunctionFor(q, VectorSimilarityFunction.EUCLIDEAN);
+                int[] newToOld = new int[graph.size()];
+                for (int i = 0; i < graph.size(); i++) {
+                    newToOld[oldToNew[i]] = i;
+                }
+                for (int node = 0; node < graph.size(); node++) {
+                    assertEquals(heapSf.similarityTo(newToOld[node]), inlineSf.similarityTo(node), 1e-6);
+                    var neighborScores = inlineSf.edgeLoadingSimilarityTo(node);
+                    var it = onDiskView.getNeighborsIterator(node);
+                    for (int j = 0; it.hasNext(); j++) {
+                        assertEquals(heapSf.similarityTo(newToOld[it.nextInt()]), neighborScores[j], 1e-6);
+                    }
+                }
+            }
+        }
+    }
+
+    @Test
+    public void testFloat16Vectors() throws Exception {
+        int dimension = between(2, 40);
+        var graph = new TestUtil.RandomlyConnectedGraphIndex<float[]>(between(100, 500), 8, getRandom());
+        var vectors = IntStream.range(0, graph.size()).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+        var f16 = Float16VectorValues.encode(ravv);
+        int[] oldToNew = OnDiskGraphIndexWriter.getSequentialRenumbering(graph);
+
+        var sequentialPath = testDirectory.resolve("sequential_f16_graph");
+        try (var out = TestUtil.openFileForWriting(sequentialPath)) {
+            OnDiskGraphIndex.write(graph, ravv, null, OnDiskGraphIndex.getSequentialRenumbering(graph), VectorEncoding.FLOAT16, out);
+            out.flush();
+        }
+        // half-precision vectors written from a Float16VectorValues are not rounded again
+        var parallelPath = testDirectory.resolve("parallel_f16_graph");
+        OnDiskGraphIndexWriter.write(graph, f16, null, oldToNew, VectorEncoding.FLOAT16, parallelPath, ForkJoinPool.commonPool());
+        assertArrayEquals(Files.readAllBytes(sequentialPath), Files.readAllBytes(parallelPath));
+        var float32Path = testDirectory.resolve("f32_graph");
+        TestUtil.writeGraph(graph, ravv, float32Path);
+        assertEquals(Files.size(float32Path) - Files.size(sequentialPath), (long) graph.size() * dimension * Short.BYTES);
+
+        try (var marr = new SimpleMappedReader(sequentialPath.toAbsolutePath().toString());
+             var onDiskGraph = new OnDiskGraphIndex<float[]>(marr::duplicate, 0);
+             var onDiskView = onDiskGraph.getView())
+        {
+            assertEquals(VectorEncoding.FLOAT16, onDiskGraph.getVectorEncoding());
+            TestUtil.assertGraphEquals(graph, onDiskGraph);
+            var q = TestUtil.randomVector(getRandom(), dimension);
+            for (var vsf : VectorSimilarityFunction.values()) {
+                var rr = onDiskView.rerankerFor(q, vsf);
+                var sf = f16.scoreFunctionFor(q, vsf);
+                for (int i = 0; i < graph.size(); i++) {
+                    var rounded = f16.copy().vectorValue(i);
+                    assertArrayEquals(rounded, onDiskView.getVector(i), 0.0f);
+                    for (int j = 0; j < dimension; j++) {
+                        assertEquals(Float16.toFloat(Float16.fromFloat(ravv.vectorValue(i)[j])), rounded[j], 0.0f);
+                        assertEquals(ravv.vectorValue(i)[j], rounded[j], Math.abs(ravv.vectorValue(i)[j]) / 1024);
+                    }
+                    // scoring the half-precision values directly matches scoring them after conversion
+                    float expected = vsf.compare(q, rounded);
+                    assertEquals(expected, rr.similarityTo(i), 1e-5f);
+                    assertEquals(expected, sf.similarityTo(i), 1e-5f);
+                }
+            }
+        }
+
+        assertThrows(IllegalArgumentException.class,
+                     () -> OnDiskGraphIndexWriter.write(graph, ravv, null, oldToNew, VectorEncoding.BYTE, parallelPath, ForkJoinPool.commonPool()));
+    }
+
+    @Test
+    public void testMergeSegments() throws Exception {
+        int dimension = 8;
+        var vsf = VectorSimilarityFunction.EUCLIDEAN;
+        int[] segmentSizes = {300, 100, 100};
+        var segmentVectors = new ArrayList<ListRandomAccessVectorValues>();
+        var allVectors = new ArrayList<float[]>();
+        var marrs = new ArrayList<SimpleMappedReader>();
+        var segments = new ArrayList<OnDiskGraphIndex<float[]>>();
+        try {
+            for (int s = 0; s < segmentSizes.length; s++) {
+                var vectors = IntStream.range(0, segmentSizes[s]).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
+                allVectors.addAll(vectors);
+                var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+                segmentVectors.add(ravv);
+                var graph = new GraphIndexBuilder<>(ravv, VectorEncoding.FLOAT32, vsf, 8, 30, 1.2f, 1.2f).build();
+                var outputPath = testDirectory.resolve("segment" + s);
+                TestUtil.writeGraph(graph, ravv, outputPath);
+                var marr = new SimpleMappedReader(outputPath.toAbsolutePath().toString());
+                marrs.add(marr);
+                segments.add(new OnDiskGraphIndex<>(marr::duplicate, 0));
+            }
+
+            var merger = new GraphIndexMerger<>(segments, segmentVectors, VectorEncoding.FLOAT32, vsf, 8, 30, 1.2f, 1.2f);
+            var merged = merger.merge();
+            assertEquals(allVectors.size(), merged.size());
+            assertThrows(IllegalStateException.class, merger::merge);
+            for (int s = 0; s < segmentSizes.length; s++) {
+                int[] oldToNew = merger.getOldToNewOrdinals(s);
+                for (int i = 0; i < segmentSizes[s]; i++) {
+                    assertArrayEquals(segmentVectors.get(s).vectorValue(i), merger.getVectors().vectorValue(oldToNew[i]), 0.0f);
+                }
+            }
+
+            // the merged graph finds nodes from every segment
+            var mergedPath = testDirectory.resolve("merged");
+            OnDiskGraphIndexWriter.write(merged, merger.getVectors(), null, OnDiskGraphIndexWriter.getSequentialRenumbering(merged), mergedPath);
+            try (var marr = new SimpleMappedReader(mergedPath.toAbsolutePath().toString());
+                 var onDiskGraph = new OnDiskGraphIndex<float[]>(marr::duplicate, 0);
+                 var onDiskView = onDiskGraph.getView())
+            {
+                var searcher = new GraphSearcher.Builder<>(onDiskView).build();
+                int found = 0;
+                for (int i = 0; i < allVectors.size(); i++) {
+                    var q = allVectors.get(i);
+                    NodeSimilarity.ExactScoreFunction sf = j -> vsf.compare(q, allVectors.get(j));
+                    for (var ns : searcher.search(sf, null, 10, Bits.ALL).getNodes()) {
+                        if (ns.node == i) {
+                            found++;
+                            break;
+                        }
+                    }
+                }
+                assertTrue("found only " + found, found >= 0.95 * allVectors.size());
+            }
+        } finally {
+            for (var segment : segments) {
+                segment.close();
+            }
+            for (var marr : marrs) {
+                marr.close();
+            }
+        }
+    }
+
     private static void validateVectors(GraphIndex.View<float[]> view, RandomAccessVectorValues<float[]> ravv) {
         for (int i = 0; i < view.size(); i++) {
             assertArrayEquals(view.getVector(i), ravv.vectorValue(i), 0.0f);
@@ -31,11 +31,13 @@ import io.github.jbellis.jvector.exceptions.ThreadInterruptedException;
 import io.github.jbellis.jvector.util.Bits;
 import io.github.jbellis.jvector.util.BoundedLongHeap;
 import io.github.jbellis.jvector.util.FixedBitSet;
+import io.github.jbellis.jvector.util.PhysicalCoreExecutor;
 import io.github.jbellis.jvector.vector.VectorEncoding;
 import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
 import org.junit.Test;
 
 import java.util.*;
+import java.util.concurrent.ForkJoinPool;
 
 import static org.junit.Assert.*;
 import static org.junit.jupiter.api.Assertions.assertThrows;
@@ -65,12 +67,22 @@ public abstract class GraphIndexTestCase<T> extends LuceneTestCase {
     // oriented in the right directions
     @Test
     public void testAknnDiverse() {
+        testAknnDiverse(false);
+    }
+
+    @Test
+    public void testAknnDiverseInPlaceNeighbors() {
+        testAknnDiverse(true);
+    }
+
+    private void testAknnDiverse(boolean inPlaceNeighbors) {
         int nDoc = 100;
         similarityFunction = VectorSimilarityFunction.DOT_PRODUCT;
         RandomAccessVectorValues<T> vectors = circularVectorValues(nDoc);
         VectorEncoding vectorEncoding = getVectorEncoding();
         GraphIndexBuilder<T> builder =
-                new GraphIndexBuilder<>(vectors, vectorEncoding, similarityFunction, 20, 100, 1.0f, 1.4f);
+                new GraphIndexBuilder<>(vectors, vectorEncoding, similarityFunction, 20, 100, 1.0f, 1.4f,
+                                        null, PhysicalCoreExecutor.pool(), ForkJoinPool.commonPool(), inPlaceNeighbors);
         var graph = TestUtil.buildSequentially(builder, vectors);
         // run some searches
         SearchResult.NodeScore[] nn = GraphSearcher.search(getTargetVector(),
@@ -93,6 +105,7 @@ public abstract class GraphIndexTestCase<T> extends LuceneTestCase {
 
         for (int i = 0; i < nDoc; i++) {
             ConcurrentNeighborSet neighbors = graph.getNeighbors(i);
+            assertEquals(inPlaceNeighbors, neighbors instanceof InPlaceNeighborSet);
             Iterator<Integer> it = neighbors.iterator();
             while (it.hasNext()) {
                 // all neighbors should be valid node ids.
@@ -383,6 +396,126 @@ public abstract class GraphIndexTestCase<T> extends LuceneTestCase {
         assertTrue("overlap=" + overlap, overlap > 0.9);
     }
 
+    // searching into a reused SearchResultBuffer should give the same results as allocating a SearchResult
+    @Test
+    public void testSearchResultBuffer() {
+        int size = between(100, 150);
+        int dim = between(2, 15);
+        AbstractMockVectorValues<T> vectors = vectorValues(size, dim);
+        var graph = new GraphIndexBuilder<>(vectors, getVectorEncoding(), similarityFunction, 20, 30, 1.0f, 1.4f).build();
+        var searcher = new GraphSearcher.Builder<>(graph.getView()).build();
+        var buffer = new SearchResultBuffer(1);
+
+        for (int i = 0; i < 20; i++) {
+            T query = randomVector(dim);
+            NodeSimilarity.ExactScoreFunction exact = j -> {
+                if (getVectorEncoding() == VectorEncoding.BYTE) {
+                    return similarityFunction.compare((byte[]) query, (byte[]) vectors.vectorValue(j));
+                }
+                return similarityFunction.compare((float[]) query, (float[]) vectors.vectorValue(j));
+            };
+            // coarsen the exact scores to get an approximate function that needs re-ranking
+            NodeSimilarity.ApproximateScoreFunction approximate = j -> Math.round(exact.similarityTo(j) * 10) / 10.0f;
+            int topK = between(1, 20);
+
+            for (NodeSimilarity.ScoreFunction sf : List.of(exact, approximate)) {
+                var expected = searcher.search(sf, exact::similarityTo, topK, Bits.ALL);
+                searcher.search(sf, exact::similarityTo, topK, Bits.ALL, buffer);
+                assertEquals(expected.getVisitedCount(), buffer.getVisitedCount());
+                assertEquals(expected.getNodes().length, buffer.size());
+                // nodes with tied scores may come out in either order
+                var expectedNodes = new HashSet<Integer>();
+                var actualNodes = new HashSet<Integer>();
+                for (int j = 0; j < buffer.size(); j++) {
+                    assertEquals(expected.getNodes()[j].score, buffer.score(j), 0.0f);
+                    expectedNodes.add(expected.getNodes()[j].node);
+                    actualNodes.add(buffer.node(j));
+                }
+                assertEquals(expectedNodes, actualNodes);
+            }
+        }
+    }
+
+    // filters are searched with a strategy that matches their selectivity, and still give good recall
+    @Test
+    public void testFilterStrategies() {
+        int size = 1000;
+        int dim = between(2, 15);
+        AbstractMockVectorValues<T> vectors = vectorValues(size, dim);
+        var graph = new GraphIndexBuilder<>(vectors, getVectorEncoding(), similarityFunction, 20, 30, 1.0f, 1.4f).build();
+        var searcher = new GraphSearcher.Builder<>(graph.getView()).withFilterThresholds(20, 0.2f).build();
+
+        var tiny = new FixedBitSet(size);
+        for (int i = 0; i < size; i += 100) {
+            tiny.set(i);
+        }
+        var half = new FixedBitSet(size);
+        for (int i = 0; i < size; i += 2) {
+            half.set(i);
+        }
+        // not a BitSet, so its selectivity is estimated by sampling
+        Bits tenPercent = new Bits() {
+            @Override
+            public boolean get(int index) {
+                return index % 10 == 3;
+            }
+
+            @Override
+            public int length() {
+                return size;
+            }
+        };
+        var cases = Map.of(Bits.ALL, SearchResult.Strategy.GRAPH,
+                           half, SearchResult.Strategy.GRAPH,
+                           tiny, SearchResult.Strategy.BRUTE_FORCE,
+                           tenPercent, SearchResult.Strategy.TWO_HOP);
+
+        int topK = 5;
+        for (var e : cases.entrySet()) {
+            Bits acceptOrds = e.getKey();
+            int totalMatches = 0;
+            for (int i = 0; i < 20; i++) {
+                T query = randomVector(dim);
+                NodeSimilarity.ExactScoreFunction exact = j -> {
+                    if (getVectorEncoding() == VectorEncoding.BYTE) {
+                        return similarityFunction.compare((byte[]) query, (byte[]) vectors.vectorValue(j));
+                    }
+                    return similarityFunction.compare((float[]) query, (float[]) vectors.vectorValue(j));
+                };
+                var result = searcher.search(exact, null, topK, acceptOrds);
+                assertEquals(e.getValue(), result.getStrategy());
+
+                NodeQueue expected = new NodeQueue(new BoundedLongHeap(topK), NodeQueue.Order.MIN_HEAP);
+                for (int j = 0; j < size; j++) {
+                    if (acceptOrds.get(j)) {
+                        expected.push(j, exact.similarityTo(j));
+                    }
+                }
+                var actualNodeIds = Arrays.stream(result.getNodes()).mapToInt(nodeScore -> nodeScore.node).toArray();
+                for (int node : actualNodeIds) {
+                    assertTrue("the results include a rejected node: " + node, acceptOrds.get(node));
+                }
+                assertEquals(topK, actualNodeIds.length);
+                totalMatches += computeOverlap(actualNodeIds, expected.nodesCopy());
+            }
+            double overlap = totalMatches / (double) (20 * topK);
+            assertTrue(e.getValue() + " overlap=" + overlap, overlap > 0.9);
+        }
+
+        // the whole graph is under the default brute-force threshold, but filters that accept much of it are
+        // still searched rather than scanned
+        var defaults = new GraphSearcher.Builder<>(graph.getView()).build();
+        T query = randomVector(dim);
+        NodeSimilarity.ExactScoreFunction exact = j -> {
+            if (getVectorEncoding() == VectorEncoding.BYTE) {
+                return similarityFunction.compare((byte[]) query, (byte[]) vectors.vectorValue(j));
+            }
+            return similarityFunction.compare((float[]) query, (float[]) vectors.vectorValue(j));
+        };
+        assertEquals(SearchResult.Strategy.GRAPH, defaults.search(exact, null, topK, half).getStrategy());
+        assertEquals(SearchResult.Strategy.BRUTE_FORCE, defaults.search(exact, null, topK, tiny).getStrategy());
+    }
+
     private int computeOverlap(int[] a, int[] b) {
         Arrays.sort(a);
         Arrays.sort(b);
@@ -0,0 +1,144 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.graph;
+
+import com.carrotsearch.randomizedtesting.annotations.ThreadLeakScope;
+import io.github.jbellis.jvector.LuceneTestCase;
+import io.github.jbellis.jvector.disk.SimpleMappedReader;
+import io.github.jbellis.jvector.vector.VectorEncoding;
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
+import org.junit.Test;
+
+import java.io.ByteArrayOutputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.StandardOpenOption;
+import java.util.ArrayList;
+import java.util.Set;
+import java.util.concurrent.atomic.AtomicBoolean;
+
+import static io.github.jbellis.jvector.TestUtil.assertGraphEquals;
+import static io.github.jbellis.jvector.TestUtil.getNeighborNodes;
+import static io.github.jbellis.jvector.graph.GraphIndexTestCase.createRandomFloatVectors;
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+
+@ThreadLeakScope(ThreadLeakScope.Scope.NONE)
+public class TestBuildCheckpoints extends LuceneTestCase {
+    private static GraphIndexBuilder<float[]> newBuilder(RandomAccessVectorValues<float[]> ravv) {
+        return new GraphIndexBuilder<>(ravv, VectorEncoding.FLOAT32, VectorSimilarityFunction.COSINE, 8, 30, 1.2f, 1.2f);
+    }
+
+    private static int checkpoint(GraphIndexBuilder<float[]> builder, Path log) throws IOException {
+        try (var out = new DataOutputStream(Files.newOutputStream(log, StandardOpenOption.CREATE, StandardOpenOption.APPEND))) {
+            return builder.checkpoint(out);
+        }
+    }
+
+    private static int resume(GraphIndexBuilder<float[]> builder, Path log) throws IOException {
+        try (var reader = new SimpleMappedReader(log.toAbsolutePath().toString())) {
+            return builder.resume(reader, Files.size(log));
+        }
+    }
+
+    @Test
+    public void testCheckpointAndResume() throws IOException {
+        var ravv = MockVectorValues.fromValues(createRandomFloatVectors(1000, 4, getRandom()));
+        var log = Files.createTempDirectory(getClass().getSimpleName()).resolve("checkpoints");
+
+        var builder = newBuilder(ravv);
+        for (int i = 0; i < 400; i++) {
+            builder.addGraphNode(i, ravv);
+        }
+        assertEquals(400, checkpoint(builder, log));
+        for (int i = 400; i < 500; i++) {
+            builder.addGraphNode(i, ravv);
+        }
+        builder.markNodeDeleted(7);
+        // the new nodes, and the older ones they were linked to, but not the rest
+        int written = checkpoint(builder, log);
+        assertTrue(written >= 100 && written < 500);
+        assertEquals(0, checkpoint(builder, log));
+        var checkpointed = new ArrayList<Set<Integer>>();
+        for (int i = 0; i < 500; i++) {
+            checkpointed.add(getNeighborNodes(builder.getGraph().getView(), i));
+        }
+        int entryNode = builder.getGraph().getView().entryNode();
+
+        // a checkpoint that was cut short is skipped
+        builder.addGraphNode(500, ravv);
+        var record = new ByteArrayOutputStream();
+        builder.checkpoint(new DataOutputStream(record));
+        try (var out = Files.newOutputStream(log, StandardOpenOption.APPEND)) {
+            out.write(record.toByteArray(), 0, record.size() / 2);
+        }
+
+        var resumed = newBuilder(ravv);
+        assertEquals(500, resume(resumed, log));
+        assertEquals(500, resumed.getGraph().size());
+        assertTrue(resumed.getGraph().getDeletedNodes().get(7));
+        assertEquals(entryNode, resumed.getGraph().getView().entryNode());
+        for (int i = 0; i < 500; i++) {
+            assertEquals(checkpointed.get(i), getNeighborNodes(resumed.getGraph().getView(), i));
+        }
+
+        // carry on with the build, appending to the same log after the partial checkpoint;
+        // cleanup() removes the deleted node
+        resumed.build();
+        assertEquals(ravv.size() - 1, resumed.getGraph().size());
+        assertTrue(checkpoint(resumed, log) < ravv.size());
+        var again = newBuilder(ravv);
+        assertEquals(7, resume(again, log));
+        assertGraphEquals(resumed.getGraph(), again.getGraph());
+    }
+
+    @Test
+    public void testCheckpointDuringInserts() throws Exception {
+        var ravv = MockVectorValues.fromValues(createRandomFloatVectors(2000, 4, getRandom()));
+        var log = Files.createTempDirectory(getClass().getSimpleName()).resolve("checkpoints");
+        var builder = newBuilder(ravv);
+
+        var done = new AtomicBoolean();
+        var inserts = new Thread(() -> {
+            builder.build();
+            done.set(true);
+        });
+        inserts.start();
+        while (!done.get()) {
+            checkpoint(builder, log);
+        }
+        inserts.join();
+
+        // whatever the last complete checkpoint caught, the restored graph only links to nodes it contains
+        var resumed = newBuilder(ravv);
+        resume(resumed, log);
+        var graph = resumed.getGraph();
+        var view = graph.getView();
+        for (var it = graph.getNodes(); it.hasNext(); ) {
+            for (var neighbors = view.getNeighborsIterator(it.nextInt()); neighbors.hasNext(); ) {
+                assertTrue(graph.containsNode(neighbors.nextInt()));
+            }
+        }
+        assertTrue(graph.containsNode(view.entryNode()));
+
+        // and resuming the build adds the rest
+        resumed.build();
+        assertEquals(ravv.size(), graph.size());
+    }
+}
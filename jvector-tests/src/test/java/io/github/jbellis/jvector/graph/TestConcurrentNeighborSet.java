@@ -121,6 +121,61 @@ public class TestConcurrentNeighborSet extends RandomizedTest {
     assertEquals(2, neighbors.size());
   }
 
+  @Test
+  public void testInPlaceMatchesCopyOnWrite() {
+    var similarityFunction = VectorSimilarityFunction.DOT_PRODUCT;
+    var vectors = new GraphIndexTestCase.CircularFloatVectorValues(100);
+    var vectorsCopy = vectors.copy();
+    NodeSimilarity scoreBetween = a -> {
+      return (NodeSimilarity.ExactScoreFunction) b -> similarityFunction.compare(vectors.vectorValue(a), vectorsCopy.vectorValue(b));
+    };
+
+    // the same inserts, pruned at the same points, leave the same neighbors
+    var copyOnWrite = new ConcurrentNeighborSet(0, 8, scoreBetween, 1.2f);
+    var inPlace = new InPlaceNeighborSet(0, 8, scoreBetween, 1.2f, 1.5f);
+    for (int i = 0; i < 200; i++) {
+      int node = between(1, 99);
+      copyOnWrite.insert(node, scoreBetween.score(0, node), 1.5f);
+      inPlace.insert(node, scoreBetween.score(0, node), 1.5f);
+    }
+    copyOnWrite.cleanup();
+    inPlace.cleanup();
+    assertEquals(copyOnWrite.size(), inPlace.size());
+    assertArrayEquals(copyOnWrite.getCurrent().copyDenseNodes(), inPlace.getCurrent().copyDenseNodes());
+    validateSortedByScore(inPlace.getCurrent());
+    assertEquals(copyOnWrite.size(), inPlace.copy().size());
+  }
+
+  @Test
+  public void testInPlaceConcurrentInserts() throws InterruptedException {
+    // with no room for pruning to kick in, every insert from every thread must land
+    int threadCount = 8;
+    int perThread = 500;
+    NodeSimilarity scoreBetween = a -> (NodeSimilarity.ExactScoreFunction) b -> 1.0f / (1 + Math.abs(a - b));
+    var neighbors = new InPlaceNeighborSet(0, threadCount * perThread, scoreBetween, 1.0f, 1.0f);
+    var threads = new Thread[threadCount];
+    for (int t = 0; t < threadCount; t++) {
+      int first = 1 + t * perThread;
+      threads[t] = new Thread(() -> {
+        for (int node = first; node < first + perThread; node++) {
+          neighbors.insert(node, scoreBetween.score(0, node), 1.0f);
+          // readers see a consistent snapshot while the writes are in flight
+          validateSortedByScore(neighbors.getCurrent());
+        }
+      });
+      threads[t].start();
+    }
+    for (var thread : threads) {
+      thread.join();
+    }
+
+    assertEquals(threadCount * perThread, neighbors.size());
+    var it = neighbors.iterator();
+    for (int expected = 1; it.hasNext(); expected++) {
+      assertEquals(expected, it.nextInt());
+    }
+  }
+
   @Test
   public void testNoDuplicatesDescOrder() {
     NodeArray cna = new NodeArray(5);
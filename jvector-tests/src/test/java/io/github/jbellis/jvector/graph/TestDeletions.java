@@ -30,13 +30,19 @@ import java.io.IOException;
 import java.nio.file.Files;
 import java.nio.file.Path;
 import java.util.Arrays;
+import java.util.HashSet;
+import java.util.concurrent.ForkJoinPool;
+import java.util.stream.IntStream;
 import java.util.function.Function;
 
 import static io.github.jbellis.jvector.TestUtil.assertGraphEquals;
 import static io.github.jbellis.jvector.TestUtil.openFileForWriting;
 import static io.github.jbellis.jvector.graph.GraphIndexTestCase.createRandomFloatVectors;
 import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertFalse;
 import static org.junit.Assert.assertNotEquals;
+import static org.junit.Assert.assertThrows;
+import static org.junit.Assert.assertTrue;
 
 @ThreadLeakScope(ThreadLeakScope.Scope.NONE)
 public class TestDeletions extends LuceneTestCase {
@@ -130,4 +136,113 @@ public class TestDeletions extends LuceneTestCase {
 
         assertEquals(0, graph.size());
     }
+
+    @Test
+    public void testIncrementalRepair() {
+        int dimension = 8;
+        var ravv = MockVectorValues.fromValues(createRandomFloatVectors(250, dimension, getRandom()));
+        var vsf = VectorSimilarityFunction.EUCLIDEAN;
+        var builder = new GraphIndexBuilder<>(ravv, VectorEncoding.FLOAT32, vsf, 8, 30, 1.2f, 1.2f);
+        var graph = builder.getGraph();
+        for (int i = 0; i < 200; i++) {
+            builder.addGraphNode(i, ravv);
+        }
+        assertTrue(builder.repairDeletions(ForkJoinPool.commonPool(), 50));
+        assertThrows(IllegalArgumentException.class, () -> builder.repairDeletions(ForkJoinPool.commonPool(), 0));
+
+        var deleted = new HashSet<Integer>();
+        while (deleted.size() < 20) {
+            int n = getRandom().nextInt(200);
+            if (deleted.add(n)) {
+                builder.markNodeDeleted(n);
+            }
+        }
+
+        // interleave repair with inserts; each call examines 50 of the 200 nodes present when the pass began
+        int calls = 0;
+        int nextNode = 200;
+        boolean done = false;
+        while (!done) {
+            done = builder.repairDeletions(ForkJoinPool.commonPool(), 50);
+            calls++;
+            for (int i = 0; i < 10 && nextNode < ravv.size(); i++) {
+                builder.addGraphNode(nextNode++, ravv);
+            }
+        }
+        assertEquals(4, calls);
+        assertEquals(nextNode - deleted.size(), graph.size());
+
+        // nothing links to the removed nodes, and the rest are still reachable
+        var view = graph.getView();
+        for (var it = graph.getNodes(); it.hasNext(); ) {
+            int node = it.nextInt();
+            assertFalse(deleted.contains(node));
+            for (var neighbors = view.getNeighborsIterator(node); neighbors.hasNext(); ) {
+                assertFalse(deleted.contains(neighbors.nextInt()));
+            }
+        }
+        int found = 0;
+        for (var it = graph.getNodes(); it.hasNext(); ) {
+            int node = it.nextInt();
+            var results = GraphSearcher.search(ravv.vectorValue(node), 10, ravv, VectorEncoding.FLOAT32, vsf, graph, Bits.ALL);
+            for (var ns : results.getNodes()) {
+                if (ns.node == node) {
+                    found++;
+                    break;
+                }
+            }
+        }
+        assertTrue("found only " + found, found >= 0.95 * graph.size());
+    }
+
+    // inserts running on other threads while a pass removes nodes never link to the removed nodes
+    @Test
+    public void testRepairDuringConcurrentInserts() throws Exception {
+        int dimension = 8;
+        // unlike MockVectorValues, safe to read from the inserting threads
+        var ravv = new ListRandomAccessVectorValues(Arrays.asList(createRandomFloatVectors(2000, dimension, getRandom())), dimension);
+        var vsf = VectorSimilarityFunction.EUCLIDEAN;
+        var builder = new GraphIndexBuilder<>(ravv, VectorEncoding.FLOAT32, vsf, 8, 30, 1.2f, 1.2f);
+        var graph = builder.getGraph();
+        for (int i = 0; i < 500; i++) {
+            builder.addGraphNode(i, ravv);
+        }
+
+        var deleted = new HashSet<Integer>();
+        var inserters = new ForkJoinPool(4);
+        try {
+            for (int round = 0; round < 3; round++) {
+                int first = 500 * (round + 1);
+                var upperBound = graph.getIdUpperBound();
+                while (deleted.size() < 30 * (round + 1)) {
+                    int n = getRandom().nextInt(upperBound);
+                    if (graph.containsNode(n) && deleted.add(n)) {
+                        builder.markNodeDeleted(n);
+                    }
+                }
+
+                var inserts = inserters.submit(() -> IntStream.range(first, first + 500).parallel().forEach(i -> builder.addGraphNode(i, ravv)));
+                // small slices, so that the pass ends (and removes the nodes) while inserts are running
+                while (!inserts.isDone()) {
+                    builder.repairDeletions(ForkJoinPool.commonPool(), 25);
+                }
+                inserts.get();
+                while (!builder.repairDeletions(ForkJoinPool.commonPool(), 100)) {
+                    // finish the pass
+                }
+            }
+        } finally {
+            inserters.shutdownNow();
+        }
+
+        assertEquals(2000 - deleted.size(), graph.size());
+        var view = graph.getView();
+        for (var it = graph.getNodes(); it.hasNext(); ) {
+            int node = it.nextInt();
+            for (var neighbors = view.getNeighborsIterator(node); neighbors.hasNext(); ) {
+                int neighbor = neighbors.nextInt();
+                assertTrue(node + " links to removed node " + neighbor, graph.containsNode(neighbor));
+            }
+        }
+    }
 }
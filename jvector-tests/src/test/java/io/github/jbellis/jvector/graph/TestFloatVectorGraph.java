@@ -26,14 +26,25 @@ package io.github.jbellis.jvector.graph;
 
 import com.carrotsearch.randomizedtesting.RandomizedTest;
 import io.github.jbellis.jvector.TestUtil;
+import io.github.jbellis.jvector.pq.BQVectors;
+import io.github.jbellis.jvector.pq.BinaryQuantization;
+import io.github.jbellis.jvector.pq.PQVectors;
+import io.github.jbellis.jvector.pq.ProductQuantization;
+import io.github.jbellis.jvector.util.Bits;
 import io.github.jbellis.jvector.util.FixedBitSet;
 import io.github.jbellis.jvector.vector.VectorEncoding;
 import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
 import org.junit.Before;
 
 import java.util.Arrays;
+import java.util.Comparator;
+import java.util.stream.Collectors;
+import java.util.stream.IntStream;
 
 import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertNull;
+import static org.junit.Assert.assertSame;
+import static org.junit.Assert.assertThrows;
 import static org.junit.Assert.assertTrue;
 
 /**
@@ -112,4 +123,106 @@ public class TestFloatVectorGraph extends GraphIndexTestCase<float[]> {
         // are closest to the query vector: sum(500,509) = 5045
         assertTrue("sum(result docs)=" + sum, sum < 5100);
     }
+
+    public void testBuildWithCompressedVectors() {
+        int dimension = 16;
+        var vectors = IntStream.range(0, 1000).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+        var pq = ProductQuantization.compute(ravv, 8, false);
+        var pqv = new PQVectors(pq, pq.encodeAll(vectors));
+        similarityFunction = VectorSimilarityFunction.EUCLIDEAN;
+
+        assertThrows(IllegalArgumentException.class,
+                     () -> new GraphIndexBuilder<>(ravv, VectorEncoding.BYTE, similarityFunction, 16, 50, 1.2f, 1.2f, pqv));
+        var builder = new GraphIndexBuilder<>(ravv, VectorEncoding.FLOAT32, similarityFunction, 16, 50, 1.2f, 1.2f, pqv);
+        var graph = builder.build();
+
+        // neighbor scores are exact even though candidates were found with PQ
+        for (int i = 0; i < 10; i++) {
+            var neighbors = graph.getNeighbors(i).getCurrent();
+            for (int j = 0; j < neighbors.size; j++) {
+                assertEquals(similarityFunction.compare(ravv.vectorValue(i), ravv.vectorValue(neighbors.node[j])), neighbors.score[j], 1e-6f);
+            }
+        }
+
+        // and searching the graph with exact scores finds the true nearest neighbors
+        int topK = 10;
+        int found = 0;
+        int queries = 50;
+        for (int i = 0; i < queries; i++) {
+            var q = TestUtil.randomVector(getRandom(), dimension);
+            var expected = IntStream.range(0, ravv.size()).boxed()
+                    .sorted(Comparator.comparingDouble(n -> -similarityFunction.compare(q, ravv.vectorValue(n))))
+                    .limit(topK)
+                    .collect(Collectors.toSet());
+            var result = GraphSearcher.search(q, topK, ravv, VectorEncoding.FLOAT32, similarityFunction, graph, Bits.ALL);
+            for (var ns : result.getNodes()) {
+                if (expected.contains(ns.node)) {
+                    found++;
+                }
+            }
+        }
+        double recall = (double) found / (queries * topK);
+        assertTrue("recall " + recall, recall > 0.9);
+    }
+
+    public void testRerankingPipeline() {
+        int dimension = 64;
+        var vectors = IntStream.range(0, 1000).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+        similarityFunction = VectorSimilarityFunction.DOT_PRODUCT;
+        var graph = new GraphIndexBuilder<>(ravv, VectorEncoding.FLOAT32, similarityFunction, 16, 50, 1.2f, 1.2f).build();
+        var bq = BinaryQuantization.compute(ravv);
+        var bqv = new BQVectors(bq, bq.encodeAll(vectors));
+        var pq = ProductQuantization.compute(ravv, 16, false);
+        var pqv = new PQVectors(pq, pq.encodeAll(vectors));
+        var searcher = new GraphSearcher.Builder<>(graph.getView()).build();
+
+        int topK = 10;
+        var q = TestUtil.randomVector(getRandom(), dimension);
+        NodeSimilarity.ReRanker exact = n -> similarityFunction.compare(q, ravv.vectorValue(n));
+        var pqScores = pqv.approximateScoreFunctionFor(q, similarityFunction);
+        int[] exactCalls = new int[1];
+        var pipeline = RerankingPipeline.traverseWith(bqv.approximateScoreFunctionFor(q, similarityFunction))
+                .thenRerank(pqScores::similarityTo, 8)
+                .thenRerank(n -> { exactCalls[0]++; return exact.similarityTo(n); }, 2)
+                .build();
+        assertEquals(3, pipeline.stageCount());
+
+        var stageNanos = new long[3];
+        var result = pipeline.search(searcher, topK, Bits.ALL, stageNanos);
+        var nodes = result.getNodes();
+        assertEquals(topK, nodes.length);
+        // only 2 * topK candidates were scored exactly, and the results carry the exact scores, best-first
+        assertEquals(2 * topK, exactCalls[0]);
+        for (int i = 0; i < nodes.length; i++) {
+            assertEquals(exact.similarityTo(nodes[i].node), nodes[i].score, 0);
+            if (i > 0) {
+                assertTrue(nodes[i - 1].score >= nodes[i].score);
+            }
+        }
+        assertTrue(result.getVisitedCount() > 0);
+        assertTrue(Arrays.stream(stageNanos).allMatch(t -> t > 0));
+
+        assertThrows(IllegalArgumentException.class, () -> RerankingPipeline.traverseWith(pqScores).build());
+        assertThrows(IllegalArgumentException.class, () -> RerankingPipeline.traverseWith(pqScores).thenRerank(exact, 0.5f));
+    }
+
+    public void testBuildCounters() {
+        int dimension = 16;
+        var vectors = IntStream.range(0, 500).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+        var builder = new GraphIndexBuilder<>(ravv, VectorEncoding.FLOAT32, similarityFunction, 16, 50, 1.2f, 1.2f);
+        assertNull(builder.getCounters());
+        var counters = builder.enableCounters();
+        assertSame(counters, builder.getCounters());
+        builder.build();
+
+        assertEquals(vectors.size(), counters.insertCount());
+        assertTrue(counters.phaseNanos(BuildCounters.Phase.SEARCH) > 0);
+        assertTrue(counters.phaseNanos(BuildCounters.Phase.INSERT_DIVERSE) > 0);
+        assertTrue(counters.maxConcurrentCandidateCount() <= counters.concurrentCandidateCount());
+        assertTrue(counters.neighborUpdateRetryCount() >= 0);
+        assertTrue(counters.cleanupNanos() > 0);
+    }
 }
@@ -0,0 +1,127 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.graph;
+
+import com.carrotsearch.randomizedtesting.RandomizedTest;
+import com.carrotsearch.randomizedtesting.annotations.ThreadLeakScope;
+import io.github.jbellis.jvector.util.Bits;
+import io.github.jbellis.jvector.util.BoundedLongHeap;
+import io.github.jbellis.jvector.util.NumaTopology;
+import io.github.jbellis.jvector.vector.VectorEncoding;
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
+import org.junit.Test;
+
+import java.util.Arrays;
+import java.util.List;
+import java.util.stream.Collectors;
+
+import static io.github.jbellis.jvector.graph.GraphIndexTestCase.createRandomFloatVectors;
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+
+@ThreadLeakScope(ThreadLeakScope.Scope.NONE)
+public class TestShardedGraphIndex extends RandomizedTest {
+    private static final VectorSimilarityFunction similarityFunction = VectorSimilarityFunction.EUCLIDEAN;
+
+    @Test
+    public void testSearch() {
+        int size = 2000;
+        int dim = 8;
+        int topK = 10;
+        var ravv = MockVectorValues.fromValues(createRandomFloatVectors(size, dim, getRandom()));
+        int shardCount = Math.min(3, Runtime.getRuntime().availableProcessors());
+        try (var index = ShardedGraphIndex.build(ravv, VectorEncoding.FLOAT32, similarityFunction, 16, 100, 1.2f, 1.2f,
+                                                 NumaTopology.uniform(shardCount))) {
+            assertEquals(shardCount, index.shardCount());
+            assertEquals(0, index.base(0));
+            assertEquals(size, index.base(shardCount));
+            for (int i = 0; i < shardCount; i++) {
+                assertEquals(index.base(i + 1) - index.base(i), index.getShard(i).size());
+            }
+
+            // only accept odd ordinals, so that acceptOrds has to be translated for every shard
+            Bits acceptOrds = new Bits() {
+                @Override
+                public boolean get(int index) {
+                    return index % 2 == 1;
+                }
+
+                @Override
+                public int length() {
+                    return size;
+                }
+            };
+            int matches = 0;
+            for (int i = 0; i < 50; i++) {
+                var query = randomVector(dim);
+                var result = index.search(query, topK, acceptOrds);
+                assertEquals(topK, result.getNodes().length);
+                for (int j = 0; j < topK; j++) {
+                    var ns = result.getNodes()[j];
+                    assertTrue(acceptOrds.get(ns.node));
+                    // scores are by global ordinal
+                    assertEquals(similarityFunction.compare(query, ravv.vectorValue(ns.node)), ns.score, 1e-6);
+                    if (j > 0) {
+                        assertTrue(result.getNodes()[j - 1].score >= ns.score);
+                    }
+                }
+
+                var expected = new NodeQueue(new BoundedLongHeap(topK), NodeQueue.Order.MIN_HEAP);
+                for (int j = 0; j < size; j++) {
+                    if (acceptOrds.get(j)) {
+                        expected.push(j, similarityFunction.compare(query, ravv.vectorValue(j)));
+                    }
+                }
+                List<Integer> expectedNodes = Arrays.stream(expected.nodesCopy()).boxed().collect(Collectors.toList());
+                matches += (int) Arrays.stream(result.getNodes()).filter(ns -> expectedNodes.contains(ns.node)).count();
+            }
+            double recall = matches / (50.0 * topK);
+            assertTrue("Recall " + recall, recall > 0.9);
+        }
+    }
+
+    @Test
+    public void testExistingShards() {
+        int dim = 4;
+        var first = MockVectorValues.fromValues(createRandomFloatVectors(100, dim, getRandom()));
+        var second = MockVectorValues.fromValues(createRandomFloatVectors(50, dim, getRandom()));
+        var graphs = List.of(buildGraph(first), buildGraph(second));
+        try (var index = new ShardedGraphIndex<>(graphs, List.of(first, second), VectorEncoding.FLOAT32,
+                                                 similarityFunction, NumaTopology.singleNode())) {
+            assertEquals(100, index.base(1));
+            assertEquals(0, index.numaNode(1));
+            // each vector is its own nearest neighbor, by global ordinal
+            for (int node : new int[] { 0, 99, 100, 149 }) {
+                var query = node < 100 ? first.vectorValue(node) : second.vectorValue(node - 100);
+                var result = index.search(query, 10, Bits.ALL);
+                assertEquals(node, result.getNodes()[0].node);
+            }
+        }
+    }
+
+    private static OnHeapGraphIndex<float[]> buildGraph(RandomAccessVectorValues<float[]> ravv) {
+        return new GraphIndexBuilder<>(ravv, VectorEncoding.FLOAT32, similarityFunction, 8, 50, 1.2f, 1.2f).build();
+    }
+
+    private static float[] randomVector(int dim) {
+        float[] v = new float[dim];
+        for (int i = 0; i < dim; i++) {
+            v[i] = getRandom().nextFloat();
+        }
+        return v;
+    }
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package io.github.jbellis.jvector.microbench;
+
+import java.io.IOException;
+import java.util.List;
+import java.util.Random;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.TimeUnit;
+import java.util.stream.Collectors;
+import java.util.stream.IntStream;
+
+import io.github.jbellis.jvector.TestUtil;
+import io.github.jbellis.jvector.example.util.SiftLoader;
+import io.github.jbellis.jvector.graph.GraphIndexBuilder;
+import io.github.jbellis.jvector.graph.ListRandomAccessVectorValues;
+import io.github.jbellis.jvector.vector.VectorEncoding;
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Param;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+import org.openjdk.jmh.infra.Blackhole;
+
+/**
+ * Sweeps graph construction over thread count, dataset (and so dimension), M, and beamWidth, to show where
+ * build throughput stops scaling.  With counters=true, each build also prints the builder's
+ * {@link io.github.jbellis.jvector.graph.BuildCounters}, which say whether the time went to searching, pruning,
+ * backlinking, or contention.  For example:
+ * <pre>
+ *     java -jar target/benchmarks.jar GraphBuildScalingBench -p threads=8,32,64 -p dataset=random-128 -p counters=true
+ * </pre>
+ * The siftsmall dataset is read from siftsmall/siftsmall_base.fvecs, as in SiftSmall.
+ */
+@Warmup(iterations = 1)
+@Measurement(iterations = 3)
+@Fork(warmups = 0, value = 1, jvmArgsAppend = {"--add-modules=jdk.incubator.vector", "--enable-preview"})
+public class GraphBuildScalingBench {
+
+    @State(Scope.Benchmark)
+    public static class Parameters {
+        @Param({"1", "2", "4", "8", "16", "32", "64"})
+        int threads;
+
+        /** random-N is `size` random vectors of dimension N */
+        @Param({"random-16", "random-128", "random-768", "siftsmall"})
+        String dataset;
+
+        @Param({"16", "32"})
+        int M;
+
+        @Param({"50", "100"})
+        int beamWidth;
+
+        @Param({"100000"})
+        int size;
+
+        /** copy-on-write ConcurrentNeighborSet, or InPlaceNeighborSet */
+        @Param({"false", "true"})
+        boolean inPlaceNeighbors;
+
+        @Param({"false"})
+        boolean counters;
+
+        ListRandomAccessVectorValues ravv;
+        VectorSimilarityFunction similarityFunction;
+        ForkJoinPool pool;
+
+        @Setup(Level.Trial)
+        public void setup() throws IOException {
+            List<float[]> vectors;
+            if (dataset.equals("siftsmall")) {
+                vectors = SiftLoader.readFvecs("siftsmall/siftsmall_base.fvecs");
+                similarityFunction = VectorSimilarityFunction.EUCLIDEAN;
+            } else if (dataset.startsWith("random-")) {
+                int dimension = Integer.parseInt(dataset.substring("random-".length()));
+                var r = new Random(1337);
+                vectors = IntStream.range(0, size).mapToObj(i -> TestUtil.randomVector(r, dimension)).collect(Collectors.toList());
+                similarityFunction = VectorSimilarityFunction.DOT_PRODUCT;
+            } else {
+                throw new IllegalArgumentException("Unknown dataset " + dataset);
+            }
+            ravv = new ListRandomAccessVectorValues(vectors, vectors.get(0).length);
+            pool = new ForkJoinPool(threads);
+        }
+
+        @TearDown(Level.Trial)
+        public void tearDown() {
+            pool.shutdown();
+        }
+    }
+
+    @Benchmark
+    @BenchmarkMode(Mode.SingleShotTime)
+    @OutputTimeUnit(TimeUnit.MILLISECONDS)
+    public void testGraphBuild(Blackhole bh, Parameters p) {
+        var builder = new GraphIndexBuilder<>(p.ravv, VectorEncoding.FLOAT32, p.similarityFunction, p.M, p.beamWidth, 1.2f, 1.2f,
+                                              null, p.pool, ForkJoinPool.commonPool(), p.inPlaceNeighbors);
+        var counters = p.counters ? builder.enableCounters() : null;
+        bh.consume(builder.build());
+        if (counters != null) {
+            System.out.format("%n%d threads, %s, M=%d, beamWidth=%d: %s%n", p.threads, p.dataset, p.M, p.beamWidth, counters);
+        }
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package io.github.jbellis.jvector.microbench;
+
+import java.util.List;
+import java.util.Random;
+import java.util.concurrent.ThreadLocalRandom;
+import java.util.concurrent.TimeUnit;
+import java.util.stream.Collectors;
+import java.util.stream.IntStream;
+
+import io.github.jbellis.jvector.TestUtil;
+import io.github.jbellis.jvector.graph.ListRandomAccessVectorValues;
+import io.github.jbellis.jvector.graph.ShardedGraphIndex;
+import io.github.jbellis.jvector.util.Bits;
+import io.github.jbellis.jvector.util.NumaTopology;
+import io.github.jbellis.jvector.vector.VectorEncoding;
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Param;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+import org.openjdk.jmh.infra.Blackhole;
+
+/**
+ * Measures search throughput of a {@link ShardedGraphIndex} of the same vectors sharded over the first `nodes`
+ * NUMA nodes of the machine, to check that throughput scales linearly with the number of sockets.
+ * Run it with `uniform=false`, enough client threads to saturate every node, and -XX:+UseNUMA so that each
+ * shard is allocated on its node, e.g. on a dual-socket host:
+ * <pre>
+ *     java -XX:+UseNUMA -jar target/benchmarks.jar ShardedSearchBench -t 32 -p nodes=1,2 -p uniform=false
+ * </pre>
+ * By default, `uniform=true` splits the machine's CPUs into `nodes` pretend nodes instead, which runs anywhere
+ * and shows the cost of sharding itself.  With `uniform=false`, a `nodes` greater than the number of nodes
+ * detected falls back to pretend nodes too, and says so.
+ */
+@Warmup(iterations = 2, time = 5)
+@Measurement(iterations = 3, time = 10)
+@Fork(warmups = 0, value = 1, jvmArgsAppend = {"--add-modules=jdk.incubator.vector", "--enable-preview", "-XX:+UseNUMA"})
+public class ShardedSearchBench {
+
+    @State(Scope.Benchmark)
+    public static class Parameters {
+        @Param({"1", "2"})
+        int nodes;
+
+        @Param({"true"})
+        boolean uniform;
+
+        @Param({"100000"})
+        int size;
+
+        @Param({"128"})
+        int dimension;
+
+        @Param({"10"})
+        int topK;
+
+        ShardedGraphIndex<float[]> index;
+        List<float[]> queries;
+
+        @Setup(Level.Trial)
+        public void setup() {
+            var topology = uniform ? NumaTopology.uniform(nodes) : detected(nodes);
+            var r = new Random(1337);
+            var vectors = IntStream.range(0, size).mapToObj(i -> TestUtil.randomVector(r, dimension)).collect(Collectors.toList());
+            queries = IntStream.range(0, 1000).mapToObj(i -> TestUtil.randomVector(r, dimension)).collect(Collectors.toList());
+            var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+            index = ShardedGraphIndex.build(ravv, VectorEncoding.FLOAT32, VectorSimilarityFunction.DOT_PRODUCT, 16, 100, 1.2f, 1.2f, topology);
+            System.out.format("%n%s: %d shards%n", topology, index.shardCount());
+        }
+
+        @TearDown(Level.Trial)
+        public void tearDown() {
+            index.close();
+        }
+
+        private static NumaTopology detected(int nodes) {
+            var detected = NumaTopology.detect();
+            if (detected.nodeCount() < nodes) {
+                System.out.format("%nOnly %d NUMA nodes detected, using %d uniform nodes instead%n", detected.nodeCount(), nodes);
+                return NumaTopology.uniform(nodes);
+            }
+            return detected.limit(nodes);
+        }
+    }
+
+    @Benchmark
+    @BenchmarkMode(Mode.Throughput)
+    @OutputTimeUnit(TimeUnit.SECONDS)
+    public void testSearch(Blackhole bh, Parameters p) {
+        var query = p.queries.get(ThreadLocalRandom.current().nextInt(p.queries.size()));
+        bh.consume(p.index.search(query, p.topK, Bits.ALL));
+    }
+}
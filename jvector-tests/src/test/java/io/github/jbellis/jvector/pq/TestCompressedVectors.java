@@ -27,13 +27,16 @@ import org.junit.Test;
 import java.io.DataOutputStream;
 import java.io.File;
 import java.io.FileOutputStream;
+import java.util.Arrays;
 import java.util.List;
 import java.util.stream.Collectors;
 import java.util.stream.IntStream;
 
 import static java.lang.Math.abs;
 import static java.lang.Math.log;
+import static org.junit.jupiter.api.Assertions.assertArrayEquals;
 import static org.junit.jupiter.api.Assertions.assertEquals;
+import static org.junit.jupiter.api.Assertions.assertThrows;
 
 @ThreadLeakScope(ThreadLeakScope.Scope.NONE)
 public class TestCompressedVectors extends RandomizedTest {
@@ -61,6 +64,23 @@ public class TestCompressedVectors extends RandomizedTest {
         }
     }
 
+    @Test
+    public void testFlatLayout() {
+        var vectors = createRandomVectors(512, 8);
+        var pq = ProductQuantization.compute(new ListRandomAccessVectorValues(vectors, 8), 4, false);
+        var compressed = pq.encodeAll(vectors);
+        var cv = new PQVectors(pq, compressed);
+
+        assertEquals(compressed.length, cv.count());
+        assertEquals(compressed.length * 4, cv.getCompressedVectors().length);
+        for (int i = 0; i < compressed.length; i++) {
+            int offset = cv.get(i);
+            assertArrayEquals(compressed[i], Arrays.copyOfRange(cv.getCompressedVectors(), offset, offset + 4));
+        }
+        assertEquals(cv, new PQVectors(pq, cv.getCompressedVectors(), compressed.length));
+        assertThrows(IllegalArgumentException.class, () -> new PQVectors(pq, new byte[7], 2));
+    }
+
     @Test
     public void testSaveLoadBQ() throws Exception {
         // Generate a PQ for random vectors
@@ -85,6 +105,74 @@ public class TestCompressedVectors extends RandomizedTest {
         }
     }
 
+    @Test
+    public void testBatchSimilarity() {
+        int dimension = 16;
+        var vectors = createRandomVectors(512, dimension);
+        var pq = ProductQuantization.compute(new ListRandomAccessVectorValues(vectors, dimension), 8, false);
+        var cv = new PQVectors(pq, pq.encodeAll(vectors));
+
+        for (var vsf : List.of(VectorSimilarityFunction.EUCLIDEAN, VectorSimilarityFunction.DOT_PRODUCT, VectorSimilarityFunction.COSINE)) {
+            var q = TestUtil.randomVector(getRandom(), dimension);
+            var f = cv.approximateScoreFunctionFor(q, vsf);
+            int count = between(1, 50);
+            int[] nodes = IntStream.range(0, count).map(i -> between(0, vectors.size() - 1)).toArray();
+            float[] results = new float[count];
+            f.similarityTo(nodes, count, results);
+            for (int i = 0; i < count; i++) {
+                assertEquals(f.similarityTo(nodes[i]), results[i]);
+            }
+        }
+    }
+
+    @Test
+    public void testSaveLoadSQ() throws Exception {
+        for (int bits : new int[] {8, 4}) {
+            var vectors = createRandomVectors(512, 17);
+            var sq = ScalarQuantization.compute(new ListRandomAccessVectorValues(vectors, 17), bits);
+            var cv = new SQVectors(sq, sq.encodeAll(vectors));
+            assertEquals(17 * Float.BYTES, cv.getOriginalSize());
+            assertEquals(bits == 8 ? 17 : 9, cv.getCompressedSize());
+
+            File cvFile = File.createTempFile("sqtest", ".cv");
+            try (var out = new DataOutputStream(new FileOutputStream(cvFile))) {
+                cv.write(out);
+            }
+            try (var in = new SimpleMappedReader(cvFile.getAbsolutePath())) {
+                var cv2 = SQVectors.load(in, 0);
+                assertEquals(cv, cv2);
+            }
+        }
+    }
+
+    @Test
+    public void testSQEncodings() {
+        // an odd dimension leaves the last SQ4 byte half empty
+        int dimension = 37;
+        var vectors = createRandomVectors(512, dimension);
+        var ravv = new ListRandomAccessVectorValues(vectors, dimension);
+        var errors = new double[2];
+        for (int b = 0; b < 2; b++) {
+            var sq = ScalarQuantization.compute(ravv, b == 0 ? 8 : 4);
+            var cv = new SQVectors(sq, sq.encodeAll(vectors));
+            var decoded = new float[dimension];
+            for (var vsf : List.of(VectorSimilarityFunction.EUCLIDEAN, VectorSimilarityFunction.DOT_PRODUCT, VectorSimilarityFunction.COSINE)) {
+                var q = TestUtil.randomVector(getRandom(), dimension);
+                var f = cv.approximateScoreFunctionFor(q, vsf);
+                var rr = cv.rerankerFor(q, vsf);
+                for (int j = 0; j < vectors.size(); j++) {
+                    // scoring on the codes gives the similarity to the decoded vector
+                    sq.decode(cv.getCompressedVectors(), cv.get(j), decoded);
+                    assertEquals(vsf.compare(q, decoded), f.similarityTo(j), 1e-4);
+                    assertEquals(f.similarityTo(j), rr.similarityTo(j));
+                    errors[b] += abs(f.similarityTo(j) - vsf.compare(q, vectors.get(j)));
+                }
+            }
+        }
+        assert errors[0] < errors[1] : String.format("SQ8 error %s should be less than SQ4 error %s", errors[0], errors[1]);
+        assert errors[0] / (3 * vectors.size()) < 0.005 : "SQ8 mean error " + errors[0] / (3 * vectors.size());
+    }
+
     private static List<float[]> createRandomVectors(int count, int dimension) {
         return IntStream.range(0, count).mapToObj(i -> TestUtil.randomVector(getRandom(), dimension)).collect(Collectors.toList());
     }
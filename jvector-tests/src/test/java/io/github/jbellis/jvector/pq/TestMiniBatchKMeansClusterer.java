@@ -0,0 +1,83 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.pq;
+
+import com.carrotsearch.randomizedtesting.RandomizedTest;
+import com.carrotsearch.randomizedtesting.annotations.ThreadLeakScope;
+import io.github.jbellis.jvector.vector.VectorUtil;
+import org.junit.Test;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertThrows;
+import static org.junit.Assert.assertTrue;
+
+@ThreadLeakScope(ThreadLeakScope.Scope.NONE)
+public class TestMiniBatchKMeansClusterer extends RandomizedTest {
+    @Test
+    public void testSeparatedClusters() {
+        // 8 tight, well-separated blobs in 4 dimensions
+        int dimension = 4;
+        int k = 8;
+        var centers = new float[k * dimension];
+        for (int c = 0; c < k; c++) {
+            for (int j = 0; j < dimension; j++) {
+                centers[c * dimension + j] = 100 * ((c >> (j % 3)) & 1) + (j == 3 ? 100 * c : 0);
+            }
+        }
+        int pointCount = 20_000;
+        var points = new float[pointCount * dimension];
+        for (int i = 0; i < pointCount; i++) {
+            int c = i % k;
+            for (int j = 0; j < dimension; j++) {
+                points[i * dimension + j] = centers[c * dimension + j] + (float) getRandom().nextGaussian();
+            }
+        }
+
+        var clusterer = new MiniBatchKMeansClusterer(points, dimension, k, getRandom());
+        var centroids = clusterer.cluster(100);
+        // every blob is found
+        for (int c = 0; c < k; c++) {
+            float nearest = Float.MAX_VALUE;
+            for (int i = 0; i < k; i++) {
+                nearest = Math.min(nearest, VectorUtil.squareDistance(centers, c * dimension, centroids, i * dimension, dimension));
+            }
+            assertTrue("blob " + c + " is " + nearest + " from the nearest centroid", nearest < 1);
+        }
+        // and the clustering converges well before 100 epochs' worth of batches
+        assertTrue(clusterer.getBatchCount() < 100 * pointCount / 1024);
+    }
+
+    @Test
+    public void testOneClusterPerPoint() {
+        var points = new float[] {1, 2, 3, 4, 5, 6};
+        var centroids = new MiniBatchKMeansClusterer(points, 2, 3, getRandom()).cluster(10);
+        var found = new boolean[3];
+        for (int c = 0; c < 3; c++) {
+            int p = (int) (centroids[2 * c] - 1) / 2;
+            assertEquals(points[2 * p], centroids[2 * c], 0);
+            assertEquals(points[2 * p + 1], centroids[2 * c + 1], 0);
+            found[p] = true;
+        }
+        assertTrue(found[0] && found[1] && found[2]);
+    }
+
+    @Test
+    public void testInvalidArguments() {
+        assertThrows(IllegalArgumentException.class, () -> new MiniBatchKMeansClusterer(new float[5], 2, 1));
+        assertThrows(IllegalArgumentException.class, () -> new MiniBatchKMeansClusterer(new float[4], 2, 3));
+    }
+}
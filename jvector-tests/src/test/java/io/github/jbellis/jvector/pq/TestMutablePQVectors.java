@@ -0,0 +1,113 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.pq;
+
+import com.carrotsearch.randomizedtesting.RandomizedTest;
+import com.carrotsearch.randomizedtesting.annotations.ThreadLeakScope;
+import io.github.jbellis.jvector.TestUtil;
+import io.github.jbellis.jvector.disk.SimpleMappedReader;
+import io.github.jbellis.jvector.graph.ListRandomAccessVectorValues;
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
+import org.junit.Test;
+
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileOutputStream;
+import java.util.List;
+import java.util.stream.Collectors;
+import java.util.stream.IntStream;
+
+import static org.junit.Assert.assertArrayEquals;
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertThrows;
+
+@ThreadLeakScope(ThreadLeakScope.Scope.NONE)
+public class TestMutablePQVectors extends RandomizedTest {
+    private static final int DIMENSION = 8;
+
+    @Test
+    public void testMatchesPQVectors() throws Exception {
+        var vectors = createRandomVectors(1000);
+        var pq = ProductQuantization.compute(new ListRandomAccessVectorValues(vectors.subList(0, 500), DIMENSION), 4, false);
+        var expected = new PQVectors(pq, pq.encodeAll(vectors));
+
+        // small chunks, so that the codes span several of them
+        var mutable = new MutablePQVectors(pq, 64);
+        // the second starts partway through a batch and a chunk
+        mutable.addAll(0, vectors.subList(0, 150));
+        mutable.addAll(150, vectors.subList(150, 300));
+        // single adds from many threads, past the end of the chunks allocated so far
+        IntStream.range(300, vectors.size()).parallel().forEach(i -> mutable.add(i, vectors.get(i)));
+        assertEquals(vectors.size(), mutable.count());
+        assertEquals(expected, mutable.toPQVectors());
+
+        int[] nodes = IntStream.range(0, vectors.size()).toArray();
+        var results = new float[nodes.length];
+        var expectedResults = new float[nodes.length];
+        for (var vsf : VectorSimilarityFunction.values()) {
+            var q = TestUtil.randomVector(getRandom(), DIMENSION);
+            var sf = mutable.approximateScoreFunctionFor(q, vsf);
+            var expectedSf = expected.approximateScoreFunctionFor(q, vsf);
+            for (int node : nodes) {
+                assertEquals(expectedSf.similarityTo(node), sf.similarityTo(node), 0);
+            }
+            sf.similarityTo(nodes, nodes.length, results);
+            expectedSf.similarityTo(nodes, nodes.length, expectedResults);
+            assertArrayEquals(expectedResults, results, 0);
+        }
+
+        // written in the PQVectors format
+        File cvFile = File.createTempFile("mutablepqtest", ".cv");
+        try (var out = new DataOutputStream(new FileOutputStream(cvFile))) {
+            mutable.write(out);
+        }
+        try (var in = new SimpleMappedReader(cvFile.getAbsolutePath())) {
+            assertEquals(expected, PQVectors.load(in, 0));
+
+            // and read back in chunks, the way codes too large for a single array are loaded
+            in.seek(0);
+            var loadedPQ = ProductQuantization.load(in);
+            int count = in.readInt();
+            in.readInt();
+            assertEquals(expected, MutablePQVectors.load(loadedPQ, in, count, 64).toPQVectors());
+        }
+    }
+
+    @Test
+    public void testReplaceAndValidate() {
+        var vectors = createRandomVectors(300);
+        var pq = ProductQuantization.compute(new ListRandomAccessVectorValues(vectors, DIMENSION), 2, false);
+        var mutable = new MutablePQVectors(pq);
+        assertEquals(0, mutable.count());
+
+        mutable.add(5, vectors.get(0));
+        assertEquals(6, mutable.count());
+        mutable.add(5, vectors.get(1));
+        var codes = mutable.toPQVectors();
+        int offset = codes.get(5);
+        var code = new byte[2];
+        System.arraycopy(codes.getCompressedVectors(), offset, code, 0, 2);
+        assertArrayEquals(pq.encode(vectors.get(1)), code);
+
+        assertThrows(IllegalArgumentException.class, () -> mutable.add(-1, vectors.get(0)));
+        assertThrows(IllegalArgumentException.class, () -> new MutablePQVectors(pq, 3));
+    }
+
+    private static List<float[]> createRandomVectors(int count) {
+        return IntStream.range(0, count).mapToObj(i -> TestUtil.randomVector(getRandom(), DIMENSION)).collect(Collectors.toList());
+    }
+}
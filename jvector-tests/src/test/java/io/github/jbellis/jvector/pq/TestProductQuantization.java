@@ -18,14 +18,23 @@ package io.github.jbellis.jvector.pq;
 
 import com.carrotsearch.randomizedtesting.RandomizedTest;
 import com.carrotsearch.randomizedtesting.annotations.ThreadLeakScope;
+import io.github.jbellis.jvector.disk.SimpleMappedReader;
 import io.github.jbellis.jvector.graph.ListRandomAccessVectorValues;
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
+import io.github.jbellis.jvector.vector.VectorUtil;
 import org.junit.Test;
 
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileOutputStream;
 import java.util.Arrays;
+import java.util.List;
 import java.util.stream.Collectors;
 import java.util.stream.IntStream;
 
 import static org.junit.Assert.assertArrayEquals;
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
 
 @ThreadLeakScope(ThreadLeakScope.Scope.NONE)
 public class TestProductQuantization extends RandomizedTest {
@@ -44,4 +53,81 @@ public class TestProductQuantization extends RandomizedTest {
             assertArrayEquals(Arrays.toString(vectors.get(i)) + "!=" + Arrays.toString(decodedScratch), vectors.get(i), decodedScratch, 0);
         }
     }
+
+    @Test
+    public void testOptimizedRotation() throws Exception {
+        // two high-variance dimensions and two low-variance ones; plain PQ puts the high-variance pair in
+        // the same subspace, while a rotation can give each subspace its share
+        var vectors = IntStream.range(0, 4096).mapToObj(i -> new float[] {
+                (float) (10 * getRandom().nextGaussian()),
+                (float) (10 * getRandom().nextGaussian()),
+                (float) getRandom().nextGaussian(),
+                (float) getRandom().nextGaussian() })
+                .collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, 4);
+        var pq = ProductQuantization.compute(ravv, 2, false);
+        var opq = ProductQuantization.computeOptimized(ravv, 2, false);
+
+        // the rotation is orthogonal
+        var rotation = opq.getRotation();
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                assertEquals(i == j ? 1 : 0, VectorUtil.dotProduct(rotation[i], rotation[j]), 1e-4);
+            }
+        }
+        assertTrue(reconstructionError(opq, vectors) < reconstructionError(pq, vectors));
+
+        // the query LUT sees the same rotation as the encoded vectors
+        var q = vectors.get(0);
+        var decoder = PQDecoder.newDecoder(opq, q, VectorSimilarityFunction.EUCLIDEAN);
+        var encoded = opq.encode(vectors.get(1));
+        var decoded = new float[4];
+        opq.decode(encoded, decoded);
+        assertEquals(VectorSimilarityFunction.EUCLIDEAN.compare(q, decoded), decoder.similarityTo(encoded, 0), 1e-4);
+
+        // and the rotation survives a round trip
+        File pqFile = File.createTempFile("opqtest", ".pq");
+        try (var out = new DataOutputStream(new FileOutputStream(pqFile))) {
+            opq.write(out);
+        }
+        try (var in = new SimpleMappedReader(pqFile.getAbsolutePath())) {
+            var opq2 = ProductQuantization.load(in);
+            assertEquals(opq, opq2);
+            assertArrayEquals(encoded, opq2.encode(vectors.get(1)));
+        }
+    }
+
+    @Test
+    public void testBatchedEncoding() {
+        var vectors = IntStream.range(0, 1000).mapToObj(i -> new float[] {
+                (float) getRandom().nextGaussian(),
+                (float) getRandom().nextGaussian(),
+                (float) getRandom().nextGaussian(),
+                (float) getRandom().nextGaussian(),
+                (float) getRandom().nextGaussian() })
+                .collect(Collectors.toList());
+        var ravv = new ListRandomAccessVectorValues(vectors, 5);
+        for (var pq : List.of(ProductQuantization.compute(ravv, 2, true), ProductQuantization.computeOptimized(ravv, 2, false))) {
+            // written at an offset, between bytes that must be left alone
+            int n = between(1, 50);
+            int offset = between(0, 10);
+            var batch = new byte[offset + n * 2 + 1];
+            Arrays.fill(batch, (byte) 7);
+            pq.encodeTo(vectors.subList(0, n), batch, offset);
+            for (int j = 0; j < n; j++) {
+                assertArrayEquals(pq.encode(vectors.get(j)), Arrays.copyOfRange(batch, offset + j * 2, offset + j * 2 + 2));
+            }
+            assertEquals(7, batch[offset + n * 2]);
+        }
+    }
+
+    private static double reconstructionError(ProductQuantization pq, List<float[]> vectors) {
+        var decoded = new float[vectors.get(0).length];
+        double error = 0;
+        for (var v : vectors) {
+            pq.decode(pq.encode(v), decoded);
+            error += VectorUtil.squareDistance(v, decoded);
+        }
+        return error;
+    }
 }
@@ -102,6 +102,25 @@ public class TestLongHeap extends LuceneTestCase {
         assertEquals(3, pq.top());
     }
 
+    @Test
+    public void testSetMaxSize() {
+        var pq = new BoundedLongHeap(2);
+        pq.push(2);
+        pq.push(3);
+        pq.push(1);
+        assertEquals(2, pq.size());
+        assertThrows(IllegalArgumentException.class, () -> pq.setMaxSize(1));
+
+        pq.clear();
+        pq.setMaxSize(4);
+        for (int i = 0; i < 6; i++) {
+            pq.push(i);
+        }
+        assertEquals(4, pq.size());
+        assertEquals(2, pq.top());
+        assertThrows(IllegalArgumentException.class, () -> pq.setMaxSize(0));
+    }
+
     @Test
     public void testDuplicateValues() {
         var pq = new BoundedLongHeap(3);
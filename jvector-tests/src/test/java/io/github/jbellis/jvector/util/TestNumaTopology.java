@@ -0,0 +1,50 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package io.github.jbellis.jvector.util;
+
+import com.carrotsearch.randomizedtesting.RandomizedTest;
+import org.junit.Test;
+
+import static org.junit.Assert.assertArrayEquals;
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertThrows;
+import static org.junit.Assert.assertTrue;
+
+public class TestNumaTopology extends RandomizedTest {
+    @Test
+    public void testParseCpuList() {
+        assertArrayEquals(new int[0], NumaTopology.parseCpuList("\n"));
+        assertArrayEquals(new int[] { 3 }, NumaTopology.parseCpuList("3\n"));
+        assertArrayEquals(new int[] { 0, 1, 2, 3, 8, 9, 16 }, NumaTopology.parseCpuList("0-3,8-9,16"));
+        assertThrows(IllegalArgumentException.class, () -> NumaTopology.parseCpuList("4-2"));
+    }
+
+    @Test
+    public void testTopology() {
+        int cpuCount = Runtime.getRuntime().availableProcessors();
+        var detected = NumaTopology.detect();
+        assertTrue(detected.nodeCount() >= 1);
+        assertEquals(1, detected.limit(1).nodeCount());
+
+        var uniform = NumaTopology.uniform(cpuCount);
+        assertEquals(cpuCount, uniform.nodeCount());
+        for (int node = 0; node < cpuCount; node++) {
+            assertArrayEquals(new int[] { node }, uniform.cpus(node));
+            assertEquals(1, uniform.physicalCoreCount(node));
+        }
+        assertThrows(IllegalArgumentException.class, () -> NumaTopology.uniform(cpuCount + 1));
+    }
+}
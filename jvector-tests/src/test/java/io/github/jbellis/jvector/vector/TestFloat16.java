@@ -0,0 +1,57 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package io.github.jbellis.jvector.vector;
+
+import com.carrotsearch.randomizedtesting.RandomizedTest;
+import org.junit.Test;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+
+public class TestFloat16 extends RandomizedTest {
+    @Test
+    public void testRoundTrip() {
+        for (int h = 0; h < 1 << 16; h++) {
+            float f = Float16.toFloat((short) h);
+            if (Float.isNaN(f)) {
+                assertTrue(Float.isNaN(Float16.toFloat(Float16.fromFloat(f))));
+            } else {
+                assertEquals(h, Float16.fromFloat(f) & 0xffff);
+            }
+        }
+    }
+
+    @Test
+    public void testRounding() {
+        assertEquals(1.0f, Float16.toFloat(Float16.fromFloat(1.0f + 0x1p-11f)), 0.0f); // tie, to even
+        assertEquals(1.0f + 0x1p-9f, Float16.toFloat(Float16.fromFloat(1.0f + 0x1.8p-10f)), 0.0f); // tie, to even
+        assertEquals(0x1p-24f, Float16.toFloat(Float16.fromFloat(0x1.8p-25f)), 0.0f); // smallest subnormal
+        assertEquals(0.0f, Float16.toFloat(Float16.fromFloat(0x1p-25f)), 0.0f);
+        assertEquals(Float16.MAX_VALUE, Float16.toFloat(Float16.fromFloat(65519f)), 0.0f);
+        assertEquals(Float.POSITIVE_INFINITY, Float16.toFloat(Float16.fromFloat(65520f)), 0.0f);
+        assertEquals(Float.NEGATIVE_INFINITY, Float16.toFloat(Float16.fromFloat(-1e6f)), 0.0f);
+
+        // every float rounds to one of the two half-precision values around it, whichever is nearer
+        for (int i = 0; i < 10000; i++) {
+            float f = (float) randomGaussian() * randomFrom(new Float[] {1e-6f, 1f, 1000f});
+            float rounded = Float16.toFloat(Float16.fromFloat(f));
+            short bits = Float16.fromFloat(f);
+            float next = Float16.toFloat((short) (bits + (Math.abs(rounded) < Math.abs(f) ? 1 : -1)));
+            assertTrue(Math.abs(f - rounded) <= Math.abs(f - next));
+        }
+    }
+}
@@ -42,6 +42,48 @@ public class TestVectorizationProvider extends RandomizedTest {
         }
     }
 
+    @Test
+    public void testSimilarityMetricsFloat16() {
+        Assume.assumeTrue(hasSimd);
+
+        VectorizationProvider a = new DefaultVectorizationProvider();
+        VectorizationProvider b = VectorizationProvider.getInstance();
+
+        for (int i = 0; i < 1000; i++) {
+            int length = between(1, 1021);
+            int offset = between(0, 17);
+            float[] v1 = TestUtil.randomVector(getRandom(), length);
+            short[] v2 = new short[offset + length];
+            Float16.encode(TestUtil.randomVector(getRandom(), length), v2, offset);
+
+            Assert.assertEquals(a.getVectorUtilSupport().float16DotProduct(v1, v2, offset, length), b.getVectorUtilSupport().float16DotProduct(v1, v2, offset, length), 0.0001f);
+            Assert.assertEquals(a.getVectorUtilSupport().float16Cosine(v1, v2, offset, length), b.getVectorUtilSupport().float16Cosine(v1, v2, offset, length), 0.00001f);
+            Assert.assertEquals(a.getVectorUtilSupport().float16SquareDistance(v1, v2, offset, length), b.getVectorUtilSupport().float16SquareDistance(v1, v2, offset, length), 0.0001f);
+        }
+    }
+
+    // infinities and NaN are widened the same way in the vectorized loop as in the scalar tail
+    @Test
+    public void testSimilarityMetricsFloat16NonFinite() {
+        Assume.assumeTrue(hasSimd);
+
+        VectorizationProvider a = new DefaultVectorizationProvider();
+        VectorizationProvider b = VectorizationProvider.getInstance();
+
+        float[] specials = { Float.POSITIVE_INFINITY, Float.NEGATIVE_INFINITY, Float.NaN };
+        for (int i = 0; i < 100; i++) {
+            int length = between(64, 1021);
+            float[] v1 = TestUtil.randomVector(getRandom(), length);
+            float[] raw = TestUtil.randomVector(getRandom(), length);
+            raw[between(0, length - 1)] = specials[between(0, specials.length - 1)];
+            short[] v2 = Float16.encode(raw);
+
+            Assert.assertEquals(a.getVectorUtilSupport().float16DotProduct(v1, v2, 0, length), b.getVectorUtilSupport().float16DotProduct(v1, v2, 0, length), 0f);
+            Assert.assertEquals(a.getVectorUtilSupport().float16Cosine(v1, v2, 0, length), b.getVectorUtilSupport().float16Cosine(v1, v2, 0, length), 0f);
+            Assert.assertEquals(a.getVectorUtilSupport().float16SquareDistance(v1, v2, 0, length), b.getVectorUtilSupport().float16SquareDistance(v1, v2, 0, length), 0f);
+        }
+    }
+
     @Test
     public void testSimilarityMetricsByte() {
         Assume.assumeTrue(hasSimd);
@@ -84,4 +126,83 @@ public class TestVectorizationProvider extends RandomizedTest {
 
         }
     }
+
+    @Test
+    public void testBulkAssembleAndSum() {
+        Assume.assumeTrue(hasSimd);
+
+        VectorizationProvider a = new DefaultVectorizationProvider();
+        VectorizationProvider b = VectorizationProvider.getInstance();
+
+        int subspaces = 17;
+        int clusters = 256;
+        for (int i = 0; i < 100; i++) {
+            float[] partials = TestUtil.randomVector(getRandom(), subspaces * clusters);
+            // an odd count exercises the tail, and encodings scattered through a larger array (in any order,
+            // possibly overlapping) the in-place reads
+            int count = between(1, 61);
+            int stored = between(1, 100);
+            byte[] encodings = new byte[stored * subspaces];
+            getRandom().nextBytes(encodings);
+            int[] offsets = new int[count];
+            for (int j = 0; j < count; j++) {
+                offsets[j] = between(0, encodings.length - subspaces);
+            }
+
+            float[] expected = new float[count];
+            float[] actual = new float[count];
+            a.getVectorUtilSupport().bulkAssembleAndSum(partials, clusters, encodings, offsets, subspaces, count, expected);
+            b.getVectorUtilSupport().bulkAssembleAndSum(partials, clusters, encodings, offsets, subspaces, count, actual);
+            for (int j = 0; j < count; j++) {
+                float single = a.getVectorUtilSupport().assembleAndSum(partials, clusters, encodings, offsets[j], subspaces);
+                Assert.assertEquals(single, expected[j], 0.0f);
+                Assert.assertEquals(single, actual[j], 0.0f);
+            }
+
+            // and spread over several arrays, as in the chunks of MutablePQVectors
+            byte[][] chunks = new byte[count][];
+            int[] chunkOffsets = new int[count];
+            for (int j = 0; j < count; j++) {
+                chunks[j] = j % 2 == 0 ? encodings : new byte[subspaces + j];
+                chunkOffsets[j] = j % 2 == 0 ? offsets[j] : j;
+                System.arraycopy(encodings, offsets[j], chunks[j], chunkOffsets[j], subspaces);
+            }
+            a.getVectorUtilSupport().bulkAssembleAndSum(partials, clusters, chunks, chunkOffsets, subspaces, count, actual);
+            Assert.assertArrayEquals(expected, actual, 0.0f);
+            b.getVectorUtilSupport().bulkAssembleAndSum(partials, clusters, chunks, chunkOffsets, subspaces, count, actual);
+            Assert.assertArrayEquals(expected, actual, 0.0f);
+        }
+    }
+
+    @Test
+    public void testUnsignedDotProducts() {
+        Assume.assumeTrue(hasSimd);
+
+        VectorizationProvider a = new DefaultVectorizationProvider();
+        VectorizationProvider b = VectorizationProvider.getInstance();
+
+        for (int i = 0; i < 1000; i++) {
+            // a length that is not a multiple of the vector width and a nonzero offset exercise the tail
+            int length = between(1, 300);
+            int offset = between(0, 3);
+            float[] weights = TestUtil.randomVector(getRandom(), 2 * length);
+            byte[] codes = new byte[offset + length];
+            getRandom().nextBytes(codes);
+
+            float expected = 0;
+            for (int j = 0; j < length; j++) {
+                expected += weights[j] * Byte.toUnsignedInt(codes[offset + j]);
+            }
+            Assert.assertEquals(expected, a.getVectorUtilSupport().uint8DotProduct(weights, codes, offset, length), 1e-5f * 255 * length);
+            Assert.assertEquals(expected, b.getVectorUtilSupport().uint8DotProduct(weights, codes, offset, length), 1e-5f * 255 * length);
+
+            expected = 0;
+            for (int j = 0; j < length; j++) {
+                int code = Byte.toUnsignedInt(codes[offset + j]);
+                expected += weights[j] * (code & 0x0f) + weights[length + j] * (code >>> 4);
+            }
+            Assert.assertEquals(expected, a.getVectorUtilSupport().uint4DotProduct(weights, codes, offset, length), 1e-5f * 15 * length);
+            Assert.assertEquals(expected, b.getVectorUtilSupport().uint4DotProduct(weights, codes, offset, length), 1e-5f * 15 * length);
+        }
+    }
 }
@@ -95,15 +95,55 @@ PanamaVectorUtilSupport implements VectorUtilSupport {
         //TODO: Re-enable once Jdk bug is fixed
         //return SimdOps.assembleAndSum(data, baseIndex, baseOffsets);
 
+        return assembleAndSum(data, baseIndex, baseOffsets, 0, baseOffsets.length);
+    }
+
+    @Override
+    public float assembleAndSum(float[] data, int baseIndex, byte[] baseOffsets, int baseOffsetsOffset, int length) {
         float sum = 0f;
-        for (int i = 0; i < baseOffsets.length; i++) {
-            sum += data[baseIndex * i + Byte.toUnsignedInt(baseOffsets[i])];
+        for (int i = 0; i < length; i++) {
+            sum += data[baseIndex * i + Byte.toUnsignedInt(baseOffsets[baseOffsetsOffset + i])];
         }
         return sum;
     }
 
+    @Override
+    public void bulkAssembleAndSum(float[] data, int baseIndex, byte[] baseOffsets, int[] offsets, int length, int count, float[] results) {
+        SimdOps.bulkAssembleAndSum(data, baseIndex, baseOffsets, offsets, length, count, results);
+    }
+
+    @Override
+    public void bulkAssembleAndSum(float[] data, int baseIndex, byte[][] encodings, int[] offsets, int length, int count, float[] results) {
+        SimdOps.bulkAssembleAndSum(data, baseIndex, encodings, offsets, length, count, results);
+    }
+
     @Override
     public int hammingDistance(long[] v1, long[] v2) {
         return SimdOps.hammingDistance(v1, v2);
     }
+
+    @Override
+    public float uint8DotProduct(float[] a, byte[] b, int boffset, int length) {
+        return SimdOps.uint8DotProduct(a, b, boffset, length);
+    }
+
+    @Override
+    public float uint4DotProduct(float[] a, byte[] b, int boffset, int length) {
+        return SimdOps.uint4DotProduct(a, b, boffset, length);
+    }
+
+    @Override
+    public float float16DotProduct(float[] a, short[] b, int boffset, int length) {
+        return SimdOps.float16DotProduct(a, b, boffset, length);
+    }
+
+    @Override
+    public float float16SquareDistance(float[] a, short[] b, int boffset, int length) {
+        return SimdOps.float16SquareDistance(a, b, boffset, length);
+    }
+
+    @Override
+    public float float16Cosine(float[] a, short[] b, int boffset, int length) {
+        return SimdOps.float16Cosine(a, b, boffset, length);
+    }
 }
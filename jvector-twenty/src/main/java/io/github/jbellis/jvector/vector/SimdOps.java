@@ -20,7 +20,9 @@ import jdk.incubator.vector.ByteVector;
 import jdk.incubator.vector.FloatVector;
 import jdk.incubator.vector.IntVector;
 import jdk.incubator.vector.LongVector;
+import jdk.incubator.vector.ShortVector;
 import jdk.incubator.vector.VectorOperators;
+import jdk.incubator.vector.VectorSpecies;
 
 import java.util.List;
 
@@ -628,6 +630,90 @@ final class SimdOps {
         return res;
     }
 
+    /**
+     * Sums `count` encodings at once, one per lane, reading encoding j in place at baseOffsets[offsets[j]].
+     * Unlike assembleAndSum, which gathers across the subspaces of a single encoding, each step here gathers
+     * the codes of one subspace for a lane's worth of encodings, and then the partial sums they select from a
+     * single row of the table, so the row stays in L1.  Each lane adds up its subspaces in the same order as
+     * the scalar loop, so the sums are identical to it.
+     */
+    static void bulkAssembleAndSum(float[] data, int dataBase, byte[] baseOffsets, int[] offsets, int length, int count, float[] results) {
+        if (HAS_AVX512) {
+            bulkAssembleAndSum(ByteVector.SPECIES_128, IntVector.SPECIES_512, FloatVector.SPECIES_512, scratchInt512.get(),
+                               data, dataBase, baseOffsets, offsets, length, count, results);
+        } else {
+            bulkAssembleAndSum(ByteVector.SPECIES_64, IntVector.SPECIES_256, FloatVector.SPECIES_256, scratchInt256.get(),
+                               data, dataBase, baseOffsets, offsets, length, count, results);
+        }
+    }
+
+    private static void bulkAssembleAndSum(VectorSpecies<Byte> byteSpecies, VectorSpecies<Integer> intSpecies, VectorSpecies<Float> floatSpecies,
+                                           int[] convOffsets, float[] data, int dataBase, byte[] baseOffsets, int[] offsets,
+                                           int length, int count, float[] results) {
+        int j = 0;
+        int limit = floatSpecies.loopBound(count);
+        for (; j < limit; j += floatSpecies.length()) {
+            var sum = FloatVector.zero(floatSpecies);
+            for (int i = 0; i < length; i++) {
+                ByteVector.fromArray(byteSpecies, baseOffsets, i, offsets, j)
+                        .convertShape(VectorOperators.B2I, intSpecies, 0)
+                        .lanewise(VectorOperators.AND, 0xff)
+                        .reinterpretAsInts()
+                        .intoArray(convOffsets, 0);
+                sum = sum.add(FloatVector.fromArray(floatSpecies, data, dataBase * i, convOffsets, 0));
+            }
+            sum.intoArray(results, j);
+        }
+
+        // Process tail
+        for (; j < count; j++) {
+            float res = 0f;
+            for (int i = 0; i < length; i++) {
+                res += data[dataBase * i + Byte.toUnsignedInt(baseOffsets[offsets[j] + i])];
+            }
+            results[j] = res;
+        }
+    }
+
+    /**
+     * As {@link #bulkAssembleAndSum(float[], int, byte[], int[], int, int, float[])}, but encoding j is read in
+     * place at encodings[j][offsets[j]].  A byte gather cannot span arrays, so the codes of each lane are loaded
+     * one at a time; the partial sums they select are still gathered and added a lane's worth at once.
+     */
+    static void bulkAssembleAndSum(float[] data, int dataBase, byte[][] encodings, int[] offsets, int length, int count, float[] results) {
+        if (HAS_AVX512) {
+            bulkAssembleAndSum(FloatVector.SPECIES_512, scratchInt512.get(), data, dataBase, encodings, offsets, length, count, results);
+        } else {
+            bulkAssembleAndSum(FloatVector.SPECIES_256, scratchInt256.get(), data, dataBase, encodings, offsets, length, count, results);
+        }
+    }
+
+    private static void bulkAssembleAndSum(VectorSpecies<Float> floatSpecies, int[] convOffsets, float[] data, int dataBase,
+                                           byte[][] encodings, int[] offsets, int length, int count, float[] results) {
+        int lanes = floatSpecies.length();
+        int j = 0;
+        int limit = floatSpecies.loopBound(count);
+        for (; j < limit; j += lanes) {
+            var sum = FloatVector.zero(floatSpecies);
+            for (int i = 0; i < length; i++) {
+                for (int l = 0; l < lanes; l++) {
+                    convOffsets[l] = Byte.toUnsignedInt(encodings[j + l][offsets[j + l] + i]);
+                }
+                sum = sum.add(FloatVector.fromArray(floatSpecies, data, dataBase * i, convOffsets, 0));
+            }
+            sum.intoArray(results, j);
+        }
+
+        // Process tail
+        for (; j < count; j++) {
+            float res = 0f;
+            for (int i = 0; i < length; i++) {
+                res += data[dataBase * i + Byte.toUnsignedInt(encodings[j][offsets[j] + i])];
+            }
+            results[j] = res;
+        }
+    }
+
     /**
      * Vectorized calculation of Hamming distance for two arrays of long integers.
      * Both arrays should have the same length.
@@ -658,4 +744,185 @@ final class SimdOps {
 
         return res;
     }
+
+    static float uint8DotProduct(float[] a, byte[] b, int boffset, int length) {
+        if (HAS_AVX512) {
+            return uint8DotProduct(ByteVector.SPECIES_128, IntVector.SPECIES_512, FloatVector.SPECIES_512, BYTE_TO_INT_MASK_512, a, b, boffset, length);
+        } else {
+            return uint8DotProduct(ByteVector.SPECIES_64, IntVector.SPECIES_256, FloatVector.SPECIES_256, BYTE_TO_INT_MASK_256, a, b, boffset, length);
+        }
+    }
+
+    private static float uint8DotProduct(VectorSpecies<Byte> byteSpecies, VectorSpecies<Integer> intSpecies, VectorSpecies<Float> floatSpecies,
+                                         IntVector mask, float[] a, byte[] b, int boffset, int length) {
+        var sum = FloatVector.zero(floatSpecies);
+        int i = 0;
+        int limit = byteSpecies.loopBound(length);
+        for (; i < limit; i += byteSpecies.length()) {
+            var codes = ByteVector.fromArray(byteSpecies, b, boffset + i)
+                    .convertShape(VectorOperators.B2I, intSpecies, 0)
+                    .lanewise(VectorOperators.AND, mask)
+                    .convert(VectorOperators.I2F, 0);
+            sum = FloatVector.fromArray(floatSpecies, a, i).fma(codes, sum);
+        }
+
+        float res = sum.reduceLanes(VectorOperators.ADD);
+
+        // Process the tail
+        for (; i < length; i++) {
+            res += a[i] * Byte.toUnsignedInt(b[boffset + i]);
+        }
+
+        return res;
+    }
+
+    static float uint4DotProduct(float[] a, byte[] b, int boffset, int length) {
+        if (HAS_AVX512) {
+            return uint4DotProduct(ByteVector.SPECIES_128, IntVector.SPECIES_512, FloatVector.SPECIES_512, BYTE_TO_INT_MASK_512, a, b, boffset, length);
+        } else {
+            return uint4DotProduct(ByteVector.SPECIES_64, IntVector.SPECIES_256, FloatVector.SPECIES_256, BYTE_TO_INT_MASK_256, a, b, boffset, length);
+        }
+    }
+
+    private static float uint4DotProduct(VectorSpecies<Byte> byteSpecies, VectorSpecies<Integer> intSpecies, VectorSpecies<Float> floatSpecies,
+                                         IntVector mask, float[] a, byte[] b, int boffset, int length) {
+        var lowSum = FloatVector.zero(floatSpecies);
+        var highSum = FloatVector.zero(floatSpecies);
+        int i = 0;
+        int limit = byteSpecies.loopBound(length);
+        for (; i < limit; i += byteSpecies.length()) {
+            var codes = ByteVector.fromArray(byteSpecies, b, boffset + i)
+                    .convertShape(VectorOperators.B2I, intSpecies, 0)
+                    .lanewise(VectorOperators.AND, mask);
+            var low = codes.lanewise(VectorOperators.AND, 0x0f).convert(VectorOperators.I2F, 0);
+            var high = codes.lanewise(VectorOperators.LSHR, 4).convert(VectorOperators.I2F, 0);
+            lowSum = FloatVector.fromArray(floatSpecies, a, i).fma(low, lowSum);
+            highSum = FloatVector.fromArray(floatSpecies, a, length + i).fma(high, highSum);
+        }
+
+        float res = lowSum.add(highSum).reduceLanes(VectorOperators.ADD);
+
+        // Process the tail
+        for (; i < length; i++) {
+            int codes = Byte.toUnsignedInt(b[boffset + i]);
+            res += a[i] * (codes & 0x0f) + a[length + i] * (codes >>> 4);
+        }
+
+        return res;
+    }
+
+    /**
+     * Widens the half-precision values at b[offset] to floats, without a lookup or a per-lane branch: the
+     * exponent and mantissa are shifted into place and then multiplied by 2^112 to correct the exponent
+     * bias, which is exact for finite values (including subnormals).  Infinities and NaN, whose exponent is
+     * all ones, are blended in with a float's all-ones exponent instead, as {@link Float16#toFloat} does.
+     */
+    private static FloatVector float16ToFloat(VectorSpecies<Short> shortSpecies, VectorSpecies<Integer> intSpecies, short[] b, int offset) {
+        var h = ShortVector.fromArray(shortSpecies, b, offset).convertShape(VectorOperators.S2I, intSpecies, 0);
+        var sign = h.lanewise(VectorOperators.AND, 0x8000).lanewise(VectorOperators.LSHL, 16);
+        var exponentAndMantissa = h.lanewise(VectorOperators.AND, 0x7fff);
+        var finite = ((IntVector) sign.lanewise(VectorOperators.OR, exponentAndMantissa.lanewise(VectorOperators.LSHL, 13)))
+                .reinterpretAsFloats().mul(0x1p112f);
+        var nonFinite = ((IntVector) exponentAndMantissa.lanewise(VectorOperators.AND, 0x3ff).lanewise(VectorOperators.LSHL, 13))
+                .lanewise(VectorOperators.OR, sign)
+                .lanewise(VectorOperators.OR, 0x7f800000)
+                .reinterpretAsFloats();
+        var isNonFinite = exponentAndMantissa.compare(VectorOperators.GE, 0x7c00).cast(finite.species());
+        return finite.blend(nonFinite, isNonFinite);
+    }
+
+    static float float16DotProduct(float[] a, short[] b, int boffset, int length) {
+        if (HAS_AVX512) {
+            return float16DotProduct(ShortVector.SPECIES_256, IntVector.SPECIES_512, FloatVector.SPECIES_512, a, b, boffset, length);
+        } else {
+            return float16DotProduct(ShortVector.SPECIES_128, IntVector.SPECIES_256, FloatVector.SPECIES_256, a, b, boffset, length);
+        }
+    }
+
+    private static float float16DotProduct(VectorSpecies<Short> shortSpecies, VectorSpecies<Integer> intSpecies, VectorSpecies<Float> floatSpecies,
+                                           float[] a, short[] b, int boffset, int length) {
+        var sum = FloatVector.zero(floatSpecies);
+        int i = 0;
+        int limit = shortSpecies.loopBound(length);
+        for (; i < limit; i += shortSpecies.length()) {
+            var bv = float16ToFloat(shortSpecies, intSpecies, b, boffset + i);
+            sum = FloatVector.fromArray(floatSpecies, a, i).fma(bv, sum);
+        }
+
+        float res = sum.reduceLanes(VectorOperators.ADD);
+
+        // Process the tail
+        for (; i < length; i++) {
+            res += a[i] * Float16.toFloat(b[boffset + i]);
+        }
+
+        return res;
+    }
+
+    static float float16SquareDistance(float[] a, short[] b, int boffset, int length) {
+        if (HAS_AVX512) {
+            return float16SquareDistance(ShortVector.SPECIES_256, IntVector.SPECIES_512, FloatVector.SPECIES_512, a, b, boffset, length);
+        } else {
+            return float16SquareDistance(ShortVector.SPECIES_128, IntVector.SPECIES_256, FloatVector.SPECIES_256, a, b, boffset, length);
+        }
+    }
+
+    private static float float16SquareDistance(VectorSpecies<Short> shortSpecies, VectorSpecies<Integer> intSpecies, VectorSpecies<Float> floatSpecies,
+                                               float[] a, short[] b, int boffset, int length) {
+        var sum = FloatVector.zero(floatSpecies);
+        int i = 0;
+        int limit = shortSpecies.loopBound(length);
+        for (; i < limit; i += shortSpecies.length()) {
+            var diff = FloatVector.fromArray(floatSpecies, a, i).sub(float16ToFloat(shortSpecies, intSpecies, b, boffset + i));
+            sum = diff.fma(diff, sum);
+        }
+
+        float res = sum.reduceLanes(VectorOperators.ADD);
+
+        // Process the tail
+        for (; i < length; i++) {
+            float diff = a[i] - Float16.toFloat(b[boffset + i]);
+            res += diff * diff;
+        }
+
+        return res;
+    }
+
+    static float float16Cosine(float[] a, short[] b, int boffset, int length) {
+        if (HAS_AVX512) {
+            return float16Cosine(ShortVector.SPECIES_256, IntVector.SPECIES_512, FloatVector.SPECIES_512, a, b, boffset, length);
+        } else {
+            return float16Cosine(ShortVector.SPECIES_128, IntVector.SPECIES_256, FloatVector.SPECIES_256, a, b, boffset, length);
+        }
+    }
+
+    private static float float16Cosine(VectorSpecies<Short> shortSpecies, VectorSpecies<Integer> intSpecies, VectorSpecies<Float> floatSpecies,
+                                       float[] a, short[] b, int boffset, int length) {
+        var vsum = FloatVector.zero(floatSpecies);
+        var vaMagnitude = FloatVector.zero(floatSpecies);
+        var vbMagnitude = FloatVector.zero(floatSpecies);
+        int i = 0;
+        int limit = shortSpecies.loopBound(length);
+        for (; i < limit; i += shortSpecies.length()) {
+            var av = FloatVector.fromArray(floatSpecies, a, i);
+            var bv = float16ToFloat(shortSpecies, intSpecies, b, boffset + i);
+            vsum = av.fma(bv, vsum);
+            vaMagnitude = av.fma(av, vaMagnitude);
+            vbMagnitude = bv.fma(bv, vbMagnitude);
+        }
+
+        float sum = vsum.reduceLanes(VectorOperators.ADD);
+        float aMagnitude = vaMagnitude.reduceLanes(VectorOperators.ADD);
+        float bMagnitude = vbMagnitude.reduceLanes(VectorOperators.ADD);
+
+        // Process the tail
+        for (; i < length; i++) {
+            float bf = Float16.toFloat(b[boffset + i]);
+            sum += a[i] * bf;
+            aMagnitude += a[i] * a[i];
+            bMagnitude += bf * bf;
+        }
+
+        return (float) (sum / Math.sqrt(aMagnitude * bMagnitude));
+    }
 }
@@ -0,0 +1,150 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package io.github.jbellis.jvector.disk;
+
+import io.github.jbellis.jvector.vector.MemorySegmentVectorUtil;
+import io.github.jbellis.jvector.vector.VectorSimilarityFunction;
+
+import java.io.EOFException;
+import java.io.IOException;
+import java.lang.foreign.MemorySegment;
+import java.lang.foreign.ValueLayout;
+import java.nio.ByteOrder;
+
+/**
+ * A RandomAccessReader over a MemorySegment, typically a file mapped by {@link MemorySegmentReaderSupplier}.
+ * Unlike SimpleMappedReader, this handles files larger than 2GB, and bulk reads copy directly from the
+ * mapped memory into the destination array.  Similarity computations against stored vectors read
+ * the mapped memory in place, so re-ranking allocates nothing.
+ * <p>
+ * Readers are cheap and do not own the underlying memory; closing a reader does not unmap it.
+ */
+public class MemorySegmentReader implements RandomAccessReader {
+    // everything in our on-disk formats is written with DataOutput, which is big-endian
+    static final ValueLayout.OfInt INT_LAYOUT = ValueLayout.JAVA_INT_UNALIGNED.withOrder(ByteOrder.BIG_ENDIAN);
+    static final ValueLayout.OfLong LONG_LAYOUT = ValueLayout.JAVA_LONG_UNALIGNED.withOrder(ByteOrder.BIG_ENDIAN);
+    static final ValueLayout.OfFloat FLOAT_LAYOUT = ValueLayout.JAVA_FLOAT_UNALIGNED.withOrder(ByteOrder.BIG_ENDIAN);
+    static final ValueLayout.OfShort SHORT_LAYOUT = ValueLayout.JAVA_SHORT_UNALIGNED.withOrder(ByteOrder.BIG_ENDIAN);
+
+    private final MemorySegment memory;
+    private long position;
+
+    public MemorySegmentReader(MemorySegment memory) {
+        this.memory = memory;
+    }
+
+    /**
+     * @return the memory this reader is reading from
+     */
+    public MemorySegment memory() {
+        return memory;
+    }
+
+    /**
+     * @return the current position of the reader in the segment
+     */
+    public long position() {
+        return position;
+    }
+
+    @Override
+    public void seek(long offset) throws IOException {
+        if (offset < 0 || offset > memory.byteSize()) {
+            throw new EOFException(String.format("Cannot seek to %d in segment of size %d", offset, memory.byteSize()));
+        }
+        position = offset;
+    }
+
+    private void checkAvailable(long bytes) throws EOFException {
+        if (bytes > memory.byteSize() - position) {
+            throw new EOFException(String.format("Cannot read %d bytes at %d in segment of size %d",
+                                                 bytes, position, memory.byteSize()));
+        }
+    }
+
+    @Override
+    public int readInt() throws IOException {
+        checkAvailable(Integer.BYTES);
+        int value = memory.get(INT_LAYOUT, position);
+        position += Integer.BYTES;
+        return value;
+    }
+
+    @Override
+    public void readFully(byte[] bytes) throws IOException {
+        checkAvailable(bytes.length);
+        MemorySegment.copy(memory, ValueLayout.JAVA_BYTE, position, bytes, 0, bytes.length);
+        position += bytes.length;
+    }
+
+    @Override
+    public void read(byte[] bytes, int offset, int count) throws IOException {
+        checkAvailable(count);
+        MemorySegment.copy(memory, ValueLayout.JAVA_BYTE, position, bytes, offset, count);
+        position += count;
+    }
+
+    @Override
+    public void readFully(float[] floats) throws IOException {
+        checkAvailable((long) floats.length * Float.BYTES);
+        MemorySegment.copy(memory, FLOAT_LAYOUT, position, floats, 0, floats.length);
+        position += (long) floats.length * Float.BYTES;
+    }
+
+    @Override
+    public void readFully(short[] shorts) throws IOException {
+        checkAvailable((long) shorts.length * Short.BYTES);
+        MemorySegment.copy(memory, SHORT_LAYOUT, position, shorts, 0, shorts.length);
+        position += (long) shorts.length * Short.BYTES;
+    }
+
+    @Override
+    public void readFully(long[] vector) throws IOException {
+        checkAvailable((long) vector.length * Long.BYTES);
+        MemorySegment.copy(memory, LONG_LAYOUT, position, vector, 0, vector.length);
+        position += (long) vector.length * Long.BYTES;
+    }
+
+    @Override
+    public void read(int[] ints, int offset, int count) throws IOException {
+        checkAvailable((long) count * Integer.BYTES);
+        MemorySegment.copy(memory, INT_LAYOUT, position, ints, offset, count);
+        position += (long) count * Integer.BYTES;
+    }
+
+    @Override
+    public float similarityTo(float[] query, long offset, VectorSimilarityFunction similarityFunction, float[] scratch) throws IOException {
+        seek(offset);
+        checkAvailable((long) query.length * Float.BYTES);
+        return MemorySegmentVectorUtil.compare(similarityFunction, query, memory, offset);
+    }
+
+    /**
+     * Advises the kernel that each range will be needed, so that page faults on any of them
+     * are serviced concurrently by readahead rather than one at a time when they are touched.
+     */
+    @Override
+    public void prefetch(long[] offsets, int count, int length) {
+        for (int i = 0; i < count; i++) {
+            MemorySegmentReaderSupplier.advise(memory, offsets[i], length, MemorySegmentReaderSupplier.Advice.WILL_NEED);
+        }
+    }
+
+    @Override
+    public void close() {
+        // the memory is owned by the supplier
+    }
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package io.github.jbellis.jvector.disk;
+
+import java.io.IOException;
+import java.lang.foreign.Arena;
+import java.lang.foreign.FunctionDescriptor;
+import java.lang.foreign.Linker;
+import java.lang.foreign.MemorySegment;
+import java.lang.foreign.ValueLayout;
+import java.lang.invoke.MethodHandle;
+import java.nio.channels.FileChannel;
+import java.nio.file.Path;
+import java.nio.file.StandardOpenOption;
+import java.util.logging.Logger;
+
+/**
+ * Maps a file once, into a shared Arena, and hands out MemorySegmentReaders over the mapping.
+ * All the views of an OnDiskGraphIndex opened with this supplier thus share a single mapping,
+ * which is released when the supplier is closed.  Files larger than 2GB are supported.
+ */
+public class MemorySegmentReaderSupplier implements ReaderSupplier {
+    private static final Logger LOG = Logger.getLogger(MemorySegmentReaderSupplier.class.getName());
+    private static final MethodHandle MADVISE = lookupMadvise();
+    private static final long PAGE_SIZE = lookupPageSize();
+
+    /**
+     * Access-pattern hints for the mapped file, passed to madvise(2).
+     */
+    public enum Advice {
+        NORMAL(0),
+        /** the file will be accessed randomly, e.g. by searches; disables readahead */
+        RANDOM(1),
+        /** the file will be read from start to end, e.g. while warming a cache; enables aggressive readahead */
+        SEQUENTIAL(2),
+        /** the file will be needed soon; the kernel may start reading it in the background */
+        WILL_NEED(3);
+
+        // these values are shared by Linux and the BSDs (including macOS)
+        final int value;
+
+        Advice(int value) {
+            this.value = value;
+        }
+    }
+
+    private final Arena arena;
+    private final MemorySegment memory;
+
+    /**
+     * Maps `path`, advising the kernel that it will be accessed randomly.
+     */
+    public MemorySegmentReaderSupplier(Path path) throws IOException {
+        this(path, Advice.RANDOM);
+    }
+
+    public MemorySegmentReaderSupplier(Path path, Advice advice) throws IOException {
+        arena = Arena.ofShared();
+        try (var channel = FileChannel.open(path, StandardOpenOption.READ)) {
+            memory = channel.map(FileChannel.MapMode.READ_ONLY, 0L, channel.size(), arena);
+        } catch (Throwable t) {
+            arena.close();
+            throw t;
+        }
+        advise(advice);
+    }
+
+    @Override
+    public RandomAccessReader get() {
+        return new MemorySegmentReader(memory);
+    }
+
+    /**
+     * Re-advises the kernel about how the mapping will be accessed, e.g. SEQUENTIAL while loading a
+     * CachingGraphIndex and then RANDOM for serving searches.
+     *
+     * @return true if the advice was accepted; false if madvise is not available on this platform
+     * or the call failed.
+     */
+    public boolean advise(Advice advice) {
+        return advise(memory, advice);
+    }
+
+    /**
+     * Gives `advice` about `segment`, which must start on a page boundary within a mapped file.
+     */
+    static boolean advise(MemorySegment segment, Advice advice) {
+        if (MADVISE == null || segment.byteSize() == 0) {
+            return false;
+        }
+        try {
+            int rc = (int) MADVISE.invokeExact(segment, segment.byteSize(), advice.value);
+            return rc == 0;
+        } catch (Throwable t) {
+            LOG.warning("madvise failed: " + t);
+            return false;
+        }
+    }
+
+    /**
+     * Gives `advice` about the `length` bytes at `offset` in `memory`, which must be a mapped file.
+     * The range is widened to page boundaries as madvise requires.
+     */
+    static boolean advise(MemorySegment memory, long offset, long length, Advice advice) {
+        long start = offset - (offset % PAGE_SIZE);
+        long end = Math.min(offset + length, memory.byteSize());
+        if (start >= end) {
+            return false;
+        }
+        return advise(memory.asSlice(start, end - start), advice);
+    }
+
+    private static long lookupPageSize() {
+        try {
+            var linker = Linker.nativeLinker();
+            var getpagesize = linker.defaultLookup().find("getpagesize")
+                                    .map(address -> linker.downcallHandle(address, FunctionDescriptor.of(ValueLayout.JAVA_INT)))
+                                    .orElse(null);
+            if (getpagesize != null) {
+                int pageSize = (int) getpagesize.invokeExact();
+                if (pageSize > 0) {
+                    return pageSize;
+                }
+            }
+        } catch (Throwable t) {
+            // fall through to the common default; we only need it to align madvise ranges
+        }
+        return 4096;
+    }
+
+    private static MethodHandle lookupMadvise() {
+        try {
+            var linker = Linker.nativeLinker();
+            var descriptor = FunctionDescriptor.of(ValueLayout.JAVA_INT, ValueLayout.ADDRESS, ValueLayout.JAVA_LONG, ValueLayout.JAVA_INT);
+            return linker.defaultLookup().find("madvise")
+                         .map(address -> linker.downcallHandle(address, descriptor))
+                         .orElse(null);
+        } catch (Throwable t) {
+            // e.g. native access is disabled; mapping still works, just without hints
+            LOG.info("madvise is not available: " + t);
+            return null;
+        }
+    }
+
+    @Override
+    public void close() {
+        arena.close();
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package io.github.jbellis.jvector.vector;
+
+import jdk.incubator.vector.FloatVector;
+import jdk.incubator.vector.VectorOperators;
+
+import java.lang.foreign.MemorySegment;
+import java.lang.foreign.ValueLayout;
+import java.nio.ByteOrder;
+
+/**
+ * Vector API kernels comparing an on-heap vector with big-endian float vectors in a MemorySegment.
+ * Only loaded when the jdk.incubator.vector module is readable; see MemorySegmentVectorUtil.
+ */
+final class MemorySegmentSimdOps {
+    private static final ValueLayout.OfFloat FLOAT_LAYOUT = MemorySegmentVectorUtil.FLOAT_LAYOUT;
+
+    static float dotProduct(float[] a, MemorySegment b, long bOffset) {
+        final int vectorizedLength = FloatVector.SPECIES_PREFERRED.loopBound(a.length);
+        FloatVector sum = FloatVector.zero(FloatVector.SPECIES_PREFERRED);
+
+        int i = 0;
+        // Process the vectorized part
+        for (; i < vectorizedLength; i += FloatVector.SPECIES_PREFERRED.length()) {
+            FloatVector va = FloatVector.fromArray(FloatVector.SPECIES_PREFERRED, a, i);
+            FloatVector vb = FloatVector.fromMemorySegment(FloatVector.SPECIES_PREFERRED, b, bOffset + (long) i * Float.BYTES, ByteOrder.BIG_ENDIAN);
+            sum = va.fma(vb, sum);
+        }
+
+        float res = sum.reduceLanes(VectorOperators.ADD);
+
+        // Process the tail
+        for (; i < a.length; ++i)
+            res += a[i] * b.get(FLOAT_LAYOUT, bOffset + (long) i * Float.BYTES);
+
+        return res;
+    }
+
+    static float squareDistance(float[] a, MemorySegment b, long bOffset) {
+        final int vectorizedLength = FloatVector.SPECIES_PREFERRED.loopBound(a.length);
+        FloatVector sum = FloatVector.zero(FloatVector.SPECIES_PREFERRED);
+
+        int i = 0;
+        // Process the vectorized part
+        for (; i < vectorizedLength; i += FloatVector.SPECIES_PREFERRED.length()) {
+            FloatVector va = FloatVector.fromArray(FloatVector.SPECIES_PREFERRED, a, i);
+            FloatVector vb = FloatVector.fromMemorySegment(FloatVector.SPECIES_PREFERRED, b, bOffset + (long) i * Float.BYTES, ByteOrder.BIG_ENDIAN);
+            var diff = va.sub(vb);
+            sum = diff.fma(diff, sum);
+        }
+
+        float res = sum.reduceLanes(VectorOperators.ADD);
+
+        // Process the tail
+        for (; i < a.length; ++i) {
+            var diff = a[i] - b.get(FLOAT_LAYOUT, bOffset + (long) i * Float.BYTES);
+            res += diff * diff;
+        }
+
+        return res;
+    }
+
+    static float cosine(float[] a, MemorySegment b, long bOffset) {
+        var vsum = FloatVector.zero(FloatVector.SPECIES_PREFERRED);
+        var vaMagnitude = FloatVector.zero(FloatVector.SPECIES_PREFERRED);
+        var vbMagnitude = FloatVector.zero(FloatVector.SPECIES_PREFERRED);
+
+        int vectorizedLength = FloatVector.SPECIES_PREFERRED.loopBound(a.length);
+        for (int i = 0; i < vectorizedLength; i += FloatVector.SPECIES_PREFERRED.length()) {
+            var va = FloatVector.fromArray(FloatVector.SPECIES_PREFERRED, a, i);
+            var vb = FloatVector.fromMemorySegment(FloatVector.SPECIES_PREFERRED, b, bOffset + (long) i * Float.BYTES, ByteOrder.BIG_ENDIAN);
+            vsum = va.fma(vb, vsum);
+            vaMagnitude = va.fma(va, vaMagnitude);
+            vbMagnitude = vb.fma(vb, vbMagnitude);
+        }
+
+        float sum = vsum.reduceLanes(VectorOperators.ADD);
+        float aMagnitude = vaMagnitude.reduceLanes(VectorOperators.ADD);
+        float bMagnitude = vbMagnitude.reduceLanes(VectorOperators.ADD);
+
+        // Process the tail
+        for (int i = vectorizedLength; i < a.length; i++) {
+            float bi = b.get(FLOAT_LAYOUT, bOffset + (long) i * Float.BYTES);
+            sum += a[i] * bi;
+            aMagnitude += a[i] * a[i];
+            bMagnitude += bi * bi;
+        }
+
+        return (float) (sum / Math.sqrt(aMagnitude * bMagnitude));
+    }
+}
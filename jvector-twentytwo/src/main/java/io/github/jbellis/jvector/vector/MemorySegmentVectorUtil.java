@@ -0,0 +1,93 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package io.github.jbellis.jvector.vector;
+
+import java.lang.foreign.MemorySegment;
+import java.lang.foreign.ValueLayout;
+import java.nio.ByteOrder;
+
+/**
+ * Similarity computations between an on-heap vector and a float vector stored in a MemorySegment,
+ * such as a mapped index file, without first copying the latter onto the heap.  Vectors in the
+ * segment are big-endian, as written by DataOutput.
+ * <p>
+ * Uses the Panama Vector API when the jdk.incubator.vector module is readable, and scalar loops otherwise.
+ * It is the caller's responsibility to make sure that `a.length` floats are available at `bOffset`;
+ * MemorySegment will throw IndexOutOfBoundsException if they are not.
+ */
+public final class MemorySegmentVectorUtil {
+    static final ValueLayout.OfFloat FLOAT_LAYOUT = ValueLayout.JAVA_FLOAT_UNALIGNED.withOrder(ByteOrder.BIG_ENDIAN);
+
+    private static final boolean SIMD = VectorizationProvider.vectorModulePresentAndReadable();
+
+    private MemorySegmentVectorUtil() {}
+
+    /**
+     * @return the similarity between `query` and the vector at `offset` in `segment`, as computed by
+     * {@link VectorSimilarityFunction#compare(float[], float[])}
+     */
+    public static float compare(VectorSimilarityFunction similarityFunction, float[] query, MemorySegment segment, long offset) {
+        switch (similarityFunction) {
+            case EUCLIDEAN:
+                return 1 / (1 + squareDistance(query, segment, offset));
+            case DOT_PRODUCT:
+                return (1 + dotProduct(query, segment, offset)) / 2;
+            case COSINE:
+                return (1 + cosine(query, segment, offset)) / 2;
+            default:
+                throw new IllegalArgumentException("Unsupported similarity function " + similarityFunction);
+        }
+    }
+
+    public static float dotProduct(float[] a, MemorySegment b, long bOffset) {
+        if (SIMD) {
+            return MemorySegmentSimdOps.dotProduct(a, b, bOffset);
+        }
+        float res = 0f;
+        for (int i = 0; i < a.length; i++) {
+            res += a[i] * b.get(FLOAT_LAYOUT, bOffset + (long) i * Float.BYTES);
+        }
+        return res;
+    }
+
+    public static float squareDistance(float[] a, MemorySegment b, long bOffset) {
+        if (SIMD) {
+            return MemorySegmentSimdOps.squareDistance(a, b, bOffset);
+        }
+        float res = 0f;
+        for (int i = 0; i < a.length; i++) {
+            float diff = a[i] - b.get(FLOAT_LAYOUT, bOffset + (long) i * Float.BYTES);
+            res += diff * diff;
+        }
+        return res;
+    }
+
+    public static float cosine(float[] a, MemorySegment b, long bOffset) {
+        if (SIMD) {
+            return MemorySegmentSimdOps.cosine(a, b, bOffset);
+        }
+        float sum = 0f;
+        float aMagnitude = 0f;
+        float bMagnitude = 0f;
+        for (int i = 0; i < a.length; i++) {
+            float bi = b.get(FLOAT_LAYOUT, bOffset + (long) i * Float.BYTES);
+            sum += a[i] * bi;
+            aMagnitude += a[i] * a[i];
+            bMagnitude += bi * bi;
+        }
+        return (float) (sum / Math.sqrt(aMagnitude * bMagnitude));
+    }
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package io.github.jbellis.jvector.disk;
+
+import com.carrotsearch.randomizedtesting.RandomizedTest;
+import com.carrotsearch.randomizedtesting.annotations.ThreadLeakScope;
+import org.junit.After;
+import org.junit.Before;
+import org.junit.Test;
+
+import java.io.BufferedOutputStream;
+import java.io.DataOutputStream;
+import java.io.EOFException;
+import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+
+import static org.junit.Assert.assertArrayEquals;
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertThrows;
+
+@ThreadLeakScope(ThreadLeakScope.Scope.NONE)
+public class TestMemorySegmentReader extends RandomizedTest {
+    private Path testDirectory;
+
+    @Before
+    public void setup() throws IOException {
+        testDirectory = Files.createTempDirectory(this.getClass().getSimpleName());
+    }
+
+    @After
+    public void tearDown() throws IOException {
+        try (var files = Files.list(testDirectory)) {
+            for (var f : (Iterable<Path>) files::iterator) {
+                Files.delete(f);
+            }
+        }
+        Files.delete(testDirectory);
+    }
+
+    @Test
+    public void testReads() throws Exception {
+        var path = testDirectory.resolve("data");
+        var floats = new float[17];
+        for (int i = 0; i < floats.length; i++) {
+            floats[i] = randomFloat();
+        }
+        var longs = new long[5];
+        for (int i = 0; i < longs.length; i++) {
+            longs[i] = randomLong();
+        }
+        var bytes = randomBytesOfLength(11);
+
+        try (var out = new DataOutputStream(new BufferedOutputStream(Files.newOutputStream(path)))) {
+            out.writeInt(42);
+            out.write(bytes);
+            // deliberately unaligned
+            for (var f : floats) {
+                out.writeFloat(f);
+            }
+            for (var l : longs) {
+                out.writeLong(l);
+            }
+            for (int i = 0; i < 3; i++) {
+                out.writeInt(i - 1);
+            }
+        }
+
+        try (var supplier = new MemorySegmentReaderSupplier(path);
+             var reader = supplier.get();
+             var reader2 = supplier.get())
+        {
+            assertEquals(42, reader.readInt());
+            var bytes2 = new byte[bytes.length];
+            reader.readFully(bytes2);
+            assertArrayEquals(bytes, bytes2);
+            var floats2 = new float[floats.length];
+            reader.readFully(floats2);
+            assertArrayEquals(floats, floats2, 0.0f);
+            var longs2 = new long[longs.length];
+            reader.readFully(longs2);
+            assertArrayEquals(longs, longs2);
+            var ints = new int[4];
+            reader.read(ints, 1, 3);
+            assertArrayEquals(new int[] {0, -1, 0, 1}, ints);
+
+            // readers have independent positions
+            assertEquals(42, reader2.readInt());
+
+            // reading past the end of the file is an error, not a silent short read
+            reader.seek(Files.size(path) - 2);
+            assertThrows(EOFException.class, reader::readInt);
+            assertThrows(EOFException.class, () -> reader.seek(Files.size(path) + 1));
+
+            // hints are best-effort, but must not break subsequent reads
+            supplier.advise(MemorySegmentReaderSupplier.Advice.SEQUENTIAL);
+            reader2.seek(0);
+            assertEquals(42, reader2.readInt());
+        }
+    }
+}
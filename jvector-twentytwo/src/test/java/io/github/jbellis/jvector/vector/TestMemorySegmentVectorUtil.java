@@ -0,0 +1,65 @@
+/*
+ * Copyright DataStax, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package io.github.jbellis.jvector.vector;
+
+import com.carrotsearch.randomizedtesting.RandomizedTest;
+import org.junit.Test;
+
+import java.lang.foreign.Arena;
+import java.lang.foreign.ValueLayout;
+import java.nio.ByteOrder;
+
+import static org.junit.Assert.assertEquals;
+
+public class TestMemorySegmentVectorUtil extends RandomizedTest {
+    private float[] randomVector(int dim) {
+        var v = new float[dim];
+        for (int i = 0; i < dim; i++) {
+            v[i] = randomFloat() * 2 - 1;
+        }
+        return v;
+    }
+
+    // summation order differs between implementations, so allow for rounding relative to the magnitude
+    private static void assertClose(float expected, float actual) {
+        assertEquals(expected, actual, Math.max(0.0001f, Math.abs(expected) * 0.0001f));
+    }
+
+    @Test
+    public void testMatchesOnHeapSimilarity() {
+        var layout = ValueLayout.JAVA_FLOAT_UNALIGNED.withOrder(ByteOrder.BIG_ENDIAN);
+        try (var arena = Arena.ofConfined()) {
+            for (int i = 0; i < 100; i++) {
+                int dim = randomIntBetween(1, 1021);
+                var a = randomVector(dim);
+                var b = randomVector(dim);
+                // put b at an unaligned offset, as it would be in an index file
+                long offset = randomIntBetween(0, 7);
+                var segment = arena.allocate(offset + (long) dim * Float.BYTES);
+                for (int j = 0; j < dim; j++) {
+                    segment.set(layout, offset + (long) j * Float.BYTES, b[j]);
+                }
+
+                assertClose(VectorUtil.dotProduct(a, b), MemorySegmentVectorUtil.dotProduct(a, segment, offset));
+                assertClose(VectorUtil.squareDistance(a, b), MemorySegmentVectorUtil.squareDistance(a, segment, offset));
+                assertClose(VectorUtil.cosine(a, b), MemorySegmentVectorUtil.cosine(a, segment, offset));
+                for (var vsf : VectorSimilarityFunction.values()) {
+                    assertClose(vsf.compare(a, b), MemorySegmentVectorUtil.compare(vsf, a, segment, offset));
+                }
+            }
+        }
+    }
+}
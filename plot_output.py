@@ -29,6 +29,18 @@ class Point:
     ef: int
     overquery: int
 
+@dataclass
+class LoadPoint:
+    pq: str
+    configuration: str
+    M: int
+    ef: int
+    overquery: int
+    load: str
+    throughput: float
+    p50: float
+    p99: float
+
 def parse_data(description, data):
     """
     Parses a given set of data lines to extract relevant information.
@@ -46,6 +58,7 @@ def parse_data(description, data):
     dataset_name = re.search(r'(\S+):', description).group(1)
 
     parsed_data = []
+    load_data = []
     current_pq = None
     M = None
     for line in data:
@@ -72,12 +85,20 @@ def parse_data(description, data):
             assert current_pq is not None
             assert M is not None
             parsed_data.append(Point(current_pq, recall, throughput, M, ef, overquery))
+        elif "  Load " in line:
+            # e.g. "  Load (disk) top 100/2 closed threads=16: qps 1234.5 p50 0.812 p90 ... p99 2.345 ... ms"
+            m = re.search(r'Load \((\w+)\) top \d+/(\d+) (.+?): qps (\d+\.\d+) p50 (\d+\.\d+) .*p99 (\d+\.\d+) ', line)
+            assert current_pq is not None
+            assert M is not None
+            load_data.append(LoadPoint(current_pq, m.group(1), M, ef, int(m.group(2)), m.group(3),
+                                       float(m.group(4)), float(m.group(5)), float(m.group(6))))
 
     return {
         'name': dataset_name,
         'base_vector_count': base_vector_count,
         'dimensions': dimensions,
-        'data': parsed_data
+        'data': parsed_data,
+        'load': load_data
     }
 
 
@@ -124,6 +145,37 @@ def plot_dataset(dataset, output_dir="."):
     # Clear the figure for the next plot
     plt.clf()
 
+def plot_load(dataset, output_dir="."):
+    """Plot p99 latency against throughput for each configuration run under load."""
+    name = dataset['name']
+    load = dataset['load']
+    if not load:
+        return
+
+    plt.figure(figsize=(15, 10))
+    series = {}
+    for p in load:
+        series.setdefault((p.pq, p.configuration, p.M, p.ef, p.overquery), []).append(p)
+    for (pq, configuration, M, ef, overquery), points in series.items():
+        points.sort(key=lambda p: p.throughput)
+        label = f'Q={pq}, {configuration}, M={M}, ef={ef}, oq={overquery}'
+        plt.plot([p.throughput for p in points], [p.p99 for p in points], marker='o', label=label)
+        for p in points:
+            plt.annotate(p.load, (p.throughput, p.p99))
+
+    plt.title(f"Dataset: {name}\\np99 latency under load")
+    plt.xlabel('Throughput (queries/s)')
+    plt.ylabel('p99 latency (ms)')
+    plt.yscale('log')
+    plt.legend(loc='upper left', bbox_to_anchor=(1, 1))
+    plt.grid(True, which='both', linestyle='--', linewidth=0.5)
+    plt.tight_layout()
+
+    filename = f"{output_dir}/{name}_latency.png"
+    plt.savefig(filename)
+    print("saved " + filename)
+    plt.clf()
+
 # Load and parse data
 with open(sys.argv[1], 'r') as file:
     content = file.read().strip().split('\n\n')
@@ -140,3 +192,4 @@ for dataset in parsed_datasets:
     dataset['data'] = filter_pareto_optimal(dataset['data'])
 for dataset in parsed_datasets:
     plot_dataset(dataset)
+    plot_load(dataset)